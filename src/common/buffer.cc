@@ -18,14 +18,22 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "buffer.h"
+#include "tag-buffer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/fatal-error.h"
 #include "ns3/test.h"
 #include "ns3/random-variable.h"
+#include "ns3/thread-local-pointer.h"
 #include <iomanip>
 #include <iostream>
 
+#if defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+  (defined (__i386__) || defined (__x86_64__))
+#define BUFFER_CHECKSUM_X86 1
+#include <immintrin.h>
+#endif
+
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
 #define LOG_INTERNAL_STATE(y)                                                                    \
@@ -71,6 +79,8 @@ namespace ns3 {
  * New user data can be safely written only outside of the "dirty
  * area" if the reference count is higher than 1 (that is, if
  * more than one Buffer instance references the same BufferData).
+ * Both the reference count and the bounds of the "dirty area" are
+ * updated atomically when they are shared.
  */
 struct BufferData {
   /* The reference count of an instance of this data structure.
@@ -95,8 +105,38 @@ struct BufferData {
 };
 typedef std::vector<struct BufferData*> BufferDataList;
 
+/**
+ * The list of segments appended by reference to a Buffer. Their
+ * bytes logically follow the byte at offset m_end of the Buffer.
+ *
+ * Multiple Buffer instances may reference the same BufferTail: it
+ * must be copied before being modified if its reference count is
+ * higher than 1. The reference count is updated atomically.
+ */
+struct BufferTail {
+  /* The reference count of an instance of this data structure.
+   */
+  uint32_t m_count;
+  /* the sum of the sizes of the segments.
+   */
+  uint32_t m_size;
+  /* The segments are never empty and never have a tail themselves.
+   */
+  std::vector<Buffer> m_segments;
+};
+
+/* Appending a Buffer smaller than this copies its bytes rather than
+ * referencing it, unless the receiving Buffer would have to be copied
+ * anyway to make room for them.
+ */
+#define BUFFER_MIN_SEGMENT_SIZE 256
+
 static struct BufferData *BufferAllocate (uint32_t reqSize);
 
+/* the number of virtual zero bytes which were copied in a BufferData.
+ */
+static uint64_t g_materializedBytes = 0;
+
 static void BufferDeallocate (struct BufferData *data);
 
 
@@ -105,67 +145,86 @@ static void BufferDeallocate (struct BufferData *data);
 namespace ns3 {
 
 #ifdef BUFFER_HEURISTICS
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+/* The free list and the heuristics are kept per thread because the
+ * threads of a MultiThreadedSimulatorImpl create and destroy buffers
+ * concurrently. A BufferData goes to the free list of the thread which
+ * releases it, which is not necessarily the one which created it.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (BufferDataList*)0)
-#define IS_DESTROYED(x) (x == (BufferDataList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED(x) && !IS_DESTROYED(x))
-#define DESTROYED ((BufferDataList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((BufferDataList*)0)
-static uint32_t g_recommendedStart = 0;
-static uint64_t g_nAddNoRealloc = 0;
-static uint64_t g_nAddRealloc = 0;
-static BufferDataList *g_freeList = 0;
-static uint32_t g_maxSize = 0;
-static uint64_t g_nAllocs = 0;
-static uint64_t g_nCreates = 0;
+struct BufferThreadState {
+  BufferDataList freeList;
+  uint32_t maxSize;
+  uint32_t recommendedStart;
+  uint64_t nAddNoRealloc;
+  uint64_t nAddRealloc;
+  uint64_t nAllocs;
+  uint64_t nCreates;
+};
+/* Set when the static destructors of this compilation unit have run:
+ * the buffers released after this point are not kept in a free list
+ * because nobody would delete them.
+ */
+static bool g_freeListDestroyed = false;
+
+static void
+DestroyThreadState (void *p)
+{
+  struct BufferThreadState *state = static_cast<struct BufferThreadState *> (p);
+  for (BufferDataList::iterator i = state->freeList.begin ();
+       i != state->freeList.end (); i++)
+    {
+      BufferDeallocate (*i);
+    }
+  delete state;
+}
+
+static struct BufferThreadState *
+GetThreadState (void)
+{
+  static ThreadLocalPointer states (&DestroyThreadState);
+  struct BufferThreadState *state = static_cast<struct BufferThreadState *> (states.Get ());
+  if (state == 0)
+    {
+      state = new BufferThreadState ();
+      states.Set (state);
+    }
+  return state;
+}
+
+static void
+UpdateRecommendedStart (uint32_t start)
+{
+  struct BufferThreadState *state = GetThreadState ();
+  state->recommendedStart = std::max (state->recommendedStart, start);
+}
 #endif /* BUFFER_HEURISTICS */
 
 static struct LocalStaticDestructor {
-  LocalStaticDestructor(void)
+  ~LocalStaticDestructor(void)
   {
-#ifdef PRINT_STATS
 #ifdef BUFFER_HEURISTICS
+    struct BufferThreadState *state = GetThreadState ();
+#ifdef PRINT_STATS
     double efficiency;
-    efficiency = g_nAllocs;
-    efficiency /= g_nCreates;
+    efficiency = state->nAllocs;
+    efficiency /= state->nCreates;
     std::cout <<"buffer free list efficiency="<<efficiency<<" (lower is better)" << std::endl;
-    std::cout <<"buffer free list max size="<<g_maxSize<<std::endl;
-    std::cout <<"buffer free list recommended start="<<g_recommendedStart<<std::endl;
+    std::cout <<"buffer free list max size="<<state->maxSize<<std::endl;
+    std::cout <<"buffer free list recommended start="<<state->recommendedStart<<std::endl;
     double addEfficiency;
-    addEfficiency = g_nAddRealloc;
-    addEfficiency /= g_nAddNoRealloc;
+    addEfficiency = state->nAddRealloc;
+    addEfficiency /= state->nAddNoRealloc;
     std::cout <<"buffer add efficiency=" << addEfficiency << " (lower is better)"<<std::endl;
-    //std::cout <<"n add reallocs="<< g_nAddRealloc << std::endl;
-    //std::cout <<"n add no reallocs="<< g_nAddNoRealloc << std::endl;
-#endif /* BUFFER_HEURISTICS */
+    //std::cout <<"n add reallocs="<< state->nAddRealloc << std::endl;
+    //std::cout <<"n add no reallocs="<< state->nAddNoRealloc << std::endl;
 #endif /* PRINT_STATS */
-    if (IS_INITIALIZED(g_freeList))
+    for (BufferDataList::iterator i = state->freeList.begin ();
+         i != state->freeList.end (); i++)
       {
-        for (BufferDataList::iterator i = g_freeList->begin ();
-             i != g_freeList->end (); i++)
-          {
-            BufferDeallocate (*i);
-          }
-        delete g_freeList;
-        g_freeList = DESTROYED;
+        BufferDeallocate (*i);
       }
+    state->freeList.clear ();
+    g_freeListDestroyed = true;
+#endif /* BUFFER_HEURISTICS */
   }
 } g_localStaticDestructor;
 
@@ -197,19 +256,18 @@ void
 Buffer::Recycle (struct BufferData *data)
 {
   NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED(g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
+  struct BufferThreadState *state = GetThreadState ();
+  state->maxSize = std::max (state->maxSize, data->m_size);
   /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED(g_freeList) ||
-      g_freeList->size () > 1000)
+  if (data->m_size < state->maxSize ||
+      g_freeListDestroyed ||
+      state->freeList.size () > 1000)
     {
       BufferDeallocate (data);
     }
   else
     {
-      NS_ASSERT (IS_INITIALIZED(g_freeList));
-      g_freeList->push_back (data);
+      state->freeList.push_back (data);
     }
 }
 
@@ -217,17 +275,14 @@ BufferData *
 Buffer::Create (uint32_t dataSize)
 {
   /* try to find a buffer correctly sized. */
-  g_nCreates++;
-  if (IS_UNINITIALIZED(g_freeList))
-    {
-      g_freeList = new BufferDataList ();
-    }
-  else if (IS_INITIALIZED(g_freeList))
+  struct BufferThreadState *state = GetThreadState ();
+  state->nCreates++;
+  if (!g_freeListDestroyed)
     {
-      while (!g_freeList->empty ()) 
+      while (!state->freeList.empty ()) 
         {
-          struct BufferData *data = g_freeList->back ();
-          g_freeList->pop_back ();
+          struct BufferData *data = state->freeList.back ();
+          state->freeList.pop_back ();
           if (data->m_size >= dataSize) 
             {
               data->m_count = 1;
@@ -236,7 +291,7 @@ Buffer::Create (uint32_t dataSize)
           BufferDeallocate (data);
         }
     }
-  g_nAllocs++;
+  state->nAllocs++;
   struct BufferData *data = BufferAllocate (dataSize);
   NS_ASSERT (data->m_count == 1);
   return data;
@@ -282,13 +337,17 @@ Buffer::CheckInternalState (void) const
     m_start <= m_data->m_size &&
     m_zeroAreaStart <= m_data->m_size;
 
-  bool ok = m_data->m_count > 0 && offsetsOk && dirtyOk && internalSizeOk;
+  bool tailOk = m_tail == 0 ||
+    (m_tail->m_count > 0 && m_tail->m_size > 0);
+
+  bool ok = m_data->m_count > 0 && offsetsOk && dirtyOk && internalSizeOk && tailOk;
   if (!ok)
     {
       LOG_INTERNAL_STATE ("check " << this << 
                           ", " << (offsetsOk?"true":"false") << 
                           ", " << (dirtyOk?"true":"false") << 
-                          ", " << (internalSizeOk?"true":"false") << " ");
+                          ", " << (internalSizeOk?"true":"false") << 
+                          ", " << (tailOk?"true":"false") << " ");
     }
   return ok;
 }
@@ -298,8 +357,9 @@ Buffer::Initialize (uint32_t zeroSize)
 {
   NS_LOG_FUNCTION (this << zeroSize);
   m_data = Buffer::Create (0);
+  m_tail = 0;
 #ifdef BUFFER_HEURISTICS
-  m_start = std::min (m_data->m_size, g_recommendedStart);
+  m_start = std::min (m_data->m_size, GetThreadState ()->recommendedStart);
   m_maxZeroAreaStart = m_start;
 #else
   m_start = 0;
@@ -314,6 +374,7 @@ Buffer::Initialize (uint32_t zeroSize)
 
 Buffer::Buffer (Buffer const&o)
   : m_data (o.m_data),
+    m_tail (o.m_tail),
 #ifdef BUFFER_HEURISTICS
     m_maxZeroAreaStart (o.m_zeroAreaStart),
 #endif
@@ -323,7 +384,11 @@ Buffer::Buffer (Buffer const&o)
     m_end (o.m_end)
 {
   NS_LOG_FUNCTION (this << &o);
-  m_data->m_count++;
+  __sync_add_and_fetch (&m_data->m_count, 1);
+  if (m_tail != 0)
+    {
+      __sync_add_and_fetch (&m_tail->m_count, 1);
+    }
   NS_ASSERT (CheckInternalState ());
 }
 
@@ -335,16 +400,24 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
         {
           Recycle (m_data);
         }
       m_data = o.m_data;
-      m_data->m_count++;
+      __sync_add_and_fetch (&m_data->m_count, 1);
+    }
+  if (m_tail != o.m_tail)
+    {
+      if (o.m_tail != 0)
+        {
+          __sync_add_and_fetch (&o.m_tail->m_count, 1);
+        }
+      ReleaseTail ();
+      m_tail = o.m_tail;
     }
   HEURISTICS (
-  g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
+  UpdateRecommendedStart (m_maxZeroAreaStart);
   m_maxZeroAreaStart = o.m_maxZeroAreaStart;
   );
   m_zeroAreaStart = o.m_zeroAreaStart;
@@ -359,19 +432,31 @@ Buffer::~Buffer ()
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
-  HEURISTICS (g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart));
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  HEURISTICS (UpdateRecommendedStart (m_maxZeroAreaStart));
+  if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
     {
       Recycle (m_data);
     }
+  ReleaseTail ();
 }
 
 uint32_t 
 Buffer::GetSize (void) const
 {
   NS_ASSERT (CheckInternalState ());
-  return m_end - m_start;
+  return m_end - m_start + GetTailSize ();
+}
+
+uint64_t
+Buffer::GetMaterializedBytes (void)
+{
+  return g_materializedBytes;
+}
+
+uint32_t
+Buffer::GetSegmentCount (void) const
+{
+  return 1 + (m_tail == 0 ? 0 : m_tail->m_segments.size ());
 }
 
 Buffer::Iterator 
@@ -397,6 +482,90 @@ Buffer::GetInternalEnd (void) const
 {
   return m_end - (m_zeroAreaEnd - m_zeroAreaStart);
 }
+uint32_t
+Buffer::GetTailSize (void) const
+{
+  return m_tail == 0 ? 0 : m_tail->m_size;
+}
+
+void
+Buffer::ReleaseTail (void)
+{
+  if (m_tail == 0)
+    {
+      return;
+    }
+  if (__sync_sub_and_fetch (&m_tail->m_count, 1) == 0)
+    {
+      delete m_tail;
+    }
+  m_tail = 0;
+}
+
+struct BufferTail *
+Buffer::GetWritableTail (void)
+{
+  if (m_tail == 0)
+    {
+      m_tail = new BufferTail ();
+      m_tail->m_count = 1;
+      m_tail->m_size = 0;
+    }
+  else if (m_tail->m_count > 1)
+    {
+      struct BufferTail *tail = new BufferTail (*m_tail);
+      tail->m_count = 1;
+      ReleaseTail ();
+      m_tail = tail;
+    }
+  return m_tail;
+}
+
+void
+Buffer::AppendSegments (const Buffer &o)
+{
+  NS_ASSERT (&o != this);
+  struct BufferTail *tail = GetWritableTail ();
+  if (o.m_end != o.m_start)
+    {
+      Buffer head = o;
+      head.ReleaseTail ();
+      tail->m_segments.push_back (head);
+      tail->m_size += head.GetSize ();
+    }
+  if (o.m_tail != 0)
+    {
+      tail->m_segments.insert (tail->m_segments.end (),
+                               o.m_tail->m_segments.begin (),
+                               o.m_tail->m_segments.end ());
+      tail->m_size += o.m_tail->m_size;
+    }
+}
+
+void
+Buffer::GetAreas (AreaList &areas) const
+{
+  if (m_zeroAreaStart != m_start)
+    {
+      areas.push_back (std::make_pair (m_data->m_data + m_start, m_zeroAreaStart - m_start));
+    }
+  if (m_zeroAreaEnd != m_zeroAreaStart)
+    {
+      areas.push_back (std::make_pair ((const uint8_t *)0, m_zeroAreaEnd - m_zeroAreaStart));
+    }
+  if (m_end != m_zeroAreaEnd)
+    {
+      areas.push_back (std::make_pair (m_data->m_data + m_zeroAreaStart, m_end - m_zeroAreaEnd));
+    }
+  if (m_tail != 0)
+    {
+      for (std::vector<Buffer>::const_iterator i = m_tail->m_segments.begin ();
+           i != m_tail->m_segments.end (); i++)
+        {
+          i->GetAreas (areas);
+        }
+    }
+}
 
 bool
 Buffer::AddAtStart (uint32_t start)
@@ -404,34 +573,48 @@ Buffer::AddAtStart (uint32_t start)
   NS_LOG_FUNCTION (this << start);
   bool dirty;
   NS_ASSERT (CheckInternalState ());
-  bool isDirty = m_data->m_count > 1 && m_start > m_data->m_dirtyStart;
-  if (m_start >= start && !isDirty)
+  if (m_start >= start && m_data->m_count == 1)
     {
-      /* enough space in the buffer and not dirty. 
+      /* enough space in the buffer and not shared.
        * To add: |..|
        * Before: |*****---------***|
        * After:  |***..---------***|
        */
-      NS_ASSERT (m_data->m_count == 1 || m_start == m_data->m_dirtyStart);
       m_start -= start;
       dirty = m_start > m_data->m_dirtyStart;
       // update dirty area
       m_data->m_dirtyStart = m_start;
-      HEURISTICS (g_nAddNoRealloc++);
+      HEURISTICS (GetThreadState ()->nAddNoRealloc++);
     } 
+  else if (m_start >= start &&
+           __sync_bool_compare_and_swap (&m_data->m_dirtyStart, m_start, m_start - start))
+    {
+      /* enough space in the buffer and not dirty: the dirty area was
+       * extended in front of m_start atomically because the other
+       * buffers which share m_data might be used by other threads.
+       */
+      m_start -= start;
+      dirty = false;
+      HEURISTICS (GetThreadState ()->nAddNoRealloc++);
+    }
   else
     {
-      uint32_t newSize = GetInternalSize () + start;
+      /* Leave as much room in front of the new bytes as the largest
+       * headers seen so far, to not copy the buffer again when the
+       * next header is added.
+       */
+      uint32_t headroom = start;
+      HEURISTICS (headroom = std::max (start, GetThreadState ()->recommendedStart));
+      uint32_t newSize = GetInternalSize () + headroom;
       struct BufferData *newData = Buffer::Create (newSize);
-      memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
+      memcpy (newData->m_data + headroom, m_data->m_data + m_start, GetInternalSize ());
+      if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
         {
           Buffer::Recycle (m_data);
         }
       m_data = newData;
 
-      int32_t delta = start - m_start;
+      int32_t delta = headroom - m_start;
       m_start += delta;
       m_zeroAreaStart += delta;
       m_zeroAreaEnd += delta;
@@ -444,7 +627,7 @@ Buffer::AddAtStart (uint32_t start)
 
       dirty = true;
 
-      HEURISTICS (g_nAddRealloc++);
+      HEURISTICS (GetThreadState ()->nAddRealloc++);
     }
   HEURISTICS (m_maxZeroAreaStart = std::max (m_maxZeroAreaStart, m_zeroAreaStart));
   LOG_INTERNAL_STATE ("add start=" << start << ", ");
@@ -457,30 +640,48 @@ Buffer::AddAtEnd (uint32_t end)
   NS_LOG_FUNCTION (this << end);
   bool dirty;
   NS_ASSERT (CheckInternalState ());
-  bool isDirty = m_data->m_count > 1 && m_end < m_data->m_dirtyEnd;
-  if (GetInternalEnd () + end <= m_data->m_size && !isDirty)
+  if (m_tail != 0)
+    {
+      /* the new bytes follow the last segment: only this segment
+       * might have to be copied to make room for them.
+       */
+      struct BufferTail *tail = GetWritableTail ();
+      dirty = tail->m_segments.back ().AddAtEnd (end);
+      tail->m_size += end;
+      LOG_INTERNAL_STATE ("add end=" << end << ", ");
+      NS_ASSERT (CheckInternalState ());
+      return dirty;
+    }
+  uint32_t internalEnd = GetInternalEnd ();
+  if (internalEnd + end <= m_data->m_size && m_data->m_count == 1)
     {
-      /* enough space in buffer and not dirty
+      /* enough space in buffer and not shared
        * Add:    |...|
        * Before: |**----*****|
        * After:  |**----...**|
        */
-      NS_ASSERT (m_data->m_count == 1 || m_end == m_data->m_dirtyEnd);
       m_end += end;
       // update dirty area.
       m_data->m_dirtyEnd = m_end;
 
       dirty = m_end < m_data->m_dirtyEnd;
 
-      HEURISTICS (g_nAddNoRealloc++);
+      HEURISTICS (GetThreadState ()->nAddNoRealloc++);
     } 
+  else if (internalEnd + end <= m_data->m_size &&
+           __sync_bool_compare_and_swap (&m_data->m_dirtyEnd, m_end, m_end + end))
+    {
+      /* enough space in buffer and not dirty: see AddAtStart. */
+      m_end += end;
+      dirty = false;
+      HEURISTICS (GetThreadState ()->nAddNoRealloc++);
+    }
   else
     {
       uint32_t newSize = GetInternalSize () + end;
       struct BufferData *newData = Buffer::Create (newSize);
       memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
         {
           Buffer::Recycle (m_data);
         }
@@ -499,7 +700,7 @@ Buffer::AddAtEnd (uint32_t end)
 
       dirty = true;
 
-      HEURISTICS (g_nAddRealloc++);
+      HEURISTICS (GetThreadState ()->nAddRealloc++);
     } 
   HEURISTICS (m_maxZeroAreaStart = std::max (m_maxZeroAreaStart, m_zeroAreaStart));
   LOG_INTERNAL_STATE ("add end=" << end << ", ");
@@ -512,9 +713,11 @@ void
 Buffer::AddAtEnd (const Buffer &o)
 {
   NS_LOG_FUNCTION (this << &o);
-  if (m_data->m_count == 1 &&
+  if (m_tail == 0 &&
+      m_data->m_count == 1 &&
       m_end == m_zeroAreaEnd &&
       m_end == m_data->m_dirtyEnd &&
+      o.m_tail == 0 &&
       o.m_start == o.m_zeroAreaStart &&
       o.m_zeroAreaEnd - o.m_zeroAreaStart > 0)
     {
@@ -538,22 +741,82 @@ Buffer::AddAtEnd (const Buffer &o)
       return;
     }
 
-  Buffer dst = CreateFullCopy ();
-  Buffer src = o.CreateFullCopy ();
+  uint32_t size = o.GetSize ();
+  if (size == 0)
+    {
+      return;
+    }
+  bool inPlace = GetInternalEnd () + size <= m_data->m_size &&
+    (m_data->m_count == 1 || m_end == m_data->m_dirtyEnd);
+  if (m_tail == 0 && size < BUFFER_MIN_SEGMENT_SIZE &&
+      o.m_tail == 0 && o.m_zeroAreaStart == o.m_zeroAreaEnd &&
+      (inPlace || GetInternalSize () < BUFFER_MIN_SEGMENT_SIZE))
+    {
+      /* copying a few real bytes is cheaper than merging segments later.
+       * o might be this buffer so it must be read after AddAtEnd,
+       * from its original size.
+       */
+      AddAtEnd (size);
+      o.CopyData (m_data->m_data + GetInternalEnd () - size, size);
+      NS_ASSERT (CheckInternalState ());
+      return;
+    }
 
-  dst.AddAtEnd (src.GetSize ());
-  Buffer::Iterator destStart = dst.End ();
-  destStart.Prev (src.GetSize ());
-  destStart.Write (src.Begin (), src.End ());
-  *this = dst;
+  // o might be this buffer or share our tail.
+  Buffer src = o;
+  AppendSegments (src);
+  LOG_INTERNAL_STATE ("add segments=" << size << ", ");
   NS_ASSERT (CheckInternalState ());
 }
 
+void
+Buffer::RemoveSegmentsAtStart (uint32_t start)
+{
+  NS_ASSERT (m_tail != 0 && start < m_tail->m_size);
+  /* The head and the first segments go away: the segment which
+   * holds the new first byte becomes the head of this buffer.
+   */
+  struct BufferTail *tail = GetWritableTail ();
+  m_tail = 0;
+  std::vector<Buffer>::iterator i = tail->m_segments.begin ();
+  while (start >= i->GetSize ())
+    {
+      start -= i->GetSize ();
+      tail->m_size -= i->GetSize ();
+      i++;
+    }
+  Buffer head = *i;
+  tail->m_size -= head.GetSize ();
+  tail->m_segments.erase (tail->m_segments.begin (), i + 1);
+  head.RemoveAtStart (start);
+  *this = head;
+  if (tail->m_segments.empty ())
+    {
+      delete tail;
+    }
+  else
+    {
+      m_tail = tail;
+    }
+}
+
 void 
 Buffer::RemoveAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   NS_ASSERT (CheckInternalState ());
+  if (m_tail != 0 && start > m_end - m_start)
+    {
+      uint32_t tailStart = start - (m_end - m_start);
+      if (tailStart < m_tail->m_size)
+        {
+          RemoveSegmentsAtStart (tailStart);
+          LOG_INTERNAL_STATE ("rem start=" << start << ", ");
+          NS_ASSERT (CheckInternalState ());
+          return;
+        }
+      ReleaseTail ();
+    }
   uint32_t newStart = m_start + start;
   if (newStart <= m_zeroAreaStart)
     {
@@ -599,6 +862,34 @@ Buffer::RemoveAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   NS_ASSERT (CheckInternalState ());
+  if (m_tail != 0)
+    {
+      if (end < m_tail->m_size)
+        {
+          struct BufferTail *tail = GetWritableTail ();
+          uint32_t left = end;
+          while (left > 0)
+            {
+              Buffer &last = tail->m_segments.back ();
+              uint32_t size = std::min (left, last.GetSize ());
+              if (size == last.GetSize ())
+                {
+                  tail->m_segments.pop_back ();
+                }
+              else
+                {
+                  last.RemoveAtEnd (size);
+                }
+              tail->m_size -= size;
+              left -= size;
+            }
+          LOG_INTERNAL_STATE ("rem end=" << end << ", ");
+          NS_ASSERT (CheckInternalState ());
+          return;
+        }
+      end -= m_tail->m_size;
+      ReleaseTail ();
+    }
   uint32_t newEnd = m_end - std::min (end, m_end - m_start);
   if (newEnd > m_zeroAreaEnd)
     {
@@ -636,8 +927,9 @@ Buffer::CreateFragment (uint32_t start, uint32_t length) const
   NS_LOG_FUNCTION (this << start << length);
   NS_ASSERT (CheckInternalState ());
   Buffer tmp = *this;
-  tmp.RemoveAtStart (start);
+  // removing the end first drops the unused segments without copying the tail.
   tmp.RemoveAtEnd (GetSize () - (start + length));
+  tmp.RemoveAtStart (start);
   NS_ASSERT (CheckInternalState ());
   return tmp;
 }
@@ -647,19 +939,21 @@ Buffer::CreateFullCopy (void) const
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
-  if (m_zeroAreaEnd - m_zeroAreaStart != 0) 
+  if (m_zeroAreaEnd - m_zeroAreaStart != 0 || m_tail != 0) 
     {
+      AreaList areas;
+      GetAreas (areas);
+      for (AreaList::const_iterator i = areas.begin (); i != areas.end (); i++)
+        {
+          if (i->first == 0)
+            {
+              __sync_add_and_fetch (&g_materializedBytes, i->second);
+            }
+        }
       Buffer tmp;
-      tmp.AddAtStart (m_zeroAreaEnd - m_zeroAreaStart);
-      tmp.Begin ().WriteU8 (0, m_zeroAreaEnd - m_zeroAreaStart);
-      uint32_t dataStart = m_zeroAreaStart - m_start;
-      tmp.AddAtStart (dataStart);
-      tmp.Begin ().Write (m_data->m_data+m_start, dataStart);
-      uint32_t dataEnd = m_end - m_zeroAreaEnd;
-      tmp.AddAtEnd (dataEnd);
-      Buffer::Iterator i = tmp.End ();
-      i.Prev (dataEnd);
-      i.Write (m_data->m_data+m_zeroAreaStart,dataEnd);
+      uint32_t size = GetSize ();
+      tmp.AddAtStart (size);
+      CopyData (tmp.m_data->m_data + tmp.m_start, size);
       NS_ASSERT (tmp.CheckInternalState ());
       return tmp;
     }
@@ -667,6 +961,120 @@ Buffer::CreateFullCopy (void) const
   return *this;
 }
 
+/* The serialized form of a Buffer is the number of runs, the length
+ * of each run, whose top bit is set for a run of virtual zero bytes,
+ * and then the content of the runs of real bytes.
+ */
+#define BUFFER_SERIALIZED_ZERO_RUN 0x80000000
+
+uint32_t
+Buffer::GetSerializedSize (void) const
+{
+  AreaList areas;
+  GetAreas (areas);
+  uint32_t size = 4;
+  for (AreaList::const_iterator i = areas.begin (); i != areas.end (); i++)
+    {
+      size += 4;
+      if (i->first != 0)
+        {
+          size += i->second;
+        }
+    }
+  return size;
+}
+
+void
+Buffer::Serialize (TagBuffer &buffer) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (CheckInternalState ());
+  AreaList areas;
+  GetAreas (areas);
+  buffer.WriteU32 (areas.size ());
+  for (AreaList::const_iterator i = areas.begin (); i != areas.end (); i++)
+    {
+      NS_ASSERT (i->second < BUFFER_SERIALIZED_ZERO_RUN);
+      buffer.WriteU32 (i->first != 0 ? i->second : (i->second | BUFFER_SERIALIZED_ZERO_RUN));
+    }
+  for (AreaList::const_iterator i = areas.begin (); i != areas.end (); i++)
+    {
+      if (i->first != 0)
+        {
+          buffer.Write (i->first, i->second);
+        }
+    }
+}
+
+void
+Buffer::Deserialize (TagBuffer &buffer)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t n = buffer.ReadU32 ();
+  std::vector<uint32_t> runs;
+  runs.reserve (n);
+  /* The runs written for a buffer without segments are at most a run
+   * of real bytes, a run of zero bytes and another run of real bytes:
+   * such a buffer is rebuilt in a single BufferData.
+   */
+  uint32_t headSize = 0;
+  uint32_t zeroSize = 0;
+  uint32_t endSize = 0;
+  bool seenZero = false;
+  bool simple = true;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t run = buffer.ReadU32 ();
+      runs.push_back (run);
+      uint32_t length = run & ~BUFFER_SERIALIZED_ZERO_RUN;
+      if (run & BUFFER_SERIALIZED_ZERO_RUN)
+        {
+          simple = simple && !seenZero && endSize == 0;
+          seenZero = true;
+          zeroSize = length;
+        }
+      else if (i == 0)
+        {
+          headSize = length;
+        }
+      else
+        {
+          simple = simple && seenZero && endSize == 0;
+          endSize = length;
+        }
+    }
+  if (simple)
+    {
+      Buffer tmp = Buffer (zeroSize);
+      tmp.AddAtStart (headSize);
+      buffer.Read (tmp.m_data->m_data + tmp.m_start, headSize);
+      tmp.AddAtEnd (endSize);
+      buffer.Read (tmp.m_data->m_data + tmp.m_end - (tmp.m_zeroAreaEnd - tmp.m_zeroAreaStart) - endSize,
+                   endSize);
+      NS_ASSERT (tmp.CheckInternalState ());
+      *this = tmp;
+      return;
+    }
+  Buffer tmp;
+  for (std::vector<uint32_t>::const_iterator i = runs.begin (); i != runs.end (); i++)
+    {
+      uint32_t length = *i & ~BUFFER_SERIALIZED_ZERO_RUN;
+      if (*i & BUFFER_SERIALIZED_ZERO_RUN)
+        {
+          tmp.AddAtEnd (Buffer (length));
+        }
+      else
+        {
+          Buffer piece;
+          piece.AddAtStart (length);
+          buffer.Read (piece.m_data->m_data + piece.m_start, length);
+          tmp.AddAtEnd (piece);
+        }
+    }
+  NS_ASSERT (tmp.CheckInternalState ());
+  *this = tmp;
+}
+
 int32_t 
 Buffer::GetCurrentStartOffset (void) const
 {
@@ -675,7 +1083,7 @@ Buffer::GetCurrentStartOffset (void) const
 int32_t 
 Buffer::GetCurrentEndOffset (void) const
 {
-  return m_end;
+  return m_end + GetTailSize ();
 }
 
 
@@ -701,61 +1109,63 @@ Buffer::PeekData (void) const
 void
 Buffer::CopyData(std::ostream *os, uint32_t size) const
 {
-  if (size > 0)
+  uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
+  os->write((const char*)(m_data->m_data + m_start), tmpsize);
+  size -= tmpsize;
+  tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
+  size -= tmpsize;
+  while (tmpsize > 0)
     {
-      uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
-      os->write((const char*)(m_data->m_data + m_start), tmpsize);
-      if (size > tmpsize) 
-        { 
-          size -= m_zeroAreaStart-m_start;
-          tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
-          uint32_t left = tmpsize;
-          while (left > 0)
-            {
-              uint32_t toWrite = std::min (left, g_zeroes.size);
-              os->write (g_zeroes.buffer, toWrite);
-              left -= toWrite;
-            }
-          if (size > tmpsize)
-            {
-              size -= tmpsize;
-              tmpsize = std::min (m_end - m_zeroAreaEnd, size);
-              os->write ((const char*)(m_data->m_data + m_zeroAreaStart), tmpsize); 
-            }
+      uint32_t toWrite = std::min (tmpsize, g_zeroes.size);
+      os->write (g_zeroes.buffer, toWrite);
+      tmpsize -= toWrite;
+    }
+  tmpsize = std::min (m_end - m_zeroAreaEnd, size);
+  os->write ((const char*)(m_data->m_data + m_zeroAreaStart), tmpsize); 
+  size -= tmpsize;
+  if (m_tail != 0)
+    {
+      for (std::vector<Buffer>::const_iterator i = m_tail->m_segments.begin ();
+           i != m_tail->m_segments.end () && size > 0; i++)
+        {
+          tmpsize = std::min (i->GetSize (), size);
+          i->CopyData (os, tmpsize);
+          size -= tmpsize;
         }
     }
 }
 
+uint32_t
+Buffer::CopyHeadData (uint8_t *buffer, uint32_t size) const
+{
+  uint32_t originalSize = size;
+  uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
+  memcpy (buffer, (const char*)(m_data->m_data + m_start), tmpsize);
+  buffer += tmpsize;
+  size -= tmpsize;
+  tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
+  memset (buffer, 0, tmpsize);
+  buffer += tmpsize;
+  size -= tmpsize;
+  tmpsize = std::min (m_end - m_zeroAreaEnd, size);
+  memcpy (buffer, (const char*)(m_data->m_data + m_zeroAreaStart), tmpsize);
+  size -= tmpsize;
+  return originalSize - size;
+}
+
 uint32_t 
 Buffer::CopyData (uint8_t *buffer, uint32_t size) const
 {
-  uint32_t originalSize = size;
-  if (size > 0)
-    {
-      uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
-      memcpy (buffer, (const char*)(m_data->m_data + m_start), tmpsize);
-      buffer += tmpsize;
-      if (size > tmpsize) 
-        { 
-          size -= m_zeroAreaStart-m_start;
-          tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
-          uint32_t left = tmpsize;
-          while (left > 0)
-            {
-              uint32_t toWrite = std::min (left, g_zeroes.size);
-              memcpy (buffer, g_zeroes.buffer, toWrite);
-              left -= toWrite;
-              buffer += toWrite;
-            }
-          if (size > tmpsize)
-            {
-              size -= tmpsize;
-              tmpsize = std::min (m_end - m_zeroAreaEnd, size);
-              memcpy (buffer, (const char*)(m_data->m_data + m_zeroAreaStart), tmpsize);
-            }
+  uint32_t copied = CopyHeadData (buffer, size);
+  if (m_tail != 0)
+    {
+      for (std::vector<Buffer>::const_iterator i = m_tail->m_segments.begin ();
+           i != m_tail->m_segments.end () && copied < size; i++)
+        {
+          copied += i->CopyHeadData (buffer + copied, size - copied);
         }
     }
-  return originalSize - size;
+  return copied;
 }
 
 /******************************************************
@@ -768,7 +1178,12 @@ Buffer::Iterator::Iterator ()
     m_zeroEnd (0),
     m_dataStart (0),
     m_dataEnd (0),
+    m_tailStart (0),
     m_current (0),
+    m_tail (0),
+    m_segment (0),
+    m_segmentStart (0),
+    m_segmentEnd (0),
     m_data (0)
 {}
 Buffer::Iterator::Iterator (Buffer const*buffer)
@@ -788,10 +1203,57 @@ Buffer::Iterator::Construct (const Buffer *buffer)
   m_zeroStart = buffer->m_zeroAreaStart;
   m_zeroEnd = buffer->m_zeroAreaEnd;
   m_dataStart = buffer->m_start;
-  m_dataEnd = buffer->m_end;
+  m_dataEnd = buffer->m_end + buffer->GetTailSize ();
+  m_tailStart = buffer->m_end;
+  m_tail = buffer->m_tail;
+  m_segment = 0;
+  m_segmentStart = m_tailStart;
+  m_segmentEnd = m_tailStart + (m_tail != 0 ? m_tail->m_segments[0].GetSize () : 0);
   m_data = buffer->m_data->m_data;
 }
 
+Buffer::Iterator
+Buffer::Iterator::GetTailIterator (uint32_t *left)
+{
+  NS_ASSERT (m_tail != 0 && m_current >= m_tailStart && m_current < m_dataEnd);
+  if (m_current < m_segmentStart)
+    {
+      // moving backward: search again from the first segment.
+      m_segment = 0;
+      m_segmentStart = m_tailStart;
+      m_segmentEnd = m_tailStart + m_tail->m_segments[0].GetSize ();
+    }
+  while (m_current >= m_segmentEnd)
+    {
+      m_segment++;
+      m_segmentStart = m_segmentEnd;
+      m_segmentEnd += m_tail->m_segments[m_segment].GetSize ();
+    }
+  // a segment has no tail: its iterator never comes back here.
+  Iterator segment = m_tail->m_segments[m_segment].Begin ();
+  segment.Next (m_current - m_segmentStart);
+  *left = m_segmentEnd - m_current;
+  return segment;
+}
+
+uint8_t
+Buffer::Iterator::ReadTailU8 (void)
+{
+  uint32_t left;
+  Iterator segment = GetTailIterator (&left);
+  m_current++;
+  return segment.ReadU8 ();
+}
+
+void
+Buffer::Iterator::WriteTailU8 (uint8_t data)
+{
+  uint32_t left;
+  Iterator segment = GetTailIterator (&left);
+  m_current++;
+  segment.WriteU8 (data);
+}
+
 void 
 Buffer::Iterator::Next (void)
 {
@@ -1149,17 +1611,205 @@ Buffer::Iterator::CalculateIpChecksum(uint16_t size)
   return CalculateIpChecksum(size, 0);
 }
 
+/* The checksum kernels below return the ones' complement sum of the
+ * 16 bit words of an area, read in host byte order, with an odd last
+ * byte padded with a zero byte. The sum is not folded: see RFC 1071
+ * for why the words can be added in any order and with any width as
+ * long as the carries are added back.
+ */
+static uint64_t
+ChecksumPortable (const uint8_t *data, uint32_t size)
+{
+  uint64_t sum = 0;
+  while (size >= 8)
+    {
+      uint64_t word;
+      memcpy (&word, data, 8);
+      sum += word;
+      sum += (sum < word);
+      data += 8;
+      size -= 8;
+    }
+  // sum is at most 2^64-1 here: adding less than 2^32 cannot overflow twice.
+  uint64_t tail = 0;
+  if (size >= 4)
+    {
+      uint32_t word;
+      memcpy (&word, data, 4);
+      tail += word;
+      data += 4;
+      size -= 4;
+    }
+  if (size >= 2)
+    {
+      uint16_t word;
+      memcpy (&word, data, 2);
+      tail += word;
+      data += 2;
+      size -= 2;
+    }
+  if (size == 1)
+    {
+      uint8_t last[2] = {data[0], 0};
+      uint16_t word;
+      memcpy (&word, last, 2);
+      tail += word;
+    }
+  sum += tail;
+  sum += (sum < tail);
+  return sum;
+}
+
+#if defined (BUFFER_CHECKSUM_X86)
+__attribute__ ((target ("sse2")))
+static uint64_t
+ChecksumSse2 (const uint8_t *data, uint32_t size)
+{
+  // each 64 bit lane accumulates 32 bit words: it cannot overflow
+  // for an area smaller than 4GB.
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i a = zero;
+  __m128i b = zero;
+  while (size >= 16)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *)data);
+      a = _mm_add_epi64 (a, _mm_unpacklo_epi32 (v, zero));
+      b = _mm_add_epi64 (b, _mm_unpackhi_epi32 (v, zero));
+      data += 16;
+      size -= 16;
+    }
+  uint64_t lanes[2];
+  _mm_storeu_si128 ((__m128i *)lanes, _mm_add_epi64 (a, b));
+  uint64_t sum = lanes[0] + lanes[1];
+  uint64_t tail = ChecksumPortable (data, size);
+  sum += tail;
+  sum += (sum < tail);
+  return sum;
+}
+
+__attribute__ ((target ("avx2")))
+static uint64_t
+ChecksumAvx2 (const uint8_t *data, uint32_t size)
+{
+  __m256i zero = _mm256_setzero_si256 ();
+  __m256i a = zero;
+  __m256i b = zero;
+  while (size >= 32)
+    {
+      __m256i v = _mm256_loadu_si256 ((const __m256i *)data);
+      a = _mm256_add_epi64 (a, _mm256_unpacklo_epi32 (v, zero));
+      b = _mm256_add_epi64 (b, _mm256_unpackhi_epi32 (v, zero));
+      data += 32;
+      size -= 32;
+    }
+  uint64_t lanes[4];
+  _mm256_storeu_si256 ((__m256i *)lanes, _mm256_add_epi64 (a, b));
+  uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  uint64_t tail = ChecksumPortable (data, size);
+  sum += tail;
+  sum += (sum < tail);
+  return sum;
+}
+#endif /* BUFFER_CHECKSUM_X86 */
+
+typedef uint64_t (*ChecksumKernel) (const uint8_t *data, uint32_t size);
+
+static ChecksumKernel
+SelectChecksumKernel (void)
+{
+#if defined (BUFFER_CHECKSUM_X86)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      return &ChecksumAvx2;
+    }
+  if (__builtin_cpu_supports ("sse2"))
+    {
+      return &ChecksumSse2;
+    }
+#endif /* BUFFER_CHECKSUM_X86 */
+  return &ChecksumPortable;
+}
+
+static ChecksumKernel g_checksumKernel = SelectChecksumKernel ();
+
+/* Fold a sum of host byte order words into the 16 bit word which
+ * ReadU16 would have read, that is, in little endian byte order.
+ * The sum of an area which starts at an odd offset from the start of
+ * the checksummed range is byte-swapped, as described in section 2.(B)
+ * of RFC 1071.
+ */
+static uint16_t
+FoldChecksum (uint64_t sum, bool swap)
+{
+  sum = (sum & 0xffffffff) + (sum >> 32);
+  sum = (sum & 0xffffffff) + (sum >> 32);
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+  uint16_t one = 1;
+  bool bigEndian = *(uint8_t *)&one == 0;
+  if (swap != bigEndian)
+    {
+      sum = ((sum >> 8) | (sum << 8)) & 0xffff;
+    }
+  return sum;
+}
+
+/* Sum the bytes from the current position to end, which is not
+ * after the first segment, and move there. The parity of the offset
+ * of each area from start tells whether its sum must be swapped.
+ */
+uint32_t
+Buffer::Iterator::SumArea (uint32_t end, uint32_t start)
+{
+  NS_ASSERT (end <= m_tailStart);
+  uint32_t sum = 0;
+  if (m_current < m_zeroStart)
+    {
+      uint32_t areaEnd = std::min (end, m_zeroStart);
+      bool odd = ((m_current - start) & 1) == 1;
+      sum += FoldChecksum (g_checksumKernel (&m_data[m_current], areaEnd - m_current), odd);
+      m_current = areaEnd;
+    }
+  if (m_current < m_zeroEnd)
+    {
+      // the zero area does not change the sum.
+      m_current = std::min (end, m_zeroEnd);
+    }
+  if (m_current < end)
+    {
+      bool odd = ((m_current - start) & 1) == 1;
+      sum += FoldChecksum (g_checksumKernel (&m_data[m_current - (m_zeroEnd - m_zeroStart)],
+                                             end - m_current), odd);
+      m_current = end;
+    }
+  return sum;
+}
+
 uint16_t
 Buffer::Iterator::CalculateIpChecksum(uint16_t size, uint32_t initialChecksum)
 {
   /* see RFC 1071 to understand this code. */
+  NS_ASSERT (m_current >= m_dataStart &&
+             m_current + size <= m_dataEnd);
+  uint32_t start = m_current;
+  uint32_t end = m_current + size;
   uint32_t sum = initialChecksum;
 
-  for (int j = 0; j < size/2; j++)
-    sum += ReadU16 ();
-
-  if (size & 1)
-     sum += ReadU8 ();
+  if (m_current < m_tailStart)
+    {
+      sum += SumArea (std::min (end, m_tailStart), start);
+    }
+  while (m_current < end)
+    {
+      // the offsets of a segment iterator differ from ours: only
+      // the parity of the offsets from start matters.
+      uint32_t left;
+      Iterator segment = GetTailIterator (&left);
+      uint32_t n = std::min (left, end - m_current);
+      sum += segment.SumArea (segment.m_current + n, segment.m_current - (m_current - start));
+      m_current += n;
+    }
 
   while (sum >> 16)
     sum = (sum & 0xffff) + (sum >> 16);
@@ -1471,6 +2121,348 @@ BufferTest::DoRun (void)
   return GetErrorStatus ();
 }
 //-----------------------------------------------------------------------------
+class BufferSegmentTest : public TestCase
+{
+public:
+  BufferSegmentTest ();
+private:
+  virtual bool DoRun (void);
+  Buffer CreateBuffer (uint32_t size, uint8_t first);
+  void Check (const Buffer &buffer, const std::vector<uint8_t> &expected, int line);
+};
+
+BufferSegmentTest::BufferSegmentTest ()
+  : TestCase ("Buffer segments")
+{}
+
+Buffer
+BufferSegmentTest::CreateBuffer (uint32_t size, uint8_t first)
+{
+  Buffer buffer;
+  buffer.AddAtStart (size);
+  Buffer::Iterator i = buffer.Begin ();
+  for (uint32_t j = 0; j < size; j++)
+    {
+      i.WriteU8 (first + j);
+    }
+  return buffer;
+}
+
+void
+BufferSegmentTest::Check (const Buffer &buffer, const std::vector<uint8_t> &expected, int line)
+{
+  NS_TEST_EXPECT_MSG_EQ_INTERNAL (buffer.GetSize (), expected.size (), "wrong size", __FILE__, line);
+  std::vector<uint8_t> got (expected.size () + 1, 0xff);
+  uint32_t copied = buffer.CopyData (&got[0], got.size ());
+  NS_TEST_EXPECT_MSG_EQ_INTERNAL (copied, expected.size (), "wrong copied size", __FILE__, line);
+  got.resize (expected.size ());
+  NS_TEST_EXPECT_MSG_EQ_INTERNAL ((got == expected), true, "wrong content", __FILE__, line);
+}
+
+bool
+BufferSegmentTest::DoRun (void)
+{
+  Buffer a = CreateBuffer (1000, 0);
+  Buffer b = CreateBuffer (600, 100);
+  Buffer z = Buffer (700);
+  std::vector<uint8_t> expected;
+  for (uint32_t j = 0; j < 1000; j++)
+    {
+      expected.push_back (j);
+    }
+  for (uint32_t j = 0; j < 600; j++)
+    {
+      expected.push_back (100 + j);
+    }
+  expected.resize (2300, 0);
+
+  // appending large buffers references them
+  Buffer c = a;
+  c.AddAtEnd (b);
+  c.AddAtEnd (z);
+  NS_TEST_EXPECT_MSG_EQ (c.GetSegmentCount (), 3, "large buffers are not copied");
+  NS_TEST_EXPECT_MSG_EQ (c.GetCurrentEndOffset () - c.GetCurrentStartOffset (), 2300, "offsets");
+  Check (c, expected, __LINE__);
+  Check (a, std::vector<uint8_t> (expected.begin (), expected.begin () + 1000), __LINE__);
+
+  // fragments share the segments
+  Buffer f = c.CreateFragment (900, 1000);
+  NS_TEST_EXPECT_MSG_EQ (f.GetSegmentCount (), 3, "fragment across all the segments");
+  Check (f, std::vector<uint8_t> (expected.begin () + 900, expected.begin () + 1900), __LINE__);
+  f = c.CreateFragment (1100, 300);
+  NS_TEST_EXPECT_MSG_EQ (f.GetSegmentCount (), 1, "fragment of a single segment");
+  Check (f, std::vector<uint8_t> (expected.begin () + 1100, expected.begin () + 1400), __LINE__);
+
+  // removing bytes across segments
+  Buffer d = c;
+  d.RemoveAtStart (1050);
+  d.RemoveAtEnd (100);
+  Check (d, std::vector<uint8_t> (expected.begin () + 1050, expected.begin () + 2200), __LINE__);
+  d.RemoveAtEnd (600);
+  NS_TEST_EXPECT_MSG_EQ (d.GetSegmentCount (), 1, "last segment removed");
+  Check (d, std::vector<uint8_t> (expected.begin () + 1050, expected.begin () + 1600), __LINE__);
+  Check (c, expected, __LINE__);
+
+  // appending a buffer to itself
+  Buffer e = b;
+  e.AddAtEnd (e);
+  std::vector<uint8_t> twice (expected.begin () + 1000, expected.begin () + 1600);
+  twice.insert (twice.end (), expected.begin () + 1000, expected.begin () + 1600);
+  Check (e, twice, __LINE__);
+
+  // iterators walk the segments in place
+  Buffer g = c;
+  g.AddAtStart (2);
+  int32_t start = g.GetCurrentStartOffset ();
+  int32_t end = g.GetCurrentEndOffset ();
+  Buffer::Iterator i = g.Begin ();
+  NS_TEST_EXPECT_MSG_EQ (g.GetSegmentCount (), 3, "not merged by Begin");
+  NS_TEST_EXPECT_MSG_EQ (g.GetCurrentStartOffset (), start, "Begin keeps the offsets");
+  NS_TEST_EXPECT_MSG_EQ (g.GetCurrentEndOffset (), end, "Begin keeps the offsets");
+  NS_TEST_EXPECT_MSG_EQ (i.GetSize (), 2302, "iterator size");
+  i.WriteU8 (0xaa);
+  i.WriteU8 (0xbb);
+  bool same = true;
+  for (uint32_t j = 0; j < expected.size (); j++)
+    {
+      same = same && i.ReadU8 () == expected[j];
+    }
+  NS_TEST_EXPECT_MSG_EQ (same, true, "content read across the segments");
+  NS_TEST_EXPECT_MSG_EQ (i.IsEnd (), true, "end of the segments");
+  i = g.End ();
+  i.Prev (1301);
+  NS_TEST_EXPECT_MSG_EQ (i.ReadNtohU16 (), (expected[999] << 8 | expected[1000]), "read across two segments");
+  i = g.End ();
+  same = true;
+  for (uint32_t j = expected.size (); j > 0; j--)
+    {
+      i.Prev ();
+      same = same && i.ReadU8 () == expected[j - 1];
+      i.Prev ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (same, true, "content read backward across the segments");
+  NS_TEST_EXPECT_MSG_EQ (g.GetSegmentCount (), 3, "not merged by End");
+  Check (c, expected, __LINE__);
+
+  // appending bytes extends the last segment
+  Buffer h = a;
+  h.AddAtEnd (b);
+  h.AddAtEnd (1);
+  NS_TEST_EXPECT_MSG_EQ (h.GetSegmentCount (), 2, "not merged by AddAtEnd");
+  i = h.End ();
+  i.Prev ();
+  i.WriteU8 (0xcc);
+  std::vector<uint8_t> appended (expected.begin (), expected.begin () + 1600);
+  appended.push_back (0xcc);
+  Check (h, appended, __LINE__);
+  Check (h.CreateFullCopy (), appended, __LINE__);
+  Check (b, std::vector<uint8_t> (expected.begin () + 1000, expected.begin () + 1600), __LINE__);
+
+  // the longest run of virtual zero bytes stays virtual when segments are merged
+  uint64_t materialized = Buffer::GetMaterializedBytes ();
+  Buffer v = Buffer (300);
+  v.AddAtStart (20);
+  Buffer shared = v;
+  v.AddAtEnd (Buffer (500));
+  v.AddAtEnd (Buffer (100));
+  NS_TEST_EXPECT_MSG_EQ (v.GetSegmentCount (), 3, "zero areas are never copied when appended");
+  v.Begin ();
+  NS_TEST_EXPECT_MSG_EQ (v.GetSize (), 920, "size");
+  NS_TEST_EXPECT_MSG_EQ (Buffer::GetMaterializedBytes () - materialized, 0, "zero areas are not copied by Begin");
+  Buffer x = a;
+  x.AddAtEnd (Buffer (700));
+  x.AddAtEnd (b);
+  x.AddAtEnd (Buffer (300));
+  x.AddAtEnd (b);
+  x.End ();
+  NS_TEST_EXPECT_MSG_EQ (Buffer::GetMaterializedBytes () - materialized, 0, "zero areas are not copied by End");
+  std::vector<uint8_t> mixed (expected.begin (), expected.begin () + 1000);
+  mixed.resize (1700, 0);
+  mixed.insert (mixed.end (), expected.begin () + 1000, expected.begin () + 1600);
+  mixed.resize (2600, 0);
+  mixed.insert (mixed.end (), expected.begin () + 1000, expected.begin () + 1600);
+  Check (x, mixed, __LINE__);
+  Buffer y = Buffer (100).CreateFullCopy ();
+  NS_TEST_EXPECT_MSG_EQ (Buffer::GetMaterializedBytes () - materialized, 100, "full copies are accounted");
+
+  // serialization keeps the segments and the zero areas virtual
+  Buffer seg = a;
+  seg.AddAtEnd (z);
+  seg.AddAtEnd (b);
+  std::vector<uint8_t> raw (seg.GetSerializedSize ());
+  TagBuffer tb = TagBuffer (&raw[0], &raw[0] + raw.size ());
+  seg.Serialize (tb);
+  NS_TEST_EXPECT_MSG_EQ ((raw.size () < 1700), true, "zero area serialized");
+  Buffer r;
+  tb = TagBuffer (&raw[0], &raw[0] + raw.size ());
+  r.Deserialize (tb);
+  Check (r, std::vector<uint8_t> (mixed.begin (), mixed.begin () + 2300), __LINE__);
+  Buffer w = Buffer (500);
+  w.AddAtStart (2);
+  i = w.Begin ();
+  i.WriteU8 (0x12);
+  i.WriteU8 (0x34);
+  w.AddAtEnd (1);
+  i = w.End ();
+  i.Prev ();
+  i.WriteU8 (0x56);
+  raw.resize (w.GetSerializedSize ());
+  NS_TEST_EXPECT_MSG_EQ (raw.size (), 4 + 3 * 4 + 3, "runs of a buffer without segments");
+  tb = TagBuffer (&raw[0], &raw[0] + raw.size ());
+  w.Serialize (tb);
+  tb = TagBuffer (&raw[0], &raw[0] + raw.size ());
+  r.Deserialize (tb);
+  NS_TEST_EXPECT_MSG_EQ (r.GetSegmentCount (), 1, "single segment");
+  NS_TEST_EXPECT_MSG_EQ (Buffer::GetMaterializedBytes () - materialized, 100, "zero area materialized");
+  std::vector<uint8_t> head (503, 0);
+  head[0] = 0x12;
+  head[1] = 0x34;
+  head[502] = 0x56;
+  Check (r, head, __LINE__);
+
+  return GetErrorStatus ();
+}
+//-----------------------------------------------------------------------------
+class BufferChecksumTest : public TestCase
+{
+public:
+  BufferChecksumTest ();
+private:
+  virtual bool DoRun (void);
+  uint16_t CalculateReference (Buffer::Iterator i, uint16_t size, uint32_t initial);
+};
+
+BufferChecksumTest::BufferChecksumTest ()
+  : TestCase ("Buffer checksum")
+{}
+
+// the byte-at-a-time loop which the checksum kernels replace.
+uint16_t
+BufferChecksumTest::CalculateReference (Buffer::Iterator i, uint16_t size, uint32_t initial)
+{
+  uint32_t sum = initial;
+  for (int j = 0; j < size/2; j++)
+    sum += i.ReadU16 ();
+  if (size & 1)
+     sum += i.ReadU8 ();
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return ~sum;
+}
+
+bool
+BufferChecksumTest::DoRun (void)
+{
+  UniformVariable bytesRng (0, 256);
+
+  // every kernel available on this cpu, for every alignment and every
+  // tail length.
+  std::vector<ChecksumKernel> kernels;
+  kernels.push_back (&ChecksumPortable);
+#if defined (BUFFER_CHECKSUM_X86)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("sse2"))
+    {
+      kernels.push_back (&ChecksumSse2);
+    }
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      kernels.push_back (&ChecksumAvx2);
+    }
+#endif /* BUFFER_CHECKSUM_X86 */
+  uint8_t data[200];
+  for (uint32_t j = 0; j < sizeof (data); j++)
+    {
+      data[j] = static_cast<uint8_t> (bytesRng.GetValue ());
+    }
+  memset (data + 150, 0xff, 50);
+  for (uint32_t offset = 0; offset < 8; offset++)
+    {
+      for (uint32_t size = 0; size <= sizeof (data) - offset; size++)
+        {
+          uint16_t expected = FoldChecksum (ChecksumPortable (data + offset, size), false);
+          for (uint32_t k = 1; k < kernels.size (); k++)
+            {
+              uint16_t checksum = FoldChecksum (kernels[k] (data + offset, size), false);
+              NS_TEST_EXPECT_MSG_EQ (checksum, expected, "kernel " << k << ", offset " << offset
+                                     << ", size " << size);
+            }
+        }
+    }
+
+  // a buffer with a zero area in the middle, checksummed from even and
+  // odd offsets over ranges which start and end in every area.
+  Buffer buffer = Buffer (37);
+  buffer.AddAtStart (45);
+  buffer.AddAtEnd (71);
+  Buffer::Iterator i = buffer.Begin ();
+  for (uint32_t j = 0; j < 45; j++)
+    {
+      i.WriteU8 (static_cast<uint8_t> (bytesRng.GetValue ()));
+    }
+  i.Next (37);
+  for (uint32_t j = 0; j < 71; j++)
+    {
+      i.WriteU8 (static_cast<uint8_t> (bytesRng.GetValue ()));
+    }
+  for (uint32_t start = 0; start < buffer.GetSize (); start += 3)
+    {
+      for (uint32_t size = 0; start + size <= buffer.GetSize (); size += 5)
+        {
+          uint32_t initial = (start * 7919 + size) & 0x3ffff;
+          i = buffer.Begin ();
+          i.Next (start);
+          uint16_t expected = CalculateReference (i, size, initial);
+          uint16_t checksum = i.CalculateIpChecksum (size, initial);
+          NS_TEST_EXPECT_MSG_EQ (checksum, expected, "start " << start << ", size " << size);
+          NS_TEST_EXPECT_MSG_EQ (i.GetDistanceFrom (buffer.Begin ()), start + size, "iterator advanced");
+        }
+    }
+
+  // the same buffer followed by segments, one of which is virtual:
+  // the checksum of the segments must match that of a full copy.
+  Buffer payload;
+  payload.AddAtStart (301);
+  i = payload.Begin ();
+  for (uint32_t j = 0; j < 301; j++)
+    {
+      i.WriteU8 (static_cast<uint8_t> (bytesRng.GetValue ()));
+    }
+  Buffer segmented = buffer;
+  segmented.AddAtEnd (payload);
+  segmented.AddAtEnd (Buffer (300));
+  segmented.AddAtEnd (payload);
+  NS_TEST_EXPECT_MSG_EQ (segmented.GetSegmentCount (), 4, "segments");
+  Buffer copy = segmented.CreateFullCopy ();
+  for (uint32_t start = 0; start < segmented.GetSize (); start += 29)
+    {
+      for (uint32_t size = 0; start + size <= segmented.GetSize (); size += 37)
+        {
+          i = copy.Begin ();
+          i.Next (start);
+          uint16_t expected = i.CalculateIpChecksum (size, start);
+          i = segmented.Begin ();
+          i.Next (start);
+          uint16_t checksum = i.CalculateIpChecksum (size, start);
+          NS_TEST_EXPECT_MSG_EQ (checksum, expected, "segments, start " << start << ", size " << size);
+          NS_TEST_EXPECT_MSG_EQ (i.GetDistanceFrom (segmented.Begin ()), start + size, "iterator advanced");
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (segmented.GetSegmentCount (), 4, "segments not merged");
+
+  // all zeroes and all ones.
+  buffer = Buffer (64);
+  i = buffer.Begin ();
+  NS_TEST_EXPECT_MSG_EQ (i.CalculateIpChecksum (64), 0xffff, "zeroes");
+  buffer = Buffer ();
+  buffer.AddAtStart (64);
+  buffer.Begin ().WriteU8 (0xff, 64);
+  i = buffer.Begin ();
+  NS_TEST_EXPECT_MSG_EQ (i.CalculateIpChecksum (64), 0, "ones");
+
+  return GetErrorStatus ();
+}
+//-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
 {
 public:
@@ -1481,6 +2473,8 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest);
+  AddTestCase (new BufferSegmentTest);
+  AddTestCase (new BufferChecksumTest);
 }
 
 BufferTestSuite g_bufferTestSuite;
@@ -22,12 +22,15 @@
 
 #include <stdint.h>
 #include <vector>
+#include <utility>
 #include <ostream>
 
 #define BUFFER_HEURISTICS 1
 
 namespace ns3 {
 
+class TagBuffer;
+
 /**
  * \ingroup packet
  *
@@ -56,7 +59,9 @@ namespace ns3 {
  * safe to modify the content of a BufferData if the modification
  * falls outside of the "dirty area" defined by the BufferData.
  * In every other case, the BufferData must be copied before
- * being modified.
+ * being modified. The Buffer instances which share a BufferData
+ * might be used by different threads, so the reference count is
+ * updated and the dirty area is extended with atomic operations.
  *
  * To understand the way the Buffer::Add and Buffer::Remove methods
  * work, you first need to understand the "virtual offsets" used to
@@ -85,12 +90,26 @@ namespace ns3 {
  *                        |------------------------------------------^ m_end
  *
  * A simple state invariant is that m_start <= m_zeroStart <= m_zeroEnd <= m_end
+ *
+ * A large Buffer appended to another one with Buffer::AddAtEnd is not
+ * copied: it is referenced as a segment of the "tail" of the Buffer,
+ * a list of Buffers whose bytes logically follow the byte at m_end.
+ * Like the BufferData, the tail is shared copy-on-write between the
+ * Buffer instances. Removing bytes and creating fragments never copies
+ * the bytes of the segments, and AddAtEnd (uint32_t) adds the new bytes
+ * to the last segment. The Buffer::Iterator reads and writes the bytes
+ * of the first BufferData inline, and those of the segments through
+ * a slower path: adding, peeking and removing a header at the start
+ * of a Buffer with segments never copies them.
  */
 class Buffer 
 {
 public:
   /**
    * \brief iterator in a Buffer instance
+   *
+   * An Iterator references the segments of its Buffer: it must not
+   * be used once this Buffer was modified or destroyed.
    */
   class Iterator 
   {
@@ -363,6 +382,10 @@ public:
       void Construct (const Buffer *buffer);
       bool CheckNoZero (uint32_t start, uint32_t end) const;
       bool Check (uint32_t i) const;
+      Iterator GetTailIterator (uint32_t *left);
+      uint8_t ReadTailU8 (void);
+      void WriteTailU8 (uint8_t data);
+      uint32_t SumArea (uint32_t end, uint32_t start);
 
     /* offset in virtual bytes from the start of the data buffer to the
      * start of the "virtual zero area".
@@ -380,10 +403,25 @@ public:
      * end of the data which can be read by this iterator
      */
       uint32_t m_dataEnd;
+    /* offset in virtual bytes from the start of the data buffer to the
+     * first byte of the segments of the buffer, that is, to the end of
+     * the bytes stored in the data buffer.
+     */
+      uint32_t m_tailStart;
     /* offset in virtual bytes from the start of the data buffer to the
      * current position represented by this iterator.
      */
       uint32_t m_current;
+    /* the segments of the buffer, zero if there are none.
+     */
+      const struct BufferTail *m_tail;
+    /* the index of the last segment accessed by this iterator and its
+     * offsets in virtual bytes from the start of the data buffer: the
+     * segments are only searched again when the iterator leaves them.
+     */
+      uint32_t m_segment;
+      uint32_t m_segmentStart;
+      uint32_t m_segmentEnd;
     /* a pointer to the underlying byte buffer. All offsets are relative
      * to this pointer.
      */
@@ -432,7 +470,9 @@ public:
   /**
    * \param o the buffer to append to the end of this buffer.
    *
-   * Add bytes at the end of the Buffer.
+   * Add bytes at the end of the Buffer. The bytes of a small
+   * buffer are copied while a large buffer is referenced as
+   * a new segment of this Buffer.
    * Any call to this method invalidates any Iterator
    * pointing to this Buffer.
    */
@@ -442,7 +482,8 @@ public:
    *
    * Remove bytes at the start of the Buffer.
    * Any call to this method invalidates any Iterator
-   * pointing to this Buffer.
+   * pointing to this Buffer. The offset of the remaining
+   * bytes, as returned by GetCurrentStartOffset, might change.
    */
   void RemoveAtStart (uint32_t start);
   /**
@@ -476,9 +517,48 @@ public:
 
   Buffer CreateFullCopy (void) const;
 
+  /**
+   * \return the number of separate memory areas which hold the
+   *          bytes of this buffer: one unless large buffers were
+   *          appended to it with AddAtEnd.
+   */
+  uint32_t GetSegmentCount (void) const;
+
+  /**
+   * \returns the number of virtual zero bytes which were copied in
+   *          memory since the start of the program because the whole
+   *          content of a buffer was needed, by CreateFullCopy and
+   *          PeekData.
+   *
+   * CopyData writes the zero bytes in the memory of the caller but
+   * never copies them in a buffer so it does not increase this counter.
+   */
+  static uint64_t GetMaterializedBytes (void);
+
   int32_t GetCurrentStartOffset (void) const;
   int32_t GetCurrentEndOffset (void) const;
 
+  /**
+   * \returns the number of bytes needed to serialize this buffer
+   *          with Buffer::Serialize.
+   */
+  uint32_t GetSerializedSize (void) const;
+  /**
+   * \param buffer the raw buffer to write into.
+   *
+   * The serialized form lists the runs of real and virtual zero
+   * bytes of this buffer: the virtual zero bytes are never
+   * written and remain virtual once deserialized.
+   */
+  void Serialize (TagBuffer &buffer) const;
+  /**
+   * \param buffer the raw buffer to read from.
+   *
+   * Replace the content of this buffer with the bytes read from
+   * buffer, as written by Buffer::Serialize.
+   */
+  void Deserialize (TagBuffer &buffer);
+
   /** 
    * Copy the specified amount of data from the buffer to the given output stream.
    * 
@@ -497,16 +577,28 @@ public:
 private:
 
   void TransformIntoRealBuffer (void) const;
+  typedef std::vector<std::pair<const uint8_t *, uint32_t> > AreaList;
+  void GetAreas (AreaList &areas) const;
   bool CheckInternalState (void) const;
   void Initialize (uint32_t zeroSize);
   uint32_t GetInternalSize (void) const;
   uint32_t GetInternalEnd (void) const;
+  uint32_t GetTailSize (void) const;
+  uint32_t CopyHeadData (uint8_t *buffer, uint32_t size) const;
+  struct BufferTail *GetWritableTail (void);
+  void ReleaseTail (void);
+  void AppendSegments (const Buffer &o);
+  void RemoveSegmentsAtStart (uint32_t start);
   static void Recycle (struct BufferData *data);
   static struct BufferData *Create (uint32_t size);
 
   /* This structure is described in the buffer.cc file.
    */
   struct BufferData *m_data;
+  /* The segments appended after m_end, zero if there are none.
+   * This structure is described in the buffer.cc file.
+   */
+  struct BufferTail *m_tail;
 #ifdef BUFFER_HEURISTICS
   /* keep track of the maximum value of m_zeroAreaStart across
    * the lifetime of a Buffer instance. This variable is used
@@ -556,18 +648,29 @@ Buffer::Iterator::WriteU8 (uint8_t data)
       m_data[m_current] = data;
       m_current++;
     }
-  else
+  else if (m_current < m_tailStart)
     {
       m_data[m_current - (m_zeroEnd-m_zeroStart)] = data;
       m_current++;      
     }
+  else
+    {
+      WriteTailU8 (data);
+    }
 }
 
 void 
 Buffer::Iterator::WriteU8 (uint8_t  data, uint32_t len)
 {
   NS_ASSERT (CheckNoZero (m_current, m_current + len));
-  if (m_current <= m_zeroStart)
+  if (m_current + len > m_tailStart)
+    {
+      for (uint32_t i = 0; i < len; i++)
+        {
+          WriteU8 (data);
+        }
+    }
+  else if (m_current <= m_zeroStart)
     {
       memset (&(m_data[m_current]), data, len);
       m_current += len;
@@ -597,12 +700,16 @@ Buffer::Iterator::ReadU8 (void)
       m_current++;
       return 0;
     }
-  else
+  else if (m_current < m_tailStart)
     {
       uint8_t data = m_data[m_current - (m_zeroEnd-m_zeroStart)];
       m_current++;
       return data;
     }
+  else
+    {
+      return ReadTailU8 ();
+    }
 }
 
 
@@ -19,6 +19,7 @@
  */
 #include "byte-tag-list.h"
 #include "ns3/log.h"
+#include "ns3/thread-local-pointer.h"
 #include <vector>
 #include <string.h>
 
@@ -32,28 +33,87 @@ namespace ns3 {
 
 struct ByteTagListData {
   uint32_t size;
+  /* the reference count and the end of the dirty area are updated
+   * atomically: the lists which share an instance might be used by
+   * different threads. */
   uint32_t count;
   uint32_t dirty;
   uint8_t data[4];
 };
 
+/* The counters are shared by all threads and updated atomically. */
+static struct ByteTagList::MemoryStats g_memoryStats = {0, 0, 0, 0};
+
+static void
+AddMemoryStats (const struct ByteTagListData *data)
+{
+  __sync_add_and_fetch (&g_memoryStats.buffers, 1);
+  uint64_t bytes = __sync_add_and_fetch (&g_memoryStats.bytes, data->size);
+  uint64_t maxBytes = g_memoryStats.maxBytes;
+  while (bytes > maxBytes &&
+         !__sync_bool_compare_and_swap (&g_memoryStats.maxBytes, maxBytes, bytes))
+    {
+      maxBytes = g_memoryStats.maxBytes;
+    }
+}
+
+static void
+RemoveMemoryStats (const struct ByteTagListData *data)
+{
+  __sync_sub_and_fetch (&g_memoryStats.buffers, 1);
+  __sync_sub_and_fetch (&g_memoryStats.bytes, data->size);
+}
+
 #ifdef USE_FREE_LIST
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
+/* The free lists are kept per thread because the threads of a
+ * MultiThreadedSimulatorImpl create and destroy tag lists concurrently.
+ */
+struct ByteTagListDataFreeList
 {
-public:
-  ~ByteTagListDataFreeList ();
-} g_freeList;
-static uint32_t g_maxSize = 0;
+  std::vector<struct ByteTagListData *> data;
+  uint32_t maxSize;
+};
 
-ByteTagListDataFreeList::~ByteTagListDataFreeList ()
+static void
+ReleaseFreeList (struct ByteTagListDataFreeList *freeList)
 {
-  for (ByteTagListDataFreeList::iterator i = begin ();
-       i != end (); i++)
+  for (std::vector<struct ByteTagListData *>::iterator i = freeList->data.begin ();
+       i != freeList->data.end (); i++)
     {
       uint8_t *buffer = (uint8_t *)(*i);
       delete [] buffer;
     }
+  freeList->data.clear ();
+}
+
+static void
+DestroyFreeList (void *p)
+{
+  struct ByteTagListDataFreeList *freeList = static_cast<struct ByteTagListDataFreeList *> (p);
+  ReleaseFreeList (freeList);
+  delete freeList;
+}
+
+static struct ByteTagListDataFreeList *
+GetFreeList (void)
+{
+  static ThreadLocalPointer freeLists (&DestroyFreeList);
+  struct ByteTagListDataFreeList *freeList = static_cast<struct ByteTagListDataFreeList *> (freeLists.Get ());
+  if (freeList == 0)
+    {
+      freeList = new ByteTagListDataFreeList ();
+      freeLists.Set (freeList);
+    }
+  return freeList;
 }
+
+static struct FreeListDestructor
+{
+  ~FreeListDestructor ()
+  {
+    ReleaseFreeList (GetFreeList ());
+  }
+} g_freeListDestructor;
 #endif /* USE_FREE_LIST */
 
 ByteTagList::Iterator::Item::Item (TagBuffer buf_)
@@ -128,7 +188,7 @@ ByteTagList::ByteTagList (const ByteTagList &o)
   NS_LOG_FUNCTION (this << &o);
   if (m_data != 0)
     {
-      m_data->count++;
+      __sync_add_and_fetch (&m_data->count, 1);
     }
 }
 ByteTagList &
@@ -145,7 +205,7 @@ ByteTagList::operator = (const ByteTagList &o)
   m_used = o.m_used;
   if (m_data != 0)
     {
-      m_data->count++;
+      __sync_add_and_fetch (&m_data->count, 1);
     }
   return *this;
 }
@@ -169,7 +229,8 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
       m_used = 0;
     } 
   else if (m_data->size < spaceNeeded ||
-	   (m_data->count != 1 && m_data->dirty != m_used))
+	   (m_data->count != 1 &&
+	    !__sync_bool_compare_and_swap (&m_data->dirty, m_used, spaceNeeded)))
     {
       struct ByteTagListData *newData = Allocate (spaceNeeded);
       memcpy (&newData->data, &m_data->data, m_used);
@@ -218,6 +279,67 @@ ByteTagList::BeginAll (void) const
   return Begin (0, OFFSET_MAX);
 }
 
+uint32_t
+ByteTagList::GetSerializedSize (int32_t offsetStart, int32_t offsetEnd) const
+{
+  uint32_t size = 4;
+  ByteTagList::Iterator i = Begin (offsetStart, offsetEnd);
+  while (i.HasNext ())
+    {
+      ByteTagList::Iterator::Item item = i.Next ();
+      size += 2 + item.tid.GetName ().size () + 4 + 4 + 4 + item.size;
+    }
+  return size;
+}
+
+void
+ByteTagList::Serialize (TagBuffer &buffer, int32_t offsetStart, int32_t offsetEnd) const
+{
+  NS_LOG_FUNCTION (this << offsetStart << offsetEnd);
+  uint32_t n = 0;
+  ByteTagList::Iterator i = Begin (offsetStart, offsetEnd);
+  while (i.HasNext ())
+    {
+      i.Next ();
+      n++;
+    }
+  buffer.WriteU32 (n);
+  i = Begin (offsetStart, offsetEnd);
+  while (i.HasNext ())
+    {
+      ByteTagList::Iterator::Item item = i.Next ();
+      std::string name = item.tid.GetName ();
+      buffer.WriteU16 (name.size ());
+      buffer.Write ((const uint8_t *)name.c_str (), name.size ());
+      buffer.WriteU32 (item.size);
+      buffer.WriteU32 (item.start - offsetStart);
+      buffer.WriteU32 (item.end - offsetStart);
+      buffer.CopyFrom (item.buf);
+    }
+}
+
+void
+ByteTagList::Deserialize (TagBuffer &buffer, int32_t offsetStart)
+{
+  NS_LOG_FUNCTION (this << offsetStart);
+  uint32_t n = buffer.ReadU32 ();
+  std::string name;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      name.resize (buffer.ReadU16 ());
+      buffer.Read ((uint8_t *)&name[0], name.size ());
+      TypeId tid = TypeId::LookupByName (name);
+      uint32_t size = buffer.ReadU32 ();
+      int32_t start = buffer.ReadU32 ();
+      int32_t end = buffer.ReadU32 ();
+      TagBuffer tag = Add (tid, size, start + offsetStart, end + offsetStart);
+      for (uint32_t j = 0; j < size; j++)
+        {
+          tag.WriteU8 (buffer.ReadU8 ());
+        }
+    }
+}
+
 ByteTagList::Iterator 
 ByteTagList::Begin (int32_t offsetStart, int32_t offsetEnd) const
 {
@@ -282,6 +404,7 @@ ByteTagList::AddAtEnd (int32_t adjustment, int32_t appendOffset)
 
       if (item.start >= appendOffset)
 	{
+	  __sync_add_and_fetch (&g_memoryStats.compacted, 1);
 	  continue;
 	}
       else if (item.start < appendOffset && item.end > appendOffset)
@@ -316,6 +439,7 @@ ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
 
       if (item.end <= prependOffset)
 	{
+	  __sync_add_and_fetch (&g_memoryStats.compacted, 1);
 	  continue;
 	}
       else if (item.end > prependOffset && item.start < prependOffset)
@@ -332,31 +456,111 @@ ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
   *this = list;
 }
 
+void
+ByteTagList::Compact (int32_t offsetStart, int32_t offsetEnd)
+{
+  NS_LOG_FUNCTION (this << offsetStart << offsetEnd);
+  if (m_data == 0)
+    {
+      return;
+    }
+  /* look for the first stale tag: the lists of most packets hold none
+   * and are left shared.
+   */
+  uint8_t *current = m_data->data;
+  uint8_t *end = &m_data->data[m_used];
+  while (current < end)
+    {
+      TagBuffer buf = TagBuffer (current, end);
+      buf.ReadU32 ();
+      uint32_t size = buf.ReadU32 ();
+      int32_t start = buf.ReadU32 ();
+      int32_t stop = buf.ReadU32 ();
+      if (start >= offsetEnd || stop <= offsetStart)
+        {
+          break;
+        }
+      current += 4 + 4 + 4 + 4 + size;
+    }
+  if (current == end)
+    {
+      return;
+    }
+  struct ByteTagListData *data = m_data;
+  uint32_t used = current - m_data->data;
+  if (m_data->count != 1)
+    {
+      data = Allocate (m_used);
+      memcpy (data->data, m_data->data, used);
+    }
+  uint8_t *dst = &data->data[used];
+  while (current < end)
+    {
+      TagBuffer buf = TagBuffer (current, end);
+      buf.ReadU32 ();
+      uint32_t size = buf.ReadU32 ();
+      int32_t start = buf.ReadU32 ();
+      int32_t stop = buf.ReadU32 ();
+      uint32_t itemSize = 4 + 4 + 4 + 4 + size;
+      if (start >= offsetEnd || stop <= offsetStart)
+        {
+          __sync_add_and_fetch (&g_memoryStats.compacted, 1);
+        }
+      else
+        {
+          memmove (dst, current, itemSize);
+          dst += itemSize;
+        }
+      current += itemSize;
+    }
+  if (data != m_data)
+    {
+      Deallocate (m_data);
+      m_data = data;
+    }
+  m_used = dst - m_data->data;
+  m_data->dirty = m_used;
+  if (m_used == 0)
+    {
+      Deallocate (m_data);
+      m_data = 0;
+    }
+}
+
+struct ByteTagList::MemoryStats
+ByteTagList::GetMemoryStats (void)
+{
+  return g_memoryStats;
+}
+
 #ifdef USE_FREE_LIST
 
 struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
+  struct ByteTagListDataFreeList *freeList = GetFreeList ();
+  while (!freeList->data.empty ())
     {
-      struct ByteTagListData *data = g_freeList.back ();
-      g_freeList.pop_back ();
+      struct ByteTagListData *data = freeList->data.back ();
+      freeList->data.pop_back ();
       NS_ASSERT (data != 0);
       if (data->size >= size)
 	{
 	  data->count = 1;
 	  data->dirty = 0;
+	  AddMemoryStats (data);
 	  return data;
 	}
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
     }
-  uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
+  uint8_t *buffer = new uint8_t [std::max (size, freeList->maxSize) + sizeof (struct ByteTagListData) - 4];
   struct ByteTagListData *data = (struct ByteTagListData *)buffer;
   data->count = 1;
   data->size = size;
   data->dirty = 0;
+  AddMemoryStats (data);
   return data;
 }
 
@@ -368,19 +572,20 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
+  if (__sync_sub_and_fetch (&data->count, 1) == 0)
     {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
-	  data->size < g_maxSize)
+      struct ByteTagListDataFreeList *freeList = GetFreeList ();
+      freeList->maxSize = std::max (freeList->maxSize, data->size);
+      RemoveMemoryStats (data);
+      if (freeList->data.size () > FREE_LIST_SIZE ||
+	  data->size < freeList->maxSize)
 	{
 	  uint8_t *buffer = (uint8_t *)data;
 	  delete [] buffer;
 	}
       else
 	{
-	  g_freeList.push_back (data);
+	  freeList->data.push_back (data);
 	}
     }
 }
@@ -396,6 +601,7 @@ ByteTagList::Allocate (uint32_t size)
   data->count = 1;
   data->size = size;
   data->dirty = 0;
+  AddMemoryStats (data);
   return data;
 }
 
@@ -407,9 +613,9 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (__sync_sub_and_fetch (&data->count, 1) == 0)
     {
+      RemoveMemoryStats (data);
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
     }
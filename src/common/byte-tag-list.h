@@ -63,7 +63,10 @@ struct ByteTagListData;
  *     are never updated because we rely on the fact that they will be updated in
  *     either the next call to Packet::AddHeader or Packet::AddTrailer or when
  *     the user iterates the tag list with Packet::GetTagIterator and 
- *     TagIterator::Next.
+ *     TagIterator::Next. The tags which no longer tag any byte of the packet
+ *     are dropped by ByteTagList::Compact, though, so that the list does not
+ *     grow with the tags of the bytes removed by fragmentation and
+ *     reassembly.
  */
 class ByteTagList
 {
@@ -101,6 +104,34 @@ public:
     int32_t m_nextEnd;
   };
 
+  /**
+   * The counters of the memory used by the tag lists of all packets.
+   */
+  struct MemoryStats
+  {
+    /**
+     * The number of tag buffers currently allocated.
+     */
+    uint64_t buffers;
+    /**
+     * The size of the tag buffers currently allocated.
+     */
+    uint64_t bytes;
+    /**
+     * The largest size of the tag buffers allocated so far.
+     */
+    uint64_t maxBytes;
+    /**
+     * The number of tags dropped because they tagged none of the
+     * bytes of their packet any more.
+     */
+    uint64_t compacted;
+  };
+  /**
+   * \returns the memory counters.
+   */
+  static struct MemoryStats GetMemoryStats (void);
+
   ByteTagList ();
   ByteTagList (const ByteTagList &o);
   ByteTagList &operator = (const ByteTagList &o);
@@ -152,6 +183,47 @@ public:
    * the location where new bytes have been added to the byte buffer.
    */
   void AddAtStart (int32_t adjustment, int32_t prependOffset);
+  /**
+   * \param offsetStart the offset of the first byte of the byte buffer
+   *        associated to this ByteTagList.
+   * \param offsetEnd the offset of the end of the byte buffer
+   *        associated to this ByteTagList.
+   *
+   * Drop the tags which do not tag any byte between offsetStart and
+   * offsetEnd. The tags which do are left untouched, even if they
+   * extend beyond these offsets, so that a list which holds no stale
+   * tag stays shared with its copies.
+   */
+  void Compact (int32_t offsetStart, int32_t offsetEnd);
+
+  /**
+   * \param offsetStart the offset of the first byte of the byte buffer
+   *        associated to this ByteTagList.
+   * \param offsetEnd the offset of the end of the byte buffer
+   *        associated to this ByteTagList.
+   * \returns the number of bytes needed to serialize the tags which
+   *          overlap the input offsets with ByteTagList::Serialize.
+   */
+  uint32_t GetSerializedSize (int32_t offsetStart, int32_t offsetEnd) const;
+  /**
+   * \param buffer the raw buffer to write into.
+   * \param offsetStart the offset of the first byte of the byte buffer
+   *        associated to this ByteTagList.
+   * \param offsetEnd the offset of the end of the byte buffer
+   *        associated to this ByteTagList.
+   *
+   * The tags are identified by the name of their TypeId and their
+   * boundaries are written relative to offsetStart.
+   */
+  void Serialize (TagBuffer &buffer, int32_t offsetStart, int32_t offsetEnd) const;
+  /**
+   * \param buffer the raw buffer to read from.
+   * \param offsetStart the offset of the first byte of the byte buffer
+   *        associated to this ByteTagList.
+   *
+   * Add the tags written by ByteTagList::Serialize to this list.
+   */
+  void Deserialize (TagBuffer &buffer, int32_t offsetStart);
 
 private:
   bool IsDirtyAtEnd (int32_t appendOffset);
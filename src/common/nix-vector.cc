@@ -292,6 +292,35 @@ NixVector::Deserialize (Buffer::Iterator i)
   return totalSize;
 }
 
+void
+NixVector::Serialize (TagBuffer &buffer) const
+{
+  buffer.WriteU32 (GetSerializedSize ());
+  buffer.WriteU32 (m_used);
+  buffer.WriteU32 (m_currentVectorBitSize);
+  buffer.WriteU32 (m_totalBitSize);
+  for (uint32_t j = 0; j < m_nixVector.size (); j++)
+    {
+      buffer.WriteU32 (m_nixVector[j]);
+    }
+}
+
+void
+NixVector::Deserialize (TagBuffer &buffer)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t size = buffer.ReadU32 ();
+  NS_ASSERT (size >= 16 && size % 4 == 0);
+  m_used = buffer.ReadU32 ();
+  m_currentVectorBitSize = buffer.ReadU32 ();
+  m_totalBitSize = buffer.ReadU32 ();
+  m_nixVector.clear ();
+  for (size -= 16; size > 0; size -= 4)
+    {
+      m_nixVector.push_back (buffer.ReadU32 ());
+    }
+}
+
 void
 NixVector::DumpNixVector (std::ostream &os) const
 {
@@ -23,6 +23,7 @@
 
 #include "ns3/object.h"
 #include "ns3/buffer.h"
+#include "ns3/tag-buffer.h"
 
 namespace ns3 {
 
@@ -116,6 +117,16 @@ class NixVector : public Object
      * \param i Buffer iterator for reading
      */
     uint32_t Deserialize (Buffer::Iterator i);
+    /**
+     * \param buffer the raw buffer to write GetSerializedSize
+     *        bytes into, in the format used by the Buffer::Iterator
+     *        version of Serialize.
+     */
+    void Serialize (TagBuffer &buffer) const;
+    /**
+     * \param buffer the raw buffer to read from.
+     */
+    void Deserialize (TagBuffer &buffer);
     /**
      * \return number of bits of numberOfNeighbors
      *
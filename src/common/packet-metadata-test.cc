@@ -250,16 +250,18 @@ namespace ns3 {
 
 class PacketMetadataTest : public TestCase {
 public:
-  PacketMetadataTest ();
+  PacketMetadataTest (bool lazy);
   virtual ~PacketMetadataTest ();
   bool CheckHistory (Ptr<Packet> p, const char *file, int line, uint32_t n, ...);
   virtual bool DoRun (void);
 private:
   Ptr<Packet> DoAddHeader (Ptr<Packet> p);
+  bool m_lazy;
 };
 
-PacketMetadataTest::PacketMetadataTest ()
-  : TestCase ("Packet metadata")
+PacketMetadataTest::PacketMetadataTest (bool lazy)
+  : TestCase (lazy ? "Lazy packet metadata" : "Packet metadata"),
+    m_lazy (lazy)
 {}
 
 PacketMetadataTest::~PacketMetadataTest ()
@@ -404,7 +406,16 @@ PacketMetadataTest::DoRun (void)
 {
   bool result = true;
 
-  PacketMetadata::Enable ();
+  // the other tests which run in this process expect the current mode.
+  bool wasLazy = PacketMetadata::IsLazyEnabled ();
+  if (m_lazy)
+    {
+      PacketMetadata::EnableLazy ();
+    }
+  else
+    {
+      PacketMetadata::Enable ();
+    }
 
   Ptr<Packet> p = Create<Packet> (0);
   Ptr<Packet> p1 = Create<Packet> (0);
@@ -772,6 +783,35 @@ PacketMetadataTest::DoRun (void)
   CHECK_HISTORY (p, 1, 500);
   p->RemoveAtStart (10);
   CHECK_HISTORY (p, 1, 490);
+
+  // copies and fragments which share a history, checked only once all
+  // the operations were done: in lazy mode, the whole history is then
+  // rebuilt from the deltas.
+  p = Create<Packet> (10);
+  ADD_HEADER (p, 1);
+  ADD_HEADER (p, 2);
+  p1 = p->Copy ();
+  REM_HEADER (p, 2);
+  ADD_TRAILER (p, 3);
+  ADD_HEADER (p1, 4);
+  REM_HEADER (p1, 4);
+  REM_HEADER (p1, 2);
+  REM_HEADER (p1, 1);
+  ADD_TRAILER (p1, 5);
+  p2 = p->CreateFragment (0, 5);
+  p2->AddAtEnd (p1);
+  CHECK_HISTORY (p2, 4, 1, 4, 10, 5);
+  CHECK_HISTORY (p1, 2, 10, 5);
+  CHECK_HISTORY (p, 3, 1, 10, 3);
+
+  if (wasLazy)
+    {
+      PacketMetadata::EnableLazy ();
+    }
+  else
+    {
+      PacketMetadata::DisableLazy ();
+    }
   
   return !result;
 }
@@ -785,7 +825,8 @@ public:
 PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
-  AddTestCase (new PacketMetadataTest);
+  AddTestCase (new PacketMetadataTest (false));
+  AddTestCase (new PacketMetadataTest (true));
 }
 
 PacketMetadataTestSuite g_packetMetadataTest;
@@ -22,10 +22,13 @@
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
+#include "ns3/free-list-pool.h"
+#include "ns3/thread-local-pointer.h"
 #include "packet-metadata.h"
 #include "buffer.h"
 #include "header.h"
 #include "trailer.h"
+#include "tag-buffer.h"
 
 NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 
@@ -33,20 +36,59 @@ namespace ns3 {
 
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
+bool PacketMetadata::m_enableLazy = false;
 bool PacketMetadata::m_metadataSkipped = false;
-uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+PacketMetadata::FreeListDestructor PacketMetadata::m_freeListDestructor;
 
-PacketMetadata::DataFreeList::~DataFreeList ()
+/* The free lists are kept per thread because the threads of a
+ * MultiThreadedSimulatorImpl create and destroy packets concurrently.
+ */
+struct PacketMetadata::FreeList
+{
+  std::vector<struct Data *> data;
+  /* the largest size of struct Data requested by this thread. */
+  uint32_t maxSize;
+};
+
+PacketMetadata::FreeListDestructor::~FreeListDestructor ()
 {
-  for (iterator i = begin (); i != end (); i++)
+  struct FreeList *freeList = PacketMetadata::GetFreeList ();
+  for (std::vector<struct Data *>::iterator i = freeList->data.begin ();
+       i != freeList->data.end (); i++)
     {
       PacketMetadata::Deallocate (*i);
     }
+  freeList->data.clear ();
   PacketMetadata::m_enable = false;
 }
 
+namespace {
+
+/* The deltas all have the same size, which is given by the
+ * first caller.
+ */
+FreeListPool &
+GetDeltaPool (size_t size)
+{
+  static FreeListPool pool (size, 1, 1000);
+  return pool;
+}
+
+} // anonymous namespace
+
+void *
+PacketMetadata::Delta::operator new (size_t size)
+{
+  return GetDeltaPool (size).Allocate (size);
+}
+
+void
+PacketMetadata::Delta::operator delete (void *buffer, size_t size)
+{
+  GetDeltaPool (size).Deallocate (buffer, size);
+}
+
 void 
 PacketMetadata::Enable (void)
 {
@@ -58,6 +100,7 @@ PacketMetadata::Enable (void)
                  "to call ns3::PacketMetadata::Enable () near the beginning of"
                  " the program, before any packets are sent.");
   m_enable = true;
+  m_enableLazy = false;
 }
 
 void 
@@ -65,6 +108,34 @@ PacketMetadata::EnableChecking (void)
 {
   Enable ();
   m_enableChecking = true;
+  m_enableLazy = false;
+}
+
+void
+PacketMetadata::EnableLazy (void)
+{
+  Enable ();
+  // the checks must be done when the chunks are removed, not when the
+  // metadata is printed.
+  m_enableLazy = !m_enableChecking;
+}
+
+void
+PacketMetadata::DisableLazy (void)
+{
+  m_enableLazy = false;
+}
+
+bool
+PacketMetadata::IsEnabled (void)
+{
+  return m_enable;
+}
+
+bool
+PacketMetadata::IsLazyEnabled (void)
+{
+  return m_enableLazy;
 }
 
 void
@@ -73,8 +144,7 @@ PacketMetadata::ReserveCopy (uint32_t size)
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -313,6 +383,14 @@ PacketMetadata::UpdateHead (uint16_t written)
   m_data->m_dirtyEnd = m_used;
 }
 
+bool
+PacketMetadata::ClaimDirtyArea (uint32_t n)
+{
+  // the other instances which share m_data might be used by other
+  // threads: only one of them can extend the dirty area.
+  return __sync_bool_compare_and_swap (&m_data->m_dirtyEnd, m_used, m_used + n);
+}
+
 uint16_t
 PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
 {
@@ -325,7 +403,7 @@ PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
+       !ClaimDirtyArea (n)))
     {
       ReserveCopy (n);
     }
@@ -363,7 +441,7 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
+       !ClaimDirtyArea (n)))
     {
       ReserveCopy (n);
     }
@@ -517,18 +595,44 @@ PacketMetadata::ReadItems (uint16_t current,
   return buffer - &m_data->m_data[current];
 }
 
+struct PacketMetadata::FreeList *
+PacketMetadata::GetFreeList (void)
+{
+  static ThreadLocalPointer freeLists (&PacketMetadata::DestroyFreeList);
+  struct FreeList *freeList = static_cast<struct FreeList *> (freeLists.Get ());
+  if (freeList == 0)
+    {
+      freeList = new FreeList ();
+      freeLists.Set (freeList);
+    }
+  return freeList;
+}
+
+void
+PacketMetadata::DestroyFreeList (void *p)
+{
+  struct FreeList *freeList = static_cast<struct FreeList *> (p);
+  for (std::vector<struct Data *>::iterator i = freeList->data.begin ();
+       i != freeList->data.end (); i++)
+    {
+      PacketMetadata::Deallocate (*i);
+    }
+  delete freeList;
+}
+
 struct PacketMetadata::Data *
 PacketMetadata::Create (uint32_t size)
 {
-  NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
-  if (size > m_maxSize)
+  struct FreeList *freeList = GetFreeList ();
+  NS_LOG_LOGIC ("create size="<<size<<", max="<<freeList->maxSize);
+  if (size > freeList->maxSize)
     {
-      m_maxSize = size;
+      freeList->maxSize = size;
     }
-  while (!m_freeList.empty ()) 
+  while (!freeList->data.empty ()) 
     {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
+      struct PacketMetadata::Data *data = freeList->data.back ();
+      freeList->data.pop_back ();
       if (data->m_size >= size) 
         {
           NS_LOG_LOGIC ("create found size="<<data->m_size);
@@ -538,8 +642,8 @@ PacketMetadata::Create (uint32_t size)
       PacketMetadata::Deallocate (data);
       NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
     }
-  NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
-  return PacketMetadata::Allocate (m_maxSize);
+  NS_LOG_LOGIC ("create alloc size="<<freeList->maxSize);
+  return PacketMetadata::Allocate (freeList->maxSize);
 }
 
 void
@@ -550,16 +654,17 @@ PacketMetadata::Recycle (struct PacketMetadata::Data *data)
       PacketMetadata::Deallocate (data);
       return;
     } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
+  struct FreeList *freeList = GetFreeList ();
+  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<freeList->data.size ());
   NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
-      data->m_size < m_maxSize) 
+  if (freeList->data.size () > 1000 ||
+      data->m_size < freeList->maxSize) 
     {
       PacketMetadata::Deallocate (data);
     } 
   else 
     {
-      m_freeList.push_back (data);
+      freeList->data.push_back (data);
     }
 }
 
@@ -611,14 +716,24 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-
+  uint16_t chunkUid = __sync_fetch_and_add (&m_chunkUid, 1);
+  if (m_enableLazy)
+    {
+      PushDelta (ADD_HEADER, uid, size, chunkUid);
+      return;
+    }
+  Materialize ();
+  ApplyAddHeader (uid, size, chunkUid);
+}
+void
+PacketMetadata::ApplyAddHeader (uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
   struct PacketMetadata::SmallItem item;
   item.next = m_head;
   item.prev = 0xffff;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = chunkUid;
   uint16_t written = AddSmall (&item);
   UpdateHead (written);
 }
@@ -632,6 +747,20 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableLazy)
+    {
+      if (!CancelDelta (ADD_HEADER, uid, size))
+        {
+          PushDelta (REMOVE_HEADER, uid, size, 0);
+        }
+      return;
+    }
+  Materialize ();
+  ApplyRemoveHeader (uid, size);
+}
+void
+PacketMetadata::ApplyRemoveHeader (uint32_t uid, uint32_t size)
+{
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -678,13 +807,24 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  uint16_t chunkUid = __sync_fetch_and_add (&m_chunkUid, 1);
+  if (m_enableLazy)
+    {
+      PushDelta (ADD_TRAILER, uid, size, chunkUid);
+      return;
+    }
+  Materialize ();
+  ApplyAddTrailer (uid, size, chunkUid);
+}
+void
+PacketMetadata::ApplyAddTrailer (uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = chunkUid;
   uint16_t written = AddSmall (&item);
   UpdateTail (written);
 }
@@ -698,6 +838,20 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableLazy)
+    {
+      if (!CancelDelta (ADD_TRAILER, uid, size))
+        {
+          PushDelta (REMOVE_TRAILER, uid, size, 0);
+        }
+      return;
+    }
+  Materialize ();
+  ApplyRemoveTrailer (uid, size);
+}
+void
+PacketMetadata::ApplyRemoveTrailer (uint32_t uid, uint32_t size)
+{
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -743,6 +897,19 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableLazy)
+    {
+      PushDelta (ADD_AT_END, 0, 0, 0);
+      m_deltas->other = new PacketMetadata (o);
+      return;
+    }
+  Materialize ();
+  ApplyAddAtEnd (o);
+}
+void
+PacketMetadata::ApplyAddAtEnd (PacketMetadata const&o)
+{
+  o.Materialize ();
   if (m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
@@ -822,6 +989,17 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableLazy)
+    {
+      PushDelta (REMOVE_AT_START, 0, start, 0);
+      return;
+    }
+  Materialize ();
+  ApplyRemoveAtStart (start);
+}
+void
+PacketMetadata::ApplyRemoveAtStart (uint32_t start)
+{
   NS_ASSERT (m_data != 0);
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
@@ -883,6 +1061,17 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableLazy)
+    {
+      PushDelta (REMOVE_AT_END, 0, end, 0);
+      return;
+    }
+  Materialize ();
+  ApplyRemoveAtEnd (end);
+}
+void
+PacketMetadata::ApplyRemoveAtEnd (uint32_t end)
+{
   NS_ASSERT (m_data != 0);
 
   uint32_t leftToRemove = end;
@@ -937,9 +1126,108 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
     }
   NS_ASSERT (leftToRemove == 0);
 }
+void
+PacketMetadata::PushDelta (enum DeltaType type, uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
+  struct Delta *delta = new Delta ();
+  delta->count = 1;
+  delta->prev = m_deltas;
+  delta->type = type;
+  delta->chunkUid = chunkUid;
+  delta->uid = uid;
+  delta->size = size;
+  delta->other = 0;
+  // the new delta takes over the reference of this metadata to the
+  // previous one.
+  m_deltas = delta;
+}
+
+bool
+PacketMetadata::CancelDelta (enum DeltaType type, uint32_t uid, uint32_t size)
+{
+  // removing the chunk which was just added leaves the list of items as
+  // it was before the chunk was added.
+  struct Delta *last = m_deltas;
+  if (last == 0 || last->type != type || last->uid != uid || last->size != size)
+    {
+      return false;
+    }
+  m_deltas = last->prev;
+  if (m_deltas != 0)
+    {
+      __sync_add_and_fetch (&m_deltas->count, 1);
+    }
+  ReleaseDeltas (last);
+  return true;
+}
+
+void
+PacketMetadata::ReleaseDeltas (struct Delta *delta)
+{
+  while (delta != 0)
+    {
+      if (__sync_sub_and_fetch (&delta->count, 1) > 0)
+        {
+          break;
+        }
+      struct Delta *prev = delta->prev;
+      delete delta->other;
+      delete delta;
+      delta = prev;
+    }
+}
+
+void
+PacketMetadata::Materialize (void) const
+{
+  if (m_deltas == 0)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+  PacketMetadata *self = const_cast<PacketMetadata *> (this);
+  struct Delta *deltas = m_deltas;
+  self->m_deltas = 0;
+  std::vector<const struct Delta *> pending;
+  for (const struct Delta *delta = deltas; delta != 0; delta = delta->prev)
+    {
+      pending.push_back (delta);
+    }
+  for (std::vector<const struct Delta *>::reverse_iterator i = pending.rbegin (); i != pending.rend (); i++)
+    {
+      const struct Delta *delta = *i;
+      switch (delta->type)
+        {
+        case ADD_HEADER:
+          self->ApplyAddHeader (delta->uid, delta->size, delta->chunkUid);
+          break;
+        case REMOVE_HEADER:
+          self->ApplyRemoveHeader (delta->uid, delta->size);
+          break;
+        case ADD_TRAILER:
+          self->ApplyAddTrailer (delta->uid, delta->size, delta->chunkUid);
+          break;
+        case REMOVE_TRAILER:
+          self->ApplyRemoveTrailer (delta->uid, delta->size);
+          break;
+        case ADD_AT_END:
+          self->ApplyAddAtEnd (*delta->other);
+          break;
+        case REMOVE_AT_START:
+          self->ApplyRemoveAtStart (delta->size);
+          break;
+        case REMOVE_AT_END:
+          self->ApplyRemoveAtEnd (delta->size);
+          break;
+        }
+    }
+  ReleaseDeltas (deltas);
+}
+
 uint32_t
 PacketMetadata::GetTotalSize (void) const
 {
+  Materialize ();
   uint32_t totalSize = 0;
   uint16_t current = m_head;
   uint16_t tail = m_tail;
@@ -967,6 +1255,7 @@ PacketMetadata::GetUid (void) const
 PacketMetadata::ItemIterator 
 PacketMetadata::BeginItem (Buffer buffer) const
 {
+  Materialize ();
   return ItemIterator (this, buffer);
 }
 PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
@@ -1025,10 +1314,10 @@ PacketMetadata::ItemIterator::Next (void)
       item.type = PacketMetadata::Item::HEADER;
       if (!item.isFragment)
         {
-          ns3::Buffer tmp = m_buffer;
-          tmp.RemoveAtStart (m_offset);
-          tmp.RemoveAtEnd (tmp.GetSize () - item.currentSize);
-          item.current = tmp.Begin ();
+          m_item = m_buffer;
+          m_item.RemoveAtStart (m_offset);
+          m_item.RemoveAtEnd (m_item.GetSize () - item.currentSize);
+          item.current = m_item.Begin ();
         }
     }
   else if (tid.IsChildOf (Trailer::GetTypeId ()))
@@ -1036,10 +1325,10 @@ PacketMetadata::ItemIterator::Next (void)
       item.type = PacketMetadata::Item::TRAILER;
       if (!item.isFragment)
         {
-          ns3::Buffer tmp = m_buffer;
-          tmp.RemoveAtEnd (tmp.GetSize () - (m_offset + smallItem.size));
-          tmp.RemoveAtStart (tmp.GetSize () - item.currentSize);
-          item.current = tmp.End ();
+          m_item = m_buffer;
+          m_item.RemoveAtEnd (m_item.GetSize () - (m_offset + smallItem.size));
+          m_item.RemoveAtStart (m_item.GetSize () - item.currentSize);
+          item.current = m_item.End ();
         }
     }
   else 
@@ -1054,6 +1343,7 @@ uint32_t
 PacketMetadata::GetSerializedSize (void) const
 {
   NS_LOG_FUNCTION (this);
+  Materialize ();
   uint32_t totalSize = 0;
   totalSize += 4;
   if (!m_enable)
@@ -1091,16 +1381,41 @@ void
 PacketMetadata::Serialize (Buffer::Iterator i, uint32_t size) const
 {
   NS_LOG_FUNCTION (this);
-  uint32_t bytesWritten = 0;
-  i.WriteU32 (size);
-  bytesWritten += 4;
+  NS_ASSERT (size == GetSerializedSize ());
+  std::vector<uint8_t> tmp (size);
+  TagBuffer buffer = TagBuffer (&tmp[0], &tmp[0] + size);
+  Serialize (buffer);
+  i.Write (&tmp[0], size);
+}
+uint32_t 
+PacketMetadata::Deserialize (Buffer::Iterator i)
+{
+  NS_LOG_FUNCTION (this);
+  Buffer::Iterator start = i;
+  uint32_t size = i.ReadU32 ();
+  std::vector<uint8_t> tmp (size);
+  start.Read (&tmp[0], size);
+  TagBuffer buffer = TagBuffer (&tmp[0], &tmp[0] + size);
+  Deserialize (buffer);
+  return size;
+}
+void 
+PacketMetadata::Serialize (TagBuffer &buffer) const
+{
+  NS_LOG_FUNCTION (this);
+  Materialize ();
+  buffer.WriteU32 (GetSerializedSize ());
+  if (!m_enable)
+    {
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t current = m_head;
   while (current != 0xffff)
     {
       ReadItems (current, &item, &extraItem);
-      NS_LOG_LOGIC ("bytesWritten=" << bytesWritten << ", typeUid="<<
+      NS_LOG_LOGIC ("typeUid="<<
         item.typeUid << ", size="<<item.size<<", chunkUid="<<item.chunkUid<<
         ", fragmentStart="<<extraItem.fragmentStart<<", fragmentEnd="<<
         extraItem.fragmentEnd<< ", packetUid="<<extraItem.packetUid);
@@ -1110,29 +1425,20 @@ PacketMetadata::Serialize (Buffer::Iterator i, uint32_t size) const
           TypeId tid;
           tid.SetUid (uid);
           std::string uidString = tid.GetName ();
-          i.WriteU32 (uidString.size ());
-          bytesWritten += 4;
-          i.Write ((uint8_t *)uidString.c_str (), uidString.size ());
-          bytesWritten += uidString.size ();
+          buffer.WriteU32 (uidString.size ());
+          buffer.Write ((const uint8_t *)uidString.c_str (), uidString.size ());
         }
       else
         {
-          i.WriteU32 (0);
-          bytesWritten += 4;
+          buffer.WriteU32 (0);
         }
       uint8_t isBig = item.typeUid & 0x1;
-      i.WriteU8 (isBig);
-      bytesWritten += 1;
-      i.WriteU32 (item.size);
-      bytesWritten += 4;
-      i.WriteU16 (item.chunkUid);
-      bytesWritten += 2;
-      i.WriteU32 (extraItem.fragmentStart);
-      bytesWritten += 4;
-      i.WriteU32 (extraItem.fragmentEnd);
-      bytesWritten += 4;
-      i.WriteU32 (extraItem.packetUid);
-      bytesWritten += 4;
+      buffer.WriteU8 (isBig);
+      buffer.WriteU32 (item.size);
+      buffer.WriteU16 (item.chunkUid);
+      buffer.WriteU32 (extraItem.fragmentStart);
+      buffer.WriteU32 (extraItem.fragmentEnd);
+      buffer.WriteU32 (extraItem.packetUid);
       if (current == m_tail)
         {
           break;
@@ -1141,20 +1447,20 @@ PacketMetadata::Serialize (Buffer::Iterator i, uint32_t size) const
       NS_ASSERT (current != item.next);
       current = item.next;
     }
-  NS_ASSERT (bytesWritten == size);
 }
-uint32_t 
-PacketMetadata::Deserialize (Buffer::Iterator i)
+void 
+PacketMetadata::Deserialize (TagBuffer &buffer)
 {
   NS_LOG_FUNCTION (this);
+  Materialize ();
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
-  uint32_t totalSize = i.ReadU32 ();
-  uint32_t size = totalSize;
+  uint32_t size = buffer.ReadU32 ();
   size -= 4;
+  std::string uidString;
   while (size > 0)
     {
-      uint32_t uidStringSize = i.ReadU32 ();
+      uint32_t uidStringSize = buffer.ReadU32 ();
       size -= 4;
       uint32_t uid;
       if (uidStringSize == 0)
@@ -1164,28 +1470,20 @@ PacketMetadata::Deserialize (Buffer::Iterator i)
         }
       else
         {
-          std::string uidString;
-          for (uint32_t j = 0; j < uidStringSize; j++)
-            {
-              uidString.push_back (i.ReadU8 ());
-              size --;
-            }
+          uidString.resize (uidStringSize);
+          buffer.Read ((uint8_t *)&uidString[0], uidStringSize);
+          size -= uidStringSize;
           TypeId tid = TypeId::LookupByName (uidString);
           uid = tid.GetUid ();
         }
-      uint8_t isBig = i.ReadU8 ();
-      size --;
+      uint8_t isBig = buffer.ReadU8 ();
       item.typeUid = (uid << 1) | isBig;
-      item.size = i.ReadU32 ();
-      size -= 4;
-      item.chunkUid = i.ReadU16 ();
-      size -= 2;
-      extraItem.fragmentStart = i.ReadU32 ();
-      size -= 4;
-      extraItem.fragmentEnd = i.ReadU32 ();
-      size -= 4;
-      extraItem.packetUid = i.ReadU32 ();
-      size -= 4;
+      item.size = buffer.ReadU32 ();
+      item.chunkUid = buffer.ReadU16 ();
+      extraItem.fragmentStart = buffer.ReadU32 ();
+      extraItem.fragmentEnd = buffer.ReadU32 ();
+      extraItem.packetUid = buffer.ReadU32 ();
+      size -= 1 + 4 + 2 + 4 + 4 + 4;
       NS_LOG_LOGIC ("size=" << size << ", typeUid="<<item.typeUid <<
         ", size="<<item.size<<", chunkUid="<<item.chunkUid<<
         ", fragmentStart="<<extraItem.fragmentStart<<", fragmentEnd="<<
@@ -1193,10 +1491,7 @@ PacketMetadata::Deserialize (Buffer::Iterator i)
       uint32_t tmp = AddBig (0xffff, m_tail, &item, &extraItem);
       UpdateTail (tmp);
     }
-  NS_ASSERT (size == 0);
-  return totalSize;
 }
 
-
 } // namespace ns3
 
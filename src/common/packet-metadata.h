@@ -33,6 +33,7 @@ class Chunk;
 class Buffer;
 class Header;
 class Trailer;
+class TagBuffer;
 
 /**
  * \internal
@@ -106,7 +107,8 @@ public:
      */
     uint32_t currentTrimedFromEnd;
     /* an iterator which can be fed to Deserialize. Valid only
-     * if isFragment and isPayload are false.
+     * if isFragment and isPayload are false, and only until the
+     * next call to ItemIterator::Next.
      */
     Buffer::Iterator current;
   };
@@ -119,6 +121,9 @@ public:
   private:
     const PacketMetadata *m_metadata;
     Buffer m_buffer;
+    // the bytes of the last item: the segments of a buffer are
+    // referenced by its iterators.
+    Buffer m_item;
     uint16_t m_current;
     uint32_t m_offset;
     bool m_hasReadTail;
@@ -126,6 +131,31 @@ public:
 
   static void Enable (void);
   static void EnableChecking (void);
+  /**
+   * Enable the metadata, but only record the operations on the
+   * headers, trailers and fragments of each packet as a compact list of
+   * deltas, shared by the copies of a packet. The full list of items is
+   * rebuilt from the deltas when it is read, by BeginItem or Serialize.
+   * A header or trailer removed right after it was added cancels its
+   * delta, so the packets which are never printed cost little.
+   *
+   * This mode is ignored if EnableChecking is called, and is turned off
+   * by Enable and DisableLazy.
+   */
+  static void EnableLazy (void);
+  /**
+   * Keep the metadata enabled, but record the full list of items again.
+   * The deltas of a packet are applied the next time it is modified.
+   */
+  static void DisableLazy (void);
+  /**
+   * \returns true if the metadata is enabled, in any mode.
+   */
+  static bool IsEnabled (void);
+  /**
+   * \returns true if the metadata is recorded as deltas.
+   */
+  static bool IsLazyEnabled (void);
 
   inline PacketMetadata (uint32_t uid, uint32_t size);
   inline PacketMetadata (PacketMetadata const &o);
@@ -156,12 +186,25 @@ public:
   uint32_t GetSerializedSize (void) const;
   void Serialize (Buffer::Iterator i, uint32_t size) const;
   uint32_t Deserialize (Buffer::Iterator i);
+  /**
+   * \param buffer the raw buffer to write GetSerializedSize bytes into.
+   */
+  void Serialize (TagBuffer &buffer) const;
+  /**
+   * \param buffer the raw buffer to read from.
+   *
+   * Append the items written by PacketMetadata::Serialize to the
+   * items of this metadata.
+   */
+  void Deserialize (TagBuffer &buffer);
 
   ItemIterator BeginItem (Buffer buffer) const;
 
 private:
   struct Data {
-    /* number of references to this struct Data instance. */
+    /* number of references to this struct Data instance.
+     * The instances which share it might be used by different
+     * threads so, it is updated atomically, like m_dirtyEnd. */
     uint16_t m_count;
     /* size (in bytes) of m_data buffer below */
     uint16_t m_size;
@@ -236,15 +279,48 @@ private:
     uint32_t packetUid;
   };
 
-  class DataFreeList : public std::vector<struct Data *>
+  /* the free list of struct Data of a thread. */
+  struct FreeList;
+  class FreeListDestructor
   {
   public:
-    ~DataFreeList ();
+    ~FreeListDestructor ();
   };
 
-  friend DataFreeList::~DataFreeList ();
+  friend FreeListDestructor::~FreeListDestructor ();
   friend class ItemIterator;
 
+  enum DeltaType {
+    ADD_HEADER,
+    REMOVE_HEADER,
+    ADD_TRAILER,
+    REMOVE_TRAILER,
+    ADD_AT_END,
+    REMOVE_AT_START,
+    REMOVE_AT_END
+  };
+  /* an operation which was not yet applied to the list of items.
+   * The deltas form a singly-linked list, from the most recent
+   * one to the oldest one, whose tail is shared by the copies of
+   * a packet.
+   */
+  struct Delta {
+    /* number of references to this delta: from PacketMetadata
+       instances and from the next deltas. */
+    uint32_t count;
+    struct Delta *prev;
+    enum DeltaType type;
+    uint16_t chunkUid;
+    uint32_t uid;
+    /* the size of the chunk, or the number of bytes removed. */
+    uint32_t size;
+    /* the metadata appended by ADD_AT_END. */
+    PacketMetadata *other;
+
+    static void *operator new (size_t size);
+    static void operator delete (void *buffer, size_t size);
+  };
+
   PacketMetadata ();
 
   inline uint16_t AddSmall (const PacketMetadata::SmallItem *item);
@@ -263,29 +339,43 @@ private:
   inline void AppendValue (uint32_t value, uint8_t *buffer);
   void AppendValueExtra (uint32_t value, uint8_t *buffer);
   inline void Reserve (uint32_t n);
+  bool ClaimDirtyArea (uint32_t n);
   void ReserveCopy (uint32_t n);
   uint32_t GetTotalSize (void) const;
   uint32_t ReadItems (uint16_t current, 
                       struct PacketMetadata::SmallItem *item,
                       struct PacketMetadata::ExtraItem *extraItem) const;
   void DoAddHeader (uint32_t uid, uint32_t size);
+  void ApplyAddHeader (uint32_t uid, uint32_t size, uint16_t chunkUid);
+  void ApplyRemoveHeader (uint32_t uid, uint32_t size);
+  void ApplyAddTrailer (uint32_t uid, uint32_t size, uint16_t chunkUid);
+  void ApplyRemoveTrailer (uint32_t uid, uint32_t size);
+  void ApplyAddAtEnd (PacketMetadata const&o);
+  void ApplyRemoveAtStart (uint32_t start);
+  void ApplyRemoveAtEnd (uint32_t end);
+  void PushDelta (enum DeltaType type, uint32_t uid, uint32_t size, uint16_t chunkUid);
+  bool CancelDelta (enum DeltaType type, uint32_t uid, uint32_t size);
+  void Materialize (void) const;
+  static void ReleaseDeltas (struct Delta *delta);
 
 
   static struct PacketMetadata::Data *Create (uint32_t size);
   static void Recycle (struct PacketMetadata::Data *data);
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
+  static struct FreeList *GetFreeList (void);
+  static void DestroyFreeList (void *freeList);
   
-  static DataFreeList m_freeList;
+  static FreeListDestructor m_freeListDestructor;
   static bool m_enable;
   static bool m_enableChecking;
+  static bool m_enableLazy;
 
   // set to true when adding metadata to a packet is skipped because
   // m_enable is false; used to detect enabling of metadata in the
   // middle of a simulation, which isn't allowed.
   static bool m_metadataSkipped;
 
-  static uint32_t m_maxSize;
   static uint16_t m_chunkUid;
   
   struct Data *m_data;
@@ -298,6 +388,8 @@ private:
   uint16_t m_tail;
   uint16_t m_used;
   uint32_t m_packetUid;
+  /* the deltas not yet applied to the items above. */
+  struct Delta *m_deltas;
 };
 
 }; // namespace ns3
@@ -309,7 +401,8 @@ PacketMetadata::PacketMetadata (uint32_t uid, uint32_t size)
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
-    m_packetUid (uid)
+    m_packetUid (uid),
+    m_deltas (0)
 {
   memset (m_data->m_data, 0xff, 4);
   if (size > 0)
@@ -322,10 +415,15 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_head (o.m_head),
     m_tail (o.m_tail),
     m_used (o.m_used),
-    m_packetUid (o.m_packetUid)
+    m_packetUid (o.m_packetUid),
+    m_deltas (o.m_deltas)
 {
   NS_ASSERT (m_data != 0);
-  m_data->m_count++;
+  __sync_add_and_fetch (&m_data->m_count, 1);
+  if (m_deltas != 0)
+    {
+      __sync_add_and_fetch (&m_deltas->count, 1);
+    }
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -334,26 +432,40 @@ PacketMetadata::operator = (PacketMetadata const& o)
     {
       // not self assignment
       NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
         {
           PacketMetadata::Recycle (m_data);
         }
       m_data = o.m_data;
       NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      __sync_add_and_fetch (&m_data->m_count, 1);
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
   m_used = o.m_used;
   m_packetUid = o.m_packetUid;
+  if (m_deltas != o.m_deltas)
+    {
+      if (o.m_deltas != 0)
+        {
+          __sync_add_and_fetch (&o.m_deltas->count, 1);
+        }
+      if (m_deltas != 0)
+        {
+          ReleaseDeltas (m_deltas);
+        }
+      m_deltas = o.m_deltas;
+    }
   return *this;
 }
 PacketMetadata::~PacketMetadata ()
 {
+  if (m_deltas != 0)
+    {
+      ReleaseDeltas (m_deltas);
+    }
   NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -28,104 +28,68 @@ NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
-#ifdef USE_FREE_LIST
-
-struct PacketTagList::TagData *PacketTagList::g_free = 0;
-uint32_t PacketTagList::g_nfree = 0;
-
-struct PacketTagList::TagData *
-PacketTagList::AllocData (void) const
+struct PacketTagList::TagSpill *
+PacketTagList::GetWritableSpill (void)
 {
-  NS_LOG_FUNCTION (g_nfree);
-  struct PacketTagList::TagData *retval;
-  if (g_free != 0) 
+  if (m_spill == 0)
     {
-      retval = g_free;
-      g_free = g_free->m_next;
-      g_nfree--;
-    } 
-  else 
+      m_spill = new TagSpill ();
+      m_spill->count = 1;
+    }
+  else if (m_spill->count > 1)
     {
-      retval = new struct PacketTagList::TagData ();
+      NS_LOG_LOGIC ("copy shared spill " << m_spill);
+      struct TagSpill *copy = new TagSpill ();
+      copy->count = 1;
+      copy->tags = m_spill->tags;
+      ReleaseSpill (m_spill);
+      m_spill = copy;
     }
-  return retval;
+  return m_spill;
 }
 
-void
-PacketTagList::FreeData (struct TagData *data) const
+int32_t
+PacketTagList::Find (TypeId tid) const
 {
-  NS_LOG_FUNCTION (g_nfree << data);
-  if (g_nfree > 1000) 
+  for (uint32_t i = 0; i < m_size; i++)
     {
-      delete data;
-      return;
+      if (GetSlot (i)->tid == tid)
+        {
+          return i;
+        }
     }
-  g_nfree++;
-  data->next = g_free;
-  data->tid = TypeId ();
-  g_free = data;
-}
-#else
-struct PacketTagList::TagData *
-PacketTagList::AllocData (void) const
-{
-  NS_LOG_FUNCTION_NOARGS ();
-  struct PacketTagList::TagData *retval;
-  retval = new struct PacketTagList::TagData ();
-  return retval;
-}
-
-void
-PacketTagList::FreeData (struct TagData *data) const
-{
-  NS_LOG_FUNCTION (data);
-  delete data;
+  return -1;
 }
-#endif
 
 bool
 PacketTagList::Remove (Tag &tag)
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  bool found = false;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  int32_t found = Find (tag.GetInstanceTypeId ());
+  if (found == -1) 
     {
-      if (cur->tid == tid) 
-        {
-          found = true;
-          tag.Deserialize (TagBuffer (cur->data, cur->data+PACKET_TAG_MAX_SIZE));
-        }
+      return false;
     }
-  if (!found) 
+  const struct TagData *data = GetSlot (found);
+  tag.Deserialize (TagBuffer ((uint8_t *)data->data, (uint8_t *)data->data+PACKET_TAG_MAX_SIZE));
+  if (m_size > PACKET_TAG_INLINE_TAGS)
     {
-      return false;
+      GetWritableSpill ();
     }
-  struct TagData *start = 0;
-  struct TagData **prevNext = &start;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  for (uint32_t i = found; i + 1 < m_size; i++)
     {
-      if (cur->tid == tid) 
+      *GetSlot (i) = *GetSlot (i + 1);
+    }
+  m_size--;
+  if (m_size >= PACKET_TAG_INLINE_TAGS && m_spill != 0)
+    {
+      m_spill->tags.pop_back ();
+      if (m_spill->tags.empty ())
         {
-          /**
-           * XXX
-           * Note: I believe that we could optimize this to
-           * avoid copying each TagData located after the target id
-           * and just link the already-copied list to the next tag.
-           */
-          continue;
+          ReleaseSpill (m_spill);
+          m_spill = 0;
         }
-      struct TagData *copy = AllocData ();
-      copy->tid = cur->tid;
-      copy->count = 1;
-      copy->next = 0;
-      memcpy (copy->data, cur->data, PACKET_TAG_MAX_SIZE);
-      *prevNext = copy;
-      prevNext = &copy->next;
     }
-  *prevNext = 0;
-  RemoveAll ();
-  m_next = start;
   return true;
 }
 
@@ -134,43 +98,95 @@ PacketTagList::Add (const Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
   // ensure this id was not yet added
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
-    {
-      NS_ASSERT (cur->tid != tag.GetInstanceTypeId ());
-    }
-  struct TagData *head = AllocData ();
-  head->count = 1;
-  head->next = 0;
-  head->tid = tag.GetInstanceTypeId ();
-  head->next = m_next;
+  NS_ASSERT (Find (tag.GetInstanceTypeId ()) == -1);
   NS_ASSERT (tag.GetSerializedSize () < PACKET_TAG_MAX_SIZE);
-  tag.Serialize (TagBuffer (head->data, head->data+tag.GetSerializedSize ()));
+  struct TagData *data = const_cast<PacketTagList *> (this)->AddSlot ();
+  data->tid = tag.GetInstanceTypeId ();
+  tag.Serialize (TagBuffer (data->data, data->data+tag.GetSerializedSize ()));
+}
 
-  const_cast<PacketTagList *> (this)->m_next = head;
+struct PacketTagList::TagData *
+PacketTagList::AddSlot (void)
+{
+  struct TagData *data;
+  if (m_size < PACKET_TAG_INLINE_TAGS)
+    {
+      data = &m_tags[m_size];
+    }
+  else
+    {
+      struct TagSpill *spill = GetWritableSpill ();
+      spill->tags.push_back (TagData ());
+      data = &spill->tags.back ();
+    }
+  m_size++;
+  return data;
 }
 
 bool
 PacketTagList::Peek (Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  int32_t found = Find (tag.GetInstanceTypeId ());
+  if (found == -1) 
     {
-      if (cur->tid == tid) 
-        {
-          /* found tag */
-          tag.Deserialize (TagBuffer (cur->data, cur->data+PACKET_TAG_MAX_SIZE));
-          return true;
-        }
+      /* no tag found */
+      return false;
     }
-  /* no tag found */
-  return false;
+  const struct TagData *data = GetSlot (found);
+  tag.Deserialize (TagBuffer ((uint8_t *)data->data, (uint8_t *)data->data+PACKET_TAG_MAX_SIZE));
+  return true;
 }
 
 const struct PacketTagList::TagData *
-PacketTagList::Head (void) const
+PacketTagList::GetTag (uint32_t i) const
+{
+  NS_ASSERT (i < m_size);
+  return GetSlot (m_size - 1 - i);
+}
+
+uint32_t
+PacketTagList::GetSerializedSize (void) const
+{
+  uint32_t size = 4;
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      size += 2 + GetSlot (i)->tid.GetName ().size () + PACKET_TAG_MAX_SIZE;
+    }
+  return size;
+}
+
+void
+PacketTagList::Serialize (TagBuffer &buffer) const
 {
-  return m_next;
+  NS_LOG_FUNCTION (this);
+  buffer.WriteU32 (m_size);
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      const struct TagData *data = GetSlot (i);
+      std::string name = data->tid.GetName ();
+      buffer.WriteU16 (name.size ());
+      buffer.Write ((const uint8_t *)name.c_str (), name.size ());
+      buffer.Write (data->data, PACKET_TAG_MAX_SIZE);
+    }
+}
+
+void
+PacketTagList::Deserialize (TagBuffer &buffer)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t n = buffer.ReadU32 ();
+  std::string name;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      name.resize (buffer.ReadU16 ());
+      buffer.Read ((uint8_t *)&name[0], name.size ());
+      TypeId tid = TypeId::LookupByName (name);
+      NS_ASSERT (Find (tid) == -1);
+      struct TagData *data = AddSlot ();
+      data->tid = tid;
+      buffer.Read (data->data, PACKET_TAG_MAX_SIZE);
+    }
 }
 
 } // namespace ns3
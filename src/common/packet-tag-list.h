@@ -22,7 +22,9 @@
 
 #include <stdint.h>
 #include <ostream>
+#include <vector>
 #include "ns3/type-id.h"
+#include "tag-buffer.h"
 
 namespace ns3 {
 
@@ -36,14 +38,21 @@ class Tag;
  */
 #define PACKET_TAG_MAX_SIZE 20
 
+/**
+ * \brief the list of the packet tags of a packet
+ *
+ * The first PACKET_TAG_INLINE_TAGS tags are stored within the list
+ * itself, so adding, looking up and removing a few tags does not
+ * allocate memory. The tags added beyond these spill over to a heap
+ * array which is shared between the copies of a list until one of them
+ * modifies it.
+ */
 class PacketTagList 
 {
 public:
   struct TagData {
     uint8_t data[PACKET_TAG_MAX_SIZE];
-    struct TagData *next;
     TypeId tid;
-    uint32_t count;
   };
 
   inline PacketTagList ();
@@ -56,18 +65,55 @@ public:
   bool Peek (Tag &tag) const;
   inline void RemoveAll (void);
 
-  const struct PacketTagList::TagData *Head (void) const;
+  /**
+   * \returns the number of tags in this list.
+   */
+  inline uint32_t GetNTags (void) const;
+  /**
+   * \param i the index of a tag, in [0,GetNTags ())
+   * \returns the tag, the most recently added ones first.
+   */
+  const struct PacketTagList::TagData *GetTag (uint32_t i) const;
+
+  /**
+   * \returns the number of bytes needed to serialize this list
+   *          with PacketTagList::Serialize.
+   */
+  uint32_t GetSerializedSize (void) const;
+  /**
+   * \param buffer the raw buffer to write into.
+   *
+   * The tags are identified by the name of their TypeId.
+   */
+  void Serialize (TagBuffer &buffer) const;
+  /**
+   * \param buffer the raw buffer to read from.
+   *
+   * Add the tags written by PacketTagList::Serialize to this list.
+   */
+  void Deserialize (TagBuffer &buffer);
 
 private:
+  enum {
+    PACKET_TAG_INLINE_TAGS = 4
+  };
+  struct TagSpill {
+    /* updated atomically: the lists which share a spill might be
+     * used by different threads. */
+    uint32_t count;
+    std::vector<struct TagData> tags;
+  };
 
-  bool Remove (TypeId tid);
-  struct PacketTagList::TagData *AllocData (void) const;
-  void FreeData (struct TagData *data) const;
-
-  static struct PacketTagList::TagData *g_free;
-  static uint32_t g_nfree;
+  inline const struct TagData *GetSlot (uint32_t i) const;
+  inline struct TagData *GetSlot (uint32_t i);
+  int32_t Find (TypeId tid) const;
+  struct TagData *AddSlot (void);
+  struct TagSpill *GetWritableSpill (void);
+  static inline void ReleaseSpill (struct TagSpill *spill);
 
-  struct TagData *m_next;
+  uint32_t m_size;
+  struct TagData m_tags[PACKET_TAG_INLINE_TAGS];
+  struct TagSpill *m_spill;
 };
 
 } // namespace ns3
@@ -79,15 +125,21 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_size (0),
+    m_spill (0)
 {}
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_size (o.m_size),
+    m_spill (o.m_spill)
 {
-  if (m_next != 0) 
+  for (uint32_t i = 0; i < m_size && i < PACKET_TAG_INLINE_TAGS; i++)
     {
-      m_next->count++;
+      m_tags[i] = o.m_tags[i];
+    }
+  if (m_spill != 0) 
+    {
+      __sync_add_and_fetch (&m_spill->count, 1);
     }
 }
 
@@ -95,46 +147,75 @@ PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o) 
     {
       return *this;
     }
-  RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
+  if (o.m_spill != 0)
+    {
+      __sync_add_and_fetch (&o.m_spill->count, 1);
+    }
+  ReleaseSpill (m_spill);
+  m_spill = o.m_spill;
+  m_size = o.m_size;
+  for (uint32_t i = 0; i < m_size && i < PACKET_TAG_INLINE_TAGS; i++)
     {
-      m_next->count++;
+      m_tags[i] = o.m_tags[i];
     }
   return *this;
 }
 
 PacketTagList::~PacketTagList ()
 {
-  RemoveAll ();
+  ReleaseSpill (m_spill);
 }
 
 void
-PacketTagList::RemoveAll (void)
+PacketTagList::ReleaseSpill (struct TagSpill *spill)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  if (spill != 0)
     {
-      cur->count--;
-      if (cur->count > 0) 
-        {
-          break;
-        }
-      if (prev != 0) 
+      if (__sync_sub_and_fetch (&spill->count, 1) == 0)
         {
-          FreeData (prev);
+          delete spill;
         }
-      prev = cur;
     }
-  if (prev != 0) 
+}
+
+void
+PacketTagList::RemoveAll (void)
+{
+  ReleaseSpill (m_spill);
+  m_spill = 0;
+  m_size = 0;
+}
+
+uint32_t
+PacketTagList::GetNTags (void) const
+{
+  return m_size;
+}
+
+// the tags are stored in the order they were added: the first ones in
+// m_tags, the others in m_spill.
+const struct PacketTagList::TagData *
+PacketTagList::GetSlot (uint32_t i) const
+{
+  if (i < PACKET_TAG_INLINE_TAGS)
+    {
+      return &m_tags[i];
+    }
+  return &m_spill->tags[i - PACKET_TAG_INLINE_TAGS];
+}
+
+struct PacketTagList::TagData *
+PacketTagList::GetSlot (uint32_t i)
+{
+  if (i < PACKET_TAG_INLINE_TAGS)
     {
-      FreeData (prev);
+      return &m_tags[i];
     }
-  m_next = 0;
+  return &m_spill->tags[i - PACKET_TAG_INLINE_TAGS];
 }
 
 } // namespace ns3
@@ -17,11 +17,19 @@
  *
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
+#include "ns3/core-config.h"
 #include "packet.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/test.h"
+#include "ns3/free-list-pool.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#endif /* HAVE_PTHREAD_H */
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <stdarg.h>
 
 NS_LOG_COMPONENT_DEFINE ("Packet");
@@ -30,6 +38,51 @@ namespace ns3 {
 
 uint32_t Packet::m_globalUid = 0;
 
+namespace {
+
+// the maximum number of blocks kept by the freelist of a thread: the
+// packets of a simulation are typically retired at about the rate they
+// are created, so a deep freelist is only needed to absorb bursts.
+FreeListPool &
+GetPacketPool (void)
+{
+  static FreeListPool pool (sizeof (Packet), 1, 8192);
+  return pool;
+}
+
+} // anonymous namespace
+
+void *
+Packet::operator new (size_t size)
+{
+  NS_ASSERT (size == sizeof (Packet));
+  return GetPacketPool ().Allocate (size);
+}
+
+void
+Packet::operator delete (void *buffer, size_t size)
+{
+  GetPacketPool ().Deallocate (buffer, size);
+}
+
+struct Packet::PoolStats
+Packet::GetPoolStats (void)
+{
+  FreeListPool::Stats poolStats = GetPacketPool ().GetStats ();
+  struct PoolStats stats;
+  stats.allocations = poolStats.allocations;
+  stats.hits = poolStats.hits;
+  stats.pooled = poolStats.pooled;
+  stats.maxPooled = poolStats.maxPooled;
+  return stats;
+}
+
+void
+Packet::TrimPool (void)
+{
+  GetPacketPool ().Trim ();
+}
+
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
 {
@@ -79,21 +132,22 @@ ByteTagIterator::ByteTagIterator (ByteTagList::Iterator i)
 {}
 
 
-PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *head)
-  : m_current (head)
+PacketTagIterator::PacketTagIterator (const PacketTagList *list)
+  : m_list (list),
+    m_current (0)
 {}
 bool 
 PacketTagIterator::HasNext (void) const
 {
-  return m_current != 0;
+  return m_current < m_list->GetNTags ();
 }
 PacketTagIterator::Item 
 PacketTagIterator::Next (void)
 {
   NS_ASSERT (HasNext ());
-  const struct PacketTagList::TagData *prev = m_current;
-  m_current = m_current->next;
-  return PacketTagIterator::Item (prev);
+  const struct PacketTagList::TagData *data = m_list->GetTag (m_current);
+  m_current++;
+  return PacketTagIterator::Item (data);
 }
 
 PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
@@ -125,10 +179,9 @@ Packet::Packet ()
   : m_buffer (),
     m_byteTagList (),
     m_packetTagList (),
-    m_metadata (m_globalUid, 0),
+    m_metadata (__sync_fetch_and_add (&m_globalUid, 1), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 
 Packet::Packet (const Packet &o)
@@ -161,24 +214,32 @@ Packet::Packet (uint32_t size)
   : m_buffer (size),
     m_byteTagList (),
     m_packetTagList (),
-    m_metadata (m_globalUid, size),
+    m_metadata (__sync_fetch_and_add (&m_globalUid, 1), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const*buffer, uint32_t size)
   : m_buffer (),
     m_byteTagList (),
     m_packetTagList (),
-    m_metadata (m_globalUid, size),
+    m_metadata (__sync_fetch_and_add (&m_globalUid, 1), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
 }
 
+Packet::Packet (uint8_t const*buffer, uint32_t size, bool magic)
+  : m_buffer (),
+    m_byteTagList (),
+    m_packetTagList (),
+    m_metadata (0, 0),
+    m_nixVector (0)
+{
+  DoDeserialize (buffer, size);
+}
+
 Packet::Packet (const Buffer &buffer,  const ByteTagList &byteTagList, 
                 const PacketTagList &packetTagList, const PacketMetadata &metadata)
   : m_buffer (buffer),
@@ -196,9 +257,20 @@ Packet::CreateFragment (uint32_t start, uint32_t length) const
   NS_ASSERT (m_buffer.GetSize () >= start + length);
   uint32_t end = m_buffer.GetSize () - (start + length);
   PacketMetadata metadata = m_metadata.CreateFragment (start, end);
+  // the first byte of the fragment might not be at the same offset
+  // as in the original buffer.
+  int32_t adjustment = buffer.GetCurrentStartOffset () - (m_buffer.GetCurrentStartOffset () + start);
+  ByteTagList byteTagList = m_byteTagList;
+  if (adjustment != 0)
+    {
+      byteTagList.AddAtStart (adjustment, buffer.GetCurrentStartOffset ());
+    }
+  // the fragment shares the tag list of this packet unless some of its
+  // tags tag none of the bytes of the fragment.
+  byteTagList.Compact (buffer.GetCurrentStartOffset (), buffer.GetCurrentEndOffset ());
   // again, call the constructor directly rather than
   // through Create because it is private.
-  return Ptr<Packet> (new Packet (buffer, m_byteTagList, m_packetTagList, metadata), false);
+  return Ptr<Packet> (new Packet (buffer, byteTagList, m_packetTagList, metadata), false);
 }
 
 void
@@ -239,7 +311,15 @@ Packet::RemoveHeader (Header &header)
 {
   uint32_t deserialized = header.Deserialize (m_buffer.Begin ());
   NS_LOG_FUNCTION (this << header.GetInstanceTypeId ().GetName () << deserialized);
+  uint32_t orgStart = m_buffer.GetCurrentStartOffset () + std::min (deserialized, m_buffer.GetSize ());
   m_buffer.RemoveAtStart (deserialized);
+  // Update tag offsets if the remaining bytes were moved
+  int32_t adjustment = m_buffer.GetCurrentStartOffset () - orgStart;
+  if (adjustment != 0)
+    {
+      m_byteTagList.AddAtStart (adjustment, m_buffer.GetCurrentStartOffset ());
+    }
+  m_byteTagList.Compact (m_buffer.GetCurrentStartOffset (), m_buffer.GetCurrentEndOffset ());
   m_metadata.RemoveHeader (header, deserialized);
   return deserialized;
 }
@@ -272,6 +352,7 @@ Packet::RemoveTrailer (Trailer &trailer)
   uint32_t deserialized = trailer.Deserialize (m_buffer.End ());
   NS_LOG_FUNCTION (this << trailer.GetInstanceTypeId ().GetName () << deserialized);
   m_buffer.RemoveAtEnd (deserialized);
+  m_byteTagList.Compact (m_buffer.GetCurrentStartOffset (), m_buffer.GetCurrentEndOffset ());
   m_metadata.RemoveTrailer (trailer, deserialized);
   return deserialized;
 }
@@ -317,13 +398,22 @@ Packet::RemoveAtEnd (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   m_buffer.RemoveAtEnd (size);
+  m_byteTagList.Compact (m_buffer.GetCurrentStartOffset (), m_buffer.GetCurrentEndOffset ());
   m_metadata.RemoveAtEnd (size);
 }
 void 
 Packet::RemoveAtStart (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
+  uint32_t orgStart = m_buffer.GetCurrentStartOffset () + std::min (size, m_buffer.GetSize ());
   m_buffer.RemoveAtStart (size);
+  // Update tag offsets if the remaining bytes were moved
+  int32_t adjustment = m_buffer.GetCurrentStartOffset () - orgStart;
+  if (adjustment != 0)
+    {
+      m_byteTagList.AddAtStart (adjustment, m_buffer.GetCurrentStartOffset ());
+    }
+  m_byteTagList.Compact (m_buffer.GetCurrentStartOffset (), m_buffer.GetCurrentEndOffset ());
   m_metadata.RemoveAtStart (size);
 }
 
@@ -525,6 +615,18 @@ Packet::EnablePrinting (void)
   PacketMetadata::Enable ();
 }
 
+void
+Packet::EnableLazyPrinting (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // the mode chosen by a previous call to EnablePrinting or
+  // EnableChecking is kept.
+  if (!PacketMetadata::IsEnabled ())
+    {
+      PacketMetadata::EnableLazy ();
+    }
+}
+
 void
 Packet::EnableChecking (void)
 {
@@ -532,58 +634,92 @@ Packet::EnableChecking (void)
   PacketMetadata::EnableChecking ();
 }
 
+/* The serialized form of a packet is its total size and its uid
+ * followed by the serialized form of its byte buffer, of its byte and
+ * packet tags, of its nix-vector if it has one and of its metadata.
+ */
+uint32_t
+Packet::GetSerializedSize (void) const
+{
+  uint32_t size = 4 + 4 + 1;
+  size += m_buffer.GetSerializedSize ();
+  size += m_byteTagList.GetSerializedSize (m_buffer.GetCurrentStartOffset (),
+                                           m_buffer.GetCurrentEndOffset ());
+  size += m_packetTagList.GetSerializedSize ();
+  if (m_nixVector != 0)
+    {
+      size += m_nixVector->GetSerializedSize ();
+    }
+  size += m_metadata.GetSerializedSize ();
+  return size;
+}
+
+uint32_t
+Packet::Serialize (uint8_t *buffer, uint32_t maxSize) const
+{
+  NS_LOG_FUNCTION (this << maxSize);
+  uint32_t size = GetSerializedSize ();
+  if (size > maxSize)
+    {
+      return 0;
+    }
+  TagBuffer tmp = TagBuffer (buffer, buffer + size);
+  tmp.WriteU32 (size);
+  tmp.WriteU32 (m_metadata.GetUid ());
+  m_buffer.Serialize (tmp);
+  m_byteTagList.Serialize (tmp, m_buffer.GetCurrentStartOffset (),
+                           m_buffer.GetCurrentEndOffset ());
+  m_packetTagList.Serialize (tmp);
+  tmp.WriteU8 (m_nixVector != 0);
+  if (m_nixVector != 0)
+    {
+      m_nixVector->Serialize (tmp);
+    }
+  m_metadata.Serialize (tmp);
+  return size;
+}
+
+void
+Packet::DoDeserialize (uint8_t const*buffer, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  TagBuffer tmp = TagBuffer (const_cast<uint8_t *> (buffer), 
+                             const_cast<uint8_t *> (buffer) + size);
+  uint32_t serializedSize = tmp.ReadU32 ();
+  NS_ASSERT_MSG (serializedSize <= size, "Truncated serialized packet");
+  tmp.TrimAtEnd (size - serializedSize);
+  m_metadata = PacketMetadata (tmp.ReadU32 (), 0);
+  m_buffer.Deserialize (tmp);
+  m_byteTagList.RemoveAll ();
+  m_byteTagList.Deserialize (tmp, m_buffer.GetCurrentStartOffset ());
+  m_packetTagList.RemoveAll ();
+  m_packetTagList.Deserialize (tmp);
+  m_nixVector = 0;
+  if (tmp.ReadU8 ())
+    {
+      m_nixVector = CreateObject<NixVector> ();
+      m_nixVector->Deserialize (tmp);
+    }
+  m_metadata.Deserialize (tmp);
+}
+
 Buffer 
 Packet::Serialize (void) const
 {
   NS_LOG_FUNCTION (this);
+  uint32_t size = GetSerializedSize ();
+  std::vector<uint8_t> tmp (size);
+  Serialize (&tmp[0], size);
   Buffer buffer;
-  uint32_t reserve;
-
-  // write metadata
-  reserve = m_metadata.GetSerializedSize ();
-  buffer.AddAtStart (reserve);
-  m_metadata.Serialize (buffer.Begin (), reserve);
-
-  // write tags
-  //XXX
-  //reserve = m_tags.GetSerializedSize ();
-  //buffer.AddAtStart (reserve);
-  //m_tags.Serialize (buffer.Begin (), reserve);
-  
-  // aggregate byte buffer, metadata, and tags
-  Buffer tmp = m_buffer.CreateFullCopy ();
-  tmp.AddAtEnd (buffer);
-  
-  // write byte buffer size.
-  tmp.AddAtStart (4);
-  tmp.Begin ().WriteU32 (m_buffer.GetSize ());
-
-  return tmp;
+  buffer.AddAtStart (size);
+  buffer.Begin ().Write (&tmp[0], size);
+  return buffer;
 }
 void 
 Packet::Deserialize (Buffer buffer)
 {
   NS_LOG_FUNCTION (this);
-  Buffer buf = buffer;
-  // read size
-  uint32_t packetSize = buf.Begin ().ReadU32 ();
-  buf.RemoveAtStart (4);
-
-  // read buffer.
-  buf.RemoveAtEnd (buf.GetSize () - packetSize);
-  m_buffer = buf;
-  buffer.RemoveAtStart (4 + packetSize);
-
-
-  // read tags
-  //XXX
-  //uint32_t tagsDeserialized = m_tags.Deserialize (buffer.Begin ());
-  //buffer.RemoveAtStart (tagsDeserialized);
-
-  // read metadata
-  uint32_t metadataDeserialized = 
-    m_metadata.Deserialize (buffer.Begin ());
-  buffer.RemoveAtStart (metadataDeserialized);
+  DoDeserialize (buffer.PeekData (), buffer.GetSize ());
 }
 
 void 
@@ -671,7 +807,7 @@ Packet::PrintPacketTags (std::ostream &os) const
 PacketTagIterator 
 Packet::GetPacketTagIterator (void) const
 {
-  return PacketTagIterator (m_packetTagList.Head ());
+  return PacketTagIterator (&m_packetTagList);
 }
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet)
@@ -1070,6 +1206,168 @@ PacketTest::DoRun (void)
     NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (b), false, "trivial");
   }
 
+  {
+    // more tags than the list stores inline: the others spill over to
+    // an array shared by the copies of the packet.
+    Packet p;
+    p.AddPacketTag (ATestTag<1> ());
+    p.AddPacketTag (ATestTag<2> ());
+    p.AddPacketTag (ATestTag<3> ());
+    p.AddPacketTag (ATestTag<4> ());
+    p.AddPacketTag (ATestTag<5> ());
+    p.AddPacketTag (ATestTag<6> ());
+    Packet copy = p;
+    copy.AddPacketTag (ATestTag<7> ());
+    ATestTag<2> two;
+    NS_TEST_EXPECT_MSG_EQ (copy.RemovePacketTag (two), true, "inline tag removed");
+    NS_TEST_EXPECT_MSG_EQ (two.m_error, false, "inline tag read");
+    ATestTag<6> six;
+    NS_TEST_EXPECT_MSG_EQ (copy.RemovePacketTag (six), true, "spilled tag removed");
+    NS_TEST_EXPECT_MSG_EQ (six.m_error, false, "spilled tag read");
+    NS_TEST_EXPECT_MSG_EQ (copy.PeekPacketTag (six), false, "spilled tag gone");
+
+    // the original packet is unchanged.
+    uint32_t expected[] = {6, 5, 4, 3, 2, 1};
+    uint32_t n = 0;
+    PacketTagIterator i = p.GetPacketTagIterator ();
+    while (i.HasNext ())
+      {
+        PacketTagIterator::Item item = i.Next ();
+        std::ostringstream oss;
+        oss << "anon::ATestTag<" << expected[n] << ">";
+        NS_TEST_EXPECT_MSG_EQ (item.GetTypeId ().GetName (), oss.str (), "most recent tag first");
+        n++;
+      }
+    NS_TEST_EXPECT_MSG_EQ (n, 6, "tags of the original packet");
+
+    uint32_t expectedCopy[] = {7, 5, 4, 3, 1};
+    n = 0;
+    i = copy.GetPacketTagIterator ();
+    while (i.HasNext ())
+      {
+        PacketTagIterator::Item item = i.Next ();
+        std::ostringstream oss;
+        oss << "anon::ATestTag<" << expectedCopy[n] << ">";
+        NS_TEST_EXPECT_MSG_EQ (item.GetTypeId ().GetName (), oss.str (), "most recent tag first");
+        n++;
+      }
+    NS_TEST_EXPECT_MSG_EQ (n, 5, "tags of the copy");
+
+    ATestTag<7> seven;
+    NS_TEST_EXPECT_MSG_EQ (copy.PeekPacketTag (seven), true, "tag added after the copy");
+    NS_TEST_EXPECT_MSG_EQ (seven.m_error, false, "tag added after the copy");
+    NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (seven), false, "tag added to the copy only");
+  }
+
+  {
+    // large packets are appended by reference, and their tags follow them
+    std::vector<uint8_t> bytes (1000, 0x5a);
+    Ptr<Packet> a = Create<Packet> (&bytes[0], bytes.size ());
+    a->AddByteTag (ATestTag<1> ());
+    Ptr<Packet> b = Create<Packet> (&bytes[0], bytes.size ());
+    b->AddByteTag (ATestTag<2> ());
+    a->AddAtEnd (b);
+    CHECK (a, 2, E (1, 0, 1000), E (2, 1000, 2000));
+    Ptr<Packet> frag = a->CreateFragment (1500, 400);
+    CHECK (frag, 1, E (2, 0, 400));
+    frag = a->CreateFragment (900, 200);
+    CHECK (frag, 2, E (1, 0, 100), E (2, 100, 200));
+    a->RemoveAtStart (1200);
+    CHECK (a, 1, E (2, 0, 800));
+    a->AddHeader (ATestHeader<10> ());
+    CHECK (a, 1, E (2, 10, 810));
+  }
+
+  {
+    // a serialized packet keeps its uid, its tags, its nix-vector and
+    // its zero-filled payload which is never materialized.
+    Ptr<Packet> p = Create<Packet> (1000);
+    p->AddByteTag (ATestTag<20> ());
+    p->AddHeader (ATestHeader<10> ());
+    p->AddByteTag (ATestTag<3> ());
+    p->AddPacketTag (ATestTag<1> ());
+    p->AddPacketTag (ATestTag<2> ());
+    p->AddPacketTag (ATestTag<3> ());
+    p->AddPacketTag (ATestTag<4> ());
+    p->AddPacketTag (ATestTag<5> ());
+    Ptr<NixVector> nixVector = CreateObject<NixVector> ();
+    nixVector->AddNeighborIndex (5, 3);
+    p->SetNixVector (nixVector);
+    uint64_t materialized = Buffer::GetMaterializedBytes ();
+    uint32_t size = p->GetSerializedSize ();
+    NS_TEST_EXPECT_MSG_LT (size, 1000, "The zero-filled payload was serialized");
+    std::vector<uint8_t> raw (size);
+    NS_TEST_EXPECT_MSG_EQ (p->Serialize (&raw[0], size - 1), 0, "Serialized in a buffer too small");
+    NS_TEST_EXPECT_MSG_EQ (p->Serialize (&raw[0], size), size, "Wrong serialized size");
+    Ptr<Packet> copy = Create<Packet> (&raw[0], size, true);
+    NS_TEST_EXPECT_MSG_EQ (Buffer::GetMaterializedBytes (), materialized, "The zero-filled payload was materialized");
+    NS_TEST_EXPECT_MSG_EQ (copy->GetUid (), p->GetUid (), "The uid was not kept");
+    NS_TEST_EXPECT_MSG_EQ (copy->GetSize (), 1010, "Wrong size");
+    CHECK (copy, 2, E (20, 10, 1010), E (3, 0, 1010));
+    uint32_t n = 0;
+    PacketTagIterator i = copy->GetPacketTagIterator ();
+    while (i.HasNext ())
+      {
+        PacketTagIterator::Item item = i.Next ();
+        std::ostringstream oss;
+        oss << "anon::ATestTag<" << 5 - n << ">";
+        NS_TEST_EXPECT_MSG_EQ (item.GetTypeId ().GetName (), oss.str (), "Packet tags out of order");
+        n++;
+      }
+    NS_TEST_EXPECT_MSG_EQ (n, 5, "Wrong number of packet tags");
+    ATestTag<5> five;
+    NS_TEST_EXPECT_MSG_EQ (copy->PeekPacketTag (five), true, "Packet tag lost");
+    NS_TEST_EXPECT_MSG_EQ (five.m_error, false, "Packet tag corrupted");
+    NS_TEST_EXPECT_MSG_NE (copy->GetNixVector (), 0, "Nix-vector lost");
+    NS_TEST_EXPECT_MSG_EQ (copy->GetNixVector ()->ExtractNeighborIndex (3), 5, "Nix-vector corrupted");
+    ATestHeader<10> header;
+    copy->RemoveHeader (header);
+    NS_TEST_EXPECT_MSG_EQ (header.m_error, false, "Header corrupted");
+    std::vector<uint8_t> expected (1000, 0);
+    std::vector<uint8_t> payload (1000, 1);
+    copy->CopyData (&payload[0], payload.size ());
+    NS_TEST_EXPECT_MSG_EQ ((payload == expected), true, "Payload corrupted");
+
+    // the Buffer interface uses the same format.
+    Ptr<Packet> other = Create<Packet> ();
+    other->Deserialize (p->Serialize ());
+    NS_TEST_EXPECT_MSG_EQ (other->GetUid (), p->GetUid (), "The uid was not kept");
+    CHECK (other, 2, E (20, 10, 1010), E (3, 0, 1010));
+  }
+
+  {
+    // the tags of the bytes removed from a packet are dropped and the
+    // fragments share the tags of the original packet.
+    ByteTagList::MemoryStats before = ByteTagList::GetMemoryStats ();
+    Ptr<Packet> stream = Create<Packet> (150);
+    for (uint32_t k = 0; k < 100; k++)
+      {
+        Ptr<Packet> segment = Create<Packet> (100);
+        segment->AddByteTag (ATestTag<1> ());
+        stream->AddAtEnd (segment);
+        stream->RemoveAtStart (100);
+      }
+    CHECK (stream, 2, E (1, 0, 50), E (1, 50, 150));
+    ByteTagList::MemoryStats after = ByteTagList::GetMemoryStats ();
+    NS_TEST_EXPECT_MSG_EQ (after.compacted - before.compacted, 98, "Stale tags were kept");
+    NS_TEST_EXPECT_MSG_EQ (after.buffers - before.buffers, 1, "Tag buffers leaked");
+    Ptr<Packet> whole = stream->CreateFragment (0, 150);
+    NS_TEST_EXPECT_MSG_EQ (ByteTagList::GetMemoryStats ().buffers - before.buffers, 1, "Tags of a fragment were copied");
+    Ptr<Packet> half = stream->CreateFragment (60, 40);
+    CHECK (half, 1, E (1, 0, 40));
+    after = ByteTagList::GetMemoryStats ();
+    NS_TEST_EXPECT_MSG_EQ (after.buffers - before.buffers, 2, "Stale tags shared with a fragment");
+    NS_TEST_EXPECT_MSG_EQ (after.compacted - before.compacted, 99, "Stale tags copied to a fragment");
+    CHECK (whole, 2, E (1, 0, 50), E (1, 50, 150));
+    stream->RemoveAtEnd (100);
+    CHECK (stream, 1, E (1, 0, 50));
+    CHECK (whole, 2, E (1, 0, 50), E (1, 50, 150));
+    half = 0;
+    whole = 0;
+    stream = 0;
+    NS_TEST_EXPECT_MSG_EQ (ByteTagList::GetMemoryStats ().buffers, before.buffers, "Tag buffers leaked");
+  }
+
   {
     // bug 572                                                                  
     Ptr<Packet> tmp = Create<Packet> (1000);
@@ -1083,8 +1381,154 @@ PacketTest::DoRun (void)
     CHECK (tmp, 1, E (20, 1, 1001));
   }
 
+  {
+    // a header removed across the head and the first segment of the
+    // buffer keeps the tags of the remaining bytes in place.
+    Ptr<Packet> tmp = Create<Packet> (4);
+    Ptr<Packet> segment = Create<Packet> (1000);
+    segment->AddByteTag (ATestTag<20> ());
+    segment->AddHeader (ATestHeader<8> ());
+    tmp->AddAtEnd (segment);
+    CHECK (tmp, 1, E (20, 12, 1012));
+    Ptr<Packet> copy = tmp->Copy ();
+    ATestHeader<8> header;
+    tmp->RemoveHeader (header);
+    CHECK (tmp, 1, E (20, 4, 1004));
+    copy->RemoveAtStart (8);
+    CHECK (copy, 1, E (20, 4, 1004));
+  }
+
+  return GetErrorStatus ();
+}
+
+class PacketPoolTest : public TestCase
+{
+public:
+  PacketPoolTest ();
+  virtual bool DoRun (void);
+};
+
+PacketPoolTest::PacketPoolTest ()
+  : TestCase ("Check that the storage of released packets is recycled") {}
+
+bool
+PacketPoolTest::DoRun (void)
+{
+  Packet::TrimPool ();
+  Packet::PoolStats before = Packet::GetPoolStats ();
+  NS_TEST_EXPECT_MSG_EQ (before.pooled, 0, "TrimPool did not empty the pool");
+  Ptr<Packet> p = Create<Packet> (100);
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      // each copy is released when the next one is created.
+      Ptr<Packet> copy = p->Copy ();
+      copy->RemoveAtStart (10);
+      NS_TEST_EXPECT_MSG_EQ (copy->GetSize (), 90, "Recycled packet was not initialized");
+    }
+  Packet::PoolStats after = Packet::GetPoolStats ();
+  NS_TEST_EXPECT_MSG_EQ (after.allocations - before.allocations, 101, "Wrong number of packets allocated");
+  // only the first packet and the first copy cannot reuse a released packet.
+  NS_TEST_EXPECT_MSG_EQ (after.hits - before.hits, 99, "Packets were not allocated from the pool");
+  NS_TEST_EXPECT_MSG_EQ (after.pooled, 1, "The last copy was not returned to the pool");
+  p = 0;
+  NS_TEST_EXPECT_MSG_EQ (Packet::GetPoolStats ().pooled, 2, "The packet was not returned to the pool");
+  Packet::TrimPool ();
+  NS_TEST_EXPECT_MSG_EQ (Packet::GetPoolStats ().pooled, 0, "TrimPool did not empty the pool");
   return GetErrorStatus ();
 }
+
+#ifdef HAVE_PTHREAD_H
+
+class PacketThreadTest : public TestCase
+{
+public:
+  PacketThreadTest ();
+  virtual bool DoRun (void);
+private:
+  template <int N>
+  void CopyPackets (void);
+
+  std::vector<Ptr<Packet> > m_packets;
+  SystemMutex m_mutex;
+  // protected by m_mutex
+  std::vector<uint32_t> m_uids;
+  uint32_t m_errors;
+};
+
+PacketThreadTest::PacketThreadTest ()
+  : TestCase ("Check that the copies of a packet can be modified concurrently by different threads") {}
+
+template <int N>
+void
+PacketThreadTest::CopyPackets (void)
+{
+  std::vector<uint32_t> uids;
+  uint32_t errors = 0;
+  for (uint32_t i = 0; i < m_packets.size (); i++)
+    {
+      // the copies made by all threads share the buffer of m_packets[i]:
+      // each thread writes a header of a different size in front of it.
+      Ptr<Packet> copy = m_packets[i]->Copy ();
+      ATestHeader<N> header;
+      copy->AddHeader (header);
+      Ptr<Packet> other = Create<Packet> (10);
+      uids.push_back (other->GetUid ());
+      copy->AddAtEnd (other);
+      copy->RemoveAtEnd (10);
+      copy->RemoveHeader (header);
+      ATestHeader<1> original;
+      copy->RemoveHeader (original);
+      if (header.m_error || original.m_error || copy->GetSize () != 100)
+        {
+          errors++;
+        }
+    }
+  CriticalSection cs (m_mutex);
+  m_uids.insert (m_uids.end (), uids.begin (), uids.end ());
+  m_errors += errors;
+}
+
+bool
+PacketThreadTest::DoRun (void)
+{
+  m_packets.clear ();
+  for (uint32_t i = 0; i < 5000; i++)
+    {
+      // leave room in front of the header to add the other headers
+      // without copying the buffer.
+      Ptr<Packet> packet = Create<Packet> (100);
+      ATestHeader<40> room;
+      packet->AddHeader (room);
+      packet->RemoveHeader (room);
+      packet->AddHeader (ATestHeader<1> ());
+      m_packets.push_back (packet);
+    }
+  m_uids.clear ();
+  m_errors = 0;
+  std::vector<Ptr<SystemThread> > threads;
+  threads.push_back (Create<SystemThread> (MakeCallback (&PacketThreadTest::CopyPackets<2>, this)));
+  threads.push_back (Create<SystemThread> (MakeCallback (&PacketThreadTest::CopyPackets<3>, this)));
+  threads.push_back (Create<SystemThread> (MakeCallback (&PacketThreadTest::CopyPackets<4>, this)));
+  threads.push_back (Create<SystemThread> (MakeCallback (&PacketThreadTest::CopyPackets<5>, this)));
+  for (std::vector<Ptr<SystemThread> >::iterator i = threads.begin (); i != threads.end (); ++i)
+    {
+      (*i)->Start ();
+    }
+  for (std::vector<Ptr<SystemThread> >::iterator i = threads.begin (); i != threads.end (); ++i)
+    {
+      (*i)->Join ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_errors, 0, "Copies of the packet were corrupted");
+  NS_TEST_EXPECT_MSG_EQ (m_uids.size (), 20000, "Wrong number of packets created");
+  std::sort (m_uids.begin (), m_uids.end ());
+  NS_TEST_EXPECT_MSG_EQ ((std::adjacent_find (m_uids.begin (), m_uids.end ()) == m_uids.end ()), true,
+                         "Two packets got the same uid");
+  NS_TEST_EXPECT_MSG_EQ (m_packets.back ()->GetSize (), 101, "The shared packet was modified");
+  m_packets.clear ();
+  return GetErrorStatus ();
+}
+
+#endif /* HAVE_PTHREAD_H */
 //-----------------------------------------------------------------------------
 class PacketTestSuite : public TestSuite
 {
@@ -1096,6 +1540,10 @@ PacketTestSuite::PacketTestSuite ()
   : TestSuite ("packet", UNIT)
 {
   AddTestCase (new PacketTest);
+  AddTestCase (new PacketPoolTest);
+#ifdef HAVE_PTHREAD_H
+  AddTestCase (new PacketThreadTest);
+#endif /* HAVE_PTHREAD_H */
 }
 
 PacketTestSuite g_packetTestSuite;
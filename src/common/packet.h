@@ -147,8 +147,9 @@ public:
   Item Next (void);
 private:
   friend class Packet;
-  PacketTagIterator (const struct PacketTagList::TagData *head);
-  const struct PacketTagList::TagData *m_current;
+  PacketTagIterator (const PacketTagList *list);
+  const PacketTagList *m_list;
+  uint32_t m_current;
 };
 
 /**
@@ -198,10 +199,51 @@ private:
  *
  * The performance aspects of the Packet API are discussed in 
  * \ref packetperf
+ *
+ * The storage of the Packet objects is recycled through per-thread
+ * freelists, so that, once the pools are warm, creating, copying and
+ * releasing a packet does not call the global allocator for the Packet
+ * itself.
  */
 class Packet : public SimpleRefCount<Packet>
 {
 public:
+  /**
+   * The counters of the Packet allocation pools, summed over all
+   * threads.
+   */
+  struct PoolStats
+  {
+    /**
+     * The number of Packet instances allocated.
+     */
+    uint64_t allocations;
+    /**
+     * The number of allocations served from a freelist.
+     */
+    uint64_t hits;
+    /**
+     * The number of blocks currently held by the freelists.
+     */
+    uint64_t pooled;
+    /**
+     * The largest number of blocks held by a freelist so far.
+     */
+    uint64_t maxPooled;
+  };
+
+  static void *operator new (size_t size);
+  static void operator delete (void *buffer, size_t size);
+  /**
+   * \returns the pool counters. The value returned while other
+   *          threads allocate packets is only approximate.
+   */
+  static struct PoolStats GetPoolStats (void);
+  /**
+   * Return the blocks held by the freelist of the calling thread
+   * to the global allocator.
+   */
+  static void TrimPool (void);
 
   /**
    * Create an empty packet with a new uid (as returned
@@ -230,6 +272,18 @@ public:
    * \param size the size of the input buffer.
    */
   Packet (uint8_t const*buffer, uint32_t size);
+  /**
+   * Create a packet from the serialized representation of a packet
+   * written by Packet::Serialize. The packet keeps the uid, the
+   * byte buffer, the tags, the nix-vector and the metadata of the
+   * serialized packet.
+   *
+   * \param buffer the serialized packet.
+   * \param size the size of the serialized packet.
+   * \param magic unused: it distinguishes this constructor from the
+   *        one which copies a payload.
+   */
+  Packet (uint8_t const*buffer, uint32_t size, bool magic);
   /**
    * Create a new packet which contains a fragment of the original
    * packet. The returned packet shares the same uid as this packet.
@@ -409,6 +463,17 @@ public:
    * simulation setup and before any packet is created.
    */
   static void EnablePrinting (void);
+  /**
+   * Enable printing like EnablePrinting, but only record cheap deltas
+   * when headers and trailers are added and removed, and rebuild the
+   * metadata of a packet when it is printed: the packets which are
+   * never printed cost much less. The ascii trace helpers use this mode.
+   * This method does nothing if EnablePrinting or EnableChecking was
+   * called before, and EnablePrinting turns this mode off.
+   *
+   * \sa PacketMetadata::EnableLazy
+   */
+  static void EnableLazyPrinting (void);
   /**
    * The packet metadata is also used to perform extensive
    * sanity checks at runtime when performing operations on a 
@@ -420,34 +485,41 @@ public:
   static void EnableChecking (void);
 
   /**
-   * \returns a byte buffer
-   *
-   * This method creates a serialized representation of a Packet object
-   * ready to be transmitted over a network to another system. This
-   * serialized representation contains a copy of the packet byte buffer,
-   * the tag list, and the packet metadata (if there is one).
+   * \returns the number of bytes needed to serialize this packet
+   *          with Packet::Serialize.
+   */
+  uint32_t GetSerializedSize (void) const;
+  /**
+   * \param buffer the memory to write the packet into.
+   * \param maxSize the size of the memory available in buffer.
+   * \returns the number of bytes written, or zero if maxSize is
+   *          smaller than GetSerializedSize and nothing was written.
    *
-   * This method will trigger calls to the Serialize and GetSerializedSize
-   * methods of each tag stored in this packet.
+   * This method writes a serialized representation of a Packet object
+   * ready to be transmitted over a network to another system: the
+   * uid of the packet, its byte buffer, its byte and packet tags,
+   * its nix-vector and its metadata (if there is one). The virtual
+   * zero bytes of the byte buffer are not written and the tags are
+   * copied in their serialized form: no Tag method is invoked.
+   * The packet is rebuilt with the constructor
+   * Packet (uint8_t const*, uint32_t, bool).
    *
    * This method will typically be used by parallel simulations where
    * the simulated system is partitioned and each partition runs on
    * a different CPU.
    */
+  uint32_t Serialize (uint8_t *buffer, uint32_t maxSize) const;
+  /**
+   * \returns a byte buffer which holds the output of
+   *          Packet::Serialize (uint8_t *, uint32_t).
+   */
   Buffer Serialize (void) const;
   /**
    * \param buffer a byte buffer
    *
    * This method reads a byte buffer as created by Packet::Serialize
    * and restores the state of the Packet to what it was prior to
-   * calling Serialize.
-   *
-   * This method will trigger calls to the Deserialize method
-   * of each tag stored in this packet.
-   *
-   * This method will typically be used by parallel simulations where
-   * the simulated system is partitioned and each partition runs on
-   * a different CPU.
+   * calling Serialize, including its uid.
    */
   void Deserialize (Buffer buffer);
 
@@ -554,6 +626,7 @@ public:
   Ptr<NixVector> GetNixVector (void) const; 
 
 private:
+  void DoDeserialize (uint8_t const*buffer, uint32_t size);
   Packet (const Buffer &buffer, const ByteTagList &byteTagList, 
           const PacketTagList &packetTagList, const PacketMetadata &metadata);
   Buffer m_buffer;
@@ -564,6 +637,8 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
 
+  /* incremented atomically: the threads of a MultiThreadedSimulatorImpl
+   * create packets concurrently. */
   static uint32_t m_globalUid;
 };
 
@@ -21,9 +21,12 @@
 #include <stdlib.h>
 #include <sstream>
 #include <cstring>
+#include <vector>
 
 #include "ns3/test.h"
 #include "ns3/pcap-file.h"
+#include "ns3/pcap-file-wrapper.h"
+#include "ns3/boolean.h"
 
 using namespace ns3;
 
@@ -1083,6 +1086,130 @@ DiffTestCase::DoRun (void)
   return GetErrorStatus();
 }
 
+// ===========================================================================
+// Test case to make sure that the records written from the background thread
+// of an asynchronous PcapFileWrapper are identical to the records written
+// synchronously.
+// ===========================================================================
+class AsynchronousWrapperTestCase : public TestCase
+{
+public:
+  AsynchronousWrapperTestCase ();
+
+private:
+  virtual bool DoRun (void);
+  Ptr<PcapFileWrapper> WriteKnownPackets (std::string filename, bool asynchronous);
+};
+
+AsynchronousWrapperTestCase::AsynchronousWrapperTestCase ()
+  : TestCase ("Check that an asynchronous PcapFileWrapper writes the same records")
+{
+}
+
+Ptr<PcapFileWrapper>
+AsynchronousWrapperTestCase::WriteKnownPackets (std::string filename, bool asynchronous)
+{
+  Ptr<PcapFileWrapper> f = CreateObject<PcapFileWrapper> ();
+  f->SetAttribute ("Asynchronous", BooleanValue (asynchronous));
+  bool err = f->Open (filename, "w");
+  NS_TEST_EXPECT_MSG_EQ (err, false, "Open (" << filename << ", \"w\") returns error");
+  err = f->Init (1);
+  NS_TEST_EXPECT_MSG_EQ (err, false, "Init (1) returns error");
+  uint8_t data[2048];
+  for (uint32_t i = 0; i < N_KNOWN_PACKETS; ++i)
+    {
+      PacketEntry const & p = knownPackets[i];
+      memset (data, 0, sizeof (data));
+      memcpy (data, p.data, sizeof (p.data));
+      Time t = MicroSeconds (p.tsSec * 1000000ULL + p.tsUsec);
+      err = f->Write (t, data, p.origLen);
+      NS_TEST_EXPECT_MSG_EQ (err, false, "Write must not fail");
+    }
+  return f;
+}
+
+bool
+AsynchronousWrapperTestCase::DoRun (void)
+{
+  std::string synchronous = "synchronous.pcap";
+  std::string asynchronous = "asynchronous.pcap";
+
+  Ptr<PcapFileWrapper> f = WriteKnownPackets (synchronous, false);
+  NS_TEST_EXPECT_MSG_EQ (f->GetQueuedRecords (), 0, "Synchronous records were queued");
+  f->Close ();
+
+  f = WriteKnownPackets (asynchronous, true);
+  NS_TEST_EXPECT_MSG_EQ (f->GetQueuedRecords (), N_KNOWN_PACKETS, "Records were not queued");
+  NS_TEST_EXPECT_MSG_EQ (f->GetDroppedRecords (), 0, "Records were dropped");
+  f->Flush ();
+  uint32_t sec (0), usec (0);
+  bool diff = PcapFile::Diff (synchronous, asynchronous, sec, usec);
+  NS_TEST_EXPECT_MSG_EQ (diff, false, "Flushed records differ at " << sec << "." << usec);
+  f->Close ();
+  diff = PcapFile::Diff (synchronous, asynchronous, sec, usec);
+  NS_TEST_EXPECT_MSG_EQ (diff, false, "Records differ at " << sec << "." << usec);
+
+  remove (synchronous.c_str ());
+  remove (asynchronous.c_str ());
+  return GetErrorStatus ();
+}
+
+// ===========================================================================
+// Test case to make sure that a PcapFileWrapper captures the whole packet
+// when the snapshot length is larger than the default one.
+// ===========================================================================
+class LargeSnapLenWrapperTestCase : public TestCase
+{
+public:
+  LargeSnapLenWrapperTestCase ();
+
+private:
+  virtual bool DoRun (void);
+};
+
+LargeSnapLenWrapperTestCase::LargeSnapLenWrapperTestCase ()
+  : TestCase ("Check that a PcapFileWrapper captures packets larger than the default snapshot length")
+{
+}
+
+bool
+LargeSnapLenWrapperTestCase::DoRun (void)
+{
+  std::string filename = "large-snaplen.pcap";
+  const uint32_t snapLen = 2 * PcapFile::SNAPLEN_DEFAULT;
+  const uint32_t size = PcapFile::SNAPLEN_DEFAULT + 1000;
+  std::vector<uint8_t> written (size);
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      written[i] = i % 251;
+    }
+
+  Ptr<PcapFileWrapper> f = CreateObject<PcapFileWrapper> ();
+  bool err = f->Open (filename, "w");
+  NS_TEST_ASSERT_MSG_EQ (err, false, "Open (" << filename << ", \"w\") returns error");
+  err = f->Init (1, snapLen);
+  NS_TEST_ASSERT_MSG_EQ (err, false, "Init (1, " << snapLen << ") returns error");
+  err = f->Write (Seconds (1.0), Create<Packet> (&written[0], size));
+  NS_TEST_EXPECT_MSG_EQ (err, false, "Write must not fail");
+  f->Close ();
+
+  PcapFile r;
+  err = r.Open (filename, "r");
+  NS_TEST_ASSERT_MSG_EQ (err, false, "Open (" << filename << ", \"r\") returns error");
+  std::vector<uint8_t> read (snapLen);
+  uint32_t tsSec, tsUsec, inclLen, origLen, readLen;
+  err = r.Read (&read[0], snapLen, tsSec, tsUsec, inclLen, origLen, readLen);
+  NS_TEST_ASSERT_MSG_EQ (err, false, "Read must not fail");
+  NS_TEST_EXPECT_MSG_EQ (inclLen, size, "Wrong included length");
+  NS_TEST_EXPECT_MSG_EQ (origLen, size, "Wrong original length");
+  NS_TEST_ASSERT_MSG_EQ (readLen, size, "Wrong number of bytes read");
+  NS_TEST_EXPECT_MSG_EQ (memcmp (&read[0], &written[0], size), 0, "Packet bytes differ");
+  r.Close ();
+
+  remove (filename.c_str ());
+  return GetErrorStatus ();
+}
+
 class PcapFileTestSuite : public TestSuite
 {
 public:
@@ -1099,6 +1226,8 @@ PcapFileTestSuite::PcapFileTestSuite ()
   AddTestCase (new RecordHeaderTestCase);
   AddTestCase (new ReadFileTestCase);
   AddTestCase (new DiffTestCase);
+  AddTestCase (new AsynchronousWrapperTestCase);
+  AddTestCase (new LargeSnapLenWrapperTestCase);
 }
 
 PcapFileTestSuite pcapFileTestSuite;
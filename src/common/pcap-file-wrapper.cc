@@ -17,18 +17,154 @@
  */
 
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/core-config.h"
 
 #include "buffer.h"
 #include "header.h"
 #include "pcap-file-wrapper.h"
 
+#include <algorithm>
+#include <deque>
+#include <vector>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
 NS_LOG_COMPONENT_DEFINE ("PcapFileWrapper");
 
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (PcapFileWrapper);
 
+#ifdef HAVE_PTHREAD_H
+
+/* The simulation thread appends the records of a file to its current
+ * chunk of memory and queues the chunk for the writer thread once it
+ * is full. The writer thread, shared by all the files, writes the
+ * queued chunks and returns them to the free chunks of their file.
+ * A file allocates its chunks as needed, up to its BufferSize.
+ */
+struct PcapWriteQueue
+{
+  PcapFile *file;
+  uint32_t chunkSize;
+  uint32_t maxChunks;
+  uint32_t nChunks;
+  uint8_t *current;
+  uint32_t used;
+  // the fields below are protected by g_writerMutex
+  std::vector<uint8_t *> freeChunks;
+  uint32_t pending;
+  bool error;
+};
+
+struct PcapWriteJob
+{
+  struct PcapWriteQueue *queue;
+  uint8_t *data;
+  uint32_t size;
+};
+
+static pthread_mutex_t g_writerLifecycleMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_writerWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_writerDone = PTHREAD_COND_INITIALIZER;
+static std::deque<struct PcapWriteJob> g_writerJobs;
+static pthread_t g_writerThread;
+static uint32_t g_writerUsers = 0;
+static bool g_writerStop = false;
+
+static void *
+PcapWriterRun (void *)
+{
+  pthread_mutex_lock (&g_writerMutex);
+  while (true)
+    {
+      while (g_writerJobs.empty () && !g_writerStop)
+        {
+          pthread_cond_wait (&g_writerWork, &g_writerMutex);
+        }
+      if (g_writerJobs.empty ())
+        {
+          break;
+        }
+      struct PcapWriteJob job = g_writerJobs.front ();
+      g_writerJobs.pop_front ();
+      pthread_mutex_unlock (&g_writerMutex);
+      bool error = job.queue->file->WriteRecords (job.data, job.size);
+      pthread_mutex_lock (&g_writerMutex);
+      job.queue->error = job.queue->error || error;
+      job.queue->freeChunks.push_back (job.data);
+      job.queue->pending--;
+      pthread_cond_broadcast (&g_writerDone);
+    }
+  pthread_mutex_unlock (&g_writerMutex);
+  return 0;
+}
+
+// the writer thread runs while at least one file is asynchronous.
+static void
+PcapWriterAddUser (void)
+{
+  pthread_mutex_lock (&g_writerLifecycleMutex);
+  pthread_mutex_lock (&g_writerMutex);
+  bool first = g_writerUsers == 0;
+  g_writerUsers++;
+  g_writerStop = false;
+  pthread_mutex_unlock (&g_writerMutex);
+  if (first)
+    {
+      int rc = pthread_create (&g_writerThread, 0, &PcapWriterRun, 0);
+      NS_ABORT_MSG_IF (rc != 0, "Unable to start the pcap writer thread");
+    }
+  pthread_mutex_unlock (&g_writerLifecycleMutex);
+}
+
+static void
+PcapWriterRemoveUser (void)
+{
+  pthread_mutex_lock (&g_writerLifecycleMutex);
+  pthread_mutex_lock (&g_writerMutex);
+  g_writerUsers--;
+  bool last = g_writerUsers == 0;
+  if (last)
+    {
+      g_writerStop = true;
+      pthread_cond_signal (&g_writerWork);
+    }
+  pthread_mutex_unlock (&g_writerMutex);
+  if (last)
+    {
+      pthread_join (g_writerThread, 0);
+    }
+  pthread_mutex_unlock (&g_writerLifecycleMutex);
+}
+
+static void
+PcapWriteQueueSubmit (struct PcapWriteQueue *queue)
+{
+  if (queue->current == 0 || queue->used == 0)
+    {
+      return;
+    }
+  struct PcapWriteJob job;
+  job.queue = queue;
+  job.data = queue->current;
+  job.size = queue->used;
+  pthread_mutex_lock (&g_writerMutex);
+  g_writerJobs.push_back (job);
+  queue->pending++;
+  pthread_cond_signal (&g_writerWork);
+  pthread_mutex_unlock (&g_writerMutex);
+  queue->current = 0;
+  queue->used = 0;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
 TypeId 
 PcapFileWrapper::GetTypeId (void)
 {
@@ -40,12 +176,27 @@ PcapFileWrapper::GetTypeId (void)
                    UintegerValue (PcapFile::SNAPLEN_DEFAULT),
                    MakeUintegerAccessor (&PcapFileWrapper::m_snapLen),
                    MakeUintegerChecker<uint32_t> (0, PcapFile::SNAPLEN_DEFAULT))
+    .AddAttribute ("Asynchronous",
+                   "Write the records from a background thread rather than "
+                   "from the simulation thread",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PcapFileWrapper::m_asynchronous),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BufferSize",
+                   "Maximum size of the memory which holds the records waiting "
+                   "for the background thread",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&PcapFileWrapper::m_bufferSize),
+                   MakeUintegerChecker<uint32_t> ())
     ;
   return tid;
 }
 
 
 PcapFileWrapper::PcapFileWrapper ()
+  : m_queue (0),
+    m_queued (0),
+    m_dropped (0)
 {
 }
 
@@ -57,12 +208,29 @@ PcapFileWrapper::~PcapFileWrapper ()
 void
 PcapFileWrapper::Close (void)
 {
+#ifdef HAVE_PTHREAD_H
+  if (m_queue != 0)
+    {
+      Flush ();
+      PcapWriterRemoveUser ();
+      for (std::vector<uint8_t *>::iterator i = m_queue->freeChunks.begin ();
+           i != m_queue->freeChunks.end (); i++)
+        {
+          delete [] *i;
+        }
+      delete m_queue;
+      m_queue = 0;
+    }
+#endif /* HAVE_PTHREAD_H */
   m_file.Close ();
 }
 
 bool
 PcapFileWrapper::Open (std::string const &filename, std::string const &mode)
 {
+  Close ();
+  m_queued = 0;
+  m_dropped = 0;
   return m_file.Open (filename, mode);
 }
 
@@ -89,6 +257,66 @@ PcapFileWrapper::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t tzCorrec
   return true;
 }
 
+uint8_t *
+PcapFileWrapper::Reserve (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen, uint32_t &inclLen)
+{
+#ifdef HAVE_PTHREAD_H
+  uint8_t header[PcapFile::RECORD_HEADER_SIZE];
+  if (m_file.FormatRecordHeader (header, tsSec, tsUsec, totalLen, inclLen))
+    {
+      return 0;
+    }
+  struct PcapWriteQueue *queue = m_queue;
+  if (queue == 0)
+    {
+      queue = new PcapWriteQueue ();
+      queue->file = &m_file;
+      queue->chunkSize = std::max ((uint32_t)(1 << 16), PcapFile::RECORD_HEADER_SIZE + m_file.GetSnapLen ());
+      queue->maxChunks = std::max ((uint32_t)2, m_bufferSize / queue->chunkSize);
+      queue->nChunks = 0;
+      queue->current = 0;
+      queue->used = 0;
+      queue->pending = 0;
+      queue->error = false;
+      m_queue = queue;
+      PcapWriterAddUser ();
+    }
+  uint32_t size = PcapFile::RECORD_HEADER_SIZE + inclLen;
+  if (queue->used + size > queue->chunkSize)
+    {
+      PcapWriteQueueSubmit (queue);
+    }
+  if (queue->current == 0)
+    {
+      pthread_mutex_lock (&g_writerMutex);
+      if (!queue->freeChunks.empty ())
+        {
+          queue->current = queue->freeChunks.back ();
+          queue->freeChunks.pop_back ();
+        }
+      pthread_mutex_unlock (&g_writerMutex);
+      if (queue->current == 0 && queue->nChunks < queue->maxChunks)
+        {
+          queue->current = new uint8_t [queue->chunkSize];
+          queue->nChunks++;
+        }
+      if (queue->current == 0)
+        {
+          m_dropped++;
+          return 0;
+        }
+    }
+  NS_ASSERT (queue->used + size <= queue->chunkSize);
+  uint8_t *record = queue->current + queue->used;
+  memcpy (record, header, PcapFile::RECORD_HEADER_SIZE);
+  queue->used += size;
+  m_queued++;
+  return record + PcapFile::RECORD_HEADER_SIZE;
+#else /* HAVE_PTHREAD_H */
+  return 0;
+#endif /* HAVE_PTHREAD_H */
+}
+
 bool
 PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
 {
@@ -99,8 +327,34 @@ PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
   uint64_t us = current % 1000000;
 
   uint32_t bufferSize = p->GetSize ();
-  p->CopyData (buffer, bufferSize);
-  bool rc = m_file.Write (s, us, buffer, bufferSize);
+#ifdef HAVE_PTHREAD_H
+  if (m_asynchronous)
+    {
+      // the bytes of the packet are copied directly in the queue.
+      uint32_t captured;
+      uint8_t *record = Reserve (s, us, bufferSize, captured);
+      if (record == 0)
+        {
+          return true;
+        }
+      p->CopyData (record, captured);
+      return false;
+    }
+#endif /* HAVE_PTHREAD_H */
+
+  // only the bytes which fit in the capture are copied: the payload
+  // of a large packet is never read beyond the snapshot length, which
+  // may be larger than the stack buffer.
+  uint32_t captured = std::min (bufferSize, m_file.GetSnapLen ());
+  std::vector<uint8_t> large;
+  uint8_t *data = buffer;
+  if (captured > sizeof (buffer))
+    {
+      large.resize (captured);
+      data = &large[0];
+    }
+  p->CopyData (data, captured);
+  bool rc = m_file.Write (s, us, data, bufferSize);
   return rc;
 }
 
@@ -121,9 +375,34 @@ PcapFileWrapper::Write (Time t, Header &header, Ptr<const Packet> p)
   headerBuffer.AddAtStart (headerSize);
   header.Serialize (headerBuffer.Begin ());
 
-  headerBuffer.Begin ().Read (buffer, headerSize);
-  p->CopyData (&buffer[headerSize], packetSize);
-  bool rc = m_file.Write (s, us, buffer, bufferSize);
+#ifdef HAVE_PTHREAD_H
+  if (m_asynchronous)
+    {
+      uint32_t captured;
+      uint8_t *record = Reserve (s, us, bufferSize, captured);
+      if (record == 0)
+        {
+          return true;
+        }
+      headerSize = std::min (headerSize, captured);
+      headerBuffer.Begin ().Read (record, headerSize);
+      p->CopyData (&record[headerSize], captured - headerSize);
+      return false;
+    }
+#endif /* HAVE_PTHREAD_H */
+
+  uint32_t captured = std::min (bufferSize, m_file.GetSnapLen ());
+  std::vector<uint8_t> large;
+  uint8_t *data = buffer;
+  if (captured > sizeof (buffer))
+    {
+      large.resize (captured);
+      data = &large[0];
+    }
+  headerSize = std::min (headerSize, captured);
+  headerBuffer.Begin ().Read (data, headerSize);
+  p->CopyData (&data[headerSize], captured - headerSize);
+  bool rc = m_file.Write (s, us, data, bufferSize);
 
   return rc;
 }
@@ -135,9 +414,59 @@ PcapFileWrapper::Write (Time t, uint8_t const *buffer, uint32_t length)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
+#ifdef HAVE_PTHREAD_H
+  if (m_asynchronous)
+    {
+      uint32_t captured;
+      uint8_t *record = Reserve (s, us, length, captured);
+      if (record == 0)
+        {
+          return true;
+        }
+      memcpy (record, buffer, captured);
+      return false;
+    }
+#endif /* HAVE_PTHREAD_H */
+
   return m_file.Write (s, us, buffer, length);
 }
 
+void
+PcapFileWrapper::Flush (void)
+{
+#ifdef HAVE_PTHREAD_H
+  if (m_queue != 0)
+    {
+      PcapWriteQueueSubmit (m_queue);
+      pthread_mutex_lock (&g_writerMutex);
+      while (m_queue->pending != 0)
+        {
+          pthread_cond_wait (&g_writerDone, &g_writerMutex);
+        }
+      bool error = m_queue->error;
+      m_queue->error = false;
+      pthread_mutex_unlock (&g_writerMutex);
+      if (error)
+        {
+          NS_LOG_ERROR ("Unable to write the queued records");
+        }
+    }
+#endif /* HAVE_PTHREAD_H */
+  m_file.Flush ();
+}
+
+uint64_t
+PcapFileWrapper::GetQueuedRecords (void) const
+{
+  return m_queued;
+}
+
+uint64_t
+PcapFileWrapper::GetDroppedRecords (void) const
+{
+  return m_dropped;
+}
+
 uint32_t
 PcapFileWrapper::GetMagic (void)
 {
@@ -28,8 +28,15 @@
 
 namespace ns3 {
 
+struct PcapWriteQueue;
+
 /*
  * A class representing a pcap file tailored for use in model code.
+ *
+ * When the "Asynchronous" attribute is set, the records are appended
+ * to a per-file ring of memory chunks and a background thread shared
+ * by all the files writes the full chunks to disk. A record which does
+ * not fit in the ring because the disk cannot keep up is dropped.
  */
 
 class PcapFileWrapper : public Object
@@ -224,10 +231,36 @@ public:
    * See http://wiki.wireshark.org/Development/LibpcapFileFormat
    */ 
   uint32_t GetDataLinkType (void);
+
+  /**
+   * \brief Write the records queued for the background thread to disk
+   *
+   * Return once all the records written so far are in the file.
+   */
+  void Flush (void);
+
+  /**
+   * \returns the number of records queued for the background thread
+   *          since the file was opened.
+   */
+  uint64_t GetQueuedRecords (void) const;
+
+  /**
+   * \returns the number of records dropped since the file was opened
+   *          because the ring of the background thread was full.
+   */
+  uint64_t GetDroppedRecords (void) const;
   
 private:
+  uint8_t *Reserve (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen, uint32_t &inclLen);
+
   PcapFile m_file;
   uint32_t m_snapLen;
+  bool m_asynchronous;
+  uint32_t m_bufferSize;
+  struct PcapWriteQueue *m_queue;
+  uint64_t m_queued;
+  uint64_t m_dropped;
 };
 
 } //namespace ns3
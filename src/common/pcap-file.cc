@@ -430,14 +430,15 @@ PcapFile::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t timeZoneCorrect
 }
 
 bool
-PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen)
+PcapFile::FormatRecordHeader (uint8_t *buffer, uint32_t tsSec, uint32_t tsUsec, 
+                              uint32_t totalLen, uint32_t &inclLen)
 {
   if (m_haveFileHeader == false)
     {
       return true;
     }
 
-  uint32_t inclLen = totalLen > m_fileHeader.m_snapLen ? m_fileHeader.m_snapLen : totalLen;
+  inclLen = totalLen > m_fileHeader.m_snapLen ? m_fileHeader.m_snapLen : totalLen;
 
   PcapRecordHeader header;
   header.m_tsSec = tsSec;
@@ -451,21 +452,53 @@ PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, ui
     }
 
   //
-  // Watch out for memory alignment differences between machines, so write
-  // them all individually.
+  // Watch out for memory alignment differences between machines, so copy
+  // the fields individually.
   //
-  uint32_t result = 0;
+  memcpy (buffer, &header.m_tsSec, 4);
+  memcpy (buffer + 4, &header.m_tsUsec, 4);
+  memcpy (buffer + 8, &header.m_inclLen, 4);
+  memcpy (buffer + 12, &header.m_origLen, 4);
+  return false;
+}
 
-  result |= (fwrite (&header.m_tsSec, sizeof(header.m_tsSec), 1, m_filePtr) != 1);
-  result |= (fwrite (&header.m_tsUsec, sizeof(header.m_tsUsec), 1, m_filePtr) != 1);
-  result |= (fwrite (&header.m_inclLen, sizeof(header.m_inclLen), 1, m_filePtr) != 1);
-  result |= (fwrite (&header.m_origLen, sizeof(header.m_origLen), 1, m_filePtr) != 1);
+bool
+PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen)
+{
+  uint8_t header[RECORD_HEADER_SIZE];
+  uint32_t inclLen;
+  if (FormatRecordHeader (header, tsSec, tsUsec, totalLen, inclLen))
+    {
+      return true;
+    }
 
+  uint32_t result = 0;
+
+  result |= (fwrite (header, RECORD_HEADER_SIZE, 1, m_filePtr) != 1);
   result |= fwrite (data, 1, inclLen, m_filePtr) != inclLen;
 
   return result != 0;
 }
 
+bool
+PcapFile::WriteRecords (uint8_t const *records, uint32_t size)
+{
+  if (m_haveFileHeader == false)
+    {
+      return true;
+    }
+  return fwrite (records, 1, size, m_filePtr) != size;
+}
+
+void
+PcapFile::Flush (void)
+{
+  if (m_filePtr)
+    {
+      fflush (m_filePtr);
+    }
+}
+
 bool
 PcapFile::Read (
   uint8_t * const data, 
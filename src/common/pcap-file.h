@@ -37,6 +37,7 @@ class PcapFile
 public:
   static const int32_t  ZONE_DEFAULT    = 0;           /**< Time zone offset for current location */
   static const uint32_t SNAPLEN_DEFAULT = 65535;       /**< Default value for maximum octets to save per packet */
+  static const uint32_t RECORD_HEADER_SIZE = 16;      /**< Size of the header of a packet record */
 
 public:
   PcapFile ();
@@ -155,6 +156,36 @@ public:
    */
   bool Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen);
 
+  /**
+   * \brief Format the header of the record of the next packet
+   *
+   * \param buffer      [out] Memory for the RECORD_HEADER_SIZE bytes of the header
+   * \param tsSec       Packet timestamp, seconds
+   * \param tsUsec      Packet timestamp, microseconds
+   * \param totalLen    Total packet length
+   * \param inclLen     [out] Number of bytes of the packet which must follow
+   *                    the header in the record
+   *
+   * \return true on error, false otherwise
+   */
+  bool FormatRecordHeader (uint8_t *buffer, uint32_t tsSec, uint32_t tsUsec, 
+                           uint32_t totalLen, uint32_t &inclLen);
+
+  /**
+   * \brief Write records formatted with FormatRecordHeader to file
+   *
+   * \param records     Records buffer
+   * \param size        Size of the records buffer
+   *
+   * \return true on error, false otherwise
+   */
+  bool WriteRecords (uint8_t const *records, uint32_t size);
+
+  /**
+   * \brief Flush the records written so far to the underlying file
+   */
+  void Flush (void);
+
   /**
    * \brief Read next packet from file
    * 
@@ -113,10 +113,9 @@ TagBuffer::WriteDouble (double v)
 void 
 TagBuffer::Write (const uint8_t *buffer, uint32_t size)
 {
-  for (uint32_t i = 0; i < size; ++i, ++buffer)
-    {
-      WriteU8 (*buffer);
-    }
+  NS_ASSERT (m_current + size <= m_end);
+  memcpy (m_current, buffer, size);
+  m_current += size;
 }
 uint64_t 
 TagBuffer::ReadU64 (void)
@@ -161,10 +160,9 @@ TagBuffer::ReadDouble (void)
 void 
 TagBuffer::Read (uint8_t *buffer, uint32_t size)
 {
-  for (uint32_t i = 0; i < size; ++i, ++buffer)
-    {
-      *buffer = ReadU8 ();
-    }
+  NS_ASSERT (m_current + size <= m_end);
+  memcpy (buffer, m_current, size);
+  m_current += size;
 }
 TagBuffer::TagBuffer (uint8_t *start, uint8_t *end)
   : m_current (start),
@@ -27,6 +27,8 @@ namespace ns3 {
  *         The AttributeList container implementation
  *********************************************************************/
 
+uint32_t AttributeList::m_globalGeneration = 1;
+
 AttributeList::AttributeList ()
 {}
 
@@ -119,6 +121,7 @@ AttributeList::DoSetOne (Ptr<const AttributeChecker> checker, const AttributeVal
   attr.checker = checker;
   attr.value = value.Copy ();
   m_attributes.push_back (attr);
+  NotifyChanged ();
 }
 bool
 AttributeList::DoSet (struct TypeId::AttributeInfo *info, const AttributeValue &value)
@@ -159,6 +162,17 @@ void
 AttributeList::Reset (void)
 {
   m_attributes.clear ();
+  NotifyChanged ();
+}
+void
+AttributeList::NotifyChanged (void)
+{
+  // the construction plans cached by ObjectBase depend on the content
+  // of the global container.
+  if (this == GetGlobal ())
+    {
+      m_globalGeneration++;
+    }
 }
 AttributeList *
 AttributeList::GetGlobal (void)
@@ -104,8 +104,11 @@ private:
   bool DoSet (struct TypeId::AttributeInfo *info, const AttributeValue &param);
   void DoSetOne (Ptr<const AttributeChecker> checker, const AttributeValue &param);
   std::string LookupAttributeFullNameByChecker (Ptr<const AttributeChecker> checker) const;
+  void NotifyChanged (void);
 
   Attrs m_attributes;
+  // incremented whenever the global container is modified
+  static uint32_t m_globalGeneration;
 };
 
 class UnsafeAttributeList
@@ -293,6 +293,15 @@ AttributeTestCase<BooleanValue>::DoRun (void)
   ok = CheckGetCodePaths (p, "TestBoolName", "true", BooleanValue (true));
   NS_TEST_ASSERT_MSG_EQ (ok, false, "Attribute not set properly by default value");
 
+  //
+  // The value from the attribute list takes precedence over the default value.
+  //
+  p = CreateObjectWithAttributes<AttributeObjectTest> (attrs);
+  NS_TEST_ASSERT_MSG_NE (p, 0, "Unable to CreateObjectWithAttributes");
+
+  ok = CheckGetCodePaths (p, "TestBoolName", "false", BooleanValue (false));
+  NS_TEST_ASSERT_MSG_EQ (ok, false, "Default value used instead of the value from CreateObjectWithAttributes");
+
   //
   // Set the default value of the BooleanValue the other way and create an object.
   // The new default value should stick.
@@ -1144,6 +1153,75 @@ CallbackValueTestCase::DoRun (void)
   return GetErrorStatus ();
 }
 
+// ===========================================================================
+// Test the lookups of TypeIds and of their attributes and trace sources by
+// name, including the attributes and trace sources of a parent.
+// ===========================================================================
+class DerivedAttributeObjectTest : public AttributeObjectTest
+{
+public:
+  static TypeId GetTypeId (void) {
+    static TypeId tid = TypeId ("ns3::DerivedAttributeObjectTest")
+      .SetParent<AttributeObjectTest> ()
+      ;
+    return tid;
+  }
+};
+
+class TypeIdLookupTestCase : public TestCase
+{
+public:
+  TypeIdLookupTestCase (std::string description);
+  virtual ~TypeIdLookupTestCase () {}
+
+private:
+  virtual bool DoRun (void);
+};
+
+TypeIdLookupTestCase::TypeIdLookupTestCase (std::string description)
+  : TestCase (description)
+{
+}
+
+bool
+TypeIdLookupTestCase::DoRun (void)
+{
+  TypeId base = AttributeObjectTest::GetTypeId ();
+  TypeId derived = DerivedAttributeObjectTest::GetTypeId ();
+
+  TypeId tid = TypeId::LookupByName ("ns3::DerivedAttributeObjectTest");
+  NS_TEST_ASSERT_MSG_EQ (tid, derived, "Could not look up a TypeId by name");
+
+  bool ok = TypeId::LookupByNameFailSafe ("ns3::DoesNotExist", &tid);
+  NS_TEST_ASSERT_MSG_EQ (ok, false, "Found a TypeId which was never registered");
+
+  struct TypeId::AttributeInfo baseInfo;
+  ok = base.LookupAttributeByName ("TestBoolName", &baseInfo);
+  NS_TEST_ASSERT_MSG_EQ (ok, true, "Could not look up an attribute by name");
+
+  struct TypeId::AttributeInfo info;
+  ok = derived.LookupAttributeByName ("TestBoolName", &info);
+  NS_TEST_ASSERT_MSG_EQ (ok, true, "Could not look up the attribute of a parent by name");
+  NS_TEST_ASSERT_MSG_EQ (info.checker, baseInfo.checker, "Found the wrong attribute");
+  NS_TEST_ASSERT_MSG_EQ (info.accessor, baseInfo.accessor, "Found the wrong attribute");
+
+  ok = TypeId::LookupAttributeByFullName ("ns3::DerivedAttributeObjectTest::TestBoolName", &info);
+  NS_TEST_ASSERT_MSG_EQ (ok, true, "Could not look up the attribute of a parent by full name");
+  NS_TEST_ASSERT_MSG_EQ (info.checker, baseInfo.checker, "Found the wrong attribute");
+
+  ok = derived.LookupAttributeByName ("DoesNotExist", &info);
+  NS_TEST_ASSERT_MSG_EQ (ok, false, "Found an attribute which was never registered");
+
+  Ptr<const TraceSourceAccessor> source = derived.LookupTraceSourceByName ("Source2");
+  NS_TEST_ASSERT_MSG_NE (source, 0, "Could not look up the trace source of a parent by name");
+  NS_TEST_ASSERT_MSG_EQ (source, base.LookupTraceSourceByName ("Source2"), "Found the wrong trace source");
+
+  source = derived.LookupTraceSourceByName ("DoesNotExist");
+  NS_TEST_ASSERT_MSG_EQ (source, 0, "Found a trace source which was never registered");
+
+  return GetErrorStatus ();
+}
+
 // ===========================================================================
 // The Test Suite that glues all of the Test Cases together.
 // ===========================================================================
@@ -1168,6 +1246,7 @@ AttributesTestSuite::AttributesTestSuite ()
   AddTestCase (new TracedCallbackTestCase ("Ensure TracedCallback<double, int, float> works as trace source"));
   AddTestCase (new PointerAttributeTestCase ("Check Attributes of type PointerValue"));
   AddTestCase (new CallbackValueTestCase ("Check Attributes of type CallbackValue"));
+  AddTestCase (new TypeIdLookupTestCase ("Check the lookups of TypeIds, attributes and trace sources by name"));
 }
 
 AttributesTestSuite attributesTestSuite;
@@ -33,6 +33,7 @@
 #include "callback.h"
 
 #include <sstream>
+#include <set>
 
 NS_LOG_COMPONENT_DEFINE ("Config");
 
@@ -132,82 +133,112 @@ MatchContainer::DisconnectWithoutContext (std::string name, const CallbackBase &
 
 } // namespace Config
 
+/* An ArrayMatcher compiles the index of an array item of a path: a
+ * list of alternatives separated by '|', each of which is '*', an
+ * inclusive range "[min-max]" or a single index.
+ */
 class ArrayMatcher
 {
 public:
   ArrayMatcher (std::string element);
   bool Matches (uint32_t i) const;
+  /**
+   * \param n the number of elements of the array
+   * \param first the first index which can match
+   * \param last one past the last index which can match
+   */
+  void GetBounds (uint32_t n, uint32_t *first, uint32_t *last) const;
 private:
+  void Compile (std::string element);
   bool StringToUint32 (std::string str, uint32_t *value) const;
   std::string m_element;
+  // the inclusive bounds of each alternative.
+  std::vector<std::pair<uint32_t, uint32_t> > m_ranges;
 };
 
 
 ArrayMatcher::ArrayMatcher (std::string element)
   : m_element (element)
-{}
-bool 
-ArrayMatcher::Matches (uint32_t i) const
 {
-  if (m_element == "*")
+  Compile (element);
+}
+void
+ArrayMatcher::Compile (std::string element)
+{
+  if (element == "*")
     {
-      NS_LOG_DEBUG ("Array "<<i<<" matches *");
-      return true;
+      m_ranges.push_back (std::make_pair (0, 0xffffffff));
+      return;
     }
   std::string::size_type tmp;
-  tmp = m_element.find ("|");
+  tmp = element.find ("|");
   if (tmp != std::string::npos)
     {
-      std::string left = m_element.substr (0, tmp-0);
-      std::string right = m_element.substr (tmp+1, m_element.size () - (tmp + 1));
-      ArrayMatcher matcher = ArrayMatcher (left);
-      if (matcher.Matches (i))
-	{
-	  NS_LOG_DEBUG ("Array "<<i<<" matches "<<left);
-	  return true;
-	}
-      matcher = ArrayMatcher (right);
-      if (matcher.Matches (i))
-	{
-	  NS_LOG_DEBUG ("Array "<<i<<" matches "<<right);
-	  return true;
-	}
-      NS_LOG_DEBUG ("Array "<<i<<" does not match "<<m_element);
-      return false;
+      std::string left = element.substr (0, tmp-0);
+      std::string right = element.substr (tmp+1, element.size () - (tmp + 1));
+      Compile (left);
+      Compile (right);
+      return;
     }
-  std::string::size_type leftBracket = m_element.find ("[");
-  std::string::size_type rightBracket = m_element.find ("]");
-  std::string::size_type dash = m_element.find ("-");
-  if (leftBracket == 0 && rightBracket == m_element.size () - 1 &&
+  std::string::size_type leftBracket = element.find ("[");
+  std::string::size_type rightBracket = element.find ("]");
+  std::string::size_type dash = element.find ("-");
+  if (leftBracket == 0 && rightBracket == element.size () - 1 &&
       dash > leftBracket && dash < rightBracket)
     {
-      std::string lowerBound = m_element.substr (leftBracket + 1, dash - (leftBracket + 1));
-      std::string upperBound = m_element.substr (dash + 1, rightBracket - (dash + 1));
+      std::string lowerBound = element.substr (leftBracket + 1, dash - (leftBracket + 1));
+      std::string upperBound = element.substr (dash + 1, rightBracket - (dash + 1));
       uint32_t min;
       uint32_t max;
       if (StringToUint32 (lowerBound, &min) && 
 	  StringToUint32 (upperBound, &max) &&
-	  i >= min && i <= max)
+          min <= max)
         {
-	  NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
-          return true;
+          m_ranges.push_back (std::make_pair (min, max));
         }
-      else
-	{
-	  NS_LOG_DEBUG ("Array "<<i<<" does not "<<m_element);
-	  return false;
-	}
+      return;
     }
   uint32_t value;
-  if (StringToUint32 (m_element, &value) &&
-      i == value)
+  if (StringToUint32 (element, &value))
+    {
+      m_ranges.push_back (std::make_pair (value, value));
+    }
+}
+bool 
+ArrayMatcher::Matches (uint32_t i) const
+{
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator j = m_ranges.begin ();
+       j != m_ranges.end (); j++)
     {
-      NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
-      return true;
+      if (i >= j->first && i <= j->second)
+        {
+          NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
+          return true;
+        }
     }
   NS_LOG_DEBUG ("Array "<<i<<" does not match "<<m_element);
   return false;
 }
+void
+ArrayMatcher::GetBounds (uint32_t n, uint32_t *first, uint32_t *last) const
+{
+  *first = n;
+  *last = 0;
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator j = m_ranges.begin ();
+       j != m_ranges.end (); j++)
+    {
+      *first = std::min (*first, j->first);
+      if (j->first < n)
+        {
+          *last = std::max (*last, std::min (j->second, n - 1) + 1);
+        }
+    }
+  if (*first >= *last)
+    {
+      *first = 0;
+      *last = 0;
+    }
+}
 
 bool
 ArrayMatcher::StringToUint32 (std::string str, uint32_t *value) const
@@ -219,6 +250,10 @@ ArrayMatcher::StringToUint32 (std::string str, uint32_t *value) const
 }
 
 
+/* A Resolver splits its path into items once and remembers, for each
+ * attribute item, how the item was resolved on the last TypeId it met:
+ * the objects reached by a path usually share their type at each depth.
+ */
 class Resolver
 {
 public:
@@ -227,20 +262,52 @@ public:
 
   void Resolve (Ptr<Object> root);
 private:
+  struct Item {
+    std::string name;
+    // for the "$TypeId" items
+    bool isGetObject;
+    bool hasTid;
+    TypeId tid;
+    // for the attribute items
+    uint16_t lastTid;
+    bool found;
+    struct TypeId::AttributeInfo info;
+    bool isPointer;
+    bool isVector;
+    const ObjectVectorAccessor *vector;
+  };
   void Canonicalize (void);
-  void DoResolve (std::string path, Ptr<Object> root);
-  void DoArrayResolve (std::string path, const ObjectVectorValue &vector);
+  void DoResolve (uint32_t depth, Ptr<Object> root);
+  void DoArrayResolve (uint32_t depth, Ptr<Object> root, struct Item *item);
   void DoResolveOne (Ptr<Object> object);
   std::string GetResolvedPath (void) const;
   virtual void DoOne (Ptr<Object> object, std::string path) = 0;
   std::vector<std::string> m_workStack;
   std::string m_path;
+  std::vector<struct Item> m_items;
 };
 
 Resolver::Resolver (std::string path)
   : m_path (path)
 {
   Canonicalize ();
+  std::string::size_type cur = 0;
+  std::string::size_type next = m_path.find ("/", 1);
+  while (next != std::string::npos)
+    {
+      struct Item item;
+      item.name = m_path.substr (cur + 1, next - (cur + 1));
+      item.isGetObject = item.name.find ("$") == 0;
+      item.hasTid = false;
+      item.lastTid = 0;
+      item.found = false;
+      item.isPointer = false;
+      item.isVector = false;
+      item.vector = 0;
+      m_items.push_back (item);
+      cur = next;
+      next = m_path.find ("/", cur + 1);
+    }
 }
 Resolver::~Resolver ()
 {}
@@ -265,7 +332,7 @@ Resolver::Canonicalize (void)
 void 
 Resolver::Resolve (Ptr<Object> root)
 {
-  DoResolve (m_path, root);
+  DoResolve (0, root);
 }
 
 std::string
@@ -287,15 +354,11 @@ Resolver::DoResolveOne (Ptr<Object> object)
 }
 
 void
-Resolver::DoResolve (std::string path, Ptr<Object> root)
+Resolver::DoResolve (uint32_t depth, Ptr<Object> root)
 {
-  NS_LOG_FUNCTION (path << root);
-  std::string::size_type tmp;
-  tmp = path.find ("/");
-  NS_ASSERT (tmp == 0);
-  std::string::size_type next = path.find ("/", 1);
+  NS_LOG_FUNCTION (depth << root);
 
-  if (next == std::string::npos)
+  if (depth == m_items.size ())
     {
       //
       // If root is zero, we're beginning to see if we can use the object name 
@@ -311,8 +374,7 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
         }
       return;
     }
-  std::string item = path.substr (1, next-1);
-  std::string pathLeft = path.substr (next, path.size ()-next);
+  struct Item *item = &m_items[depth];
 
   //
   // If root is zero, we're beginning to see if we can use the object name 
@@ -323,11 +385,10 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
   //
   if (root == 0)
     {
-      std::string::size_type offset = path.find ("/Names");
-      if (offset == 0)
+      if (item->name.find ("Names") == 0)
         {
-          m_workStack.push_back (item);
-          DoResolve (pathLeft, root);
+          m_workStack.push_back (item->name);
+          DoResolve (depth + 1, root);
           m_workStack.pop_back ();
           return;
         }
@@ -339,12 +400,12 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
   // zero, this means to look in the root of the "/Names" name space, otherwise
   // it refers to a name space context (level).
   //
-  Ptr<Object> namedObject = Names::Find<Object> (root, item);
+  Ptr<Object> namedObject = Names::Find<Object> (root, item->name);
   if (namedObject)
     {
-      NS_LOG_DEBUG ("Name system resolved item = " << item << " to " << namedObject);
-      m_workStack.push_back (item);
-      DoResolve (pathLeft, namedObject);
+      NS_LOG_DEBUG ("Name system resolved item = " << item->name << " to " << namedObject);
+      m_workStack.push_back (item->name);
+      DoResolve (depth + 1, namedObject);
       m_workStack.pop_back ();
       return;
     }
@@ -360,61 +421,76 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
     {
       return;
     }
-  std::string::size_type dollarPos = item.find ("$");
-  if (dollarPos == 0)
+  if (item->isGetObject)
     {
       // This is a call to GetObject
-      std::string tidString = item.substr (1, item.size () - 1);
+      std::string tidString = item->name.substr (1, item->name.size () - 1);
       NS_LOG_DEBUG ("GetObject="<<tidString<<" on path="<<GetResolvedPath ());
-      TypeId tid = TypeId::LookupByName (tidString);
-      Ptr<Object> object = root->GetObject<Object> (tid);
+      if (!item->hasTid)
+        {
+          item->tid = TypeId::LookupByName (tidString);
+          item->hasTid = true;
+        }
+      Ptr<Object> object = root->GetObject<Object> (item->tid);
       if (object == 0)
 	{
 	  NS_LOG_DEBUG ("GetObject ("<<tidString<<") failed on path="<<GetResolvedPath ());
 	  return;
 	}
-      m_workStack.push_back (item);
-      DoResolve (pathLeft, object);
+      m_workStack.push_back (item->name);
+      DoResolve (depth + 1, object);
       m_workStack.pop_back ();
     }
   else 
     {
       // this is a normal attribute.
       TypeId tid = root->GetInstanceTypeId ();
-      struct TypeId::AttributeInfo info;
-      if (!tid.LookupAttributeByName (item, &info))
+      if (item->lastTid != tid.GetUid ())
+        {
+          item->lastTid = tid.GetUid ();
+          item->found = tid.LookupAttributeByName (item->name, &item->info);
+          if (item->found)
+            {
+              item->isPointer = dynamic_cast<const PointerChecker *> (PeekPointer (item->info.checker)) != 0;
+              item->isVector = dynamic_cast<const ObjectVectorChecker *> (PeekPointer (item->info.checker)) != 0;
+              item->vector = 0;
+              if (item->isVector)
+                {
+                  item->vector = dynamic_cast<const ObjectVectorAccessor *> (PeekPointer (item->info.accessor));
+                }
+            }
+        }
+      if (!item->found)
 	{
-	  NS_LOG_DEBUG ("Requested item="<<item<<" does not exist on path="<<GetResolvedPath ());
+	  NS_LOG_DEBUG ("Requested item="<<item->name<<" does not exist on path="<<GetResolvedPath ());
 	  return;
 	}
-      // attempt to cast to a pointer checker.
-      const PointerChecker *ptr = dynamic_cast<const PointerChecker *> (PeekPointer (info.checker));
-      if (ptr != 0)
+      if (item->isPointer)
 	{
-	  NS_LOG_DEBUG ("GetAttribute(ptr)="<<item<<" on path="<<GetResolvedPath ());
+	  NS_LOG_DEBUG ("GetAttribute(ptr)="<<item->name<<" on path="<<GetResolvedPath ());
           PointerValue ptr;
-          root->GetAttribute (item, ptr);
+          if (!(item->info.flags & TypeId::ATTR_GET) ||
+              !item->info.accessor->Get (PeekPointer (root), ptr))
+            {
+              root->GetAttribute (item->name, ptr);
+            }
 	  Ptr<Object> object = ptr.Get<Object> ();
 	  if (object == 0)
 	    {
-	      NS_LOG_ERROR ("Requested object name=\""<<item<<
+	      NS_LOG_ERROR ("Requested object name=\""<<item->name<<
 			    "\" exists on path=\""<<GetResolvedPath ()<<"\""
 			    " but is null.");
 	      return;
 	    }
-	  m_workStack.push_back (item);
-	  DoResolve (pathLeft, object);
+	  m_workStack.push_back (item->name);
+	  DoResolve (depth + 1, object);
 	  m_workStack.pop_back ();
 	}
-      // attempt to cast to an object vector.
-      const ObjectVectorChecker *vectorChecker = dynamic_cast<const ObjectVectorChecker *> (PeekPointer (info.checker));
-      if (vectorChecker != 0)
+      else if (item->isVector)
 	{
-	  NS_LOG_DEBUG ("GetAttribute(vector)="<<item<<" on path="<<GetResolvedPath ());
-	  ObjectVectorValue vector;
-          root->GetAttribute (item, vector);
-	  m_workStack.push_back (item);
-	  DoArrayResolve (pathLeft, vector);
+	  NS_LOG_DEBUG ("GetAttribute(vector)="<<item->name<<" on path="<<GetResolvedPath ());
+	  m_workStack.push_back (item->name);
+	  DoArrayResolve (depth + 1, root, item);
 	  m_workStack.pop_back ();
 	}
       // this could be anything else and we don't know what to do with it.
@@ -423,29 +499,46 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
 }
 
 void 
-Resolver::DoArrayResolve (std::string path, const ObjectVectorValue &vector)
+Resolver::DoArrayResolve (uint32_t depth, Ptr<Object> root, struct Item *item)
 {
-  NS_ASSERT (path != "");
-  std::string::size_type tmp;
-  tmp = path.find ("/");
-  NS_ASSERT (tmp == 0);
-  std::string::size_type next = path.find ("/", 1);
-  if (next == std::string::npos)
+  if (depth == m_items.size ())
     {
-      NS_FATAL_ERROR ("vector path includes no index data on path=\""<<path<<"\"");
+      NS_FATAL_ERROR ("vector path includes no index data on path=\""<<m_path<<"\"");
     }
-  std::string item = path.substr (1, next-1);
-  std::string pathLeft = path.substr (next, path.size ()-next);
-
-  ArrayMatcher matcher = ArrayMatcher (item);
-  for (uint32_t i = 0; i < vector.GetN (); i++)
+  ArrayMatcher matcher = ArrayMatcher (m_items[depth].name);
+  if (item->vector == 0 || !(item->info.flags & TypeId::ATTR_GET))
+    {
+      ObjectVectorValue vector;
+      root->GetAttribute (item->name, vector);
+      for (uint32_t i = 0; i < vector.GetN (); i++)
+        {
+          if (matcher.Matches (i))
+            {
+              std::ostringstream oss;
+              oss << i;
+              m_workStack.push_back (oss.str ());
+              DoResolve (depth + 1, vector.Get (i));
+              m_workStack.pop_back ();
+            }
+        }
+      return;
+    }
+  // only the objects whose index matches are read from the vector.
+  uint32_t n;
+  if (!item->vector->GetItemN (PeekPointer (root), &n))
+    {
+      return;
+    }
+  uint32_t first, last;
+  matcher.GetBounds (n, &first, &last);
+  for (uint32_t i = first; i < last; i++)
     {
       if (matcher.Matches (i))
 	{
 	  std::ostringstream oss;
 	  oss << i;
 	  m_workStack.push_back (oss.str ());
-	  DoResolve (pathLeft, vector.Get (i));
+	  DoResolve (depth + 1, item->vector->GetItem (PeekPointer (root), i));
 	  m_workStack.pop_back ();
 	}
     }
@@ -1221,6 +1314,92 @@ ObjectVectorTraceConfigTestCase::DoRun (void)
   return GetErrorStatus ();
 }
 
+// ===========================================================================
+// Test that a path only visits the existing objects whose index matches.
+// ===========================================================================
+class ObjectVectorIndexConfigTestCase : public TestCase
+{
+public:
+  ObjectVectorIndexConfigTestCase ();
+  virtual ~ObjectVectorIndexConfigTestCase () {}
+
+  void Trace (std::string path, int16_t oldValue, int16_t newValue) {m_got.insert (path);}
+
+private:
+  virtual bool DoRun (void);
+
+  std::set<std::string> m_got;
+};
+
+ObjectVectorIndexConfigTestCase::ObjectVectorIndexConfigTestCase ()
+  : TestCase ("Check that vector paths visit only the matching indices of the vector")
+{
+}
+
+bool
+ObjectVectorIndexConfigTestCase::DoRun (void)
+{
+  IntegerValue iv;
+
+  Ptr<ConfigTestObject> root = CreateObject<ConfigTestObject> ();
+  Config::RegisterRootNamespaceObject (root);
+  Ptr<ConfigTestObject> a = CreateObject<ConfigTestObject> ();
+  root->SetNodeB (a);
+
+  std::vector<Ptr<ConfigTestObject> > objects;
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Ptr<ConfigTestObject> obj = CreateObject<ConfigTestObject> ();
+      a->AddNodeA (obj);
+      objects.push_back (obj);
+    }
+  objects[4]->SetNodeA (CreateObject<ConfigTestObject> ());
+
+  //
+  // A range which goes past the end of the vector is clipped to the vector
+  //
+  Config::Set ("/NodeB/NodesA/[3-100]/A", IntegerValue (-3));
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      objects[i]->GetAttribute ("A", iv);
+      NS_TEST_ASSERT_MSG_EQ (iv.Get (), (i < 3 ? 10 : -3), "Object Attribute \"A\" not set as expected");
+    }
+
+  //
+  // An index past the end of the vector matches nothing
+  //
+  Config::Set ("/NodeB/NodesA/10|12/A", IntegerValue (-4));
+  objects[9]->GetAttribute ("A", iv);
+  NS_TEST_ASSERT_MSG_EQ (iv.Get (), -3, "Object Attribute \"A\" unexpectedly set");
+
+  //
+  // Overlapping alternatives visit each object once, in order
+  //
+  m_got.clear ();
+  Config::Connect ("/NodeB/NodesA/[5-6]|2|[5-8]|2/Source",
+                   MakeCallback (&ObjectVectorIndexConfigTestCase::Trace, this));
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      objects[i]->SetAttribute ("Source", IntegerValue (i));
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_got.size (), 5U, "Unexpected number of traced objects");
+  NS_TEST_ASSERT_MSG_EQ (m_got.count ("/NodeB/NodesA/2/Source"), 1U, "Object 2 not traced");
+  NS_TEST_ASSERT_MSG_EQ (m_got.count ("/NodeB/NodesA/8/Source"), 1U, "Object 8 not traced");
+
+  //
+  // Null pointers and GetObject are resolved per object
+  //
+  Config::Set ("/NodeB/NodesA/*/NodeA/$ConfigTestObject/B", IntegerValue (-5));
+  objects[4]->GetAttribute ("B", iv);
+  NS_TEST_ASSERT_MSG_EQ (iv.Get (), 9, "Object Attribute \"B\" unexpectedly set");
+  PointerValue ptr;
+  objects[4]->GetAttribute ("NodeA", ptr);
+  ptr.Get<ConfigTestObject> ()->GetAttribute ("B", iv);
+  NS_TEST_ASSERT_MSG_EQ (iv.Get (), -5, "Object Attribute \"B\" not set as expected");
+
+  return GetErrorStatus ();
+}
+
 // ===========================================================================
 // The Test Suite that glues all of the Test Cases together.
 // ===========================================================================
@@ -1236,6 +1415,7 @@ ConfigTestSuite::ConfigTestSuite ()
   AddTestCase (new RootNamespaceConfigTestCase);
   AddTestCase (new UnderRootNamespaceConfigTestCase);
   AddTestCase (new ObjectVectorConfigTestCase);
+  AddTestCase (new ObjectVectorIndexConfigTestCase);
 }
 
 ConfigTestSuite configTestSuite;
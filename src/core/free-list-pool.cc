@@ -0,0 +1,238 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "free-list-pool.h"
+#include "assert.h"
+#include "ns3/core-config.h"
+#include <new>
+#include <algorithm>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+namespace ns3 {
+
+namespace {
+
+struct FreeBlock
+{
+  FreeBlock *next;
+};
+
+} // anonymous namespace
+
+struct FreeListPool::ThreadPool
+{
+  FreeBlock *freeList[MAX_CLASSES];
+  uint32_t length[MAX_CLASSES];
+  uint32_t total;
+  uint32_t maxTotal;
+  uint64_t allocations;
+  uint64_t hits;
+  uint64_t oversized;
+  FreeListPool *owner;
+  ThreadPool *prev;
+  ThreadPool *next;
+};
+
+struct FreeListPool::Threads
+{
+  ThreadPool *pools;
+  struct Stats retired;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t mutex;
+  pthread_key_t key;
+#else /* HAVE_PTHREAD_H */
+  ThreadPool pool;
+#endif /* HAVE_PTHREAD_H */
+};
+
+FreeListPool::FreeListPool (uint32_t granularity, uint32_t classes, uint32_t maxBlocks)
+  : m_granularity (granularity),
+    m_classes (classes),
+    m_maxBlocks (maxBlocks),
+    m_threads (new Threads ())
+{
+  NS_ASSERT (granularity >= sizeof (FreeBlock));
+  NS_ASSERT (classes > 0 && classes <= MAX_CLASSES);
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init (&m_threads->mutex, 0);
+  pthread_key_create (&m_threads->key, &FreeListPool::DestroyThreadPool);
+#endif /* HAVE_PTHREAD_H */
+}
+
+void
+FreeListPool::ReleaseBlocks (ThreadPool *pool)
+{
+  for (uint32_t i = 0; i < MAX_CLASSES; i++)
+    {
+      while (pool->freeList[i] != 0)
+        {
+          FreeBlock *block = pool->freeList[i];
+          pool->freeList[i] = block->next;
+          ::operator delete (block);
+        }
+      pool->length[i] = 0;
+    }
+  pool->total = 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+
+void
+FreeListPool::DestroyThreadPool (void *p)
+{
+  ThreadPool *pool = static_cast<ThreadPool *> (p);
+  Threads *threads = pool->owner->m_threads;
+  ReleaseBlocks (pool);
+  pthread_mutex_lock (&threads->mutex);
+  threads->retired.allocations += pool->allocations;
+  threads->retired.hits += pool->hits;
+  threads->retired.oversized += pool->oversized;
+  threads->retired.maxPooled = std::max<uint64_t> (threads->retired.maxPooled, pool->maxTotal);
+  if (pool->prev != 0)
+    {
+      pool->prev->next = pool->next;
+    }
+  else
+    {
+      threads->pools = pool->next;
+    }
+  if (pool->next != 0)
+    {
+      pool->next->prev = pool->prev;
+    }
+  pthread_mutex_unlock (&threads->mutex);
+  delete pool;
+}
+
+FreeListPool::ThreadPool *
+FreeListPool::GetThreadPool (void)
+{
+  ThreadPool *pool = static_cast<ThreadPool *> (pthread_getspecific (m_threads->key));
+  if (pool == 0)
+    {
+      pool = new ThreadPool ();
+      pool->owner = this;
+      pthread_setspecific (m_threads->key, pool);
+      pthread_mutex_lock (&m_threads->mutex);
+      pool->next = m_threads->pools;
+      if (m_threads->pools != 0)
+        {
+          m_threads->pools->prev = pool;
+        }
+      m_threads->pools = pool;
+      pthread_mutex_unlock (&m_threads->mutex);
+    }
+  return pool;
+}
+
+#else /* HAVE_PTHREAD_H */
+
+void
+FreeListPool::DestroyThreadPool (void *p)
+{}
+
+FreeListPool::ThreadPool *
+FreeListPool::GetThreadPool (void)
+{
+  m_threads->pools = &m_threads->pool;
+  return &m_threads->pool;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+void *
+FreeListPool::Allocate (size_t size)
+{
+  ThreadPool *pool = GetThreadPool ();
+  pool->allocations++;
+  uint32_t sizeClass = (size + m_granularity - 1) / m_granularity - 1;
+  if (sizeClass >= m_classes)
+    {
+      pool->oversized++;
+      return ::operator new (size);
+    }
+  FreeBlock *block = pool->freeList[sizeClass];
+  if (block != 0)
+    {
+      pool->hits++;
+      pool->freeList[sizeClass] = block->next;
+      pool->length[sizeClass]--;
+      pool->total--;
+      return block;
+    }
+  return ::operator new ((sizeClass + 1) * m_granularity);
+}
+
+void
+FreeListPool::Deallocate (void *buffer, size_t size)
+{
+  if (buffer == 0)
+    {
+      return;
+    }
+  uint32_t sizeClass = (size + m_granularity - 1) / m_granularity - 1;
+  if (sizeClass >= m_classes)
+    {
+      ::operator delete (buffer);
+      return;
+    }
+  ThreadPool *pool = GetThreadPool ();
+  if (pool->length[sizeClass] >= m_maxBlocks)
+    {
+      ::operator delete (buffer);
+      return;
+    }
+  FreeBlock *block = static_cast<FreeBlock *> (buffer);
+  block->next = pool->freeList[sizeClass];
+  pool->freeList[sizeClass] = block;
+  pool->length[sizeClass]++;
+  pool->total++;
+  if (pool->total > pool->maxTotal)
+    {
+      pool->maxTotal = pool->total;
+    }
+}
+
+struct FreeListPool::Stats
+FreeListPool::GetStats (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&m_threads->mutex);
+#endif /* HAVE_PTHREAD_H */
+  struct Stats stats = m_threads->retired;
+  stats.pooled = 0;
+  for (ThreadPool *pool = m_threads->pools; pool != 0; pool = pool->next)
+    {
+      stats.allocations += pool->allocations;
+      stats.hits += pool->hits;
+      stats.oversized += pool->oversized;
+      stats.pooled += pool->total;
+      stats.maxPooled = std::max<uint64_t> (stats.maxPooled, pool->maxTotal);
+    }
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&m_threads->mutex);
+#endif /* HAVE_PTHREAD_H */
+  return stats;
+}
+
+void
+FreeListPool::Trim (void)
+{
+  ReleaseBlocks (GetThreadPool ());
+}
+
+} // namespace ns3
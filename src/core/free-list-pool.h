@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef FREE_LIST_POOL_H
+#define FREE_LIST_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ns3 {
+
+/**
+ * \brief per-thread freelists of fixed-size memory blocks
+ *
+ * The blocks are grouped in size classes: the class i holds the
+ * blocks of (i + 1) * granularity bytes. Each thread has its own
+ * freelists, so that Allocate and Deallocate never take a lock, and
+ * a block is recycled by the thread which releases it, which is
+ * not necessarily the thread which allocated it. The requests larger
+ * than the largest size class go to the global allocator.
+ *
+ * This class is used to implement the class-specific operator new
+ * and operator delete of the objects which are created and destroyed
+ * at a high rate, such as the events and the packets. A FreeListPool
+ * is never destroyed: it should be a function-local static, so that
+ * it is constructed before it is first used, even during the static
+ * initialization of the program.
+ */
+class FreeListPool
+{
+public:
+  /**
+   * The counters of a pool, summed over all threads.
+   */
+  struct Stats
+  {
+    /**
+     * The number of blocks allocated.
+     */
+    uint64_t allocations;
+    /**
+     * The number of allocations served from a freelist.
+     */
+    uint64_t hits;
+    /**
+     * The number of allocations too large for any size class.
+     */
+    uint64_t oversized;
+    /**
+     * The number of blocks currently held by the freelists.
+     */
+    uint64_t pooled;
+    /**
+     * The largest number of blocks held by the freelists of
+     * a thread so far.
+     */
+    uint64_t maxPooled;
+  };
+
+  /**
+   * \param granularity the size difference between two consecutive
+   *        size classes, in bytes.
+   * \param classes the number of size classes, at most MAX_CLASSES.
+   * \param maxBlocks the maximum number of blocks kept by the
+   *        freelist of a size class of a thread.
+   */
+  FreeListPool (uint32_t granularity, uint32_t classes, uint32_t maxBlocks);
+
+  /**
+   * \param size the size of the block, in bytes
+   * \returns a block of at least size bytes
+   */
+  void *Allocate (size_t size);
+  /**
+   * \param buffer a block returned by Allocate, or zero
+   * \param size the size given to Allocate
+   */
+  void Deallocate (void *buffer, size_t size);
+  /**
+   * \returns the pool counters. The value returned while other
+   *          threads use the pool is only approximate.
+   */
+  struct Stats GetStats (void);
+  /**
+   * Return the blocks held by the freelists of the calling thread
+   * to the global allocator.
+   */
+  void Trim (void);
+
+  static const uint32_t MAX_CLASSES = 16;
+
+private:
+  struct ThreadPool;
+  struct Threads;
+
+  FreeListPool (const FreeListPool &o);
+  FreeListPool &operator = (const FreeListPool &o);
+
+  ThreadPool *GetThreadPool (void);
+  static void ReleaseBlocks (ThreadPool *pool);
+  static void DestroyThreadPool (void *p);
+
+  uint32_t m_granularity;
+  uint32_t m_classes;
+  uint32_t m_maxBlocks;
+  // the pools of all live threads, the counters of the pools of
+  // the threads which have exited and the lock which protects them.
+  struct Threads *m_threads;
+};
+
+} // namespace ns3
+
+#endif /* FREE_LIST_POOL_H */
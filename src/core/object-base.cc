@@ -20,12 +20,17 @@
 #include "object-base.h"
 #include "log.h"
 #include "trace-source-accessor.h"
+#include "trace-stats.h"
 #include "attribute-list.h"
 #include "string.h"
 #include "ns3/core-config.h"
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+#include <vector>
 
 NS_LOG_COMPONENT_DEFINE ("ObjectBase");
 
@@ -53,106 +58,205 @@ void
 ObjectBase::NotifyConstructionCompleted (void)
 {}
 
-void
-ObjectBase::ConstructSelf (const AttributeList &attributes)
+/* The construction plan of a TypeId lists the attributes of the TypeId
+ * and of its parents which must be set during construction, together
+ * with the value which is used when the caller does not specify one:
+ * the value from the global AttributeList, from the NS_ATTRIBUTE_DEFAULT
+ * environment variable or the initial value, in this order. A plan is
+ * rebuilt when the global AttributeList changes: the new plan replaces
+ * the old one, which is never modified once it is published, so that
+ * the objects constructed concurrently by other threads can keep using
+ * it.
+ */
+struct ConstructionPlanItem
+{
+  Ptr<const AttributeAccessor> accessor;
+  Ptr<const AttributeChecker> checker;
+  Ptr<const AttributeValue> value;
+  Ptr<const AttributeValue> initial;
+};
+
+struct ConstructionPlan
+{
+  uint32_t generation;
+  std::vector<struct ConstructionPlanItem> items;
+};
+
+// returns a copy of value which passes the checker or zero.
+static Ptr<const AttributeValue>
+CheckedValue (Ptr<const AttributeChecker> checker, const AttributeValue &value)
+{
+  if (checker->Check (value))
+    {
+      return value.Copy ();
+    }
+  const StringValue *str = dynamic_cast<const StringValue *> (&value);
+  if (str == 0)
+    {
+      return 0;
+    }
+  Ptr<AttributeValue> v = checker->Create ();
+  if (!v->DeserializeFromString (str->Get (), checker) ||
+      !checker->Check (*v))
+    {
+      return 0;
+    }
+  return v;
+}
+
+// protects the table of the construction plans.
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_plansMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif /* HAVE_PTHREAD_H */
+
+static void
+LockPlans (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&g_plansMutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+static void
+UnlockPlans (void)
 {
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_plansMutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+struct ConstructionPlan *
+ObjectBase::GetConstructionPlan (TypeId tid)
+{
+  // the plans are never deleted: an attribute setter may construct
+  // other objects while a plan is used, and so may other threads.
+  static std::vector<struct ConstructionPlan *> plans;
+  uint16_t uid = tid.GetUid ();
+  LockPlans ();
+  if (uid < plans.size () && plans[uid] != 0 &&
+      plans[uid]->generation == AttributeList::m_globalGeneration)
+    {
+      struct ConstructionPlan *plan = plans[uid];
+      UnlockPlans ();
+      return plan;
+    }
+  UnlockPlans ();
+  // the plan is built without the lock: its values are created by the
+  // attribute checkers, which may need other plans.
+  struct ConstructionPlan *plan = BuildConstructionPlan (tid);
+  LockPlans ();
+  if (uid >= plans.size ())
+    {
+      plans.resize (uid + 1, 0);
+    }
+  if (plans[uid] != 0 && plans[uid]->generation >= plan->generation)
+    {
+      // another thread built this plan, or a newer one, first.
+      delete plan;
+      plan = plans[uid];
+    }
+  else
+    {
+      plans[uid] = plan;
+    }
+  UnlockPlans ();
+  return plan;
+}
+
+struct ConstructionPlan *
+ObjectBase::BuildConstructionPlan (TypeId tid)
+{
+  NS_LOG_DEBUG ("build construction plan for tid="<<tid.GetName ());
+  struct ConstructionPlan *plan = new ConstructionPlan ();
+  plan->generation = AttributeList::m_globalGeneration;
+  AttributeList *global = AttributeList::GetGlobal ();
+#ifdef HAVE_GETENV
+  char *envVar = getenv ("NS_ATTRIBUTE_DEFAULT");
+#endif /* HAVE_GETENV */
   // loop over the inheritance tree back to the Object base class.
-  TypeId tid = GetInstanceTypeId ();
   do {
-    // loop over all attributes in object type
-    NS_LOG_DEBUG ("construct tid="<<tid.GetName ()<<", params="<<tid.GetAttributeN ());
     for (uint32_t i = 0; i < tid.GetAttributeN (); i++)
       {
-        Ptr<const AttributeAccessor> accessor = tid.GetAttributeAccessor (i);
-        Ptr<const AttributeValue> initial = tid.GetAttributeInitialValue (i);
-        Ptr<const AttributeChecker> checker = tid.GetAttributeChecker (i);
-        NS_LOG_DEBUG ("try to construct \""<< tid.GetName ()<<"::"<<
-                      tid.GetAttributeName (i)<<"\"");
         if (!(tid.GetAttributeFlags (i) & TypeId::ATTR_CONSTRUCT))
           {
             continue;
           }
-        bool found = false;
-        // is this attribute stored in this AttributeList instance ?
-        for (AttributeList::Attrs::const_iterator j = attributes.m_attributes.begin ();
-             j != attributes.m_attributes.end (); j++)
+        struct ConstructionPlanItem item;
+        item.accessor = tid.GetAttributeAccessor (i);
+        item.checker = tid.GetAttributeChecker (i);
+        item.initial = CheckedValue (item.checker, *tid.GetAttributeInitialValue (i));
+        // is this attribute stored in the global instance ?
+        for (AttributeList::Attrs::const_iterator j = global->m_attributes.begin ();
+             j != global->m_attributes.end () && item.value == 0; j++)
           {
-            if (j->checker == checker)
+            if (j->checker == item.checker)
               {
-                // We have a matching attribute value.
-                if (DoSet (accessor, checker, *j->value))
-                  {
-                    NS_LOG_DEBUG ("construct \""<< tid.GetName ()<<"::"<<
-                                  tid.GetAttributeName (i)<<"\"");
-                    found = true;
-                    break;
-                  }
+                item.value = CheckedValue (item.checker, *j->value);
               }
           }
-        if (!found)
+#ifdef HAVE_GETENV
+        // No matching attribute value so we try to look at the env var.
+        if (item.value == 0 && envVar != 0)
           {
-            // is this attribute stored in the global instance ?
-            for (AttributeList::Attrs::const_iterator j = AttributeList::GetGlobal ()->m_attributes.begin ();
-                 j != AttributeList::GetGlobal ()->m_attributes.end (); j++)
+            std::string env = std::string (envVar);
+            std::string::size_type cur = 0;
+            std::string::size_type next = 0;
+            while (next != std::string::npos && item.value == 0)
               {
-                if (j->checker == checker)
+                next = env.find (";", cur);
+                std::string tmp = std::string (env, cur, next-cur);
+                std::string::size_type equal = tmp.find ("=");
+                if (equal != std::string::npos)
                   {
-                    // We have a matching attribute value.
-                    if (DoSet (accessor, checker, *j->value))
+                    std::string name = tmp.substr (0, equal);
+                    std::string value = tmp.substr (equal+1, tmp.size () - equal - 1);
+                    if (name == tid.GetAttributeFullName (i))
                       {
-                        NS_LOG_DEBUG ("construct \""<< tid.GetName ()<<"::"<<
-                                      tid.GetAttributeName (i)<<"\" from global");
-                        found = true;
-                        break;
+                        item.value = CheckedValue (item.checker, StringValue (value));
                       }
                   }
+                cur = next + 1;
               }
           }
-        if (!found)
-          {
-            // No matching attribute value so we try to look at the env var.
-#ifdef HAVE_GETENV
-            char *envVar = getenv ("NS_ATTRIBUTE_DEFAULT");
-            if (envVar != 0)
-              {
-                std::string env = std::string (envVar);
-                std::string::size_type cur = 0;
-                std::string::size_type next = 0;
-                while (next != std::string::npos)
-                  {
-                    next = env.find (";", cur);
-                    std::string tmp = std::string (env, cur, next-cur);
-                    std::string::size_type equal = tmp.find ("=");
-                    if (equal != std::string::npos)
-                      {
-                        std::string name = tmp.substr (0, equal);
-                        std::string value = tmp.substr (equal+1, tmp.size () - equal - 1);
-                        if (name == tid.GetAttributeFullName (i))
-                          {
-                            if (DoSet (accessor, checker, StringValue (value)))
-                              {
-                                NS_LOG_DEBUG ("construct \""<< tid.GetName ()<<"::"<<
-                                              tid.GetAttributeName (i)<<"\" from env var");
-                                found = true;
-                                break;
-                              }
-                          }
-                      }
-                    cur = next + 1;
-                  }
-              }
 #endif /* HAVE_GETENV */
-          }
-        if (!found)
+        if (item.value == 0)
           {
-            // No matching attribute value so we try to set the default value.
-            DoSet (accessor, checker, *initial);
-            NS_LOG_DEBUG ("construct \""<< tid.GetName ()<<"::"<<
-                          tid.GetAttributeName (i)<<"\" from initial value.");
+            item.value = item.initial;
           }
+        plan->items.push_back (item);
       }
     tid = tid.GetParent ();
   } while (tid != ObjectBase::GetTypeId ());
+  return plan;
+}
+
+void
+ObjectBase::ConstructSelf (const AttributeList &attributes)
+{
+  struct ConstructionPlan *plan = GetConstructionPlan (GetInstanceTypeId ());
+  NS_LOG_DEBUG ("construct tid="<<GetInstanceTypeId ().GetName ()<<", params="<<plan->items.size ());
+  for (uint32_t k = 0; k < plan->items.size (); k++)
+    {
+      struct ConstructionPlanItem const *i = &plan->items[k];
+      bool found = false;
+      // is this attribute stored in this AttributeList instance ?
+      for (AttributeList::Attrs::const_iterator j = attributes.m_attributes.begin ();
+           j != attributes.m_attributes.end () && !found; j++)
+        {
+          if (j->checker == i->checker)
+            {
+              // We have a matching attribute value.
+              found = DoSet (i->accessor, i->checker, *j->value);
+            }
+        }
+      if (!found && i->value != 0 && !i->accessor->Set (this, *i->value) &&
+          i->initial != 0 && i->initial != i->value)
+        {
+          // the default value could not be set so we try to set the
+          // initial value.
+          i->accessor->Set (this, *i->initial);
+        }
+    }
   NotifyConstructionCompleted ();
 }
 
@@ -301,7 +405,9 @@ ObjectBase::TraceConnectWithoutContext (std::string name, const CallbackBase &cb
     {
       return false;
     }
+  TraceStats::BeginConnect (tid, name);
   bool ok = accessor->ConnectWithoutContext (this, cb);
+  TraceStats::EndConnect ();
   return ok;
 }
 bool 
@@ -313,7 +419,9 @@ ObjectBase::TraceConnect (std::string name, std::string context, const CallbackB
     {
       return false;
     }
+  TraceStats::BeginConnect (tid, name);
   bool ok = accessor->Connect (this, context, cb);
+  TraceStats::EndConnect ();
   return ok;
 }
 bool 
@@ -40,6 +40,7 @@
 namespace ns3 {
 
 class AttributeList;
+struct ConstructionPlan;
 
 /**
  * \ingroup object
@@ -153,6 +154,8 @@ protected:
   void ConstructSelf (const AttributeList &attributes);
 
 private:
+  static struct ConstructionPlan *GetConstructionPlan (TypeId tid);
+  static struct ConstructionPlan *BuildConstructionPlan (TypeId tid);
   bool DoSet (Ptr<const AttributeAccessor> spec,
               Ptr<const AttributeChecker> checker, 
               const AttributeValue &value);
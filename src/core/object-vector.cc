@@ -80,6 +80,16 @@ ObjectVectorAccessor::Get (const ObjectBase * object, AttributeValue &value) con
     }
   return true;
 }
+bool
+ObjectVectorAccessor::GetItemN (const ObjectBase *object, uint32_t *n) const
+{
+  return DoGetN (object, n);
+}
+Ptr<Object>
+ObjectVectorAccessor::GetItem (const ObjectBase *object, uint32_t i) const
+{
+  return DoGet (object, i);
+}
 bool 
 ObjectVectorAccessor::HasGetter (void) const
 {
@@ -89,6 +89,7 @@ Object::Object ()
 {
   m_aggregates->n = 1;
   m_aggregates->buffer[0] = this;
+  ClearCache (m_aggregates);
 }
 Object::~Object () 
 {
@@ -105,6 +106,8 @@ Object::~Object ()
           m_aggregates->n--;
         }
     }
+  // the cache must not return this object anymore.
+  ClearCache (m_aggregates);
   // finally, if all objects have been removed from the list,
   // delete the aggregate list
   if (m_aggregates->n == 0)
@@ -122,6 +125,7 @@ Object::Object (const Object &o)
 {
   m_aggregates->n = 1;
   m_aggregates->buffer[0] = this;
+  ClearCache (m_aggregates);
 }
 void
 Object::Construct (const AttributeList &attributes)
@@ -129,11 +133,54 @@ Object::Construct (const AttributeList &attributes)
   ConstructSelf (attributes);
 }
 
+#ifdef NS3_ASSERT_ENABLE
+static uint64_t g_cacheHits = 0;
+static uint64_t g_cacheMisses = 0;
+#endif /* NS3_ASSERT_ENABLE */
+
+uint64_t
+Object::GetCacheHits (void)
+{
+#ifdef NS3_ASSERT_ENABLE
+  return g_cacheHits;
+#else
+  return 0;
+#endif
+}
+uint64_t
+Object::GetCacheMisses (void)
+{
+#ifdef NS3_ASSERT_ENABLE
+  return g_cacheMisses;
+#else
+  return 0;
+#endif
+}
+
+void
+Object::ClearCache (struct Aggregates *aggregates)
+{
+  memset (aggregates->cacheTids, 0, sizeof (aggregates->cacheTids));
+}
+
 Ptr<Object>
 Object::DoGetObject (TypeId tid) const
 {
   NS_ASSERT (CheckLoose ());
 
+  uint16_t uid = tid.GetUid ();
+  uint32_t slot = uid % CACHE_SIZE;
+  if (m_aggregates->cacheTids[slot] == uid)
+    {
+#ifdef NS3_ASSERT_ENABLE
+      g_cacheHits++;
+#endif
+      return m_aggregates->cacheObjects[slot];
+    }
+#ifdef NS3_ASSERT_ENABLE
+  g_cacheMisses++;
+#endif
+
   uint32_t n = m_aggregates->n;
   TypeId objectTid = Object::GetTypeId ();
   for (uint32_t i = 0; i < n; i++)
@@ -156,10 +203,14 @@ Object::DoGetObject (TypeId tid) const
           current->m_getObjectCount++;
           // then, update the sort
           UpdateSortedArray (m_aggregates, i);
-          // finally, return the match
+          // finally, remember and return the match
+          m_aggregates->cacheTids[slot] = uid;
+          m_aggregates->cacheObjects[slot] = current;
           return const_cast<Object *> (current);
         }
     }
+  m_aggregates->cacheTids[slot] = uid;
+  m_aggregates->cacheObjects[slot] = 0;
   return 0;
 }
 void
@@ -243,6 +294,7 @@ Object::AggregateObject (Ptr<Object> o)
   struct Aggregates *aggregates = 
     (struct Aggregates *)malloc (sizeof(struct Aggregates)+(total-1)*sizeof(Object*));
   aggregates->n = total;
+  ClearCache (aggregates);
 
   // copy our buffer to the new buffer
   memcpy (&aggregates->buffer[0], 
@@ -706,6 +758,73 @@ AggregateObjectTestCase::DoRun (void)
   return GetErrorStatus ();
 }
 
+// ===========================================================================
+// Test case to make sure that the cache of GetObject follows the changes of
+// an aggregation.
+// ===========================================================================
+class ObjectCacheTestCase : public TestCase
+{
+public:
+  ObjectCacheTestCase ();
+  virtual ~ObjectCacheTestCase ();
+
+private:
+  virtual bool DoRun (void);
+};
+
+ObjectCacheTestCase::ObjectCacheTestCase ()
+  : TestCase ("Check the cache of GetObject")
+{
+}
+
+ObjectCacheTestCase::~ObjectCacheTestCase ()
+{
+}
+
+bool
+ObjectCacheTestCase::DoRun (void)
+{
+  Ptr<BaseA> baseA = CreateObject<BaseA> ();
+  Ptr<DerivedB> derivedB = CreateObject<DerivedB> ();
+
+  //
+  // A failed lookup is cached until another object is aggregated.
+  //
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<BaseB> (BaseB::GetTypeId ()), 0, "Unexpectedly found a BaseB through baseA");
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<BaseB> (BaseB::GetTypeId ()), 0, "Unexpectedly found a BaseB through baseA");
+
+  baseA->AggregateObject (derivedB);
+
+  //
+  // A lookup for the parent of the type of an object finds this object and
+  // the next lookup is answered by the cache.
+  //
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<BaseB> (BaseB::GetTypeId ()), derivedB, "Cannot GetObject (through baseA) for BaseB Object");
+  uint64_t hits = Object::GetCacheHits ();
+  uint64_t misses = Object::GetCacheMisses ();
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<BaseB> (BaseB::GetTypeId ()), derivedB, "Cannot GetObject (through baseA) for BaseB Object");
+  NS_TEST_ASSERT_MSG_EQ (derivedB->GetObject<BaseB> (BaseB::GetTypeId ()), derivedB, "Cannot GetObject (through derivedB) for BaseB Object");
+  NS_TEST_ASSERT_MSG_EQ (derivedB->GetObject<BaseA> (BaseA::GetTypeId ()), baseA, "Cannot GetObject (through derivedB) for BaseA Object");
+#ifdef NS3_ASSERT_ENABLE
+  NS_TEST_ASSERT_MSG_EQ (Object::GetCacheHits (), hits + 2, "The cache did not answer the repeated lookups");
+  NS_TEST_ASSERT_MSG_EQ (Object::GetCacheMisses (), misses + 1, "The cache answered a new lookup");
+#else
+  NS_TEST_ASSERT_MSG_EQ (Object::GetCacheHits (), 0, "Optimized builds do not count the lookups");
+  NS_TEST_ASSERT_MSG_EQ (Object::GetCacheMisses (), 0, "Optimized builds do not count the lookups");
+#endif
+
+  //
+  // Other lookups, which may use the same entries of the cache, do not
+  // change the results.
+  //
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<DerivedA> (DerivedA::GetTypeId ()), 0, "Unexpectedly found a DerivedA through baseA");
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<BaseB> (BaseB::GetTypeId ()), derivedB, "Cannot GetObject (through baseA) for BaseB Object");
+  NS_TEST_ASSERT_MSG_EQ (baseA->GetObject<DerivedB> (DerivedB::GetTypeId ()), derivedB, "Cannot GetObject (through baseA) for DerivedB Object");
+  NS_TEST_ASSERT_MSG_EQ ((baseA->GetObject<Object> (Object::GetTypeId ()) != 0), true, "Cannot GetObject (through baseA) for Object");
+
+  return GetErrorStatus ();
+}
+
 // ===========================================================================
 // Test case to make sure that an Object factory can create Objects
 // ===========================================================================
@@ -795,6 +914,7 @@ ObjectTestSuite::ObjectTestSuite ()
   AddTestCase (new CreateObjectTestCase);
   AddTestCase (new AggregateObjectTestCase);
   AddTestCase (new ObjectFactoryTestCase);
+  AddTestCase (new ObjectCacheTestCase);
 }
 
 ObjectTestSuite objectTestSuite;
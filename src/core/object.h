@@ -115,6 +115,20 @@ public:
    */
   template <typename T>
   Ptr<T> GetObject (TypeId tid) const;
+  /**
+   * \returns the number of GetObject lookups which were answered by the
+   *          cache of an aggregate, since the start of the program.
+   *
+   * Only debug builds count the lookups: optimized builds return zero.
+   */
+  static uint64_t GetCacheHits (void);
+  /**
+   * \returns the number of GetObject lookups which had to search the
+   *          objects of an aggregate, since the start of the program.
+   *
+   * Only debug builds count the lookups: optimized builds return zero.
+   */
+  static uint64_t GetCacheMisses (void);
   /**
    * Run the DoDispose methods of this object and all the
    * objects aggregated to it.
@@ -231,6 +245,9 @@ private:
   friend class AggregateIterator;
   friend class ObjectDeleter;
 
+  enum {
+    CACHE_SIZE = 8
+  };
   /**
    * This data structure uses a classic C-style trick to 
    * hold an array of variable size without performing
@@ -240,9 +257,16 @@ private:
    * chunk of memory than the struct to allow space for a larger
    * variable sized buffer whose size is indicated by the element
    * 'n'
+   *
+   * The results of the recent lookups of DoGetObject are cached
+   * in a direct-mapped table indexed by the uid of the requested 
+   * TypeId: a zero uid marks an empty entry and a zero object 
+   * marks a failed lookup.
    */
   struct Aggregates {
     uint32_t n;
+    uint16_t cacheTids[CACHE_SIZE];
+    Object *cacheObjects[CACHE_SIZE];
     Object *buffer[1];
   };
 
@@ -268,6 +292,7 @@ private:
   void Construct (const AttributeList &attributes);
 
   void UpdateSortedArray (struct Aggregates *aggregates, uint32_t i) const;
+  static void ClearCache (struct Aggregates *aggregates);
   /**
    * Attempt to delete this object. This method iterates
    * over all aggregated objects to check if they all 
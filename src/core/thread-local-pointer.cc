@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "thread-local-pointer.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+namespace ns3 {
+
+#ifdef HAVE_PTHREAD_H
+
+struct ThreadLocalPointer::Key
+{
+  pthread_key_t key;
+};
+
+ThreadLocalPointer::ThreadLocalPointer (void (*destroy) (void *))
+  : m_key (new Key ())
+{
+  pthread_key_create (&m_key->key, destroy);
+}
+
+void *
+ThreadLocalPointer::Get (void) const
+{
+  return pthread_getspecific (m_key->key);
+}
+
+void
+ThreadLocalPointer::Set (void *value)
+{
+  pthread_setspecific (m_key->key, value);
+}
+
+#else /* HAVE_PTHREAD_H */
+
+struct ThreadLocalPointer::Key
+{
+  void *value;
+};
+
+ThreadLocalPointer::ThreadLocalPointer (void (*destroy) (void *))
+  : m_key (new Key ())
+{
+  m_key->value = 0;
+}
+
+void *
+ThreadLocalPointer::Get (void) const
+{
+  return m_key->value;
+}
+
+void
+ThreadLocalPointer::Set (void *value)
+{
+  m_key->value = value;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+} // namespace ns3
@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef THREAD_LOCAL_POINTER_H
+#define THREAD_LOCAL_POINTER_H
+
+namespace ns3 {
+
+/**
+ * \brief a pointer which holds a separate value in each thread
+ *
+ * This class is used to keep per-thread caches, such as the free
+ * lists of the packet buffers, which would otherwise have to be
+ * locked when the threads of a MultiThreadedSimulatorImpl use them
+ * concurrently. The value of a thread is zero until this thread sets
+ * it. When a thread exits, the destroy function given to the
+ * constructor is called with its value if this value is not zero.
+ * It is not called for the main thread of the program.
+ *
+ * A ThreadLocalPointer is never destroyed: like a FreeListPool, it
+ * should be a function-local static.
+ */
+class ThreadLocalPointer
+{
+public:
+  /**
+   * \param destroy the function called with the value of each
+   *        exiting thread, or zero.
+   */
+  ThreadLocalPointer (void (*destroy) (void *));
+
+  /**
+   * \returns the value of the calling thread.
+   */
+  void *Get (void) const;
+  /**
+   * \param value the new value of the calling thread.
+   */
+  void Set (void *value);
+
+private:
+  struct Key;
+
+  ThreadLocalPointer (const ThreadLocalPointer &o);
+  ThreadLocalPointer &operator = (const ThreadLocalPointer &o);
+
+  struct Key *m_key;
+};
+
+} // namespace ns3
+
+#endif /* THREAD_LOCAL_POINTER_H */
@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "trace-stats.h"
+#include "type-id.h"
+#include "global-value.h"
+#include "boolean.h"
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <time.h>
+
+namespace ns3 {
+
+static GlobalValue g_traceStatsEnabled = GlobalValue ("TraceStatsEnabled",
+                                                      "A global switch to count the hits and the sink time "
+                                                      "of the trace sources connected by name",
+                                                      BooleanValue (false),
+                                                      MakeBooleanChecker ());
+
+namespace {
+
+typedef std::map<std::string, struct TraceStats::Entry *> EntryMap;
+
+// The entries are never deleted: the trace sources keep a pointer
+// to their entry for as long as they live.
+EntryMap *
+GetEntries (void)
+{
+  static EntryMap entries;
+  return &entries;
+}
+
+struct TraceStats::Entry *g_connecting = 0;
+
+bool
+CompareSinkTime (const struct TraceStats::Entry *a, const struct TraceStats::Entry *b)
+{
+  return a->sinkTime > b->sinkTime;
+}
+
+} // anonymous namespace
+
+bool
+TraceStats::IsEnabled (void)
+{
+  BooleanValue val;
+  g_traceStatsEnabled.GetValue (val);
+  return val.Get ();
+}
+
+uint64_t
+TraceStats::GetHits (std::string name)
+{
+  EntryMap::const_iterator i = GetEntries ()->find (name);
+  if (i == GetEntries ()->end ())
+    {
+      return 0;
+    }
+  return i->second->hits;
+}
+
+uint64_t
+TraceStats::GetSinkTime (std::string name)
+{
+  EntryMap::const_iterator i = GetEntries ()->find (name);
+  if (i == GetEntries ()->end ())
+    {
+      return 0;
+    }
+  return i->second->sinkTime;
+}
+
+void
+TraceStats::Reset (void)
+{
+  for (EntryMap::iterator i = GetEntries ()->begin (); i != GetEntries ()->end (); i++)
+    {
+      i->second->hits = 0;
+      i->second->sinkTime = 0;
+    }
+}
+
+void
+TraceStats::Print (std::ostream &os)
+{
+  std::vector<struct Entry *> entries;
+  for (EntryMap::const_iterator i = GetEntries ()->begin (); i != GetEntries ()->end (); i++)
+    {
+      if (i->second->hits != 0)
+        {
+          entries.push_back (i->second);
+        }
+    }
+  std::stable_sort (entries.begin (), entries.end (), &CompareSinkTime);
+  for (std::vector<struct Entry *>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      os << (*i)->name << " hits=" << (*i)->hits 
+         << " sinkTime=" << (*i)->sinkTime << "ns" << std::endl;
+    }
+}
+
+void
+TraceStats::BeginConnect (TypeId tid, std::string name)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  std::string fullName = tid.GetName () + "::" + name;
+  EntryMap::iterator i = GetEntries ()->find (fullName);
+  if (i == GetEntries ()->end ())
+    {
+      struct Entry *entry = new Entry ();
+      entry->name = fullName;
+      entry->hits = 0;
+      entry->sinkTime = 0;
+      i = GetEntries ()->insert (std::make_pair (fullName, entry)).first;
+    }
+  g_connecting = i->second;
+}
+
+void
+TraceStats::EndConnect (void)
+{
+  g_connecting = 0;
+}
+
+struct TraceStats::Entry *
+TraceStats::GetConnecting (void)
+{
+  return g_connecting;
+}
+
+uint64_t
+TraceStats::Start (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void
+TraceStats::Stop (struct Entry *entry, uint64_t start)
+{
+  // an entry is shared by all the instances of a type, which may
+  // fire concurrently from the threads of a MultiThreadedSimulatorImpl.
+  __sync_fetch_and_add (&entry->hits, 1);
+  __sync_fetch_and_add (&entry->sinkTime, Start () - start);
+}
+
+} // namespace ns3
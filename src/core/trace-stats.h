@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef TRACE_STATS_H
+#define TRACE_STATS_H
+
+#include <string>
+#include <ostream>
+#include <stdint.h>
+
+namespace ns3 {
+
+class TypeId;
+
+/**
+ * \brief count how often the trace sources fire and how long their sinks run
+ * \ingroup tracing
+ *
+ * When the global value "TraceStatsEnabled" is true, the trace sources
+ * connected by name, that is, through ObjectBase::TraceConnect,
+ * ObjectBase::TraceConnectWithoutContext or the Config functions,
+ * record each time they fire with at least one sink connected and the
+ * time spent in their sinks. The statistics are grouped by the name
+ * of the type of the object which holds the trace source and by the
+ * name of the trace source, for example "ns3::DropTailQueue::Enqueue".
+ *
+ * The global value must be set before the trace sources are
+ * connected: the trace sources connected while it was false are never
+ * counted. The trace sources with no sinks connected are never
+ * counted either.
+ */
+class TraceStats
+{
+public:
+  struct Entry
+  {
+    std::string name;
+    uint64_t hits;
+    uint64_t sinkTime;
+  };
+
+  /**
+   * \returns true if the trace sources which are connected now
+   *          must record their statistics, false otherwise.
+   */
+  static bool IsEnabled (void);
+  /**
+   * \param name the name of a trace source, for example
+   *        "ns3::DropTailQueue::Enqueue"
+   * \returns the number of times the trace source fired
+   */
+  static uint64_t GetHits (std::string name);
+  /**
+   * \param name the name of a trace source
+   * \returns the time spent in the sinks of the trace source,
+   *          in nanoseconds.
+   */
+  static uint64_t GetSinkTime (std::string name);
+  /**
+   * Set all the statistics recorded so far to zero.
+   */
+  static void Reset (void);
+  /**
+   * \param os the output stream
+   *
+   * Print the statistics of each trace source which fired, from
+   * the one whose sinks took the most time to the one whose sinks
+   * took the least.
+   */
+  static void Print (std::ostream &os);
+
+  /**
+   * \param tid the type of the object being connected
+   * \param name the name of the trace source being connected
+   *
+   * Called by ObjectBase before it connects one of its trace sources
+   * to a sink: while the connection lasts, GetConnecting returns the
+   * statistics of this trace source.
+   */
+  static void BeginConnect (TypeId tid, std::string name);
+  /**
+   * Called by ObjectBase once the trace source is connected.
+   */
+  static void EndConnect (void);
+  /**
+   * \returns the statistics of the trace source being connected or
+   *          zero if the statistics are disabled.
+   */
+  static struct Entry *GetConnecting (void);
+  /**
+   * \returns the current time, in nanoseconds.
+   */
+  static uint64_t Start (void);
+  /**
+   * \param entry the statistics of the trace source which fired
+   * \param start the time returned by Start before the sinks were called.
+   */
+  static void Stop (struct Entry *entry, uint64_t start);
+};
+
+} // namespace ns3
+
+#endif /* TRACE_STATS_H */
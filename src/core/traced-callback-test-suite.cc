@@ -18,6 +18,11 @@
 
 #include "test.h"
 #include "traced-callback.h"
+#include "object.h"
+#include "config.h"
+#include "boolean.h"
+#include "trace-source-accessor.h"
+#include "trace-stats.h"
 
 using namespace ns3;
 
@@ -110,6 +115,98 @@ BasicTracedCallbackTestCase::DoRun (void)
   return GetErrorStatus ();
 }
 
+class TraceStatsTestObject : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  void Fire (uint8_t a) {m_trace (a, 0.0);}
+  bool IsTraced (void) const {return !m_trace.IsEmpty ();}
+private:
+  TracedCallback<uint8_t, double> m_trace;
+};
+
+TypeId
+TraceStatsTestObject::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TraceStatsTestObject")
+    .SetParent<Object> ()
+    .AddTraceSource ("Source", "XX",
+                     MakeTraceSourceAccessor (&TraceStatsTestObject::m_trace))
+    ;
+  return tid;
+}
+
+class TraceStatsTestCase : public TestCase
+{
+public:
+  TraceStatsTestCase ();
+  virtual ~TraceStatsTestCase () {}
+
+private:
+  virtual bool DoRun (void);
+
+  void Cb (uint8_t a, double b);
+
+  uint32_t m_calls;
+};
+
+TraceStatsTestCase::TraceStatsTestCase ()
+  : TestCase ("Check TracedCallback::IsEmpty and the trace statistics")
+{
+}
+
+void
+TraceStatsTestCase::Cb (uint8_t a, double b)
+{
+  m_calls++;
+}
+
+bool
+TraceStatsTestCase::DoRun (void)
+{
+  m_calls = 0;
+  Ptr<TraceStatsTestObject> a = CreateObject<TraceStatsTestObject> ();
+  Ptr<TraceStatsTestObject> b = CreateObject<TraceStatsTestObject> ();
+  NS_TEST_ASSERT_MSG_EQ (a->IsTraced (), false, "Trace source unexpectedly connected");
+
+  //
+  // Statistics are recorded only by the trace sources connected by name
+  // while they are enabled.
+  //
+  Config::SetGlobal ("TraceStatsEnabled", BooleanValue (true));
+  a->TraceConnectWithoutContext ("Source", MakeCallback (&TraceStatsTestCase::Cb, this));
+  Config::SetGlobal ("TraceStatsEnabled", BooleanValue (false));
+  b->TraceConnectWithoutContext ("Source", MakeCallback (&TraceStatsTestCase::Cb, this));
+  NS_TEST_ASSERT_MSG_EQ (a->IsTraced (), true, "Trace source not connected");
+
+  TraceStats::Reset ();
+  a->Fire (1);
+  a->Fire (2);
+  a->Fire (3);
+  b->Fire (4);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, 4, "Unexpected number of sink calls");
+  NS_TEST_ASSERT_MSG_EQ (TraceStats::GetHits ("ns3::TraceStatsTestObject::Source"), 3, 
+                         "Unexpected number of trace hits");
+  NS_TEST_ASSERT_MSG_EQ (TraceStats::GetHits ("ns3::TraceStatsTestObject::Other"), 0, 
+                         "Unexpected trace hits");
+
+  //
+  // A trace source with no sinks left is not counted.
+  //
+  a->TraceDisconnectWithoutContext ("Source", MakeCallback (&TraceStatsTestCase::Cb, this));
+  NS_TEST_ASSERT_MSG_EQ (a->IsTraced (), false, "Trace source not disconnected");
+  a->Fire (5);
+  NS_TEST_ASSERT_MSG_EQ (TraceStats::GetHits ("ns3::TraceStatsTestObject::Source"), 3, 
+                         "Unexpected number of trace hits");
+  NS_TEST_ASSERT_MSG_EQ (m_calls, 4, "Unexpected number of sink calls");
+
+  TraceStats::Reset ();
+  NS_TEST_ASSERT_MSG_EQ (TraceStats::GetHits ("ns3::TraceStatsTestObject::Source"), 0, 
+                         "Trace hits not reset");
+
+  return GetErrorStatus ();
+}
+
 class TracedCallbackTestSuite : public TestSuite
 {
 public:
@@ -120,6 +217,7 @@ TracedCallbackTestSuite::TracedCallbackTestSuite ()
   : TestSuite ("traced-callback", UNIT)
 {
   AddTestCase (new BasicTracedCallbackTestCase);
+  AddTestCase (new TraceStatsTestCase);
 }
 
 TracedCallbackTestSuite tracedCallbackTestSuite;
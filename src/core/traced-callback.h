@@ -23,6 +23,7 @@
 
 #include <list>
 #include "callback.h"
+#include "trace-stats.h"
 
 namespace ns3 {
 
@@ -78,6 +79,14 @@ public:
    * of the TracedCallback::Connect method.
    */
   void Disconnect (const CallbackBase & callback, std::string path);
+  /**
+   * \returns true if no callback is connected, false otherwise.
+   *
+   * Calling a TracedCallback with no callback connected does nothing:
+   * the callers can check this first to avoid building the arguments
+   * of the call.
+   */
+  bool IsEmpty (void) const;
   void operator() (void) const;
   void operator() (T1 a1) const;
   void operator() (T1 a1, T2 a2) const;
@@ -91,6 +100,8 @@ public:
 private:  
   typedef std::list<Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> > CallbackList;
   CallbackList m_callbackList;
+  // the statistics recorded by this trace source, if enabled by TraceStats.
+  struct TraceStats::Entry *m_stats;
 };
 
 } // namespace ns3
@@ -104,7 +115,8 @@ template<typename T1, typename T2,
          typename T5, typename T6,
          typename T7, typename T8>
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::TracedCallback ()
-  : m_callbackList () 
+  : m_callbackList (),
+    m_stats (0)
 {}
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -116,6 +128,10 @@ TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::ConnectWithoutContext (const CallbackBa
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> cb;
   cb.Assign (callback);
   m_callbackList.push_back (cb);
+  if (TraceStats::GetConnecting () != 0)
+    {
+      m_stats = TraceStats::GetConnecting ();
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -128,6 +144,10 @@ TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Connect (const CallbackBase & callback,
   cb.Assign (callback);
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> realCb = cb.Bind (path);
   m_callbackList.push_back (realCb);
+  if (TraceStats::GetConnecting () != 0)
+    {
+      m_stats = TraceStats::GetConnecting ();
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -148,6 +168,10 @@ TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::DisconnectWithoutContext (const Callbac
 	  i++;
 	}
     }
+  if (m_callbackList.empty ())
+    {
+      m_stats = 0;
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -161,6 +185,15 @@ TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Disconnect (const CallbackBase & callba
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> realCb = cb.Bind (path);
   DisconnectWithoutContext (realCb);
 }
+template<typename T1, typename T2, 
+         typename T3, typename T4,
+         typename T5, typename T6,
+         typename T7, typename T8>
+bool
+TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::IsEmpty (void) const
+{
+  return m_callbackList.empty ();
+}
 template<typename T1, typename T2, 
          typename T3, typename T4,
          typename T5, typename T6,
@@ -168,11 +201,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (void) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) ();
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -181,11 +223,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -194,11 +245,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -207,11 +267,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2, a3);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -220,11 +289,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2, a3, a4);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -233,11 +311,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2, a3, a4, a5);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -246,11 +333,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2, a3, a4, a5, a6);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -259,11 +355,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6, T7 a7) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2, a3, a4, a5, a6, a7);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -272,11 +377,20 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6, T7 a7, T8 a8) const
 {
+  uint64_t start = 0;
+  if (m_stats != 0)
+    {
+      start = TraceStats::Start ();
+    }
   for (typename CallbackList::const_iterator i = m_callbackList.begin ();
        i != m_callbackList.end (); i++)
     {
       (*i) (a1, a2, a3, a4, a5, a6, a7, a8);
     }
+  if (m_stats != 0)
+    {
+      TraceStats::Stop (m_stats, start);
+    }
 }
 
 }//namespace ns3
@@ -99,6 +99,13 @@ public:
   void Disconnect (const CallbackBase &cb, std::string path) {
     m_cb.Disconnect (cb, path);
   }
+  /**
+   * \returns true if no callback is connected to this TracedValue,
+   *          false otherwise.
+   */
+  bool IsEmpty (void) const {
+    return m_cb.IsEmpty ();
+  }
   void Set (const T &v) {
     if (m_v != v)
       {
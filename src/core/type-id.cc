@@ -20,7 +20,9 @@
 #include "type-id.h"
 #include "singleton.h"
 #include "trace-source-accessor.h"
+#include "sgi-hashmap.h"
 #include <vector>
+#include <algorithm>
 #include <sstream>
 
 /*********************************************************************
@@ -29,6 +31,19 @@
 
 namespace {
 
+struct StringHash
+{
+  size_t operator () (std::string const &x) const
+  {
+    size_t h = 0;
+    for (std::string::const_iterator i = x.begin (); i != x.end (); i++)
+      {
+        h = 31 * h + (unsigned char)*i;
+      }
+    return h;
+  }
+};
+
 class IidManager
 {
 public:
@@ -69,6 +84,8 @@ public:
   std::string GetTraceSourceHelp (uint16_t uid, uint32_t i) const;
   ns3::Ptr<const ns3::TraceSourceAccessor> GetTraceSourceAccessor (uint16_t uid, uint32_t i) const;
   bool MustHideFromDocumentation (uint16_t uid) const;
+  bool LookupAttribute (uint16_t uid, std::string name, uint16_t *owner, uint32_t *i) const;
+  bool LookupTraceSource (uint16_t uid, std::string name, uint16_t *owner, uint32_t *i) const;
 
 private:
   bool HasTraceSource (uint16_t uid, std::string name);
@@ -87,6 +104,12 @@ private:
     std::string help;
     ns3::Ptr<const ns3::TraceSourceAccessor> accessor;
   };
+  // locates an attribute or a trace source of a type or of its parents.
+  struct Location {
+    uint16_t owner;
+    uint32_t index;
+  };
+  typedef sgi::hash_map<std::string, struct Location, StringHash> Index;
   struct IidInformation {
     std::string name;
     uint16_t parent;
@@ -96,12 +119,22 @@ private:
     bool mustHideFromDocumentation;
     std::vector<struct AttributeInformation> attributes;
     std::vector<struct TraceSourceInformation> traceSources;
+    // the types whose parent is this type.
+    std::vector<uint16_t> children;
+    // the indexes of the attributes and trace sources of this type
+    // and of its parents. They are rebuilt whenever a parent, an
+    // attribute or a trace source is registered, so that the lookups
+    // never modify them.
+    Index attributeIndex;
+    Index traceSourceIndex;
   };
   typedef std::vector<struct IidInformation>::const_iterator Iterator;
 
   struct IidManager::IidInformation *LookupInformation (uint16_t uid) const;
+  void UpdateIndexes (uint16_t uid);
 
   std::vector<struct IidInformation> m_information;
+  sgi::hash_map<std::string, uint16_t, StringHash> m_names;
 };
 
 IidManager::IidManager ()
@@ -110,15 +143,10 @@ IidManager::IidManager ()
 uint16_t 
 IidManager::AllocateUid (std::string name)
 {
-  uint16_t j = 1;
-  for (Iterator i = m_information.begin (); i != m_information.end (); i++)
+  if (m_names.find (name) != m_names.end ())
     {
-      if (i->name == name)
-        {
-          NS_FATAL_ERROR ("Trying to allocate twice the same uid: " << name);
-          return 0;
-        }
-      j++;
+      NS_FATAL_ERROR ("Trying to allocate twice the same uid: " << name);
+      return 0;
     }
   struct IidInformation information;
   information.name = name;
@@ -129,6 +157,7 @@ IidManager::AllocateUid (std::string name)
   m_information.push_back (information);
   uint32_t uid = m_information.size ();
   NS_ASSERT (uid <= 0xffff);
+  m_names[name] = uid;
   return uid;
 }
 
@@ -144,7 +173,17 @@ IidManager::SetParent (uint16_t uid, uint16_t parent)
 {
   NS_ASSERT (parent <= m_information.size ());
   struct IidInformation *information = LookupInformation (uid);
+  if (information->parent != 0 && information->parent != uid)
+    {
+      std::vector<uint16_t> *siblings = &LookupInformation (information->parent)->children;
+      siblings->erase (std::find (siblings->begin (), siblings->end (), uid));
+    }
   information->parent = parent;
+  if (parent != uid)
+    {
+      LookupInformation (parent)->children.push_back (uid);
+    }
+  UpdateIndexes (uid);
 }
 void 
 IidManager::SetGroupName (uint16_t uid, std::string groupName)
@@ -174,17 +213,12 @@ IidManager::AddConstructor (uint16_t uid, ns3::Callback<ns3::ObjectBase *> callb
 uint16_t 
 IidManager::GetUid (std::string name) const
 {
-  uint32_t j = 1;
-  for (Iterator i = m_information.begin (); i != m_information.end (); i++)
+  sgi::hash_map<std::string, uint16_t, StringHash>::const_iterator i = m_names.find (name);
+  if (i == m_names.end ())
     {
-      if (i->name == name)
-        {
-          NS_ASSERT (j <= 0xffff);
-          return j;
-        }
-      j++;
+      return 0;
     }
-  return 0;
+  return i->second;
 }
 std::string 
 IidManager::GetName (uint16_t uid) const
@@ -284,6 +318,7 @@ IidManager::AddAttribute (uint16_t uid,
   param.param = spec;
   param.checker = checker;
   information->attributes.push_back (param);
+  UpdateIndexes (uid);
 }
 
 
@@ -380,6 +415,7 @@ IidManager::AddTraceSource (uint16_t uid,
   source.help = help;
   source.accessor = accessor;
   information->traceSources.push_back (source);
+  UpdateIndexes (uid);
 }
 uint32_t 
 IidManager::GetTraceSourceN (uint16_t uid) const
@@ -415,6 +451,74 @@ IidManager::MustHideFromDocumentation (uint16_t uid) const
   return information->mustHideFromDocumentation;
 }
 
+// rebuilds the indexes of a type and of all the types derived from it.
+void
+IidManager::UpdateIndexes (uint16_t uid)
+{
+  struct IidInformation *information = LookupInformation (uid);
+  information->attributeIndex.clear ();
+  information->traceSourceIndex.clear ();
+  // walk from the type up to the top of the inheritance tree: the
+  // names of the most derived type come first.
+  uint16_t current = uid;
+  while (true)
+    {
+      struct IidInformation *tmp = LookupInformation (current);
+      for (uint32_t i = 0; i < tmp->attributes.size (); i++)
+        {
+          struct Location location;
+          location.owner = current;
+          location.index = i;
+          information->attributeIndex.insert (std::make_pair (tmp->attributes[i].name, location));
+        }
+      for (uint32_t i = 0; i < tmp->traceSources.size (); i++)
+        {
+          struct Location location;
+          location.owner = current;
+          location.index = i;
+          information->traceSourceIndex.insert (std::make_pair (tmp->traceSources[i].name, location));
+        }
+      if (tmp->parent == current || tmp->parent == 0)
+        {
+          // top of inheritance tree
+          break;
+        }
+      current = tmp->parent;
+    }
+  for (uint32_t i = 0; i < information->children.size (); i++)
+    {
+      UpdateIndexes (information->children[i]);
+    }
+}
+
+bool
+IidManager::LookupAttribute (uint16_t uid, std::string name, uint16_t *owner, uint32_t *i) const
+{
+  struct IidInformation *information = LookupInformation (uid);
+  Index::const_iterator location = information->attributeIndex.find (name);
+  if (location == information->attributeIndex.end ())
+    {
+      return false;
+    }
+  *owner = location->second.owner;
+  *i = location->second.index;
+  return true;
+}
+
+bool
+IidManager::LookupTraceSource (uint16_t uid, std::string name, uint16_t *owner, uint32_t *i) const
+{
+  struct IidInformation *information = LookupInformation (uid);
+  Index::const_iterator location = information->traceSourceIndex.find (name);
+  if (location == information->traceSourceIndex.end ())
+    {
+      return false;
+    }
+  *owner = location->second.owner;
+  *i = location->second.index;
+  return true;
+}
+
 } // anonymous namespace
 
 namespace ns3 {
@@ -485,25 +589,18 @@ TypeId::GetRegistered (uint32_t i)
 bool
 TypeId::LookupAttributeByName (std::string name, struct TypeId::AttributeInfo *info) const
 {
-  TypeId tid;
-  TypeId nextTid = *this;
-  do {
-    tid = nextTid;
-    for (uint32_t i = 0; i < tid.GetAttributeN (); i++)
-      {
-        std::string paramName = tid.GetAttributeName (i);
-        if (paramName == name)
-          {
-            info->accessor = tid.GetAttributeAccessor (i);
-            info->flags = tid.GetAttributeFlags (i);
-            info->initialValue = tid.GetAttributeInitialValue (i);
-            info->checker = tid.GetAttributeChecker (i);
-            return true;
-          }
-      }
-    nextTid = tid.GetParent ();
-  } while (nextTid != tid);
-  return false;
+  uint16_t owner;
+  uint32_t i;
+  if (!Singleton<IidManager>::Get ()->LookupAttribute (m_tid, name, &owner, &i))
+    {
+      return false;
+    }
+  TypeId tid = TypeId (owner);
+  info->accessor = tid.GetAttributeAccessor (i);
+  info->flags = tid.GetAttributeFlags (i);
+  info->initialValue = tid.GetAttributeInitialValue (i);
+  info->checker = tid.GetAttributeChecker (i);
+  return true;
 }
 
 TypeId 
@@ -696,21 +793,13 @@ TypeId::HideFromDocumentation (void)
 Ptr<const TraceSourceAccessor> 
 TypeId::LookupTraceSourceByName (std::string name) const
 {
-  TypeId tid;
-  TypeId nextTid = *this;
-  do {
-    tid = nextTid;
-    for (uint32_t i = 0; i < tid.GetTraceSourceN (); i++)
-      {
-        std::string srcName = tid.GetTraceSourceName (i);
-        if (srcName == name)
-          {
-            return tid.GetTraceSourceAccessor (i);
-          }
-      }
-    nextTid = tid.GetParent ();
-  } while (nextTid != tid);
-  return 0;
+  uint16_t owner;
+  uint32_t i;
+  if (!Singleton<IidManager>::Get ()->LookupTraceSource (m_tid, name, &owner, &i))
+    {
+      return 0;
+    }
+  return TypeId (owner).GetTraceSourceAccessor (i);
 }
 
 uint16_t 
@@ -581,7 +581,10 @@ CsmaNetDevice::TransmitStart (void)
           //
           m_backoff.ResetBackoffTime ();
           m_txMachineState = BUSY;
-          m_phyTxBeginTrace (m_currentPkt);
+          if (!m_phyTxBeginTrace.IsEmpty ())
+            {
+              m_phyTxBeginTrace (m_currentPkt);
+            }
 
           Time tEvent = Seconds (m_bps.CalculateTxTime (m_currentPkt->GetSize ()));
           NS_LOG_LOGIC ("Schedule TransmitCompleteEvent in " << tEvent.GetSeconds () << "sec");
@@ -628,8 +631,14 @@ CsmaNetDevice::TransmitAbort (void)
     {
       m_currentPkt = m_queue->Dequeue ();
       NS_ASSERT_MSG (m_currentPkt != 0, "CsmaNetDevice::TransmitAbort(): IsEmpty false but no Packet on queue?");
-      m_snifferTrace (m_currentPkt);
-      m_promiscSnifferTrace (m_currentPkt);
+      if (!m_snifferTrace.IsEmpty ())
+        {
+          m_snifferTrace (m_currentPkt);
+        }
+      if (!m_promiscSnifferTrace.IsEmpty ())
+        {
+          m_promiscSnifferTrace (m_currentPkt);
+        }
       TransmitStart ();
     }
 }
@@ -658,7 +667,10 @@ CsmaNetDevice::TransmitCompleteEvent (void)
   NS_LOG_LOGIC ("Pkt UID is " << m_currentPkt->GetUid () << ")");
 
   m_channel->TransmitEnd (); 
-  m_phyTxEndTrace (m_currentPkt);
+  if (!m_phyTxEndTrace.IsEmpty ())
+    {
+      m_phyTxEndTrace (m_currentPkt);
+    }
   m_currentPkt = 0;
 
   NS_LOG_LOGIC ("Schedule TransmitReadyEvent in " << m_tInterframeGap.GetSeconds () << "sec");
@@ -696,8 +708,14 @@ CsmaNetDevice::TransmitReadyEvent (void)
     {
       m_currentPkt = m_queue->Dequeue ();
       NS_ASSERT_MSG (m_currentPkt != 0, "CsmaNetDevice::TransmitReadyEvent(): IsEmpty false but no Packet on queue?");
-      m_snifferTrace (m_currentPkt);
-      m_promiscSnifferTrace (m_currentPkt);
+      if (!m_snifferTrace.IsEmpty ())
+        {
+          m_snifferTrace (m_currentPkt);
+        }
+      if (!m_promiscSnifferTrace.IsEmpty ())
+        {
+          m_promiscSnifferTrace (m_currentPkt);
+        }
       TransmitStart ();
     }
 }
@@ -761,7 +779,10 @@ CsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<CsmaNetDevice> senderDevice)
   // Hit the trace hook.  This trace will fire on all packets received from the
   // channel except those originated by this device.
   //
-  m_phyRxEndTrace (packet);
+  if (!m_phyRxEndTrace.IsEmpty ())
+    {
+      m_phyRxEndTrace (packet);
+    }
 
   // 
   // Only receive if the send side of net device is enabled
@@ -780,9 +801,14 @@ CsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<CsmaNetDevice> senderDevice)
 
   //
   // Trace sinks will expect complete packets, not packets without some of the
-  // headers.
+  // headers.  The copy is only needed if a sink is connected.
   //
-  Ptr<Packet> originalPacket = packet->Copy ();
+  Ptr<Packet> originalPacket;
+  if (!m_promiscSnifferTrace.IsEmpty () || !m_macPromiscRxTrace.IsEmpty () ||
+      !m_snifferTrace.IsEmpty () || !m_macRxTrace.IsEmpty ())
+    {
+      originalPacket = packet->Copy ();
+    }
 
   EthernetTrailer trailer;
   packet->RemoveTrailer (trailer);
@@ -1016,7 +1042,10 @@ CsmaNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address&
   Mac48Address source = Mac48Address::ConvertFrom (src);
   AddHeader (packet, source, destination, protocolNumber);
 
-  m_macTxTrace (packet);
+  if (!m_macTxTrace.IsEmpty ())
+    {
+      m_macTxTrace (packet);
+    }
 
   //
   // Place the packet to be sent on the send queue.  Note that the 
@@ -1039,8 +1068,14 @@ CsmaNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address&
         {
           m_currentPkt = m_queue->Dequeue ();
           NS_ASSERT_MSG (m_currentPkt != 0, "CsmaNetDevice::SendFrom(): IsEmpty false but no Packet on queue?");
-          m_promiscSnifferTrace (m_currentPkt);
-          m_snifferTrace (m_currentPkt);
+          if (!m_promiscSnifferTrace.IsEmpty ())
+            {
+              m_promiscSnifferTrace (m_currentPkt);
+            }
+          if (!m_snifferTrace.IsEmpty ())
+            {
+              m_snifferTrace (m_currentPkt);
+            }
           TransmitStart ();
         }
     }
@@ -227,7 +227,10 @@ PointToPointNetDevice::TransmitStart (Ptr<Packet> p)
   NS_ASSERT_MSG(m_txMachineState == READY, "Must be READY to transmit");
   m_txMachineState = BUSY;
   m_currentPkt = p;
-  m_phyTxBeginTrace (m_currentPkt);
+  if (!m_phyTxBeginTrace.IsEmpty ())
+    {
+      m_phyTxBeginTrace (m_currentPkt);
+    }
 
   Time txTime = Seconds (m_bps.CalculateTxTime(p->GetSize()));
   Time txCompleteTime = txTime + m_tInterframeGap;
@@ -259,7 +262,10 @@ PointToPointNetDevice::TransmitComplete (void)
 
   NS_ASSERT_MSG (m_currentPkt != 0, "PointToPointNetDevice::TransmitComplete(): m_currentPkt zero");
 
-  m_phyTxEndTrace (m_currentPkt);
+  if (!m_phyTxEndTrace.IsEmpty ())
+    {
+      m_phyTxEndTrace (m_currentPkt);
+    }
   m_currentPkt = 0;
 
   Ptr<Packet> p = m_queue->Dequeue ();
@@ -274,8 +280,14 @@ PointToPointNetDevice::TransmitComplete (void)
   //
   // Got another packet off of the queue, so start the transmit process agin.
   //
-  m_snifferTrace (p);
-  m_promiscSnifferTrace (p);
+  if (!m_snifferTrace.IsEmpty ())
+    {
+      m_snifferTrace (p);
+    }
+  if (!m_promiscSnifferTrace.IsEmpty ())
+    {
+      m_promiscSnifferTrace (p);
+    }
   TransmitStart(p);
 }
 
@@ -332,9 +344,18 @@ PointToPointNetDevice::Receive (Ptr<Packet> packet)
       // device becuase it is so simple, but this is not usually the case in 
       // more complicated devices.
       //
-      m_snifferTrace (packet);
-      m_promiscSnifferTrace (packet);
-      m_phyRxEndTrace (packet);
+      if (!m_snifferTrace.IsEmpty ())
+        {
+          m_snifferTrace (packet);
+        }
+      if (!m_promiscSnifferTrace.IsEmpty ())
+        {
+          m_promiscSnifferTrace (packet);
+        }
+      if (!m_phyRxEndTrace.IsEmpty ())
+        {
+          m_phyRxEndTrace (packet);
+        }
 
       //
       // Strip off the point-to-point protocol header and forward this packet
@@ -350,7 +371,10 @@ PointToPointNetDevice::Receive (Ptr<Packet> packet)
           m_promiscCallback (this, packet, protocol, GetRemote (), GetAddress (), NetDevice::PACKET_HOST);
         }
 
-      m_macRxTrace (packet);
+      if (!m_macRxTrace.IsEmpty ())
+        {
+          m_macRxTrace (packet);
+        }
       m_rxCallback (this, packet, protocol, GetRemote ());
     }
 }
@@ -499,7 +523,10 @@ PointToPointNetDevice::Send(
   //
   AddHeader(packet, protocolNumber);
 
-  m_macTxTrace (packet);
+  if (!m_macTxTrace.IsEmpty ())
+    {
+      m_macTxTrace (packet);
+    }
 
   //
   // If there's a transmission in progress, we enque the packet for later
@@ -514,8 +541,14 @@ PointToPointNetDevice::Send(
       if (m_queue->Enqueue (packet) == true)
         {
           packet = m_queue->Dequeue ();
-          m_snifferTrace (packet);
-          m_promiscSnifferTrace (packet);
+          if (!m_snifferTrace.IsEmpty ())
+            {
+              m_snifferTrace (packet);
+            }
+          if (!m_promiscSnifferTrace.IsEmpty ())
+            {
+              m_promiscSnifferTrace (packet);
+            }
           return TransmitStart (packet);
         }
       else
@@ -224,9 +224,19 @@ WifiPhyStateHelper::NotifySwitchingStart (Time duration)
   }
 }
 
+bool
+WifiPhyStateHelper::IsRxErrorTraced (void) const
+{
+  return !m_rxErrorTrace.IsEmpty ();
+}
+
 void
 WifiPhyStateHelper::LogPreviousIdleAndCcaBusyStates (void)
 {
+  if (m_stateLogger.IsEmpty ())
+    {
+      return;
+    }
   Time now = Simulator::Now ();
   Time idleStart = Max (m_endCcaBusy, m_endRx);
   idleStart = Max (idleStart, m_endTx);
@@ -247,7 +257,10 @@ void
 WifiPhyStateHelper::SwitchToTx (Time txDuration, Ptr<const Packet> packet, WifiMode txMode, 
 			  WifiPreamble preamble, uint8_t txPower)
 {
-  m_txTrace (packet, txMode, preamble, txPower);
+  if (!m_txTrace.IsEmpty ())
+    {
+      m_txTrace (packet, txMode, preamble, txPower);
+    }
   NotifyTxStart (txDuration);
   Time now = Simulator::Now ();
   switch (GetState ()) {
@@ -256,14 +269,20 @@ WifiPhyStateHelper::SwitchToTx (Time txDuration, Ptr<const Packet> packet, WifiM
      * as its endRx event are cancelled by the caller.
      */
     m_rxing = false;
-    m_stateLogger (m_startRx, now - m_startRx, WifiPhy::RX);
+    if (!m_stateLogger.IsEmpty ())
+      {
+        m_stateLogger (m_startRx, now - m_startRx, WifiPhy::RX);
+      }
     m_endRx = now;
     break;
   case WifiPhy::CCA_BUSY: {
     Time ccaStart = Max (m_endRx, m_endTx);
     ccaStart = Max (ccaStart, m_startCcaBusy);
     ccaStart = Max (ccaStart, m_endSwitching); 
-    m_stateLogger (ccaStart, now - ccaStart, WifiPhy::CCA_BUSY);
+    if (!m_stateLogger.IsEmpty ())
+      {
+        m_stateLogger (ccaStart, now - ccaStart, WifiPhy::CCA_BUSY);
+      }
   } break;
   case WifiPhy::IDLE:
     LogPreviousIdleAndCcaBusyStates ();
@@ -273,7 +292,10 @@ WifiPhyStateHelper::SwitchToTx (Time txDuration, Ptr<const Packet> packet, WifiM
     NS_FATAL_ERROR ("Invalid WifiPhy state.");
     break;
   }
-  m_stateLogger (now, txDuration, WifiPhy::TX);
+  if (!m_stateLogger.IsEmpty ())
+    {
+      m_stateLogger (now, txDuration, WifiPhy::TX);
+    }
   m_previousStateChangeTime = now;
   m_endTx = now + txDuration;
   m_startTx = now;
@@ -293,7 +315,10 @@ WifiPhyStateHelper::SwitchToRx (Time rxDuration)
     Time ccaStart = Max (m_endRx, m_endTx);
     ccaStart = Max (ccaStart, m_startCcaBusy);
     ccaStart = Max (ccaStart, m_endSwitching); 
-    m_stateLogger (ccaStart, now - ccaStart, WifiPhy::CCA_BUSY);
+    if (!m_stateLogger.IsEmpty ())
+      {
+        m_stateLogger (ccaStart, now - ccaStart, WifiPhy::CCA_BUSY);
+      }
   } break;
   case WifiPhy::SWITCHING: 
   case WifiPhy::RX:
@@ -319,14 +344,20 @@ WifiPhyStateHelper::SwitchToChannelSwitching (Time switchingDuration)
      * as its endRx event are cancelled by the caller.
      */
     m_rxing = false;
-    m_stateLogger (m_startRx, now - m_startRx, WifiPhy::RX);
+    if (!m_stateLogger.IsEmpty ())
+      {
+        m_stateLogger (m_startRx, now - m_startRx, WifiPhy::RX);
+      }
     m_endRx = now;
     break;
   case WifiPhy::CCA_BUSY: {
     Time ccaStart = Max (m_endRx, m_endTx);
     ccaStart = Max (ccaStart, m_startCcaBusy);
     ccaStart = Max (ccaStart, m_endSwitching);  
-    m_stateLogger (ccaStart, now - ccaStart, WifiPhy::CCA_BUSY);
+    if (!m_stateLogger.IsEmpty ())
+      {
+        m_stateLogger (ccaStart, now - ccaStart, WifiPhy::CCA_BUSY);
+      }
   } break;
   case WifiPhy::IDLE:
     LogPreviousIdleAndCcaBusyStates (); 
@@ -343,7 +374,10 @@ WifiPhyStateHelper::SwitchToChannelSwitching (Time switchingDuration)
       m_endCcaBusy = now; 
     }
 
-  m_stateLogger (now, switchingDuration, WifiPhy::SWITCHING);
+  if (!m_stateLogger.IsEmpty ())
+    {
+      m_stateLogger (now, switchingDuration, WifiPhy::SWITCHING);
+    }
   m_previousStateChangeTime = now;
   m_startSwitching = now;
   m_endSwitching = now + switchingDuration;
@@ -353,7 +387,10 @@ WifiPhyStateHelper::SwitchToChannelSwitching (Time switchingDuration)
 void 
 WifiPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, double snr, WifiMode mode, enum WifiPreamble preamble)
 {
-  m_rxOkTrace (packet, snr, mode, preamble);
+  if (!m_rxOkTrace.IsEmpty ())
+    {
+      m_rxOkTrace (packet, snr, mode, preamble);
+    }
   NotifyRxEndOk ();
   DoSwitchFromRx ();
   if (!m_rxOkCallback.IsNull ())
@@ -365,7 +402,10 @@ WifiPhyStateHelper::SwitchFromRxEndOk (Ptr<Packet> packet, double snr, WifiMode
 void 
 WifiPhyStateHelper::SwitchFromRxEndError (Ptr<const Packet> packet, double snr)
 {
-  m_rxErrorTrace (packet, snr);
+  if (!m_rxErrorTrace.IsEmpty ())
+    {
+      m_rxErrorTrace (packet, snr);
+    }
   NotifyRxEndError ();
   DoSwitchFromRx ();
   if (!m_rxErrorCallback.IsNull ())
@@ -381,7 +421,10 @@ WifiPhyStateHelper::DoSwitchFromRx (void)
   NS_ASSERT (m_rxing);
 
   Time now = Simulator::Now ();
-  m_stateLogger (m_startRx, now - m_startRx, WifiPhy::RX);
+  if (!m_stateLogger.IsEmpty ())
+    {
+      m_stateLogger (m_startRx, now - m_startRx, WifiPhy::RX);
+    }
   m_previousStateChangeTime = now;
   m_rxing = false;
 
@@ -47,6 +47,10 @@ public:
   Time GetStateDuration (void);
   Time GetDelayUntilIdle (void);
   Time GetLastRxStartTime (void) const;
+  /**
+   * \returns true if a sink is connected to the RxError trace source.
+   */
+  bool IsRxErrorTraced (void) const;
 
   void SwitchToTx (Time txDuration, Ptr<const Packet> packet, WifiMode txMode, WifiPreamble preamble, uint8_t txPower);
   void SwitchToRx (Time rxDuration);
@@ -220,6 +220,25 @@ WifiPhy::NotifyPromiscSniffTx (Ptr<const Packet> packet, uint16_t channelFreqMhz
   m_phyPromiscSniffTxTrace (packet, channelFreqMhz, channelNumber, rate, isShortPreamble);
 }
 
+bool
+WifiPhy::IsPromiscSniffRxTraced (void) const
+{
+  return !m_phyPromiscSniffRxTrace.IsEmpty ();
+}
+
+bool
+WifiPhy::IsPromiscSniffTxTraced (void) const
+{
+  return !m_phyPromiscSniffTxTrace.IsEmpty ();
+}
+
+bool
+WifiPhy::IsRxTraced (void) const
+{
+  return !m_phyRxBeginTrace.IsEmpty () || !m_phyRxEndTrace.IsEmpty () ||
+    !m_phyRxDropTrace.IsEmpty () || !m_phyPromiscSniffRxTrace.IsEmpty ();
+}
+
 WifiMode 
 WifiPhy::Get1mbb (void)
 {
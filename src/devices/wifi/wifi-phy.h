@@ -377,6 +377,27 @@ public:
    * @param isShortPreamble true if short preamble is used, false otherwise
    */
   void NotifyPromiscSniffTx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate, bool isShortPreamble);
+
+  /**
+   * \returns true if a sink is connected to the PromiscSnifferRx trace
+   * source. The subclasses check this before they compute the arguments
+   * of NotifyPromiscSniffRx.
+   */
+  bool IsPromiscSniffRxTraced (void) const;
+
+  /**
+   * \returns true if a sink is connected to the PromiscSnifferTx trace
+   * source. The subclasses check this before they compute the arguments
+   * of NotifyPromiscSniffTx.
+   */
+  bool IsPromiscSniffTxTraced (void) const;
+
+  /**
+   * \returns true if a sink is connected to one of the trace sources
+   * which report the packets being received: PhyRxBegin, PhyRxEnd,
+   * PhyRxDrop and PromiscSnifferRx.
+   */
+  bool IsRxTraced (void) const;
   
 
 private:
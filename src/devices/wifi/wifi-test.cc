@@ -23,6 +23,7 @@
 #include "adhoc-wifi-mac.h"
 #include "yans-wifi-phy.h"
 #include "arf-wifi-manager.h"
+#include "constant-rate-wifi-manager.h"
 #include "ns3/propagation-delay-model.h"
 #include "ns3/propagation-loss-model.h"
 #include "error-rate-model.h"
@@ -35,6 +36,7 @@
 #include "dca-txop.h"
 #include "mac-rx-middle.h"
 #include "ns3/pointer.h"
+#include "ns3/tag.h"
 
 namespace ns3 {
 
@@ -188,6 +190,129 @@ public:
   }
 };
 
+//-----------------------------------------------------------------------------
+class SharedPacketTestTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::SharedPacketTestTag")
+      .SetParent<Tag> ()
+      .AddConstructor<SharedPacketTestTag> ()
+      ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const { return GetTypeId (); }
+  virtual uint32_t GetSerializedSize (void) const { return 0; }
+  virtual void Serialize (TagBuffer buf) const {}
+  virtual void Deserialize (TagBuffer buf) {}
+  virtual void Print (std::ostream &os) const {}
+};
+
+// The channel hands the same packet to all its receivers: a tag added
+// by the receive trace sink of one PHY must not be seen by the others.
+class SharedPacketTagTest : public TestCase
+{
+public:
+  SharedPacketTagTest ();
+
+  virtual bool DoRun (void);
+private:
+  Ptr<WifiNetDevice> CreateOne (Vector pos, Ptr<YansWifiChannel> channel);
+  void SendOnePacket (Ptr<WifiNetDevice> dev);
+  void AddTag (Ptr<const Packet> packet);
+  void CheckTag (Ptr<const Packet> packet);
+
+  uint32_t m_tagged;
+  uint32_t m_checked;
+  uint32_t m_seen;
+};
+
+SharedPacketTagTest::SharedPacketTagTest ()
+  : TestCase ("Receive trace sinks get a private packet")
+{}
+
+void
+SharedPacketTagTest::SendOnePacket (Ptr<WifiNetDevice> dev)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  dev->Send (p, dev->GetBroadcast (), 1);
+}
+
+void
+SharedPacketTagTest::AddTag (Ptr<const Packet> packet)
+{
+  SharedPacketTestTag tag;
+  packet->AddPacketTag (tag);
+  m_tagged++;
+}
+
+void
+SharedPacketTagTest::CheckTag (Ptr<const Packet> packet)
+{
+  SharedPacketTestTag tag;
+  if (packet->PeekPacketTag (tag))
+    {
+      m_seen++;
+    }
+  m_checked++;
+}
+
+Ptr<WifiNetDevice>
+SharedPacketTagTest::CreateOne (Vector pos, Ptr<YansWifiChannel> channel)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<WifiNetDevice> dev = CreateObject<WifiNetDevice> ();
+
+  Ptr<WifiMac> mac = CreateObject<AdhocWifiMac> ();
+  mac->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  Ptr<ErrorRateModel> error = CreateObject<YansErrorRateModel> ();
+  phy->SetErrorRateModel (error);
+  phy->SetChannel (channel);
+  phy->SetDevice (dev);
+  phy->SetMobility (node);
+  phy->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<WifiRemoteStationManager> manager = CreateObject<ConstantRateWifiManager> ();
+
+  mobility->SetPosition (pos);
+  node->AggregateObject (mobility);
+  mac->SetAddress (Mac48Address::Allocate ());
+  dev->SetMac (mac);
+  dev->SetPhy (phy);
+  dev->SetRemoteStationManager (manager);
+  node->AddDevice (dev);
+  return dev;
+}
+
+bool
+SharedPacketTagTest::DoRun (void)
+{
+  m_tagged = 0;
+  m_checked = 0;
+  m_seen = 0;
+
+  Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->SetPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<WifiNetDevice> sender = CreateOne (Vector (0.0, 0.0, 0.0), channel);
+  Ptr<WifiNetDevice> first = CreateOne (Vector (5.0, 0.0, 0.0), channel);
+  Ptr<WifiNetDevice> second = CreateOne (Vector (5.0, 0.0, 0.0), channel);
+  first->GetPhy ()->TraceConnectWithoutContext ("PhyRxBegin", MakeCallback (&SharedPacketTagTest::AddTag, this));
+  second->GetPhy ()->TraceConnectWithoutContext ("PhyRxBegin", MakeCallback (&SharedPacketTagTest::CheckTag, this));
+
+  Simulator::Schedule (Seconds (1.0), &SharedPacketTagTest::SendOnePacket, this, sender);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_tagged, 1U, "the first receiver did not receive the packet");
+  NS_TEST_ASSERT_MSG_EQ (m_checked, 1U, "the second receiver did not receive the packet");
+  NS_TEST_ASSERT_MSG_EQ (m_seen, 0U, "the tag of the first receiver leaked to the second one");
+  return GetErrorStatus ();
+}
+
 //-----------------------------------------------------------------------------
 
 class WifiTestSuite : public TestSuite
@@ -201,6 +326,7 @@ WifiTestSuite::WifiTestSuite ()
 {
   AddTestCase (new WifiTest);
   AddTestCase (new MacRxMiddleTest);
+  AddTestCase (new SharedPacketTagTest);
 }
 
 WifiTestSuite g_wifiTestSuite;
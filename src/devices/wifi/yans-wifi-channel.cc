@@ -77,6 +77,10 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
 {
   Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
   NS_ASSERT (senderMobility != 0);
+  // the caller might modify its packet once we return: the receivers
+  // share a private copy which nobody modifies. YansWifiPhy copies it
+  // again before it gives it to its trace sinks, which might add tags.
+  Ptr<const Packet> copy;
   uint32_t j = 0;
   for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
     { 
@@ -91,7 +95,10 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
           double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
           NS_LOG_DEBUG ("propagation: txPower="<<txPowerDbm<<"dbm, rxPower="<<rxPowerDbm<<"dbm, "<<
                         "distance="<<senderMobility->GetDistanceFrom (receiverMobility)<<"m, delay="<<delay);
-          Ptr<Packet> copy = packet->Copy ();
+          if (copy == 0)
+            {
+              copy = packet->Copy ();
+            }
           Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
           uint32_t dstNode;
           if (dstNetDevice == 0)
@@ -110,7 +117,7 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
 }
 
 void
-YansWifiChannel::Receive (uint32_t i, Ptr<Packet> packet, double rxPowerDbm,
+YansWifiChannel::Receive (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
                           WifiMode txMode, WifiPreamble preamble) const
 {
   m_phyList[i]->StartReceivePacket (packet, rxPowerDbm, txMode, preamble);
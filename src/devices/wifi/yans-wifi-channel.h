@@ -79,13 +79,19 @@ public:
    * currently invoked only from WifiPhy::Send. YansWifiChannel 
    * delivers packets only between PHYs with the same m_channelNumber,
    * e.g. PHYs that are operating on the same channel.
+   *
+   * A single copy of the packet is shared by all the receivers: a
+   * receiving PHY copies it again only if it successfully receives it
+   * and hands it over to its MAC, or if a sink is connected to one of
+   * its receive trace sources. The receive error callback of the MAC
+   * gets the shared packet and must not add tags to it.
    */
   void Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double txPowerDbm,
              WifiMode wifiMode, WifiPreamble preamble) const;
 
 private:
   typedef std::vector<Ptr<YansWifiPhy> > PhyList;
-  void Receive (uint32_t i, Ptr<Packet> packet, double rxPowerDbm,
+  void Receive (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
                 WifiMode txMode, WifiPreamble preamble) const;
 
 
@@ -391,12 +391,19 @@ YansWifiPhy::SetReceiveErrorCallback (RxErrorCallback callback)
   m_state->SetReceiveErrorCallback (callback);
 }
 void 
-YansWifiPhy::StartReceivePacket (Ptr<Packet> packet, 
+YansWifiPhy::StartReceivePacket (Ptr<const Packet> packet, 
                                  double rxPowerDbm,
                                  WifiMode txMode,
                                  enum WifiPreamble preamble)
 {
   NS_LOG_FUNCTION (this << packet << rxPowerDbm << txMode << preamble);
+  // the packet is shared by all the receivers of the channel. The trace
+  // sinks may add tags to the packet they are given: they get a copy
+  // private to this PHY, which the MAC receives too.
+  if (IsRxTraced () || m_state->IsRxErrorTraced ())
+    {
+      packet = packet->Copy ();
+    }
   rxPowerDbm += m_rxGainDb;
   double rxPowerW = DbmToW (rxPowerDbm);
   Time rxDuration = CalculateTxDuration (packet->GetSize (), txMode, preamble);
@@ -506,9 +513,12 @@ YansWifiPhy::SendPacket (Ptr<const Packet> packet, WifiMode txMode, WifiPreamble
       m_endRxEvent.Cancel ();
     }
   NotifyTxBegin (packet);
-  uint32_t dataRate500KbpsUnits = txMode.GetDataRate () / 500000;   
-  bool isShortPreamble = (WIFI_PREAMBLE_SHORT == preamble);
-  NotifyPromiscSniffTx (packet, (uint16_t)GetChannelFrequencyMhz (), GetChannelNumber (), dataRate500KbpsUnits, isShortPreamble);
+  if (IsPromiscSniffTxTraced ())
+    {
+      uint32_t dataRate500KbpsUnits = txMode.GetDataRate () / 500000;   
+      bool isShortPreamble = (WIFI_PREAMBLE_SHORT == preamble);
+      NotifyPromiscSniffTx (packet, (uint16_t)GetChannelFrequencyMhz (), GetChannelNumber (), dataRate500KbpsUnits, isShortPreamble);
+    }
   m_state->SwitchToTx (txDuration, packet, txMode, preamble, txPower);
   m_channel->Send (this, packet, GetPowerDbm (txPower) + m_txGainDb, txMode, preamble);
 }
@@ -731,7 +741,7 @@ YansWifiPhy::GetPowerDbm (uint8_t power) const
 }
 
 void
-YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> event)
+YansWifiPhy::EndReceive (Ptr<const Packet> packet, Ptr<InterferenceHelper::Event> event)
 {
   NS_LOG_FUNCTION (this << packet << event);
   NS_ASSERT (IsStateRx ());
@@ -745,12 +755,17 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
   if (m_random.GetValue () > snrPer.per) 
     {
       NotifyRxEnd (packet); 
-      uint32_t dataRate500KbpsUnits = event->GetPayloadMode ().GetDataRate () / 500000;   
-      bool isShortPreamble = (WIFI_PREAMBLE_SHORT == event->GetPreambleType ());  
-      double signalDbm = RatioToDb (event->GetRxPowerW ()) + 30;
-      double noiseDbm = RatioToDb(event->GetRxPowerW() / snrPer.snr) - GetRxNoiseFigure() + 30 ;
-      NotifyPromiscSniffRx (packet, (uint16_t)GetChannelFrequencyMhz (), GetChannelNumber (), dataRate500KbpsUnits, isShortPreamble, signalDbm, noiseDbm);
-      m_state->SwitchFromRxEndOk (packet, snrPer.snr, event->GetPayloadMode (), event->GetPreambleType ());
+      if (IsPromiscSniffRxTraced ())
+        {
+          uint32_t dataRate500KbpsUnits = event->GetPayloadMode ().GetDataRate () / 500000;   
+          bool isShortPreamble = (WIFI_PREAMBLE_SHORT == event->GetPreambleType ());  
+          double signalDbm = RatioToDb (event->GetRxPowerW ()) + 30;
+          double noiseDbm = RatioToDb(event->GetRxPowerW() / snrPer.snr) - GetRxNoiseFigure() + 30 ;
+          NotifyPromiscSniffRx (packet, (uint16_t)GetChannelFrequencyMhz (), GetChannelNumber (), dataRate500KbpsUnits, isShortPreamble, signalDbm, noiseDbm);
+        }
+      // the packet is shared with the other receivers of the channel
+      // and the upper layers remove headers from the packet they receive.
+      m_state->SwitchFromRxEndOk (packet->Copy (), snrPer.snr, event->GetPayloadMode (), event->GetPreambleType ());
     } 
   else 
     {
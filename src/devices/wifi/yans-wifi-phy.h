@@ -91,7 +91,15 @@ public:
   /// Return current center channel frequency in MHz, see SetСhannelNumber()
   double GetChannelFrequencyMhz() const;
   
-  void StartReceivePacket (Ptr<Packet> packet,
+  /**
+   * \param packet the packet being received, which may be shared with
+   *        other receivers and must not be modified. This PHY copies it
+   *        before it hands it to the sinks of its receive trace sources.
+   * \param rxPowerDbm the power of the signal at the antenna
+   * \param mode the tx mode of the packet
+   * \param preamble the preamble of the packet
+   */
+  void StartReceivePacket (Ptr<const Packet> packet,
                            double rxPowerDbm,
                            WifiMode mode,
                            WifiPreamble preamble);
@@ -161,7 +169,7 @@ private:
   double WToDbm (double w) const;
   double RatioToDb (double ratio) const;
   double GetPowerDbm (uint8_t power) const;
-  void EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> event);
+  void EndReceive (Ptr<const Packet> packet, Ptr<InterferenceHelper::Event> event);
 
 private:
   double   m_edThresholdW;
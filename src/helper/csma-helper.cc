@@ -132,7 +132,7 @@ CsmaHelper::EnableAsciiInternal (
   // Our default trace sinks are going to use packet printing, so we have to 
   // make sure that is turned on.
   //
-  Packet::EnablePrinting ();
+  Packet::EnableLazyPrinting ();
 
   //
   // If we are not provided an OutputStreamWrapper, we are expected to create 
@@ -683,7 +683,7 @@ InternetStackHelper::EnableAsciiIpv4Internal (
   // Our trace sinks are going to use packet printing, so we have to 
   // make sure that is turned on.
   //
-  Packet::EnablePrinting ();
+  Packet::EnableLazyPrinting ();
 
   //
   // If we are not provided an OutputStreamWrapper, we are expected to create 
@@ -878,7 +878,7 @@ InternetStackHelper::EnableAsciiIpv6Internal (
   // Our trace sinks are going to use packet printing, so we have to 
   // make sure that is turned on.
   //
-  Packet::EnablePrinting ();
+  Packet::EnableLazyPrinting ();
 
   //
   // If we are not provided an OutputStreamWrapper, we are expected to create 
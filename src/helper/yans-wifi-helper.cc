@@ -438,7 +438,7 @@ YansWifiPhyHelper::EnableAsciiInternal (
   // Our trace sinks are going to use packet printing, so we have to make sure
   // that is turned on.
   //
-  Packet::EnablePrinting ();
+  Packet::EnableLazyPrinting ();
 
   uint32_t nodeid = nd->GetNode ()->GetId ();
   uint32_t deviceid = nd->GetIfIndex ();
@@ -741,7 +741,7 @@ Ipv4L3Protocol::IpMulticastForward (Ptr<Ipv4MulticastRoute> mrtentry, Ptr<const
         {
           Ptr<Packet> packet = p->Copy ();
           Ipv4Header h = header;
-          h.SetTtl (header.GetTtl () - 1);
+          h.DecrementTtl ();
           if (h.GetTtl () == 0)
             {
               NS_LOG_WARN ("TTL exceeded.  Drop.");
@@ -770,7 +770,7 @@ Ipv4L3Protocol::IpForward (Ptr<Ipv4Route> rtentry, Ptr<const Packet> p, const Ip
   Ipv4Header ipHeader = header;
   Ptr<Packet> packet = p->Copy ();
   int32_t interface = GetInterfaceForDevice (rtentry->GetOutputDevice ());
-  ipHeader.SetTtl (ipHeader.GetTtl () - 1);
+  ipHeader.DecrementTtl ();
   if (ipHeader.GetTtl () == 0)
     {
       // Do not reply to ICMP or to multicast/broadcast IP address 
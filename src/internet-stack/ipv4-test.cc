@@ -24,6 +24,8 @@
 #include "ns3/log.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/node.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/random-variable.h"
 
 #include "ipv4-l3-protocol.h"
 #include "arp-l3-protocol.h"
@@ -98,6 +100,69 @@ Ipv4L3ProtocolTestCase::DoRun (void)
   return false;
 }
 
+class Ipv4ForwardTtlTestCase : public TestCase
+{
+public:
+  Ipv4ForwardTtlTestCase ();
+  virtual bool
+  DoRun (void);
+private:
+  Buffer Serialize (const Ipv4Header &header);
+};
+
+Ipv4ForwardTtlTestCase::Ipv4ForwardTtlTestCase () :
+  TestCase ("Verify the incremental checksum update of a forwarded IPv4 header")
+{
+}
+
+Buffer
+Ipv4ForwardTtlTestCase::Serialize (const Ipv4Header &header)
+{
+  Buffer buffer;
+  buffer.AddAtStart (header.GetSerializedSize ());
+  header.Serialize (buffer.Begin ());
+  return buffer;
+}
+
+bool
+Ipv4ForwardTtlTestCase::DoRun (void)
+{
+  UniformVariable rng (0, 0xffffffff);
+  uint8_t ttls[] = {1, 2, 64, 128, 255, 0};
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      Ipv4Header sent;
+      sent.EnableChecksum ();
+      sent.SetSource (Ipv4Address ((uint32_t)rng.GetValue ()));
+      sent.SetDestination (Ipv4Address ((uint32_t)rng.GetValue ()));
+      sent.SetIdentification (i);
+      sent.SetPayloadSize (i);
+      sent.SetProtocol (i & 0xff);
+      sent.SetTtl (ttls[i % (sizeof (ttls) / sizeof (ttls[0]))]);
+
+      // what a router forwards
+      Ipv4Header forwarded;
+      forwarded.EnableChecksum ();
+      forwarded.Deserialize (Serialize (sent).Begin ());
+      NS_TEST_ASSERT_MSG_EQ (forwarded.IsChecksumOk (), true, "checksum of the header sent");
+      forwarded.DecrementTtl ();
+      Buffer incremental = Serialize (forwarded);
+
+      Ipv4Header expected = sent;
+      expected.SetTtl (sent.GetTtl () - 1);
+      Buffer full = Serialize (expected);
+
+      NS_TEST_ASSERT_MSG_EQ (memcmp (incremental.PeekData (), full.PeekData (), full.GetSize ()), 0,
+                             "incremental and full checksums differ for ttl " << (uint32_t)sent.GetTtl ());
+      Ipv4Header received;
+      received.EnableChecksum ();
+      received.Deserialize (incremental.Begin ());
+      NS_TEST_ASSERT_MSG_EQ (received.IsChecksumOk (), true, "checksum of the header forwarded");
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t)received.GetTtl (), (uint32_t)((sent.GetTtl () - 1) & 0xff), "ttl");
+    }
+  return false;
+}
+
 static class IPv4L3ProtocolTestSuite : public TestSuite
 {
 public:
@@ -105,6 +170,7 @@ public:
     TestSuite ("ipv4-protocol", UNIT)
   {
     AddTestCase (new Ipv4L3ProtocolTestCase ());
+    AddTestCase (new Ipv4ForwardTtlTestCase ());
   }
 } g_ipv4protocolTestSuite;
 
@@ -55,7 +55,8 @@ public:
                uint32_t sourceWriteSize,
                uint32_t sourceReadSize,
                uint32_t serverWriteSize,
-               uint32_t serverReadSize);
+               uint32_t serverReadSize,
+               bool virtualPayload = false);
 private:
   virtual bool DoRun (void);
   virtual void DoTeardown (void);
@@ -68,12 +69,14 @@ private:
   void ServerHandleSend (Ptr<Socket> sock, uint32_t available);
   void SourceHandleSend (Ptr<Socket> sock, uint32_t available);
   void SourceHandleRecv (Ptr<Socket> sock);
+  Ptr<Packet> CreatePayload (const uint8_t *data, uint32_t size) const;
 
   uint32_t m_totalBytes;
   uint32_t m_sourceWriteSize;
   uint32_t m_sourceReadSize;
   uint32_t m_serverWriteSize;
   uint32_t m_serverReadSize;
+  bool m_virtualPayload;
   uint32_t m_currentSourceTxBytes;
   uint32_t m_currentSourceRxBytes;
   uint32_t m_currentServerRxBytes;
@@ -109,8 +112,11 @@ TcpTestCase::TcpTestCase (uint32_t totalStreamSize,
                           uint32_t sourceWriteSize,
                           uint32_t sourceReadSize,
                           uint32_t serverWriteSize,
-                          uint32_t serverReadSize)
-  : TestCase (Name ("Send string data from client to server and back", 
+                          uint32_t serverReadSize,
+                          bool virtualPayload)
+  : TestCase (Name (virtualPayload ?
+                    "Send virtual payload from client to server and back" :
+                    "Send string data from client to server and back", 
                     totalStreamSize, 
                     sourceWriteSize,
                     serverReadSize,
@@ -120,7 +126,8 @@ TcpTestCase::TcpTestCase (uint32_t totalStreamSize,
     m_sourceWriteSize (sourceWriteSize),
     m_sourceReadSize (sourceReadSize),
     m_serverWriteSize (serverWriteSize),
-    m_serverReadSize (serverReadSize)
+    m_serverReadSize (serverReadSize),
+    m_virtualPayload (virtualPayload)
 {}
 
 bool
@@ -136,14 +143,20 @@ TcpTestCase::DoRun (void)
   for(uint32_t i = 0; i < m_totalBytes; ++i)
     {
       uint8_t m = (uint8_t)(97 + (i % 26));
-      m_sourceTxPayload[i] = m;
+      m_sourceTxPayload[i] = m_virtualPayload ? 0 : m;
     }
-  memset (m_sourceRxPayload, 0, m_totalBytes);
-  memset (m_serverRxPayload, 0, m_totalBytes);
+  memset (m_sourceRxPayload, 0xff, m_totalBytes);
+  memset (m_serverRxPayload, 0xff, m_totalBytes);
 
   SetupDefaultSim ();
 
+  uint64_t materialized = Buffer::GetMaterializedBytes ();
   Simulator::Run ();
+  if (m_virtualPayload)
+    {
+      NS_TEST_EXPECT_MSG_EQ (Buffer::GetMaterializedBytes () - materialized, 0,
+                             "Virtual payload bytes were copied in memory");
+    }
 
   NS_TEST_EXPECT_MSG_EQ (m_currentSourceTxBytes, m_totalBytes, "Source sent all bytes");
   NS_TEST_EXPECT_MSG_EQ (m_currentServerRxBytes, m_totalBytes, "Server received all bytes");
@@ -164,6 +177,16 @@ TcpTestCase::DoTeardown (void)
   Simulator::Destroy ();
 }
 
+Ptr<Packet>
+TcpTestCase::CreatePayload (const uint8_t *data, uint32_t size) const
+{
+  if (m_virtualPayload)
+    {
+      return Create<Packet> (size);
+    }
+  return Create<Packet> (data, size);
+}
+
 void
 TcpTestCase::ServerHandleConnectionCreated (Ptr<Socket> s, const Address & addr)
 {
@@ -199,7 +222,7 @@ TcpTestCase::ServerHandleSend (Ptr<Socket> sock, uint32_t available)
       uint32_t left = m_currentServerRxBytes - m_currentServerTxBytes;
       uint32_t toSend = std::min (left, sock->GetTxAvailable ());
       toSend = std::min (toSend, m_serverWriteSize);
-      Ptr<Packet> p = Create<Packet> (&m_serverRxPayload[m_currentServerTxBytes], toSend);
+      Ptr<Packet> p = CreatePayload (&m_serverRxPayload[m_currentServerTxBytes], toSend);
       NS_LOG_DEBUG ("Server send data=\"" << GetString (p) << "\"");
       int sent = sock->Send (p);
       NS_TEST_EXPECT_MSG_EQ ((sent != -1), true, "Server error during send ?");
@@ -219,7 +242,7 @@ TcpTestCase::SourceHandleSend (Ptr<Socket> sock, uint32_t available)
       uint32_t left = m_totalBytes - m_currentSourceTxBytes;
       uint32_t toSend = std::min (left, sock->GetTxAvailable ());
       toSend = std::min (toSend, m_sourceWriteSize);
-      Ptr<Packet> p = Create<Packet> (&m_sourceTxPayload[m_currentSourceTxBytes], toSend);
+      Ptr<Packet> p = CreatePayload (&m_sourceTxPayload[m_currentSourceTxBytes], toSend);
       NS_LOG_DEBUG ("Source send data=\"" << GetString (p) << "\"");
       int sent = sock->Send (p);
       NS_TEST_EXPECT_MSG_EQ ((sent != -1), true, "Error during send ?");
@@ -340,6 +363,9 @@ public:
       AddTestCase (new TcpTestCase (13, 200, 200, 200, 200));
       AddTestCase (new TcpTestCase (13, 1, 1, 1, 1));
       AddTestCase (new TcpTestCase (100000, 100, 50, 100, 20));
+      // the zero-filled payloads must never be copied in memory
+      AddTestCase (new TcpTestCase (100000, 1000, 700, 1000, 300, true));
+      AddTestCase (new TcpTestCase (100000, 100, 50, 100, 20, true));
     }
   
 } g_tcpTestSuite;
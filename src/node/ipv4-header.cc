@@ -39,7 +39,8 @@ Ipv4Header::Ipv4Header ()
     m_flags (0),
     m_fragmentOffset (0),
     m_checksum(0),
-    m_goodChecksum (true)
+    m_goodChecksum (true),
+    m_checksumCached (false)
 {}
 
 void 
@@ -52,6 +53,7 @@ void
 Ipv4Header::SetPayloadSize (uint16_t size)
 {
   m_payloadSize = size;
+  m_checksumCached = false;
 }
 uint16_t 
 Ipv4Header::GetPayloadSize (void) const
@@ -68,6 +70,7 @@ void
 Ipv4Header::SetIdentification (uint16_t identification)
 {
   m_identification = identification;
+  m_checksumCached = false;
 }
 
 
@@ -76,6 +79,7 @@ void
 Ipv4Header::SetTos (uint8_t tos)
 {
   m_tos = tos;
+  m_checksumCached = false;
 }
 uint8_t 
 Ipv4Header::GetTos (void) const
@@ -86,11 +90,13 @@ void
 Ipv4Header::SetMoreFragments (void)
 {
   m_flags |= MORE_FRAGMENTS;
+  m_checksumCached = false;
 }
 void
 Ipv4Header::SetLastFragment (void)
 {
   m_flags &= ~MORE_FRAGMENTS;
+  m_checksumCached = false;
 }
 bool 
 Ipv4Header::IsLastFragment (void) const
@@ -102,11 +108,13 @@ void
 Ipv4Header::SetDontFragment (void)
 {
   m_flags |= DONT_FRAGMENT;
+  m_checksumCached = false;
 }
 void 
 Ipv4Header::SetMayFragment (void)
 {
   m_flags &= ~DONT_FRAGMENT;
+  m_checksumCached = false;
 }
 bool 
 Ipv4Header::IsDontFragment (void) const
@@ -119,6 +127,7 @@ Ipv4Header::SetFragmentOffset (uint16_t offset)
 {
   NS_ASSERT (!(offset & (~0x3fff)));
   m_fragmentOffset = offset;
+  m_checksumCached = false;
 }
 uint16_t 
 Ipv4Header::GetFragmentOffset (void) const
@@ -131,6 +140,26 @@ void
 Ipv4Header::SetTtl (uint8_t ttl)
 {
   m_ttl = ttl;
+  m_checksumCached = false;
+}
+void
+Ipv4Header::DecrementTtl (void)
+{
+  if (m_checksumCached)
+    {
+      // RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m'), with m the 16 bit word
+      // which holds the ttl and the protocol, read in the byte order of
+      // Buffer::Iterator::ReadU16.
+      uint16_t oldWord = m_ttl | (m_protocol << 8);
+      uint16_t newWord = ((m_ttl - 1) & 0xff) | (m_protocol << 8);
+      uint32_t sum = (uint16_t)~m_checksum;
+      sum += (uint16_t)~oldWord;
+      sum += newWord;
+      while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+      m_checksum = ~sum;
+    }
+  m_ttl--;
 }
 uint8_t 
 Ipv4Header::GetTtl (void) const
@@ -147,12 +176,14 @@ void
 Ipv4Header::SetProtocol (uint8_t protocol)
 {
   m_protocol = protocol;
+  m_checksumCached = false;
 }
 
 void 
 Ipv4Header::SetSource (Ipv4Address source)
 {
   m_source = source;
+  m_checksumCached = false;
 }
 Ipv4Address
 Ipv4Header::GetSource (void) const
@@ -164,6 +195,7 @@ void
 Ipv4Header::SetDestination (Ipv4Address dst)
 {
   m_destination = dst;
+  m_checksumCached = false;
 }
 Ipv4Address
 Ipv4Header::GetDestination (void) const
@@ -264,7 +296,13 @@ Ipv4Header::Serialize (Buffer::Iterator start) const
   i.WriteHtonU32 (m_source.Get ());
   i.WriteHtonU32 (m_destination.Get ());
 
-  if (m_calcChecksum) 
+  if (m_calcChecksum && m_checksumCached)
+    {
+      i = start;
+      i.Next (10);
+      i.WriteU16 (m_checksum);
+    }
+  else if (m_calcChecksum) 
     {
       i = start;
       uint16_t checksum = i.CalculateIpChecksum(20);
@@ -297,10 +335,11 @@ Ipv4Header::Deserialize (Buffer::Iterator start)
       m_flags |= MORE_FRAGMENTS;
     }
   i.Prev ();
-  m_fragmentOffset = i.ReadU8 () & 0x1f;
-  m_fragmentOffset <<= 8;
-  m_fragmentOffset |= i.ReadU8 ();
-  m_fragmentOffset <<= 3;
+  uint16_t fragmentOffset = i.ReadU8 () & 0x1f;
+  fragmentOffset <<= 8;
+  fragmentOffset |= i.ReadU8 ();
+  fragmentOffset <<= 3;
+  m_fragmentOffset = fragmentOffset;
   m_ttl = i.ReadU8 ();
   m_protocol = i.ReadU8 ();
   m_checksum = i.ReadU16();
@@ -316,6 +355,11 @@ Ipv4Header::Deserialize (Buffer::Iterator start)
 
       m_goodChecksum = (checksum == 0);
     }
+  // the checksum read can be reused by Serialize as long as the header
+  // is serialized exactly as it was read: without options and with a
+  // fragment offset which fits in m_fragmentOffset.
+  m_checksumCached = m_calcChecksum && m_goodChecksum && headerSize == 20 &&
+    m_fragmentOffset == fragmentOffset;
   return GetSerializedSize ();
 }
 
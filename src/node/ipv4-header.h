@@ -77,6 +77,15 @@ public:
    * \param ttl the ipv4 TTL
    */
   void SetTtl (uint8_t ttl);
+  /**
+   * Decrement the TTL by one, the way a router forwards a packet.
+   *
+   * If this header was deserialized with a correct checksum and was
+   * not modified since, its checksum is updated incrementally
+   * (RFC 1624) rather than recomputed over the whole header by
+   * Serialize.
+   */
+  void DecrementTtl (void);
   /**
    * \param num the ipv4 protocol field
    */
@@ -164,6 +173,8 @@ private:
   Ipv4Address m_destination;
   uint16_t m_checksum;
   bool m_goodChecksum;
+  // true if m_checksum is the checksum of the fields above.
+  bool m_checksumCached;
 };
 
 } // namespace ns3
@@ -62,9 +62,11 @@ bool
 Queue::Enqueue (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this << p);
-  NS_LOG_LOGIC ("m_traceEnqueue (p)");
-
-  m_traceEnqueue (p);
+  if (!m_traceEnqueue.IsEmpty ())
+    {
+      NS_LOG_LOGIC ("m_traceEnqueue (p)");
+      m_traceEnqueue (p);
+    }
 
   bool retval = DoEnqueue (p);
   if (retval)
@@ -94,9 +96,11 @@ Queue::Dequeue (void)
       m_nBytes -= packet->GetSize ();
       m_nPackets--;
 
-      NS_LOG_LOGIC("m_traceDequeue (packet)");
-
-      m_traceDequeue (packet);
+      if (!m_traceDequeue.IsEmpty ())
+        {
+          NS_LOG_LOGIC("m_traceDequeue (packet)");
+          m_traceDequeue (packet);
+        }
     }
   return packet;
 }
@@ -193,8 +197,11 @@ Queue::Drop (Ptr<Packet> p)
   m_nTotalDroppedPackets++;
   m_nTotalDroppedBytes += p->GetSize ();
 
-  NS_LOG_LOGIC ("m_traceDrop (p)");
-  m_traceDrop (p);
+  if (!m_traceDrop.IsEmpty ())
+    {
+      NS_LOG_LOGIC ("m_traceDrop (p)");
+      m_traceDrop (p);
+    }
 }
 
 } // namespace ns3
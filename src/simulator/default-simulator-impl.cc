@@ -22,13 +22,17 @@
 #include "default-simulator-impl.h"
 #include "scheduler.h"
 #include "event-impl.h"
+#include "event-profiler.h"
 
 #include "ns3/ptr.h"
 #include "ns3/pointer.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 
 #include <math.h>
+#include <iostream>
 
 NS_LOG_COMPONENT_DEFINE ("DefaultSimulatorImpl");
 
@@ -42,10 +46,26 @@ DefaultSimulatorImpl::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::DefaultSimulatorImpl")
     .SetParent<Object> ()
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddAttribute ("CompactThreshold",
+                   "The fraction of the pending events which must be cancelled before "
+                   "they are purged from the event list. Zero disables purging.",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&DefaultSimulatorImpl::m_compactThreshold),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("Profile",
+                   "If true, measure the wall-clock time spent in each kind of event "
+                   "and print a report from Simulator::Destroy, to std::clog unless "
+                   "another stream is set with DefaultSimulatorImpl::SetProfileStream.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DefaultSimulatorImpl::m_profile),
+                   MakeBooleanChecker ())
     ;
   return tid;
 }
 
+// purging a short event list does not pay for itself.
+static const uint32_t COMPACT_MIN_CANCELLED = 1024;
+
 DefaultSimulatorImpl::DefaultSimulatorImpl ()
 {
   m_stop = false;
@@ -59,6 +79,10 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
+  m_cancelledEvents = 0;
+  m_purgedEvents = 0;
+  m_profiler = 0;
+  m_profileStream = &std::clog;
 }
 
 DefaultSimulatorImpl::~DefaultSimulatorImpl ()
@@ -73,11 +97,18 @@ DefaultSimulatorImpl::DoDispose (void)
       next.impl->Unref ();
     }
   m_events = 0;
+  delete m_profiler;
+  m_profiler = 0;
   SimulatorImpl::DoDispose ();
 }
 void
 DefaultSimulatorImpl::Destroy ()
 {
+  NS_LOG_INFO ("purged " << m_purgedEvents << " cancelled events");
+  if (m_profiler != 0)
+    {
+      m_profiler->Report (*m_profileStream);
+    }
   while (!m_destroyEvents.empty ()) 
     {
       Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
@@ -106,22 +137,47 @@ DefaultSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
   m_events = scheduler;
 }
 
-void
-DefaultSimulatorImpl::ProcessOneEvent (void)
+Scheduler::Event
+DefaultSimulatorImpl::NextEvent (void)
 {
   Scheduler::Event next = m_events->RemoveNext ();
 
   NS_ASSERT (next.key.m_ts >= m_currentTs);
   m_unscheduledEvents--;
+  if (next.impl->IsCancelled () && m_cancelledEvents > 0)
+    {
+      m_cancelledEvents--;
+    }
 
   NS_LOG_LOGIC ("handle " << next.key.m_ts);
   m_currentTs = next.key.m_ts;
   m_currentContext = next.key.m_context;
   m_currentUid = next.key.m_uid;
+  return next;
+}
+
+void
+DefaultSimulatorImpl::ProcessOneEvent (void)
+{
+  Scheduler::Event next = NextEvent ();
   next.impl->Invoke ();
   next.impl->Unref ();
 }
 
+void
+DefaultSimulatorImpl::ProfileOneEvent (void)
+{
+  Scheduler::Event next = NextEvent ();
+  // the receiver of a cancelled event might not exist anymore.
+  if (!next.impl->IsCancelled ())
+    {
+      m_profiler->Begin (next.impl, m_currentContext);
+      next.impl->Invoke ();
+      m_profiler->End ();
+    }
+  next.impl->Unref ();
+}
+
 bool 
 DefaultSimulatorImpl::IsFinished (void) const
 {
@@ -146,9 +202,24 @@ void
 DefaultSimulatorImpl::Run (void)
 {
   m_stop = false;
-  while (!m_events->IsEmpty () && !m_stop) 
+  if (m_profile && m_profiler == 0)
     {
-      ProcessOneEvent ();
+      m_profiler = new EventProfiler ();
+    }
+  // the profiler is kept out of the loop which runs when it is disabled.
+  if (m_profiler != 0)
+    {
+      while (!m_events->IsEmpty () && !m_stop)
+        {
+          ProfileOneEvent ();
+        }
+    }
+  else
+    {
+      while (!m_events->IsEmpty () && !m_stop) 
+        {
+          ProcessOneEvent ();
+        }
     }
 
   // If the simulator stopped naturally by lack of events, make a
@@ -159,7 +230,18 @@ DefaultSimulatorImpl::Run (void)
 void
 DefaultSimulatorImpl::RunOneEvent (void)
 {
-  ProcessOneEvent ();
+  if (m_profile && m_profiler == 0)
+    {
+      m_profiler = new EventProfiler ();
+    }
+  if (m_profiler != 0)
+    {
+      ProfileOneEvent ();
+    }
+  else
+    {
+      ProcessOneEvent ();
+    }
 }
 
 void 
@@ -291,9 +373,43 @@ DefaultSimulatorImpl::Cancel (const EventId &id)
   if (!IsExpired (id))
     {
       id.PeekEventImpl ()->Cancel ();
+      if (id.GetUid () == 2)
+        {
+          // destroy events are not in the event list.
+          return;
+        }
+      m_cancelledEvents++;
+      if (m_compactThreshold > 0 &&
+          m_cancelledEvents >= COMPACT_MIN_CANCELLED &&
+          m_cancelledEvents > m_compactThreshold * m_unscheduledEvents)
+        {
+          Compact ();
+        }
     }
 }
 
+void
+DefaultSimulatorImpl::Compact (void)
+{
+  uint32_t purged = m_events->Compact ();
+  NS_LOG_LOGIC ("purged " << purged << " of " << m_unscheduledEvents << " events");
+  m_unscheduledEvents -= purged;
+  m_purgedEvents += purged;
+  m_cancelledEvents = 0;
+}
+
+uint64_t
+DefaultSimulatorImpl::GetPurgedEventCount (void) const
+{
+  return m_purgedEvents;
+}
+
+void
+DefaultSimulatorImpl::SetProfileStream (std::ostream *os)
+{
+  m_profileStream = os;
+}
+
 bool
 DefaultSimulatorImpl::IsExpired (const EventId &ev) const
 {
@@ -28,9 +28,12 @@
 #include "ns3/ptr.h"
 
 #include <list>
+#include <ostream>
 
 namespace ns3 {
 
+class EventProfiler;
+
 class DefaultSimulatorImpl : public SimulatorImpl
 {
 public:
@@ -59,9 +62,29 @@ public:
   virtual void SetScheduler (ObjectFactory schedulerFactory);
   virtual uint32_t GetContext (void) const;
 
+  /**
+   * \returns the number of cancelled events which have been purged
+   *          from the event list before their expiration.
+   *
+   * Cancelled events are purged with Scheduler::Compact whenever
+   * they make up more than the fraction of the pending events set
+   * by the CompactThreshold attribute.
+   */
+  uint64_t GetPurgedEventCount (void) const;
+  /**
+   * \param os the output stream on which Destroy prints the report
+   *        of the event profiler, std::clog by default.
+   *
+   * The stream must outlive the call to Simulator::Destroy.
+   */
+  void SetProfileStream (std::ostream *os);
+
 private:
   virtual void DoDispose (void);
+  inline Scheduler::Event NextEvent (void);
   void ProcessOneEvent (void);
+  void ProfileOneEvent (void);
+  void Compact (void);
   uint64_t NextTs (void) const;
   typedef std::list<EventId> DestroyEvents;
 
@@ -75,6 +98,13 @@ private:
   // number of events that have been inserted but not yet scheduled,
   // not counting the "destroy" events; this is used for validation
   int m_unscheduledEvents;
+  // number of cancelled events which are still in the event list
+  uint32_t m_cancelledEvents;
+  uint64_t m_purgedEvents;
+  double m_compactThreshold;
+  bool m_profile;
+  EventProfiler *m_profiler;
+  std::ostream *m_profileStream;
 };
 
 } // namespace ns3
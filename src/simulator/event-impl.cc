@@ -19,14 +19,59 @@
  */
 
 #include "event-impl.h"
+#include "ns3/free-list-pool.h"
 
 namespace ns3 {
 
+namespace {
+
+// block sizes are multiples of 16 bytes, up to 256 bytes, and a size
+// class of a thread keeps at most 16384 blocks.
+FreeListPool &
+GetPool (void)
+{
+  static FreeListPool pool (16, 16, 16384);
+  return pool;
+}
+
+} // anonymous namespace
+
+void *
+EventImpl::operator new (size_t size)
+{
+  return GetPool ().Allocate (size);
+}
+
+void
+EventImpl::operator delete (void *buffer, size_t size)
+{
+  GetPool ().Deallocate (buffer, size);
+}
+
+struct EventImpl::PoolStats
+EventImpl::GetPoolStats (void)
+{
+  FreeListPool::Stats poolStats = GetPool ().GetStats ();
+  struct PoolStats stats;
+  stats.allocations = poolStats.allocations;
+  stats.hits = poolStats.hits;
+  stats.oversized = poolStats.oversized;
+  stats.pooled = poolStats.pooled;
+  return stats;
+}
+
+void
+EventImpl::TrimPool (void)
+{
+  GetPool ().Trim ();
+}
+
 EventImpl::~EventImpl ()
 {}
 
 EventImpl::EventImpl ()
-  : m_cancel (false)
+  : m_cancel (false),
+    m_schedulerIndex (0)
 {}
 
 void 
@@ -50,4 +95,10 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+const std::type_info &
+EventImpl::GetReceiverType (void) const
+{
+  return typeid (*this);
+}
+
 } // namespace ns3
@@ -21,6 +21,8 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <typeinfo>
 #include "ns3/simple-ref-count.h"
 
 namespace ns3 {
@@ -35,10 +37,51 @@ namespace ns3 {
  * obviously (there are Ref and Unref methods) reference-counted and
  * most subclasses are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * The storage of all subclasses is recycled through per-thread freelists,
+ * one per 16-byte size class, so that, once the pools are warm, scheduling
+ * and retiring an event does not call the global allocator.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
 public:
+  /**
+   * The counters of the EventImpl allocation pools, summed over all
+   * threads.
+   */
+  struct PoolStats
+  {
+    /**
+     * The number of EventImpl instances allocated.
+     */
+    uint64_t allocations;
+    /**
+     * The number of allocations served from a freelist.
+     */
+    uint64_t hits;
+    /**
+     * The number of allocations too large for any size class.
+     */
+    uint64_t oversized;
+    /**
+     * The number of blocks currently held by the freelists.
+     */
+    uint64_t pooled;
+  };
+
+  static void *operator new (size_t size);
+  static void operator delete (void *buffer, size_t size);
+  /**
+   * \returns the pool counters. The value returned while other
+   *          threads allocate events is only approximate.
+   */
+  static struct PoolStats GetPoolStats (void);
+  /**
+   * Return the blocks held by the freelists of the calling thread
+   * to the global allocator.
+   */
+  static void TrimPool (void);
+
   EventImpl ();
   virtual ~EventImpl () = 0;
   /**
@@ -57,14 +100,49 @@ public:
    * Invoked by the simulation engine before calling Invoke.
    */
   bool IsCancelled (void);
+  /**
+   * \param index the position of this event in the data structure
+   *        of the scheduler which holds it.
+   *
+   * This field is reserved to the Scheduler subclasses which need to
+   * locate an event in O(1) to remove it (see FourAryHeapScheduler).
+   * An event is held by at most one scheduler at a time.
+   */
+  inline void SetSchedulerIndex (uint32_t index);
+  /**
+   * \returns the value stored by the last call to SetSchedulerIndex.
+   */
+  inline uint32_t GetSchedulerIndex (void) const;
+  /**
+   * \returns the type of the object whose method is invoked by this
+   *          event or, if this event does not invoke a method, the
+   *          type of the event itself.
+   *
+   * This is used to attribute the cost of each event to its receiver
+   * when the simulator profiles the events it executes.
+   */
+  virtual const std::type_info &GetReceiverType (void) const;
 
 protected:
   virtual void Notify (void) = 0;
 
 private:
   bool m_cancel;
+  uint32_t m_schedulerIndex;
 };
 
+void
+EventImpl::SetSchedulerIndex (uint32_t index)
+{
+  m_schedulerIndex = index;
+}
+
+uint32_t
+EventImpl::GetSchedulerIndex (void) const
+{
+  return m_schedulerIndex;
+}
+
 } // namespace ns3
 
 #endif /* EVENT_IMPL_H */
@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "event-profiler.h"
+#include "event-impl.h"
+#include "ns3/simulator-config.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <sys/time.h>
+#ifdef HAVE_RT
+#include <time.h>
+#endif /* HAVE_RT */
+#if (__GNUC__ >= 3)
+#include <cxxabi.h>
+#endif
+
+namespace ns3 {
+
+static std::string
+Demangle (const char *mangled)
+{
+#if (__GNUC__ >= 3)
+  int status;
+  char *demangled = abi::__cxa_demangle (mangled, NULL, NULL, &status);
+  if (status == 0 && demangled != 0)
+    {
+      std::string ret = demangled;
+      free (demangled);
+      return ret;
+    }
+#endif
+  return mangled;
+}
+
+// the local classes of MakeEvent are named after the whole signature of
+// their enclosing function: only keep "MakeEvent<template arguments>".
+static std::string
+GetEventName (const std::type_info &type)
+{
+  std::string name = Demangle (type.name ());
+  std::string::size_type start = name.find ("MakeEvent<");
+  if (start == std::string::npos)
+    {
+      return name;
+    }
+  int depth = 0;
+  for (std::string::size_type i = start; i < name.size (); i++)
+    {
+      if (name[i] == '<')
+        {
+          depth++;
+        }
+      else if (name[i] == '>')
+        {
+          depth--;
+          if (depth == 0)
+            {
+              return name.substr (start, i + 1 - start);
+            }
+        }
+    }
+  return name;
+}
+
+bool
+EventProfiler::KeyLess::operator () (const Key &a, const Key &b) const
+{
+  if (a.event != b.event)
+    {
+      return a.event < b.event;
+    }
+  if (a.receiver != b.receiver)
+    {
+      return a.receiver < b.receiver;
+    }
+  return a.context < b.context;
+}
+
+EventProfiler::EventProfiler ()
+  : m_current (0),
+    m_start (0)
+{}
+
+uint64_t
+EventProfiler::GetNanoseconds (void)
+{
+#ifdef HAVE_RT
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else /* HAVE_RT */
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif /* HAVE_RT */
+}
+
+void
+EventProfiler::Begin (const EventImpl *event, uint32_t context)
+{
+  Key key;
+  key.event = &typeid (*event);
+  key.receiver = &event->GetReceiverType ();
+  key.context = context;
+  StatsMap::iterator i = m_stats.find (key);
+  if (i == m_stats.end ())
+    {
+      Stats stats = {0, 0};
+      i = m_stats.insert (std::make_pair (key, stats)).first;
+    }
+  m_current = &i->second;
+  m_start = GetNanoseconds ();
+}
+
+void
+EventProfiler::End (void)
+{
+  uint64_t end = GetNanoseconds ();
+  m_current->count++;
+  m_current->ns += end - m_start;
+  m_current = 0;
+}
+
+namespace {
+struct SortEntry
+{
+  uint64_t ns;
+  uint64_t count;
+  uint32_t context;
+  const std::type_info *event;
+  const std::type_info *receiver;
+};
+bool
+SpentMore (const SortEntry &a, const SortEntry &b)
+{
+  return a.ns > b.ns;
+}
+} // anonymous namespace
+
+void
+EventProfiler::Report (std::ostream &os) const
+{
+  std::vector<SortEntry> entries;
+  uint64_t totalNs = 0;
+  uint64_t totalCount = 0;
+  for (StatsMap::const_iterator i = m_stats.begin (); i != m_stats.end (); i++)
+    {
+      SortEntry entry = {i->second.ns, i->second.count, i->first.context,
+                         i->first.event, i->first.receiver};
+      entries.push_back (entry);
+      totalNs += i->second.ns;
+      totalCount += i->second.count;
+    }
+  std::sort (entries.begin (), entries.end (), &SpentMore);
+
+  std::ios_base::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os << "Event profile: " << totalCount << " events in "
+     << std::fixed << std::setprecision (6) << totalNs / 1e9 << " s" << std::endl;
+  os << std::setw (12) << "time (s)" << std::setw (8) << "%"
+     << std::setw (12) << "events" << std::setw (12) << "mean (us)"
+     << std::setw (12) << "context" << "  receiver: event" << std::endl;
+  for (std::vector<SortEntry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      os << std::setw (12) << std::setprecision (6) << i->ns / 1e9
+         << std::setw (8) << std::setprecision (2) << (totalNs == 0 ? 0.0 : 100.0 * i->ns / totalNs)
+         << std::setw (12) << i->count
+         << std::setw (12) << std::setprecision (3) << i->ns / 1e3 / i->count;
+      if (i->context == 0xffffffff)
+        {
+          os << std::setw (12) << "-";
+        }
+      else
+        {
+          os << std::setw (12) << i->context;
+        }
+      os << "  ";
+      if (i->receiver != i->event)
+        {
+          os << Demangle (i->receiver->name ()) << ": ";
+        }
+      os << GetEventName (*i->event) << std::endl;
+    }
+  os.flags (flags);
+  os.precision (precision);
+}
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <stdint.h>
+#include <map>
+#include <ostream>
+#include <typeinfo>
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup simulator
+ * \brief accumulate the wall-clock time spent in each kind of event
+ *
+ * The events are classified according to the type of the event
+ * (which identifies the function or member function invoked and
+ * the type of its arguments), the dynamic type of the object whose
+ * member function is invoked (see EventImpl::GetReceiverType) and
+ * the context of the event.
+ */
+class EventProfiler
+{
+public:
+  EventProfiler ();
+
+  /**
+   * \param event the event which is about to be invoked
+   * \param context the context of the event
+   *
+   * Must be called before the event is invoked: the receiver of the
+   * event might be destroyed by the event itself.
+   */
+  void Begin (const EventImpl *event, uint32_t context);
+  /**
+   * Account the time elapsed since the last call to Begin.
+   */
+  void End (void);
+  /**
+   * \param os the output stream
+   *
+   * Print one line per kind of event, in decreasing order of total
+   * time spent.
+   */
+  void Report (std::ostream &os) const;
+
+private:
+  struct Key
+  {
+    const std::type_info *event;
+    const std::type_info *receiver;
+    uint32_t context;
+  };
+  struct Stats
+  {
+    uint64_t count;
+    uint64_t ns;
+  };
+  struct KeyLess
+  {
+    bool operator () (const Key &a, const Key &b) const;
+  };
+  typedef std::map<Key, Stats, KeyLess> StatsMap;
+
+  static uint64_t GetNanoseconds (void);
+
+  StatsMap m_stats;
+  Stats *m_current;
+  uint64_t m_start;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
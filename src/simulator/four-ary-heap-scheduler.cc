@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "four-ary-heap-scheduler.h"
+#include "event-impl.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("FourAryHeapScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (FourAryHeapScheduler);
+
+// the children of the node at index i are stored at 4i+1 to 4i+4.
+static const uint32_t ARITY = 4;
+
+TypeId
+FourAryHeapScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FourAryHeapScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<FourAryHeapScheduler> ()
+    ;
+  return tid;
+}
+
+FourAryHeapScheduler::FourAryHeapScheduler ()
+{}
+
+FourAryHeapScheduler::~FourAryHeapScheduler ()
+{}
+
+void
+FourAryHeapScheduler::Set (uint32_t index, const EventKey &key, EventImpl *impl)
+{
+  m_keys[index] = key;
+  m_impls[index] = impl;
+  impl->SetSchedulerIndex (index);
+}
+
+void
+FourAryHeapScheduler::SiftUp (uint32_t index, const EventKey &key, EventImpl *impl)
+{
+  while (index > 0)
+    {
+      uint32_t parent = (index - 1) / ARITY;
+      if (!(key < m_keys[parent]))
+        {
+          break;
+        }
+      Set (index, m_keys[parent], m_impls[parent]);
+      index = parent;
+    }
+  Set (index, key, impl);
+}
+
+void
+FourAryHeapScheduler::SiftDown (uint32_t index, const EventKey &key, EventImpl *impl)
+{
+  uint32_t size = m_keys.size ();
+  while (true)
+    {
+      uint32_t first = index * ARITY + 1;
+      if (first >= size)
+        {
+          break;
+        }
+      uint32_t last = first + ARITY;
+      if (last > size)
+        {
+          last = size;
+        }
+      uint32_t smallest = first;
+      for (uint32_t child = first + 1; child < last; child++)
+        {
+          if (m_keys[child] < m_keys[smallest])
+            {
+              smallest = child;
+            }
+        }
+      if (!(m_keys[smallest] < key))
+        {
+          break;
+        }
+      Set (index, m_keys[smallest], m_impls[smallest]);
+      index = smallest;
+    }
+  Set (index, key, impl);
+}
+
+void
+FourAryHeapScheduler::RemoveAt (uint32_t index)
+{
+  uint32_t last = m_keys.size () - 1;
+  EventKey key = m_keys[last];
+  EventImpl *impl = m_impls[last];
+  m_keys.pop_back ();
+  m_impls.pop_back ();
+  if (index == last)
+    {
+      return;
+    }
+  // the last element is moved into the hole and may have to go
+  // either up or down from there.
+  if (index > 0 && key < m_keys[(index - 1) / ARITY])
+    {
+      SiftUp (index, key, impl);
+    }
+  else
+    {
+      SiftDown (index, key, impl);
+    }
+}
+
+void
+FourAryHeapScheduler::Insert (const Event &ev)
+{
+  m_keys.push_back (ev.key);
+  m_impls.push_back (ev.impl);
+  SiftUp (m_keys.size () - 1, ev.key, ev.impl);
+}
+
+bool
+FourAryHeapScheduler::IsEmpty (void) const
+{
+  return m_keys.empty ();
+}
+
+Scheduler::Event
+FourAryHeapScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  Event next;
+  next.impl = m_impls[0];
+  next.key = m_keys[0];
+  return next;
+}
+
+Scheduler::Event
+FourAryHeapScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  Event next;
+  next.impl = m_impls[0];
+  next.key = m_keys[0];
+  RemoveAt (0);
+  return next;
+}
+
+void
+FourAryHeapScheduler::Remove (const Event &ev)
+{
+  uint32_t index = ev.impl->GetSchedulerIndex ();
+  NS_ASSERT (index < m_impls.size () && m_impls[index] == ev.impl);
+  NS_LOG_DEBUG ("Remove " << ev.key.m_uid << " at " << index);
+  RemoveAt (index);
+}
+
+uint32_t
+FourAryHeapScheduler::Compact (void)
+{
+  uint32_t size = m_keys.size ();
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < size; i++)
+    {
+      if (m_impls[i]->IsCancelled ())
+        {
+          m_impls[i]->Unref ();
+        }
+      else
+        {
+          Set (kept, m_keys[i], m_impls[i]);
+          kept++;
+        }
+    }
+  m_keys.resize (kept);
+  m_impls.resize (kept);
+  // bottom-up heap construction.
+  if (kept > 1)
+    {
+      for (uint32_t i = (kept - 2) / ARITY + 1; i > 0; i--)
+        {
+          EventKey key = m_keys[i - 1];
+          SiftDown (i - 1, key, m_impls[i - 1]);
+        }
+    }
+  return size - kept;
+}
+
+} // namespace ns3
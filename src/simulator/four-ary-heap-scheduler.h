@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FOUR_ARY_HEAP_SCHEDULER_H
+#define FOUR_ARY_HEAP_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief an implicit 4-ary heap event scheduler
+ *
+ * The 16-byte keys of the events are stored in one array and the
+ * EventImpl pointers in a parallel array, so that the comparisons
+ * performed while the heap is walked only touch the keys: the four
+ * children of a node are contiguous and fill a 64-byte cache line.
+ * A 4-ary heap is also half as deep as a binary heap.
+ *
+ * Each event records its current position in the heap with
+ * EventImpl::SetSchedulerIndex, which makes Remove O(log n) instead
+ * of the linear search performed by HeapScheduler. Compact filters
+ * the arrays in place and rebuilds the heap in O(n).
+ */
+class FourAryHeapScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  FourAryHeapScheduler ();
+  virtual ~FourAryHeapScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+  virtual uint32_t Compact (void);
+
+private:
+  inline void Set (uint32_t index, const EventKey &key, EventImpl *impl);
+  void SiftUp (uint32_t index, const EventKey &key, EventImpl *impl);
+  void SiftDown (uint32_t index, const EventKey &key, EventImpl *impl);
+  void RemoveAt (uint32_t index);
+
+  std::vector<EventKey> m_keys;
+  std::vector<EventImpl *> m_impls;
+};
+
+} // namespace ns3
+
+#endif /* FOUR_ARY_HEAP_SCHEDULER_H */
@@ -0,0 +1,260 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "high-precision-int64.h"
+#include "ns3/fatal-error.h"
+
+#include <cmath>
+
+namespace ns3 {
+
+HighPrecision::HighPrecision (double value)
+  : m_isInteger (true),
+    m_intValue (0),
+    m_doubleValue (0.0)
+{
+  SetDouble (value);
+}
+
+void
+HighPrecision::SetDouble (double value)
+{
+  // -2^63 and 2^63 are both exactly representable as doubles.
+  if (value == floor (value) &&
+      value >= -9223372036854775808.0 &&
+      value < 9223372036854775808.0)
+    {
+      m_isInteger = true;
+      m_intValue = (int64_t)value;
+    }
+  else
+    {
+      m_isInteger = false;
+      m_doubleValue = value;
+    }
+}
+
+void
+HighPrecision::Overflow (char const *operation)
+{
+  NS_FATAL_ERROR ("High precision 64 bits " << operation << " error: overflow.");
+}
+
+int64_t
+HighPrecision::SlowGetInteger (void) const
+{
+  return (int64_t)floor (m_doubleValue);
+}
+
+bool
+HighPrecision::SlowAdd (HighPrecision const &o)
+{
+  SetDouble (GetDouble () + o.GetDouble ());
+  return false;
+}
+
+bool
+HighPrecision::SlowSub (HighPrecision const &o)
+{
+  SetDouble (GetDouble () - o.GetDouble ());
+  return false;
+}
+
+bool
+HighPrecision::SlowMul (HighPrecision const &o)
+{
+  if (!m_isInteger || !o.m_isInteger)
+    {
+      SetDouble (GetDouble () * o.GetDouble ());
+      return false;
+    }
+  int64_t a = m_intValue;
+  int64_t b = o.m_intValue;
+  if (a == 0)
+    {
+      return false;
+    }
+  int64_t minimum = (int64_t)(1ULL << 63);
+  if (a == -1 && b == minimum)
+    {
+      Overflow ("multiplication");
+    }
+  int64_t result = (int64_t)((uint64_t)a * (uint64_t)b);
+  if (result / a != b)
+    {
+      Overflow ("multiplication");
+    }
+  m_intValue = result;
+  return false;
+}
+
+bool
+HighPrecision::Div (HighPrecision const &o)
+{
+  // a zero value is always stored as an integer.
+  if (o.m_isInteger && o.m_intValue == 0)
+    {
+      NS_FATAL_ERROR ("High precision 64 bits division error: division by zero.");
+    }
+  if (m_isInteger && o.m_isInteger)
+    {
+      int64_t a = m_intValue;
+      int64_t b = o.m_intValue;
+      int64_t minimum = (int64_t)(1ULL << 63);
+      if (b == -1 && a == minimum)
+        {
+          Overflow ("division");
+        }
+      if (a % b == 0)
+        {
+          m_intValue = a / b;
+          return false;
+        }
+    }
+  SetDouble (GetDouble () / o.GetDouble ());
+  return false;
+}
+
+int
+HighPrecision::SlowCompare (HighPrecision const &o) const
+{
+  double a = GetDouble ();
+  double b = o.GetDouble ();
+  return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+} // namespace ns3
+
+#include "ns3/test.h"
+
+#define CHECK_EXPECTED(a,b) \
+  NS_TEST_ASSERT_MSG_EQ(a.GetInteger(),b,"Arithmetic failure: " << (a.GetInteger()) << "!=" << (b))
+
+#define V(v) \
+  HighPrecision (v, false)
+
+namespace ns3 {
+
+class Hp64ArithmeticTestCase : public TestCase
+{
+public:
+  Hp64ArithmeticTestCase ();
+  virtual bool DoRun (void);
+};
+
+Hp64ArithmeticTestCase::Hp64ArithmeticTestCase ()
+  : TestCase ("Check basic arithmetic operations")
+{}
+bool
+Hp64ArithmeticTestCase::DoRun (void)
+{
+  HighPrecision a;
+
+  a = V (1);
+  a.Sub (V (3));
+  CHECK_EXPECTED (a, -2);
+
+  a = V (-3);
+  a.Sub (V (-4));
+  CHECK_EXPECTED (a, 1);
+
+  a = V (1);
+  a.Add (V (-3));
+  CHECK_EXPECTED (a, -2);
+
+  a = V (-1);
+  a.Mul (V (-1));
+  CHECK_EXPECTED (a, 1);
+
+  // does not fit in the 32 bit multiplication fast path.
+  a = V (3000000000LL);
+  a.Mul (V (-3000000000LL));
+  CHECK_EXPECTED (a, -9000000000000000000LL);
+
+  a = V (2);
+  a.Mul (V (3));
+  a.Div (V (3));
+  CHECK_EXPECTED (a, 2);
+
+  // 2/3 is kept as a double and the final conversion truncates.
+  a = V (2);
+  a.Div (V (3));
+  a.Mul (V (3));
+  CHECK_EXPECTED (a, 2);
+
+  a = V (2000000000);
+  a.Div (V (3));
+  a.Mul (V (3));
+  CHECK_EXPECTED (a, 2000000000);
+
+  a = V (-7);
+  a.Div (V (2));
+  CHECK_EXPECTED (a, -4);
+
+  NS_TEST_ASSERT_MSG_EQ (V (5).Compare (V (-5)), 1, "Compare failure");
+  NS_TEST_ASSERT_MSG_EQ (V (-5).Compare (V (5)), -1, "Compare failure");
+  NS_TEST_ASSERT_MSG_EQ (V (5).Compare (V (5)), 0, "Compare failure");
+  NS_TEST_ASSERT_MSG_EQ (HighPrecision (0.5).Compare (V (0)), 1, "Compare failure");
+  NS_TEST_ASSERT_MSG_EQ (HighPrecision (0.5).Compare (V (1)), -1, "Compare failure");
+
+  return false;
+}
+
+class Hp64FractionTestCase : public TestCase
+{
+public:
+  Hp64FractionTestCase ();
+  virtual bool DoRun (void);
+};
+
+Hp64FractionTestCase::Hp64FractionTestCase ()
+  : TestCase ("Check operations on non-integral values")
+{}
+bool
+Hp64FractionTestCase::DoRun (void)
+{
+  HighPrecision a = HighPrecision (0.1);
+  a.Div (HighPrecision (1.25));
+  NS_TEST_ASSERT_MSG_EQ_TOL (a.GetDouble (), 0.08, 1e-15, "The testcase for bug 455");
+  a = HighPrecision (0.5);
+  a.Mul (HighPrecision (5));
+  NS_TEST_ASSERT_MSG_EQ (a.GetDouble (), 2.5, "Simple test for multiplication");
+  a = HighPrecision (-0.5);
+  a.Mul (HighPrecision (5));
+  NS_TEST_ASSERT_MSG_EQ (a.GetDouble (), -2.5, "Test sign, first operation negative");
+  CHECK_EXPECTED (a, -3);
+
+  // an integral result goes back to the integer representation.
+  a = HighPrecision (0.125);
+  a.Mul (V (800));
+  CHECK_EXPECTED (a, 100);
+  a.Add (V (0x7fffffffffffff00LL));
+  CHECK_EXPECTED (a, 0x7fffffffffffff64LL);
+
+  return false;
+}
+
+static class HighPrecisionInt64TestSuite : public TestSuite
+{
+public:
+  HighPrecisionInt64TestSuite ()
+    : TestSuite ("high-precision-int64", UNIT)
+  {
+    AddTestCase (new Hp64ArithmeticTestCase ());
+    AddTestCase (new Hp64FractionTestCase ());
+  }
+} g_highPrecisionInt64TestSuite;
+
+} // namespace ns3
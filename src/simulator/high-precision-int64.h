@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef HIGH_PRECISION_INT64_H
+#define HIGH_PRECISION_INT64_H
+
+#include <stdint.h>
+
+/**
+ * This file contains an implementation of the HighPrecision class
+ * which stores time values as a plain 64 bit integer count of
+ * timesteps. It is selected with the --high-precision-as-int64
+ * configure option.
+ *
+ * The 128 bit implementation spends most of its time checking whether
+ * its operands have a fractional part and converting between its fast
+ * and slow representations. Here, integer values are the only
+ * representation the fast path knows about: addition, subtraction and
+ * comparison of two integer values are inlined down to one or two
+ * machine instructions plus an overflow test. An overflow is a fatal
+ * error rather than a silent wrap-around.
+ *
+ * A value which is not integral (for example, Scalar (0.125), or the
+ * result of a division which is not exact) is stored as a double
+ * instead and every operation which involves such a value is carried
+ * out in double precision. The result is converted back to an integer
+ * whenever it is integral so that the fast path is quickly recovered.
+ * Hence, timesteps larger than 2^53 lose precision when they are
+ * combined with a non-integral value.
+ */
+
+namespace ns3 {
+
+class HighPrecision
+{
+public:
+  inline HighPrecision ();
+  inline HighPrecision (int64_t value, bool dummy);
+  HighPrecision (double value);
+
+  inline int64_t GetInteger (void) const;
+  inline double GetDouble (void) const;
+  inline bool Add (HighPrecision const &o);
+  inline bool Sub (HighPrecision const &o);
+  inline bool Mul (HighPrecision const &o);
+  bool Div (HighPrecision const &o);
+
+  inline int Compare (HighPrecision const &o) const;
+  inline static HighPrecision Zero (void);
+private:
+  int64_t SlowGetInteger (void) const;
+  bool SlowAdd (HighPrecision const &o);
+  bool SlowSub (HighPrecision const &o);
+  bool SlowMul (HighPrecision const &o);
+  int SlowCompare (HighPrecision const &o) const;
+  void SetDouble (double value);
+  static void Overflow (char const *operation);
+
+  bool m_isInteger;
+  int64_t m_intValue;
+  double m_doubleValue;
+};
+
+}; // namespace ns3
+
+namespace ns3 {
+
+HighPrecision::HighPrecision ()
+  : m_isInteger (true),
+    m_intValue (0),
+    m_doubleValue (0.0)
+{}
+
+HighPrecision::HighPrecision (int64_t value, bool dummy)
+  : m_isInteger (true),
+    m_intValue (value),
+    m_doubleValue (0.0)
+{}
+
+int64_t
+HighPrecision::GetInteger (void) const
+{
+  if (m_isInteger)
+    {
+      return m_intValue;
+    }
+  return SlowGetInteger ();
+}
+
+double
+HighPrecision::GetDouble (void) const
+{
+  if (m_isInteger)
+    {
+      return (double)m_intValue;
+    }
+  return m_doubleValue;
+}
+
+bool
+HighPrecision::Add (HighPrecision const &o)
+{
+  if (m_isInteger && o.m_isInteger)
+    {
+      int64_t result = (int64_t)((uint64_t)m_intValue + (uint64_t)o.m_intValue);
+      // the sign of the result differs from the sign of both operands.
+      if (((m_intValue ^ result) & (o.m_intValue ^ result)) < 0)
+        {
+          Overflow ("addition");
+        }
+      m_intValue = result;
+      return false;
+    }
+  return SlowAdd (o);
+}
+
+bool
+HighPrecision::Sub (HighPrecision const &o)
+{
+  if (m_isInteger && o.m_isInteger)
+    {
+      int64_t result = (int64_t)((uint64_t)m_intValue - (uint64_t)o.m_intValue);
+      // the operands have different signs and the result does not
+      // have the sign of the first operand.
+      if (((m_intValue ^ o.m_intValue) & (m_intValue ^ result)) < 0)
+        {
+          Overflow ("subtraction");
+        }
+      m_intValue = result;
+      return false;
+    }
+  return SlowSub (o);
+}
+
+bool
+HighPrecision::Mul (HighPrecision const &o)
+{
+  // the product of two 32 bit signed integers cannot overflow.
+  if (m_isInteger && o.m_isInteger &&
+      (uint64_t)m_intValue + 0x80000000ULL < 0x100000000ULL &&
+      (uint64_t)o.m_intValue + 0x80000000ULL < 0x100000000ULL)
+    {
+      m_intValue *= o.m_intValue;
+      return false;
+    }
+  return SlowMul (o);
+}
+
+int
+HighPrecision::Compare (HighPrecision const &o) const
+{
+  if (m_isInteger && o.m_isInteger)
+    {
+      return (m_intValue < o.m_intValue) ? -1 : (m_intValue > o.m_intValue) ? 1 : 0;
+    }
+  return SlowCompare (o);
+}
+
+HighPrecision
+HighPrecision::Zero (void)
+{
+  return HighPrecision (0, false);
+}
+
+}; // namespace ns3
+
+#endif /* HIGH_PRECISION_INT64_H */
@@ -23,8 +23,10 @@
 #include <stdint.h>
 #include "ns3/simulator-config.h"
 
-#ifdef USE_HIGH_PRECISION_DOUBLE
+#if defined (USE_HIGH_PRECISION_DOUBLE)
 #include "high-precision-double.h"
+#elif defined (USE_HIGH_PRECISION_INT64)
+#include "high-precision-int64.h"
 #else /* USE_HIGH_PRECISION_DOUBLE */
 #include "high-precision-128.h"
 #endif /* USE_HIGH_PRECISION_DOUBLE */
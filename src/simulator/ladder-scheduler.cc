@@ -0,0 +1,355 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "ns3/assert.h"
+#include "ns3/fatal-error.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+// a bucket which holds more events than this is spawned into a new
+// rung rather than sorted into Bottom, and Bottom is spilled into a
+// new rung when it grows beyond this.
+static const uint32_t THRESHOLD = 50;
+static const uint32_t MAX_RUNGS = 8;
+
+// Bottom is sorted in decreasing order so that the next event is
+// removed from the back of the deque and an event scheduled after
+// all the others, such as a new event at the current time, is
+// inserted at its front.
+static bool
+IsLater (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return b.key < a.key;
+}
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderScheduler> ()
+    ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topMin (0),
+    m_topMax (0),
+    m_topStart (0),
+    m_rungs (MAX_RUNGS),
+    m_nRungs (0),
+    m_size (0)
+{}
+
+LadderScheduler::~LadderScheduler ()
+{}
+
+uint64_t
+LadderScheduler::GetCurrentStart (const Rung &rung) const
+{
+  return rung.start + rung.current * rung.width;
+}
+
+void
+LadderScheduler::FillRung (Rung *rung, uint64_t start, uint64_t width, uint32_t nBuckets, Events *events)
+{
+  NS_LOG_DEBUG ("rung " << m_nRungs << ": " << events->size () << " events, " << nBuckets <<
+                " buckets of width " << width << " from " << start);
+  rung->start = start;
+  rung->width = width;
+  rung->current = 0;
+  rung->nBuckets = nBuckets;
+  rung->count = events->size ();
+  if (rung->buckets.size () < nBuckets)
+    {
+      rung->buckets.resize (nBuckets);
+    }
+  for (Events::const_iterator i = events->begin (); i != events->end (); i++)
+    {
+      uint64_t bucket = (i->key.m_ts - start) / width;
+      NS_ASSERT (bucket < nBuckets);
+      rung->buckets[bucket].push_back (*i);
+    }
+  events->clear ();
+}
+
+void
+LadderScheduler::FillBottom (Events *events)
+{
+  NS_ASSERT (m_bottom.empty ());
+  m_bottom.assign (events->begin (), events->end ());
+  std::sort (m_bottom.begin (), m_bottom.end (), &IsLater);
+  events->clear ();
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  if (m_bottom.empty () || IsLater (ev, m_bottom.front ()))
+    {
+      m_bottom.push_front (ev);
+    }
+  else
+    {
+      BottomEvents::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, &IsLater);
+      m_bottom.insert (i, ev);
+    }
+  if (m_bottom.size () > THRESHOLD && m_nRungs < MAX_RUNGS &&
+      m_bottom.front ().key.m_ts != m_bottom.back ().key.m_ts)
+    {
+      SpillBottom ();
+    }
+}
+
+void
+LadderScheduler::SpillBottom (void)
+{
+  // Bottom holds the events scheduled before the current bucket of
+  // the last rung, or before Top if there is no rung: the new rung
+  // covers the whole interval from the first event of Bottom to
+  // there, so that the events inserted later in this interval go to
+  // the new rung rather than to Bottom.
+  uint64_t start = m_bottom.back ().key.m_ts;
+  uint64_t end = m_nRungs == 0 ? m_topStart : GetCurrentStart (m_rungs[m_nRungs - 1]);
+  NS_ASSERT (end > m_bottom.front ().key.m_ts);
+  uint64_t n = m_bottom.size ();
+  uint64_t width = (end - start + n - 1) / n;
+  uint32_t nBuckets = (end - start + width - 1) / width;
+  Events events (m_bottom.begin (), m_bottom.end ());
+  m_bottom.clear ();
+  FillRung (&m_rungs[m_nRungs], start, width, nBuckets, &events);
+  m_nRungs++;
+}
+
+bool
+LadderScheduler::RemoveFrom (Events *events, const Event &ev)
+{
+  for (Events::iterator i = events->begin (); i != events->end (); i++)
+    {
+      if (i->impl == ev.impl)
+        {
+          *i = events->back ();
+          events->pop_back ();
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+LadderScheduler::Refill (void)
+{
+  NS_ASSERT (m_size > 0);
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          // all the events are in Top: the new events scheduled before
+          // its current maximum will now go to the ladder or to Bottom.
+          NS_ASSERT (!m_top.empty ());
+          uint32_t n = m_top.size ();
+          m_topStart = m_topMax + 1;
+          if (n <= THRESHOLD || m_topMax == m_topMin)
+            {
+              FillBottom (&m_top);
+            }
+          else
+            {
+              uint64_t width = (m_topMax - m_topMin) / n + 1;
+              uint32_t nBuckets = (m_topMax - m_topMin) / width + 1;
+              FillRung (&m_rungs[0], m_topMin, width, nBuckets, &m_top);
+              m_nRungs = 1;
+            }
+          continue;
+        }
+      Rung *rung = &m_rungs[m_nRungs - 1];
+      if (rung->count == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung->buckets[rung->current].empty ())
+        {
+          rung->current++;
+        }
+      Events *bucket = &rung->buckets[rung->current];
+      uint64_t bucketStart = GetCurrentStart (*rung);
+      rung->count -= bucket->size ();
+      rung->current++;
+      if (bucket->size () <= THRESHOLD || rung->width == 1 || m_nRungs == MAX_RUNGS)
+        {
+          FillBottom (bucket);
+        }
+      else
+        {
+          uint64_t n = bucket->size ();
+          uint64_t width = (rung->width + n - 1) / n;
+          uint32_t nBuckets = (rung->width + width - 1) / width;
+          FillRung (&m_rungs[m_nRungs], bucketStart, width, nBuckets, bucket);
+          m_nRungs++;
+        }
+    }
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  m_size++;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      else
+        {
+          m_topMin = std::min (m_topMin, ts);
+          m_topMax = std::max (m_topMax, ts);
+        }
+      m_top.push_back (ev);
+      return;
+    }
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung *rung = &m_rungs[i];
+      if (ts >= GetCurrentStart (*rung))
+        {
+          uint64_t bucket = (ts - rung->start) / rung->width;
+          NS_ASSERT (bucket < rung->nBuckets);
+          rung->buckets[bucket].push_back (ev);
+          rung->count++;
+          return;
+        }
+    }
+  InsertBottom (ev);
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      const_cast<LadderScheduler *> (this)->Refill ();
+    }
+  return m_bottom.back ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      Refill ();
+    }
+  Event next = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  return next;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_ASSERT (!IsEmpty ());
+  m_size--;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      if (!RemoveFrom (&m_top, ev))
+        {
+          NS_FATAL_ERROR ("Event " << ev.key.m_uid << " not found in Top");
+        }
+      return;
+    }
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung *rung = &m_rungs[i];
+      if (ts >= GetCurrentStart (*rung))
+        {
+          uint64_t bucket = (ts - rung->start) / rung->width;
+          if (!RemoveFrom (&rung->buckets[bucket], ev))
+            {
+              NS_FATAL_ERROR ("Event " << ev.key.m_uid << " not found in rung " << i);
+            }
+          rung->count--;
+          return;
+        }
+    }
+  BottomEvents::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, &IsLater);
+  NS_ASSERT (i != m_bottom.end () && i->impl == ev.impl);
+  m_bottom.erase (i);
+}
+
+// removes the cancelled events and keeps the order of the others.
+template <typename T>
+uint32_t
+LadderScheduler::Purge (T *events)
+{
+  typename T::iterator kept = events->begin ();
+  for (typename T::iterator i = events->begin (); i != events->end (); i++)
+    {
+      if (i->impl->IsCancelled ())
+        {
+          i->impl->Unref ();
+        }
+      else
+        {
+          *kept = *i;
+          kept++;
+        }
+    }
+  uint32_t purged = events->end () - kept;
+  events->erase (kept, events->end ());
+  return purged;
+}
+
+uint32_t
+LadderScheduler::Compact (void)
+{
+  uint32_t purged = Purge (&m_top) + Purge (&m_bottom);
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung *rung = &m_rungs[i];
+      for (uint32_t j = rung->current; j < rung->nBuckets; j++)
+        {
+          uint32_t n = Purge (&rung->buckets[j]);
+          rung->count -= n;
+          purged += n;
+        }
+    }
+  m_size -= purged;
+  return purged;
+}
+
+} // namespace ns3
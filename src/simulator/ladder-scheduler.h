@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This scheduler implements the ladder queue described in
+ * "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation", W. T. Tang, R. S. M. Goh and
+ * I. L.-J. Thng, ACM TOMACS, 2005.
+ *
+ * The events are split in three tiers:
+ *  - Top: an unsorted array which receives all the events scheduled
+ *    after the events already distributed in the ladder,
+ *  - Ladder: up to eight rungs of buckets. The first rung is created
+ *    from the content of Top, and an overflowing bucket is spawned
+ *    into a child rung with narrower buckets instead of being sorted,
+ *  - Bottom: a small sorted deque from which the next events are
+ *    removed. When the events inserted directly in Bottom make it
+ *    grow beyond the spawning threshold, its content is spilled into
+ *    a new rung, so that Bottom stays small and its sorted insertion
+ *    stays cheap. The events which share a single timestamp cannot
+ *    be spilled: a burst of events scheduled at the same time is
+ *    added to the far end of the deque in constant time instead.
+ *
+ * Unlike the calendar queues, the ladder adapts its bucket width to
+ * the distribution of the events when they are transferred from Top
+ * and never needs to resize itself, which gives amortized O(1)
+ * Insert and RemoveNext. Remove searches the single bucket which can
+ * contain the event.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+  virtual uint32_t Compact (void);
+
+private:
+  typedef std::vector<Event> Events;
+  typedef std::deque<Event> BottomEvents;
+  struct Rung
+  {
+    // the timestamp of the start of the first bucket
+    uint64_t start;
+    uint64_t width;
+    // the index of the first bucket which has not been consumed
+    uint32_t current;
+    uint32_t nBuckets;
+    uint32_t count;
+    std::vector<Events> buckets;
+  };
+
+  uint64_t GetCurrentStart (const Rung &rung) const;
+  void FillRung (Rung *rung, uint64_t start, uint64_t width, uint32_t nBuckets, Events *events);
+  void FillBottom (Events *events);
+  void InsertBottom (const Event &ev);
+  void SpillBottom (void);
+  bool RemoveFrom (Events *events, const Event &ev);
+  template <typename T>
+  uint32_t Purge (T *events);
+  void Refill (void);
+
+  Events m_top;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  uint64_t m_topStart;
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  BottomEvents m_bottom;
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
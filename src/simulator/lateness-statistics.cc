@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lateness-statistics.h"
+#include "ns3/assert.h"
+
+#include <string.h>
+#include <iomanip>
+
+namespace ns3 {
+
+LatenessStatistics::LatenessStatistics ()
+{
+  Reset ();
+}
+
+void
+LatenessStatistics::Reset (void)
+{
+  memset (m_buckets, 0, sizeof (m_buckets));
+  m_count = 0;
+  m_early = 0;
+  m_max = 0;
+  m_sum = 0;
+}
+
+// the values smaller than SUB_BUCKETS have a bucket each. A larger value
+// whose highest bit set is e goes in one of the SUB_BUCKETS buckets of
+// [2^e,2^(e+1)), selected by the SUB_BITS bits which follow the highest one.
+uint32_t
+LatenessStatistics::GetBucket (uint64_t ns)
+{
+  if (ns < SUB_BUCKETS)
+    {
+      return ns;
+    }
+  uint32_t e = 63 - __builtin_clzll (ns);
+  uint32_t sub = (ns >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+  return SUB_BUCKETS + (e - SUB_BITS) * SUB_BUCKETS + sub;
+}
+
+uint64_t
+LatenessStatistics::GetBucketLow (uint32_t bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    {
+      return bucket;
+    }
+  uint32_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+  uint64_t sub = bucket % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub) << shift;
+}
+
+uint64_t
+LatenessStatistics::GetBucketHigh (uint32_t bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    {
+      return bucket;
+    }
+  uint32_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+  return GetBucketLow (bucket) + (((uint64_t)1) << shift) - 1;
+}
+
+void
+LatenessStatistics::Record (int64_t ns)
+{
+  uint64_t lateness = 0;
+  if (ns < 0)
+    {
+      m_early++;
+    }
+  else
+    {
+      lateness = ns;
+    }
+  m_buckets[GetBucket (lateness)]++;
+  m_count++;
+  m_sum += lateness;
+  if (lateness > m_max)
+    {
+      m_max = lateness;
+    }
+}
+
+uint64_t
+LatenessStatistics::GetCount (void) const
+{
+  return m_count;
+}
+
+uint64_t
+LatenessStatistics::GetEarlyCount (void) const
+{
+  return m_early;
+}
+
+uint64_t
+LatenessStatistics::GetMax (void) const
+{
+  return m_max;
+}
+
+double
+LatenessStatistics::GetMean (void) const
+{
+  if (m_count == 0)
+    {
+      return 0;
+    }
+  return m_sum / m_count;
+}
+
+uint64_t
+LatenessStatistics::GetPercentile (double p) const
+{
+  NS_ASSERT (p >= 0 && p <= 100);
+  if (m_count == 0)
+    {
+      return 0;
+    }
+  // the rank of the requested sample, counted from 1.
+  uint64_t rank = (uint64_t)(p / 100 * m_count + 0.5);
+  if (rank == 0)
+    {
+      rank = 1;
+    }
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < N_BUCKETS; i++)
+    {
+      seen += m_buckets[i];
+      if (seen >= rank)
+        {
+          uint64_t high = GetBucketHigh (i);
+          return high < m_max ? high : m_max;
+        }
+    }
+  return m_max;
+}
+
+void
+LatenessStatistics::Print (std::ostream &os) const
+{
+  std::ios_base::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os << "lateness (ns): n=" << m_count << " early=" << m_early
+     << std::fixed << std::setprecision (0) << " mean=" << GetMean ()
+     << " p50=" << GetPercentile (50) << " p99=" << GetPercentile (99)
+     << " p99.9=" << GetPercentile (99.9) << " max=" << m_max << std::endl;
+  for (uint32_t i = 0; i < N_BUCKETS; i++)
+    {
+      if (m_buckets[i] == 0)
+        {
+          continue;
+        }
+      os << std::setw (12) << GetBucketLow (i) << " - " << std::setw (12) << GetBucketHigh (i)
+         << std::setw (12) << m_buckets[i] << std::endl;
+    }
+  os.flags (flags);
+  os.precision (precision);
+}
+
+} // namespace ns3
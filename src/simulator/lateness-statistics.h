@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LATENESS_STATISTICS_H
+#define LATENESS_STATISTICS_H
+
+#include <stdint.h>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief the distribution of the lateness of the events executed by
+ * a realtime simulator
+ *
+ * The lateness of an event is the difference between the wall-clock
+ * time at which it is executed and its timestamp, in nanoseconds.
+ * Events executed early are accounted with a zero lateness.
+ *
+ * The samples are accumulated in a log-linear histogram: each power
+ * of two is split in eight buckets, so the percentiles are reported
+ * with a relative error smaller than 12.5% while the memory used is
+ * constant.
+ */
+class LatenessStatistics
+{
+public:
+  LatenessStatistics ();
+
+  /**
+   * \param ns the lateness of an event, negative if it was early.
+   */
+  void Record (int64_t ns);
+  void Reset (void);
+
+  uint64_t GetCount (void) const;
+  /**
+   * \returns the number of events which were executed before their
+   *          timestamp.
+   */
+  uint64_t GetEarlyCount (void) const;
+  uint64_t GetMax (void) const;
+  double GetMean (void) const;
+  /**
+   * \param p a percentile, in [0,100]
+   * \returns the lateness below which p percent of the events were
+   *          executed: the upper bound of the bucket which contains
+   *          the requested percentile.
+   */
+  uint64_t GetPercentile (double p) const;
+
+  /**
+   * Print a summary line followed by one line per non-empty bucket.
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  enum {
+    SUB_BUCKETS = 8,
+    SUB_BITS = 3,
+    N_BUCKETS = SUB_BUCKETS + (64 - SUB_BITS) * SUB_BUCKETS
+  };
+  static uint32_t GetBucket (uint64_t ns);
+  static uint64_t GetBucketLow (uint32_t bucket);
+  static uint64_t GetBucketHigh (uint32_t bucket);
+
+  uint64_t m_buckets[N_BUCKETS];
+  uint64_t m_count;
+  uint64_t m_early;
+  uint64_t m_max;
+  double m_sum;
+};
+
+} // namespace ns3
+
+#endif /* LATENESS_STATISTICS_H */
@@ -83,6 +83,9 @@ EventImpl * MakeEvent (MEM mem_ptr, OBJ obj)
         m_function (function)
     {}
     virtual ~EventMemberImpl0 () {}
+    virtual const std::type_info &GetReceiverType (void) const {
+      return typeid (EventMemberImplObjTraits<OBJ>::GetReference (m_obj));
+    }
   private:
     virtual void Notify (void) { 
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function) (); 
@@ -108,6 +111,9 @@ EventImpl * MakeEvent (MEM mem_ptr, OBJ obj, T1 a1)
     {}
   protected:
     virtual ~EventMemberImpl1 () {}
+    virtual const std::type_info &GetReceiverType (void) const {
+      return typeid (EventMemberImplObjTraits<OBJ>::GetReference (m_obj));
+    }
   private:
     virtual void Notify (void) { 
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function) (m_a1);
@@ -134,6 +140,9 @@ EventImpl * MakeEvent (MEM mem_ptr, OBJ obj, T1 a1, T2 a2)
     { }
   protected:
     virtual ~EventMemberImpl2 () {}
+    virtual const std::type_info &GetReceiverType (void) const {
+      return typeid (EventMemberImplObjTraits<OBJ>::GetReference (m_obj));
+    }
   private:
     virtual void Notify (void) { 
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function) (m_a1, m_a2);
@@ -162,6 +171,9 @@ EventImpl * MakeEvent (MEM mem_ptr, OBJ obj, T1 a1, T2 a2, T3 a3)
     { }
   protected:
     virtual ~EventMemberImpl3 () {}
+    virtual const std::type_info &GetReceiverType (void) const {
+      return typeid (EventMemberImplObjTraits<OBJ>::GetReference (m_obj));
+    }
   private:
     virtual void Notify (void) { 
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function) (m_a1, m_a2, m_a3);
@@ -192,6 +204,9 @@ EventImpl * MakeEvent (MEM mem_ptr, OBJ obj, T1 a1, T2 a2, T3 a3, T4 a4)
     { }
   protected:
     virtual ~EventMemberImpl4 () {}
+    virtual const std::type_info &GetReceiverType (void) const {
+      return typeid (EventMemberImplObjTraits<OBJ>::GetReference (m_obj));
+    }
   private:
     virtual void Notify (void) { 
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function) (m_a1, m_a2, m_a3, m_a4);
@@ -225,6 +240,9 @@ EventImpl * MakeEvent (MEM mem_ptr, OBJ obj,
     { }
   protected:
     virtual ~EventMemberImpl5 () {}
+    virtual const std::type_info &GetReceiverType (void) const {
+      return typeid (EventMemberImplObjTraits<OBJ>::GetReference (m_obj));
+    }
   private:
     virtual void Notify (void) { 
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function) (m_a1, m_a2, m_a3, m_a4, m_a5);
@@ -0,0 +1,823 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "simulator.h"
+#include "multi-threaded-simulator-impl.h"
+#include "scheduler.h"
+#include "event-impl.h"
+
+#include "ns3/ptr.h"
+#include "ns3/assert.h"
+#include "ns3/fatal-error.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/config.h"
+#include "ns3/system-thread.h"
+#include <algorithm>
+#include <string>
+
+NS_LOG_COMPONENT_DEFINE ("MultiThreadedSimulatorImpl");
+
+namespace ns3 {
+
+/**
+ * The state of the event list of a set of contexts. Once Run is
+ * entered, a partition is only ever accessed by the thread which
+ * owns it, except for its inbox which is protected by m_inboxMutex.
+ */
+class MultiThreadedSimulatorImpl::Partition
+{
+public:
+  Ptr<Scheduler> m_events;
+  std::vector<Scheduler::Event> m_inbox;
+  SystemMutex m_inboxMutex;
+  uint32_t m_uid;
+  uint32_t m_currentUid;
+  uint64_t m_currentTs;
+  uint32_t m_currentContext;
+  int m_unscheduledEvents;
+};
+
+/**
+ * Used by the main thread to start all the worker threads on a new
+ * window and to wait until all of them have reached its end.
+ */
+class MultiThreadedSimulatorImpl::Barrier
+{
+public:
+  Barrier ();
+  ~Barrier ();
+  void Start (uint32_t n);
+  void WaitDone (void);
+  void WaitStart (uint64_t *generation);
+  void NotifyDone (void);
+private:
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_start;
+  pthread_cond_t m_done;
+  uint64_t m_generation;
+  uint32_t m_pending;
+};
+
+MultiThreadedSimulatorImpl::Barrier::Barrier ()
+  : m_generation (0),
+    m_pending (0)
+{
+  pthread_mutex_init (&m_mutex, 0);
+  pthread_cond_init (&m_start, 0);
+  pthread_cond_init (&m_done, 0);
+}
+MultiThreadedSimulatorImpl::Barrier::~Barrier ()
+{
+  pthread_cond_destroy (&m_done);
+  pthread_cond_destroy (&m_start);
+  pthread_mutex_destroy (&m_mutex);
+}
+void
+MultiThreadedSimulatorImpl::Barrier::Start (uint32_t n)
+{
+  pthread_mutex_lock (&m_mutex);
+  m_pending = n;
+  m_generation++;
+  pthread_cond_broadcast (&m_start);
+  pthread_mutex_unlock (&m_mutex);
+}
+void
+MultiThreadedSimulatorImpl::Barrier::WaitDone (void)
+{
+  pthread_mutex_lock (&m_mutex);
+  while (m_pending != 0)
+    {
+      pthread_cond_wait (&m_done, &m_mutex);
+    }
+  pthread_mutex_unlock (&m_mutex);
+}
+void
+MultiThreadedSimulatorImpl::Barrier::WaitStart (uint64_t *generation)
+{
+  pthread_mutex_lock (&m_mutex);
+  while (m_generation == *generation)
+    {
+      pthread_cond_wait (&m_start, &m_mutex);
+    }
+  *generation = m_generation;
+  pthread_mutex_unlock (&m_mutex);
+}
+void
+MultiThreadedSimulatorImpl::Barrier::NotifyDone (void)
+{
+  pthread_mutex_lock (&m_mutex);
+  NS_ASSERT (m_pending > 0);
+  m_pending--;
+  if (m_pending == 0)
+    {
+      pthread_cond_signal (&m_done);
+    }
+  pthread_mutex_unlock (&m_mutex);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (MultiThreadedSimulatorImpl);
+
+TypeId
+MultiThreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultiThreadedSimulatorImpl")
+    .SetParent<Object> ()
+    .AddConstructor<MultiThreadedSimulatorImpl> ()
+    .AddAttribute ("ThreadCount",
+                   "The number of threads (and event list partitions) used to run the simulation. "
+                   "It cannot be changed once an event has been executed.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&MultiThreadedSimulatorImpl::SetThreadCount,
+                                         &MultiThreadedSimulatorImpl::GetThreadCount),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Lookahead",
+                   "The minimum delay between an event and the events it schedules on other nodes. "
+                   "If zero, the smallest \"Delay\" attribute of the channels of the ChannelList is used.",
+                   TimeValue (Seconds (0.0)),
+                   MakeTimeAccessor (&MultiThreadedSimulatorImpl::m_lookahead),
+                   MakeTimeChecker ())
+    ;
+  return tid;
+}
+
+MultiThreadedSimulatorImpl::MultiThreadedSimulatorImpl ()
+  : m_global (0),
+    m_barrier (new Barrier ()),
+    m_threadCount (2),
+    m_nextWorker (0),
+    m_currentLookahead (0),
+    m_windowEnd (0),
+    m_parallel (false),
+    m_exit (false),
+    m_stop (false)
+{
+  NS_LOG_FUNCTION (this);
+  pthread_key_create (&m_current, 0);
+}
+
+MultiThreadedSimulatorImpl::~MultiThreadedSimulatorImpl ()
+{
+  pthread_key_delete (m_current);
+  delete m_barrier;
+}
+
+void
+MultiThreadedSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      while (!partition->m_events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->m_events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (std::vector<Scheduler::Event>::iterator j = partition->m_inbox.begin ();
+           j != partition->m_inbox.end (); ++j)
+        {
+          j->impl->Unref ();
+        }
+      delete partition;
+    }
+  m_partitions.clear ();
+  m_global = 0;
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultiThreadedSimulatorImpl::Destroy ()
+{
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultiThreadedSimulatorImpl::CreatePartitions (void)
+{
+  NS_ASSERT (m_partitions.empty ());
+  // partitions 0 to m_threadCount-1 hold the per-node events and the
+  // last one holds the global events.
+  for (uint32_t i = 0; i < m_threadCount + 1; i++)
+    {
+      Partition *partition = new Partition ();
+      partition->m_events = m_schedulerFactory.Create<Scheduler> ();
+      // uids are allocated from 4 and interleaved between partitions
+      // to keep them unique.
+      // uid 0 is "invalid" events
+      // uid 1 is "now" events
+      // uid 2 is "destroy" events
+      partition->m_uid = 4 + i;
+      // before ::Run is entered, the m_currentUid will be zero
+      partition->m_currentUid = 0;
+      partition->m_currentTs = 0;
+      partition->m_currentContext = 0xffffffff;
+      partition->m_unscheduledEvents = 0;
+      m_partitions.push_back (partition);
+    }
+  m_global = m_partitions.back ();
+}
+
+void
+MultiThreadedSimulatorImpl::SetThreadCount (uint32_t threadCount)
+{
+  NS_LOG_FUNCTION (this << threadCount);
+  if (m_partitions.empty () || threadCount == m_threadCount)
+    {
+      m_threadCount = threadCount;
+      return;
+    }
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      if ((*i)->m_currentUid != 0)
+        {
+          NS_FATAL_ERROR ("ns3::MultiThreadedSimulatorImpl::ThreadCount cannot be changed "
+                          "once the simulation has started.");
+        }
+    }
+  // No event was executed yet: the pending events are moved to the
+  // partitions which own their context with the new thread count and
+  // the new partitions allocate their uids after all the uids already
+  // allocated.
+  std::vector<Partition *> partitions;
+  partitions.swap (m_partitions);
+  uint32_t uid = 0;
+  for (std::vector<Partition *>::const_iterator i = partitions.begin (); i != partitions.end (); ++i)
+    {
+      uid = std::max (uid, (*i)->m_uid);
+    }
+  m_threadCount = threadCount;
+  CreatePartitions ();
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      m_partitions[i]->m_uid = uid + i;
+    }
+  for (std::vector<Partition *>::iterator i = partitions.begin (); i != partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      NS_ASSERT (partition->m_inbox.empty ());
+      while (!partition->m_events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->m_events->RemoveNext ();
+          Partition *owner = GetPartition (next.key.m_context);
+          owner->m_events->Insert (next);
+          owner->m_unscheduledEvents++;
+        }
+      delete partition;
+    }
+}
+
+uint32_t
+MultiThreadedSimulatorImpl::GetThreadCount (void) const
+{
+  return m_threadCount;
+}
+
+void
+MultiThreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  m_schedulerFactory = schedulerFactory;
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+      return;
+    }
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      while (!partition->m_events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->m_events->RemoveNext ();
+          scheduler->Insert (next);
+        }
+      partition->m_events = scheduler;
+    }
+}
+
+MultiThreadedSimulatorImpl::Partition *
+MultiThreadedSimulatorImpl::GetCurrentPartition (void) const
+{
+  Partition *partition = static_cast<Partition *> (pthread_getspecific (m_current));
+  if (partition == 0)
+    {
+      // the main thread, outside of a window.
+      return m_global;
+    }
+  return partition;
+}
+
+MultiThreadedSimulatorImpl::Partition *
+MultiThreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context == 0xffffffff)
+    {
+      return m_global;
+    }
+  return m_partitions[context % m_threadCount];
+}
+
+void
+MultiThreadedSimulatorImpl::Insert (Partition *partition, const Scheduler::Event &ev)
+{
+  if (!m_parallel || partition == GetCurrentPartition ())
+    {
+      partition->m_events->Insert (ev);
+      partition->m_unscheduledEvents++;
+      return;
+    }
+  // The owner of the target partition is running concurrently: the
+  // event will be merged in its event list at the end of the window.
+  if (ev.key.m_ts < m_windowEnd)
+    {
+      NS_FATAL_ERROR ("Event scheduled for context " << ev.key.m_context <<
+                      " at " << ev.key.m_ts << " before the end of the current window (" <<
+                      m_windowEnd << "): the lookahead is too large.");
+    }
+  CriticalSection cs (partition->m_inboxMutex);
+  partition->m_inbox.push_back (ev);
+}
+
+void
+MultiThreadedSimulatorImpl::DrainInboxes (void)
+{
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      for (std::vector<Scheduler::Event>::const_iterator j = partition->m_inbox.begin ();
+           j != partition->m_inbox.end (); ++j)
+        {
+          partition->m_events->Insert (*j);
+          partition->m_unscheduledEvents++;
+        }
+      partition->m_inbox.clear ();
+    }
+}
+
+void
+MultiThreadedSimulatorImpl::ProcessOneEvent (Partition *partition)
+{
+  Scheduler::Event next = partition->m_events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->m_currentTs);
+  partition->m_unscheduledEvents--;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  partition->m_currentTs = next.key.m_ts;
+  partition->m_currentContext = next.key.m_context;
+  partition->m_currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+void
+MultiThreadedSimulatorImpl::ProcessWindow (Partition *partition)
+{
+  // m_stop is only checked by Run, between two windows, so that all
+  // partitions stop at the same time.
+  while (!partition->m_events->IsEmpty () &&
+         partition->m_events->PeekNext ().key.m_ts < m_windowEnd)
+    {
+      ProcessOneEvent (partition);
+    }
+}
+
+void
+MultiThreadedSimulatorImpl::Worker (void)
+{
+  Partition *partition;
+  {
+    CriticalSection cs (m_mutex);
+    partition = m_partitions[m_nextWorker];
+    m_nextWorker++;
+  }
+  pthread_setspecific (m_current, partition);
+  uint64_t generation = 0;
+  while (true)
+    {
+      m_barrier->WaitStart (&generation);
+      if (m_exit)
+        {
+          break;
+        }
+      ProcessWindow (partition);
+      m_barrier->NotifyDone ();
+    }
+}
+
+bool
+MultiThreadedSimulatorImpl::NextTs (uint64_t *ts) const
+{
+  bool found = false;
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      if (partition->m_events->IsEmpty ())
+        {
+          continue;
+        }
+      uint64_t next = partition->m_events->PeekNext ().key.m_ts;
+      if (!found || next < *ts)
+        {
+          *ts = next;
+          found = true;
+        }
+    }
+  return found;
+}
+
+bool
+MultiThreadedSimulatorImpl::IsFinished (void) const
+{
+  uint64_t ts;
+  return !NextTs (&ts) || m_stop;
+}
+
+Time
+MultiThreadedSimulatorImpl::Next (void) const
+{
+  uint64_t ts = 0;
+  bool found = NextTs (&ts);
+  NS_ASSERT (found);
+  return TimeStep (ts);
+}
+
+uint64_t
+MultiThreadedSimulatorImpl::ComputeLookahead (void) const
+{
+  Config::MatchContainer channels = Config::LookupMatches ("/ChannelList/*");
+  for (uint32_t i = 0; i < channels.GetN (); i++)
+    {
+      // these channels share their state (the carrier of a CsmaChannel,
+      // the packet sent by a YansWifiChannel) between all the nodes
+      // attached to them, which can belong to different partitions.
+      std::string name = channels.Get (i)->GetInstanceTypeId ().GetName ();
+      if (name == "ns3::CsmaChannel" || name == "ns3::YansWifiChannel")
+        {
+          NS_FATAL_ERROR ("Channel " << name << " cannot be used with ns3::MultiThreadedSimulatorImpl.");
+        }
+    }
+  if (!m_lookahead.IsZero ())
+    {
+      return m_lookahead.GetTimeStep ();
+    }
+  if (channels.GetN () == 0)
+    {
+      NS_FATAL_ERROR ("No channel to derive a lookahead from: set ns3::MultiThreadedSimulatorImpl::Lookahead.");
+    }
+  uint64_t lookahead = 0;
+  for (uint32_t i = 0; i < channels.GetN (); i++)
+    {
+      Ptr<Object> channel = channels.Get (i);
+      TimeValue delay;
+      if (!channel->GetAttributeFailSafe ("Delay", delay))
+        {
+          NS_FATAL_ERROR ("Channel " << channel->GetInstanceTypeId ().GetName () <<
+                          " has no \"Delay\" attribute: set ns3::MultiThreadedSimulatorImpl::Lookahead.");
+        }
+      uint64_t ts = delay.Get ().GetTimeStep ();
+      if (i == 0 || ts < lookahead)
+        {
+          lookahead = ts;
+        }
+    }
+  if (lookahead == 0)
+    {
+      NS_FATAL_ERROR ("A channel has a zero delay: the simulation cannot be parallelized.");
+    }
+  return lookahead;
+}
+
+Time
+MultiThreadedSimulatorImpl::GetLookahead (void) const
+{
+  return TimeStep (m_currentLookahead);
+}
+
+void
+MultiThreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_stop = false;
+  m_currentLookahead = ComputeLookahead ();
+  NS_LOG_LOGIC ("lookahead=" << m_currentLookahead);
+
+  // The main thread runs the first partition, the other ones get
+  // their own thread.
+  std::vector<Ptr<SystemThread> > threads;
+  m_exit = false;
+  m_nextWorker = 1;
+  for (uint32_t i = 1; i < m_threadCount; i++)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&MultiThreadedSimulatorImpl::Worker, this));
+      thread->Start ();
+      threads.push_back (thread);
+    }
+
+  uint64_t next;
+  while (!m_stop && NextTs (&next))
+    {
+      if (!m_global->m_events->IsEmpty () &&
+          m_global->m_events->PeekNext ().key.m_ts == next)
+        {
+          // global events are executed alone.
+          ProcessOneEvent (m_global);
+          continue;
+        }
+      m_windowEnd = next + m_currentLookahead;
+      if (m_windowEnd < next)
+        {
+          m_windowEnd = 0xffffffffffffffffULL;
+        }
+      if (!m_global->m_events->IsEmpty () &&
+          m_global->m_events->PeekNext ().key.m_ts < m_windowEnd)
+        {
+          m_windowEnd = m_global->m_events->PeekNext ().key.m_ts;
+        }
+      m_parallel = true;
+      m_barrier->Start (m_threadCount - 1);
+      pthread_setspecific (m_current, m_partitions[0]);
+      ProcessWindow (m_partitions[0]);
+      pthread_setspecific (m_current, 0);
+      m_barrier->WaitDone ();
+      m_parallel = false;
+      DrainInboxes ();
+    }
+
+  m_exit = true;
+  m_barrier->Start (m_threadCount - 1);
+  for (std::vector<Ptr<SystemThread> >::iterator i = threads.begin (); i != threads.end (); ++i)
+    {
+      (*i)->Join ();
+    }
+
+  // From now on, the main thread sees the time of the last event
+  // executed in any partition.
+  int unscheduledEvents = 0;
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      if (partition->m_currentTs > m_global->m_currentTs)
+        {
+          m_global->m_currentTs = partition->m_currentTs;
+          m_global->m_currentUid = partition->m_currentUid;
+        }
+      unscheduledEvents += partition->m_unscheduledEvents;
+    }
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  NS_ASSERT (m_stop || unscheduledEvents == 0);
+}
+
+void
+MultiThreadedSimulatorImpl::RunOneEvent (void)
+{
+  uint64_t next;
+  if (!NextTs (&next))
+    {
+      return;
+    }
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      if (!partition->m_events->IsEmpty () &&
+          partition->m_events->PeekNext ().key.m_ts == next)
+        {
+          pthread_setspecific (m_current, partition == m_global ? 0 : partition);
+          ProcessOneEvent (partition);
+          pthread_setspecific (m_current, 0);
+          if (partition->m_currentTs > m_global->m_currentTs)
+            {
+              m_global->m_currentTs = partition->m_currentTs;
+            }
+          return;
+        }
+    }
+}
+
+void
+MultiThreadedSimulatorImpl::Stop (void)
+{
+  m_stop = true;
+}
+
+void
+MultiThreadedSimulatorImpl::Stop (Time const &time)
+{
+  Simulator::Schedule (time, &Simulator::Stop);
+}
+
+EventId
+MultiThreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  Partition *partition = GetCurrentPartition ();
+  Time tAbsolute = time + TimeStep (partition->m_currentTs);
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= TimeStep (partition->m_currentTs));
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.key.m_context = partition->m_currentContext;
+  ev.key.m_uid = partition->m_uid;
+  partition->m_uid += m_threadCount + 1;
+  partition->m_events->Insert (ev);
+  partition->m_unscheduledEvents++;
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+MultiThreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+
+  Partition *partition = GetCurrentPartition ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = partition->m_currentTs + time.GetTimeStep ();
+  ev.key.m_context = context;
+  ev.key.m_uid = partition->m_uid;
+  partition->m_uid += m_threadCount + 1;
+  Insert (GetPartition (context), ev);
+}
+
+EventId
+MultiThreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  Partition *partition = GetCurrentPartition ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = partition->m_currentTs;
+  ev.key.m_context = partition->m_currentContext;
+  ev.key.m_uid = partition->m_uid;
+  partition->m_uid += m_threadCount + 1;
+  partition->m_events->Insert (ev);
+  partition->m_unscheduledEvents++;
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+EventId
+MultiThreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), GetCurrentPartition ()->m_currentTs, 0xffffffff, 2);
+  CriticalSection cs (m_mutex);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+MultiThreadedSimulatorImpl::Now (void) const
+{
+  return TimeStep (GetCurrentPartition ()->m_currentTs);
+}
+
+Time
+MultiThreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - GetCurrentPartition ()->m_currentTs);
+    }
+}
+
+void
+MultiThreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_mutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+         }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Partition *partition = GetPartition (id.GetContext ());
+  if (m_parallel && partition != GetCurrentPartition ())
+    {
+      // the event list of this partition is owned by another thread
+      // so, we just cancel the event.
+      id.PeekEventImpl ()->Cancel ();
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  partition->m_events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+
+  partition->m_unscheduledEvents--;
+}
+
+void
+MultiThreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultiThreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0 ||
+          ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (m_mutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+         }
+      return true;
+    }
+  Partition *partition = GetPartition (ev.GetContext ());
+  if (m_parallel && partition != m_global && partition != GetCurrentPartition () &&
+      ev.PeekEventImpl () != 0)
+    {
+      // The owner of this partition is running concurrently: only
+      // the events after the end of the current window are known not
+      // to have been executed yet.
+      if (ev.GetTs () < m_windowEnd)
+        {
+          NS_FATAL_ERROR ("Event " << ev.GetUid () << " of context " << ev.GetContext () <<
+                          " checked from context " << GetContext () << " before the end of the current window.");
+        }
+      return ev.PeekEventImpl ()->IsCancelled ();
+    }
+  if (ev.PeekEventImpl () == 0 ||
+      ev.GetTs () < partition->m_currentTs ||
+      (ev.GetTs () == partition->m_currentTs &&
+       ev.GetUid () <= partition->m_currentUid) ||
+      ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+MultiThreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  // XXX: I am fairly certain other compilers use other non-standard
+  // post-fixes to indicate 64 bit constants.
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultiThreadedSimulatorImpl::GetContext (void) const
+{
+  return GetCurrentPartition ()->m_currentContext;
+}
+
+} // namespace ns3
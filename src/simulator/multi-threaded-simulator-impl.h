@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTI_THREADED_SIMULATOR_IMPL_H
+#define MULTI_THREADED_SIMULATOR_IMPL_H
+
+#include "simulator-impl.h"
+#include "scheduler.h"
+#include "event-impl.h"
+
+#include "ns3/ptr.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-mutex.h"
+
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief a conservative parallel simulator for shared-memory machines
+ *
+ * Events are partitioned according to their context (that is, the
+ * id of the node they are executed on): the events of context c
+ * are owned by partition c % ThreadCount and each partition keeps
+ * its own event list, built from the scheduler selected with the
+ * SchedulerType global value. Events which are not bound to any
+ * node (context 0xffffffff, typically scheduled from main before
+ * Simulator::Run) are kept in a separate global event list.
+ *
+ * The simulation proceeds by windows: if T is the timestamp of the
+ * earliest pending event, all partitions process concurrently, each
+ * in its own thread, their events within [T, T + lookahead). An event
+ * scheduled for another partition is delivered to the inbox of its
+ * owner and merged into the owner's event list at the end of the
+ * window. Global events are executed alone, between two windows.
+ *
+ * The lookahead is the minimum delay between an event executed on
+ * one node and an event it schedules with Simulator::ScheduleWithContext
+ * on another node. By default, it is derived at the start of
+ * Simulator::Run from the "Delay" attribute of every channel in
+ * the ChannelList, which covers PointToPointChannel. Topologies
+ * which include other channels must set the "Lookahead" attribute
+ * explicitly.
+ *
+ * Models executed by this simulator must be safe to run concurrently
+ * for different nodes: shared mutable state (a global random stream,
+ * a shared statistics object) must be protected by the model itself.
+ * The packet infrastructure is: the copies of a packet share their
+ * bytes, metadata and tags with atomic reference counts and the free
+ * lists are kept per thread. A Packet object itself must not be used
+ * by two nodes of different partitions at the same time: it must
+ * be handed over to the receiver, as PointToPointChannel does, or
+ * copied. The channels which share their state between all their
+ * nodes, CsmaChannel and YansWifiChannel, are not supported: Run
+ * fails if the ChannelList contains one of them.
+ *
+ * During a window, a partition cannot see the progress of the other
+ * ones: Simulator::IsExpired and Simulator::Cancel can only be used
+ * on an event of another partition if it is scheduled after the end
+ * of the window, which is always the case for the events scheduled
+ * with Simulator::ScheduleWithContext. Simulator::Stop is honored by
+ * all the partitions at the end of the current window.
+ *
+ * ThreadCount can be changed until the first event is executed: the
+ * pending events are then moved to their new partition.
+ */
+class MultiThreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultiThreadedSimulatorImpl ();
+  ~MultiThreadedSimulatorImpl ();
+
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual Time Next (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual void RunOneEvent (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \returns the lookahead used by the last call to Run.
+   */
+  Time GetLookahead (void) const;
+
+private:
+  class Partition;
+  class Barrier;
+  typedef std::list<EventId> DestroyEvents;
+
+  virtual void DoDispose (void);
+  void CreatePartitions (void);
+  void SetThreadCount (uint32_t threadCount);
+  uint32_t GetThreadCount (void) const;
+  Partition *GetCurrentPartition (void) const;
+  Partition *GetPartition (uint32_t context) const;
+  void Insert (Partition *partition, const Scheduler::Event &ev);
+  void ProcessOneEvent (Partition *partition);
+  void ProcessWindow (Partition *partition);
+  void DrainInboxes (void);
+  bool NextTs (uint64_t *ts) const;
+  uint64_t ComputeLookahead (void) const;
+  void Worker (void);
+
+  DestroyEvents m_destroyEvents;
+  mutable SystemMutex m_mutex;
+  ObjectFactory m_schedulerFactory;
+  std::vector<Partition *> m_partitions;
+  Partition *m_global;
+  Barrier *m_barrier;
+  // the partition executed by the calling thread
+  pthread_key_t m_current;
+  uint32_t m_threadCount;
+  uint32_t m_nextWorker;
+  Time m_lookahead;
+  uint64_t m_currentLookahead;
+  uint64_t m_windowEnd;
+  bool m_parallel;
+  bool m_exit;
+  volatile bool m_stop;
+};
+
+} // namespace ns3
+
+#endif /* MULTI_THREADED_SIMULATOR_IMPL_H */
@@ -27,7 +27,6 @@
 #include <math.h>
 #include <ostream>
 #include "high-precision.h"
-#include "cairo-wideint-private.h"
 
 namespace ns3 {
 
@@ -402,7 +401,9 @@ public:
    * \returns an approximation of the time stored in this
    *          instance in the units specified in m_tsPrecision.
    */
-  int64_t GetTimeStep (void) const;
+  int64_t GetTimeStep (void) const {
+    return m_data.GetInteger ();
+  }
 
   // -*- The rest is the the same as in the generic template class -*-
 public:
@@ -595,8 +596,13 @@ Time PicoSeconds (uint64_t ps);
  */
 Time FemtoSeconds (uint64_t fs);
 
-// internal function not publicly documented
-Time TimeStep (uint64_t ts);
+// internal function not publicly documented: the timestep value
+// passed to this function must be of the precision of
+// TimeStepPrecision::Get
+inline Time TimeStep (uint64_t ts)
+{
+  return Time (HighPrecision (ts, false));
+}
 
 // Explicit instatiation of the TimeUnit template for N=0, with a few
 // additional methods that should not be available for N != 0
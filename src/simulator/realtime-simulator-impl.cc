@@ -28,7 +28,6 @@
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
-#include "ns3/system-mutex.h"
 #include "ns3/boolean.h"
 #include "ns3/enum.h"
 
@@ -79,6 +78,7 @@ RealtimeSimulatorImpl::RealtimeSimulatorImpl ()
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
+  m_injected = 0;
 
   // Be very careful not to do anything that would cause a change or assignment
   // of the underlying reference counts of m_synchronizer or you will be sorry.
@@ -92,6 +92,7 @@ void
 RealtimeSimulatorImpl::DoDispose (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  ProcessInjected ();
   while (m_events->IsEmpty () == false)
     {
       Scheduler::Event next = m_events->RemoveNext ();
@@ -106,6 +107,8 @@ void
 RealtimeSimulatorImpl::Destroy ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  NS_LOG_INFO ("lateness: n=" << m_lateness.GetCount () << " p99=" << m_lateness.GetPercentile (99)
+               << "ns max=" << m_lateness.GetMax () << "ns");
 
   //
   // This function is only called with the private version "disconnected" from
@@ -134,19 +137,90 @@ RealtimeSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
 
   Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
 
-  { 
-    CriticalSection cs (m_mutex);
+  if (m_events != 0)
+    {
+      while (m_events->IsEmpty () == false)
+        {
+          Scheduler::Event next = m_events->RemoveNext ();
+          scheduler->Insert (next);
+        }
+    }
+  m_events = scheduler;
+}
 
-    if (m_events != 0)
-      {
-        while (m_events->IsEmpty () == false)
-          {
-            Scheduler::Event next = m_events->RemoveNext ();
-            scheduler->Insert (next);
-          }
-      }
-    m_events = scheduler;
-  }
+//
+// Push an event on the stack of injected events.  This can be called from any
+// thread: the compare-and-swap loop only retries if another thread pushed an
+// event concurrently.  The simulation thread is woken up only by the first
+// event pushed on an empty stack since it always takes the whole stack at once.
+//
+void
+RealtimeSimulatorImpl::Inject (uint64_t ts, uint32_t context, EventImpl *impl)
+{
+  InjectedEvent *injected = new InjectedEvent;
+  injected->impl = impl;
+  injected->ts = ts;
+  injected->context = context;
+  InjectedEvent *head;
+  do
+    {
+      head = m_injected;
+      injected->next = head;
+    }
+  while (!__sync_bool_compare_and_swap (&m_injected, head, injected));
+
+  if (head == 0)
+    {
+      m_synchronizer->Signal ();
+    }
+}
+
+//
+// Move the injected events to the event list.  Must be called from the
+// simulation thread.
+//
+void
+RealtimeSimulatorImpl::ProcessInjected (void)
+{
+  if (m_injected == 0)
+    {
+      return;
+    }
+  InjectedEvent *injected = __sync_lock_test_and_set (&m_injected, (InjectedEvent *)0);
+
+  //
+  // The stack holds the most recent event first: reverse it so that the events
+  // injected at the same time get their uids in the order they were injected.
+  //
+  InjectedEvent *ordered = 0;
+  while (injected != 0)
+    {
+      InjectedEvent *next = injected->next;
+      injected->next = ordered;
+      ordered = injected;
+      injected = next;
+    }
+
+  while (ordered != 0)
+    {
+      InjectedEvent *next = ordered->next;
+      //
+      // The timestamp was read from the wall clock by the injecting thread and
+      // the simulation might have executed a later event since then: time must
+      // not move backward.
+      //
+      Scheduler::Event ev;
+      ev.impl = ordered->impl;
+      ev.key.m_ts = ordered->ts < m_currentTs ? m_currentTs : ordered->ts;
+      ev.key.m_context = ordered->context;
+      ev.key.m_uid = m_uid;
+      m_uid++;
+      m_unscheduledEvents++;
+      m_events->Insert (ev);
+      NS_LOG_LOGIC ("inject " << ev.key.m_ts);
+      delete ordered;
+      ordered = next;
+    }
 }
 
 void
@@ -192,8 +266,15 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
       //
       uint64_t tsNow;
 
-      { 
-        CriticalSection cs (m_mutex);
+      {
+        //
+        // The synchronizer is reset first so that any event injected after the
+        // injected events are processed below will interrupt the wait: the
+        // foreign threads signal the synchronizer after they push their event.
+        //
+        m_synchronizer->SetCondition (false);
+        ProcessInjected ();
+
         //
         // Since we are in realtime mode, the time to delay has got to be the 
         // difference between the current realtime and the timestamp of the next 
@@ -234,31 +315,21 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
           {
             tsDelay = tsNext - tsNow;
           }
-      
-        //
-        // We've figured out how long we need to delay in order to pace the 
-        // simulation time with the real time.  We're going to sleep, but need
-        // to work with the synchronizer to make sure we're awakened if something 
-        // external happens (like a packet is received).  This next line resets
-        // the synchronizer so that any future event will cause it to interrupt.
-        //
-        m_synchronizer->SetCondition (false);
       }
 
       //
       // We have a time to delay.  This time may actually not be valid anymore
-      // since we released the critical section immediately above, and a real-time
-      // ScheduleReal or ScheduleRealNow may have snuck in, well, between the 
-      // closing brace above and this comment so to speak.  If this is the case, 
-      // that schedule operation will have done a synchronizer Signal() that 
-      // will set the condition variable to true and cause the Synchronize call 
+      // since a real-time ScheduleReal or ScheduleRealNow may have snuck in, well,
+      // between the closing brace above and this comment so to speak.  If this is
+      // the case, that schedule operation will have done a synchronizer Signal()
+      // that will set the condition variable to true and cause the Synchronize call
       // below to return immediately.
       //
       // It's easiest to understand if you just consider a short tsDelay that only
       // requires a SpinWait down in the synchronizer.  What will happen is that 
       // whan Synchronize calls SpinWait, SpinWait will look directly at its 
       // condition variable.  Note that we set this condition variable to false 
-      // inside the critical section above. 
+      // above, before we looked at the injected events.
       //
       // SpinWait will go into a forever loop until either the time has expired or
       // until the condition variable becomes true.  A true condition indicates that
@@ -296,21 +367,19 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
   //
   // If we break out of the for-loop above, we have waited until the time specified
   // by the event that was at the head of the event list when we started the process.
-  // Since there is a bunch of code that was executed outside a critical section (the
-  // Synchronize call) we cannot be sure that the event at the head of the event list
-  // is the one we think it is.  What we can be sure of is that it is time to execute
-  // whatever event is at the head of this list if the list is in time order.
+  // An event might have been injected while Synchronize timed out, so we cannot be
+  // sure that the event at the head of the event list is the one we think it is.
+  // What we can be sure of is that it is time to execute whatever event is at the
+  // head of this list if the list is in time order.
   //
   Scheduler::Event next;
 
-  { 
-    CriticalSection cs (m_mutex);
+  {
+    ProcessInjected ();
 
     // 
     // We do know we're waiting for an event, so there had better be an event on the 
-    // event queue.  Let's pull it off.  When we release the critical section, the
-    // event we're working on won't be on the list and so subsequent operations won't
-    // mess with us.
+    // event queue.  Let's pull it off.
     //
     NS_ASSERT_MSG (m_events->IsEmpty () == false, 
       "RealtimeSimulatorImpl::ProcessOneEvent(): event queue is empty");
@@ -338,16 +407,18 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
 
     // 
     // We're about to run the event and we've done our best to synchronize this
-    // event execution time to real time.  Now, if we're in SYNC_HARD_LIMIT mode
-    // we have to decide if we've done a good enough job and if we haven't, we've
-    // been asked to commit ritual suicide.
+    // event execution time to real time.  We account how well we did and, if
+    // we're in SYNC_HARD_LIMIT mode, we have to decide if we've done a good
+    // enough job and if we haven't, we've been asked to commit ritual suicide.
     //
     // We check the simulation time against the current real time to make this
     // judgement.
     //
+    uint64_t tsFinal = m_synchronizer->GetCurrentRealtime ();
+    m_lateness.Record ((int64_t)(tsFinal - m_currentTs));
+
     if (m_synchronizationMode == SYNC_HARD_LIMIT)
       {
-        uint64_t tsFinal = m_synchronizer->GetCurrentRealtime ();
         uint64_t tsJitter;
 
         if (tsFinal >= m_currentTs)
@@ -383,17 +454,12 @@ bool
 RealtimeSimulatorImpl::IsFinished (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
-  bool rc;
-  {
-    CriticalSection cs (m_mutex);
-    rc = m_events->IsEmpty () || m_stop;
-  }
-
-  return rc;
+  const_cast<RealtimeSimulatorImpl *> (this)->ProcessInjected ();
+  return m_events->IsEmpty () || m_stop;
 }
 
 //
-// Peeks into event list.  Should be called with critical section locked.
+// Peeks into event list.  Should be called from the simulation thread.
 //
 uint64_t
 RealtimeSimulatorImpl::NextTs (void) const
@@ -406,12 +472,13 @@ RealtimeSimulatorImpl::NextTs (void) const
 }
 
 //
-// Calls NextTs().  Should be called with critical section locked.
+// Calls NextTs().  Should be called from the simulation thread.
 //
 Time
 RealtimeSimulatorImpl::Next (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
+  const_cast<RealtimeSimulatorImpl *> (this)->ProcessInjected ();
   return TimeStep (NextTs ());
 }
 
@@ -432,7 +499,7 @@ RealtimeSimulatorImpl::Run (void)
       bool done = false;
 
       {
-        CriticalSection cs (m_mutex);
+        ProcessInjected ();
         //
         // In all cases we stop when the event list is empty.  If you are doing a 
         // realtime simulation and you want it to extend out for some time, you must
@@ -458,8 +525,6 @@ RealtimeSimulatorImpl::Run (void)
   // consistency test to check that we didn't lose any events along the way.
   //
   {
-    CriticalSection cs (m_mutex);
-
     NS_ASSERT_MSG (m_events->IsEmpty () == false || m_unscheduledEvents == 0,
       "RealtimeSimulatorImpl::Run(): Empty queue and unprocessed events");
   }
@@ -503,12 +568,8 @@ RealtimeSimulatorImpl::RunOneEvent (void)
 
   EventImpl *event = 0;
 
-  //
-  // Run this in a critical section in case there's another thread around that
-  // may be inserting things onto the event list.
-  //
   {
-    CriticalSection cs (m_mutex);
+    ProcessInjected ();
 
     Scheduler::Event next = m_events->RemoveNext ();
 
@@ -548,13 +609,6 @@ RealtimeSimulatorImpl::Schedule (Time const &time, EventImpl *impl)
 
   Scheduler::Event ev;
   {
-    CriticalSection cs (m_mutex);
-    //
-    // This is the reason we had to bring the absolute time calcualtion in from the
-    // simulator.h into the implementation.  Since the implementations may be 
-    // multi-threaded, we need this calculation to be atomic.  You can see it is
-    // here since we are running in a CriticalSection.
-    //
     Time tAbsolute = Simulator::Now () + time;
     NS_ASSERT_MSG (tAbsolute.IsPositive (), "RealtimeSimulatorImpl::Schedule(): Negative time");
     NS_ASSERT_MSG (tAbsolute >= TimeStep (m_currentTs), "RealtimeSimulatorImpl::Schedule(): time < m_currentTs");
@@ -565,7 +619,6 @@ RealtimeSimulatorImpl::Schedule (Time const &time, EventImpl *impl)
     m_uid++;
     m_unscheduledEvents++;
     m_events->Insert (ev);
-    m_synchronizer->Signal ();
   }
 
   return EventId (impl, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
@@ -577,7 +630,6 @@ RealtimeSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time,
   NS_LOG_FUNCTION (time << impl);
 
   {
-    CriticalSection cs (m_mutex);
     uint64_t ts;
 
     ts = m_currentTs + time.GetTimeStep ();
@@ -590,7 +642,6 @@ RealtimeSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time,
     m_uid++;
     m_unscheduledEvents++;
     m_events->Insert (ev);
-    m_synchronizer->Signal ();
   }
 }
 
@@ -600,8 +651,6 @@ RealtimeSimulatorImpl::ScheduleNow (EventImpl *impl)
   NS_LOG_FUNCTION_NOARGS ();
   Scheduler::Event ev;
   {
-    CriticalSection cs (m_mutex);
-
     ev.impl = impl;
     ev.key.m_ts = m_currentTs;
     ev.key.m_context = GetContext ();
@@ -609,7 +658,6 @@ RealtimeSimulatorImpl::ScheduleNow (EventImpl *impl)
     m_uid++;
     m_unscheduledEvents++;
     m_events->Insert (ev);
-    m_synchronizer->Signal ();
   }
 
   return EventId (impl, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
@@ -628,21 +676,9 @@ void
 RealtimeSimulatorImpl::ScheduleRealtimeWithContext (uint32_t context, Time const &time, EventImpl *impl)
 {
   NS_LOG_FUNCTION (context << time << impl);
-  
-  {
-    CriticalSection cs (m_mutex);
 
-    uint64_t ts = m_synchronizer->GetCurrentRealtime () + time.GetTimeStep ();
-    NS_ASSERT_MSG (ts >= m_currentTs, "RealtimeSimulatorImpl::ScheduleRealtime(): schedule for time < m_currentTs");
-    Scheduler::Event ev;
-    ev.impl = impl;
-    ev.key.m_ts = ts;
-    ev.key.m_uid = m_uid;
-    m_uid++;
-    m_unscheduledEvents++;
-    m_events->Insert (ev);
-    m_synchronizer->Signal ();
-  }
+  uint64_t ts = m_synchronizer->GetCurrentRealtime () + time.GetTimeStep ();
+  Inject (ts, context, impl);
 }
 
 void
@@ -656,26 +692,14 @@ void
 RealtimeSimulatorImpl::ScheduleRealtimeNowWithContext (uint32_t context, EventImpl *impl)
 {
   NS_LOG_FUNCTION (context << impl);
-  {
-    CriticalSection cs (m_mutex);
 
-    //
-    // If the simulator is running, we're pacing and have a meaningful 
-    // realtime clock.  If we're not, then m_currentTs is were we stopped.
-    // 
-    uint64_t ts = m_running ? m_synchronizer->GetCurrentRealtime () : m_currentTs;
-    NS_ASSERT_MSG (ts >= m_currentTs, 
-                   "RealtimeSimulatorImpl::ScheduleRealtimeNowWithContext(): schedule for time < m_currentTs");
-    Scheduler::Event ev;
-    ev.impl = impl;
-    ev.key.m_ts = ts;
-    ev.key.m_uid = m_uid;
-    ev.key.m_context = context;
-    m_uid++;
-    m_unscheduledEvents++;
-    m_events->Insert (ev);
-    m_synchronizer->Signal ();
-  }
+  //
+  // If the simulator is running, we're pacing and have a meaningful 
+  // realtime clock.  If we're not, the event is executed at the time were we
+  // stopped: ProcessInjected never moves time backward.
+  // 
+  uint64_t ts = m_running ? m_synchronizer->GetCurrentRealtime () : 0;
+  Inject (ts, context, impl);
 }
 
 void
@@ -698,8 +722,6 @@ RealtimeSimulatorImpl::ScheduleDestroy (EventImpl *impl)
 
   EventId id;
   {
-    CriticalSection cs (m_mutex);
-
     //
     // Time doesn't really matter here (especially in realtime mode).  It is 
     // overridden by the uid of 2 which identifies this as an event to be 
@@ -752,8 +774,6 @@ RealtimeSimulatorImpl::Remove (const EventId &id)
     }
 
   {
-    CriticalSection cs (m_mutex);
-
     Scheduler::Event event;
     event.impl = id.PeekEventImpl ();
     event.key.m_ts = id.GetTs ();
@@ -860,5 +880,18 @@ RealtimeSimulatorImpl::GetHardLimit (void) const
   NS_LOG_FUNCTION_NOARGS ();
   return m_hardLimit;
 }
+
+const LatenessStatistics &
+RealtimeSimulatorImpl::GetLatenessStatistics (void) const
+{
+  return m_lateness;
+}
+
+void
+RealtimeSimulatorImpl::ResetLatenessStatistics (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_lateness.Reset ();
+}
   
 }; // namespace ns3
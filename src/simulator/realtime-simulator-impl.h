@@ -24,16 +24,34 @@
 #include "scheduler.h"
 #include "synchronizer.h"
 #include "event-impl.h"
+#include "lateness-statistics.h"
 
 #include "ns3/ptr.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
-#include "ns3/system-mutex.h"
 
 #include <list>
 
 namespace ns3 {
 
+/**
+ * \ingroup simulator
+ * \brief a simulator which paces the execution of the events on the
+ * wall clock
+ *
+ * All the methods of this class must be called from the thread which
+ * runs the simulation, with the exception of ScheduleRealtime,
+ * ScheduleRealtimeWithContext, ScheduleRealtimeNow and
+ * ScheduleRealtimeNowWithContext which can be called from any thread.
+ * The events scheduled by these methods are pushed on a lock-free
+ * stack and inserted in the event list by the simulation thread the
+ * next time it looks for an event to execute, so that the simulation
+ * thread never takes a lock to schedule or execute its own events.
+ *
+ * The lateness of each event executed by Run, that is, how late with
+ * respect to the wall clock it was invoked, is accumulated in a
+ * LatenessStatistics object.
+ */
 class RealtimeSimulatorImpl : public SimulatorImpl
 {
 public:
@@ -83,10 +101,29 @@ public:
   void SetHardLimit (Time limit);
   Time GetHardLimit (void) const;
 
+  /**
+   * \returns the distribution of the lateness of the events executed
+   *          since the simulator was created or since the last call to
+   *          ResetLatenessStatistics.
+   */
+  const LatenessStatistics &GetLatenessStatistics (void) const;
+  void ResetLatenessStatistics (void);
+
 private:
+  // an event scheduled from a foreign thread.
+  struct InjectedEvent
+  {
+    EventImpl *impl;
+    uint64_t ts;
+    uint32_t context;
+    InjectedEvent *next;
+  };
+
   bool Running (void) const;
   bool Realtime (void) const;
 
+  void Inject (uint64_t ts, uint32_t context, EventImpl *impl);
+  void ProcessInjected (void);
   void ProcessOneEvent (void);
   uint64_t NextTs (void) const;
   virtual void DoDispose (void);
@@ -94,9 +131,9 @@ private:
   typedef std::list<EventId> DestroyEvents;
   DestroyEvents m_destroyEvents;
   bool m_stop;
-  bool m_running;
+  volatile bool m_running;
 
-  // The following variables are protected using the m_mutex
+  // The following variables are only accessed by the simulation thread.
   Ptr<Scheduler> m_events;
   int m_unscheduledEvents;
   uint32_t m_uid;
@@ -104,7 +141,8 @@ private:
   uint64_t m_currentTs;
   uint32_t m_currentContext;
 
-  mutable SystemMutex m_mutex;
+  // the events scheduled from foreign threads, most recent first.
+  InjectedEvent * volatile m_injected;
 
   Ptr<Synchronizer> m_synchronizer;
 
@@ -117,6 +155,8 @@ private:
    * The maximum allowable drift from real-time in SYNC_HARD_LIMIT mode.
    */
   Time m_hardLimit;
+
+  LatenessStatistics m_lateness;
 };
 
 } // namespace ns3
@@ -19,7 +19,9 @@
  */
 
 #include "scheduler.h"
+#include "event-impl.h"
 #include "ns3/assert.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -35,4 +37,28 @@ Scheduler::GetTypeId (void)
   return tid;
 }
 
+uint32_t
+Scheduler::Compact (void)
+{
+  std::vector<Event> events;
+  while (!IsEmpty ())
+    {
+      events.push_back (RemoveNext ());
+    }
+  uint32_t purged = 0;
+  for (std::vector<Event>::const_iterator i = events.begin (); i != events.end (); i++)
+    {
+      if (i->impl->IsCancelled ())
+        {
+          i->impl->Unref ();
+          purged++;
+        }
+      else
+        {
+          Insert (*i);
+        }
+    }
+  return purged;
+}
+
 } // namespace ns3
@@ -93,6 +93,17 @@ class Scheduler : public Object
    * This methods cannot be invoked if the list is empty.
    */
   virtual void Remove (const Event &ev) = 0;
+  /**
+   * Remove all the cancelled events from the event list and release
+   * them with EventImpl::Unref.
+   *
+   * \returns the number of events removed.
+   *
+   * The default implementation removes all the events with RemoveNext
+   * and inserts back those which are not cancelled. Subclasses can
+   * override it with a cheaper in-place filter.
+   */
+  virtual uint32_t Compact (void);
 };
 
 /* Note the invariants which this function must provide:
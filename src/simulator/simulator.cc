@@ -143,6 +143,7 @@ Simulator::Destroy (void)
   (*pimpl)->Destroy ();
   (*pimpl)->Unref ();
   *pimpl = 0;
+  EventImpl::TrimPool ();
 }
 
 void
@@ -379,6 +380,14 @@ Simulator::GetImplementation (void)
 #include "map-scheduler.h"
 #include "calendar-scheduler.h"
 #include "ns2-calendar-scheduler.h"
+#include "ladder-scheduler.h"
+#include "four-ary-heap-scheduler.h"
+#include "default-simulator-impl.h"
+#include "event-profiler.h"
+#include "lateness-statistics.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include <sstream>
 
 namespace ns3 {
 
@@ -817,6 +826,422 @@ SimulatorTemplateTestCase::DoRun (void)
   return false;
 }
 
+class CancelledEventsTestCase : public TestCase
+{
+public:
+  CancelledEventsTestCase (ObjectFactory schedulerFactory);
+private:
+  virtual bool DoRun (void);
+  void Expire (void);
+  uint32_t m_count;
+  ObjectFactory m_schedulerFactory;
+};
+
+CancelledEventsTestCase::CancelledEventsTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that cancelled events are purged with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{}
+void
+CancelledEventsTestCase::Expire (void)
+{
+  m_count++;
+}
+bool
+CancelledEventsTestCase::DoRun (void)
+{
+  m_count = 0;
+  Simulator::SetScheduler (m_schedulerFactory);
+  std::vector<EventId> ids;
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      ids.push_back (Simulator::Schedule (MicroSeconds (i + 1), &CancelledEventsTestCase::Expire, this));
+    }
+  // the 1024th cancelled event brings the cancelled events above
+  // half of the event list.
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      if (i % 4 != 0)
+        {
+          ids[i].Cancel ();
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (ids[1].IsExpired (), true, "A purged event is not expired");
+  Simulator::Remove (ids[1]);
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_count, 500, "Wrong number of events executed");
+  Ptr<DefaultSimulatorImpl> impl = DynamicCast<DefaultSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_ASSERT_MSG_EQ ((impl != 0), true, "The simulator is not a DefaultSimulatorImpl");
+  NS_TEST_EXPECT_MSG_EQ (impl->GetPurgedEventCount (), 1024, "Wrong number of purged events");
+  Simulator::Destroy ();
+  return false;
+}
+
+static void
+LadderNothing (void)
+{}
+
+class LadderSchedulerTestCase : public TestCase
+{
+public:
+  LadderSchedulerTestCase ();
+private:
+  virtual bool DoRun (void);
+  void Insert (uint64_t ts);
+  Ptr<LadderScheduler> m_scheduler;
+  std::vector<Scheduler::Event> m_events;
+  uint32_t m_uid;
+};
+
+LadderSchedulerTestCase::LadderSchedulerTestCase ()
+  : TestCase ("Check that LadderScheduler spills Bottom in order")
+{}
+void
+LadderSchedulerTestCase::Insert (uint64_t ts)
+{
+  Scheduler::Event ev;
+  ev.impl = MakeEvent (&LadderNothing);
+  ev.key.m_ts = ts;
+  ev.key.m_uid = m_uid++;
+  ev.key.m_context = 0;
+  m_scheduler->Insert (ev);
+  m_events.push_back (ev);
+}
+bool
+LadderSchedulerTestCase::DoRun (void)
+{
+  m_scheduler = CreateObject<LadderScheduler> ();
+  m_uid = 0;
+  // the first removal moves these events from Top to a rung of
+  // buckets of width 10 and the first bucket to Bottom.
+  for (uint64_t i = 0; i < 100; i++)
+    {
+      Insert (1000 + 10 * i);
+    }
+  Scheduler::Event last = m_scheduler->RemoveNext ();
+  NS_TEST_ASSERT_MSG_EQ (last.key.m_ts, 1000, "Wrong first event");
+  last.impl->Unref ();
+  uint32_t removed = 1;
+  // these events are all scheduled before the current bucket of the
+  // rung: they go to Bottom, which spills into new rungs.
+  for (uint64_t i = 0; i < 500; i++)
+    {
+      Insert (1001 + (i * 7) % 9);
+    }
+  for (uint32_t i = 100; i < m_events.size (); i += 7)
+    {
+      m_scheduler->Remove (m_events[i]);
+      m_events[i].impl->Unref ();
+      removed++;
+    }
+  while (!m_scheduler->IsEmpty ())
+    {
+      Scheduler::Event next = m_scheduler->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ ((last.key < next.key), true, "Event " << next.key.m_uid << " removed out of order");
+      next.impl->Unref ();
+      last = next;
+      removed++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (removed, 600U, "Wrong number of events removed");
+  m_scheduler = 0;
+  m_events.clear ();
+  return false;
+}
+
+class LatenessStatisticsTestCase : public TestCase
+{
+public:
+  LatenessStatisticsTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+LatenessStatisticsTestCase::LatenessStatisticsTestCase ()
+  : TestCase ("Check the percentiles of LatenessStatistics")
+{}
+bool
+LatenessStatisticsTestCase::DoRun (void)
+{
+  LatenessStatistics stats;
+  NS_TEST_EXPECT_MSG_EQ (stats.GetPercentile (99), 0, "Empty statistics");
+  stats.Record (-10);
+  for (int64_t i = 1; i <= 999; i++)
+    {
+      stats.Record (i * 1000);
+    }
+  NS_TEST_EXPECT_MSG_EQ (stats.GetCount (), 1000, "Wrong count");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetEarlyCount (), 1, "Wrong early count");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetMax (), 999000, "Wrong maximum");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetPercentile (0), 0, "Wrong minimum");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetPercentile (100), 999000, "Wrong 100th percentile");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats.GetMean (), 499500, 1, "Wrong mean");
+  // the buckets are 12.5% wide.
+  uint64_t p50 = stats.GetPercentile (50);
+  NS_TEST_EXPECT_MSG_EQ ((p50 >= 499000 && p50 <= 499000 * 1.125), true, "Wrong median " << p50);
+  uint64_t p99 = stats.GetPercentile (99);
+  NS_TEST_EXPECT_MSG_EQ ((p99 >= 989000 && p99 <= 999000), true, "Wrong 99th percentile " << p99);
+  stats.Reset ();
+  NS_TEST_EXPECT_MSG_EQ (stats.GetCount (), 0, "Reset failed");
+  stats.Record (5);
+  NS_TEST_EXPECT_MSG_EQ (stats.GetPercentile (50), 5, "Small values are exact");
+  return false;
+}
+
+class EventProfilerTestCase : public TestCase
+{
+public:
+  EventProfilerTestCase ();
+private:
+  virtual bool DoRun (void);
+  void Work (void);
+  uint32_t m_count;
+};
+
+EventProfilerTestCase::EventProfilerTestCase ()
+  : TestCase ("Check that the event profiler accounts the events it is given")
+{}
+void
+EventProfilerTestCase::Work (void)
+{
+  m_count++;
+}
+bool
+EventProfilerTestCase::DoRun (void)
+{
+  m_count = 0;
+  EventProfiler profiler;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      EventImpl *event = MakeEvent (&EventProfilerTestCase::Work, this);
+      profiler.Begin (event, 7);
+      event->Invoke ();
+      profiler.End ();
+      event->Unref ();
+    }
+  std::ostringstream oss;
+  profiler.Report (oss);
+  NS_TEST_EXPECT_MSG_EQ (m_count, 3, "Events were not invoked");
+  NS_TEST_EXPECT_MSG_EQ ((oss.str ().find ("Event profile: 3 events") != std::string::npos), true,
+                         "Wrong total in " << oss.str ());
+  NS_TEST_EXPECT_MSG_EQ ((oss.str ().find ("ns3::EventProfilerTestCase: MakeEvent<") != std::string::npos), true,
+                         "Receiver not reported in " << oss.str ());
+
+  // the simulator keeps running the same events when it profiles them.
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::DefaultSimulatorImpl");
+  factory.Set ("Profile", BooleanValue (true));
+  Ptr<DefaultSimulatorImpl> impl = factory.Create<DefaultSimulatorImpl> ();
+  std::ostringstream report;
+  impl->SetProfileStream (&report);
+  Simulator::SetImplementation (impl);
+  m_count = 0;
+  Simulator::Schedule (Seconds (1), &EventProfilerTestCase::Work, this);
+  EventId cancelled = Simulator::Schedule (Seconds (2), &EventProfilerTestCase::Work, this);
+  cancelled.Cancel ();
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_count, 1, "Wrong number of events executed");
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ ((report.str ().find ("Event profile: 1 events") != std::string::npos), true,
+                         "Wrong total in " << report.str ());
+  NS_TEST_EXPECT_MSG_EQ ((report.str ().find ("ns3::EventProfilerTestCase: MakeEvent<") != std::string::npos), true,
+                         "Receiver not reported in " << report.str ());
+  return false;
+}
+
+class EventPoolTestCase : public TestCase
+{
+public:
+  EventPoolTestCase ();
+private:
+  virtual bool DoRun (void);
+  void Chain (uint32_t left);
+  uint32_t m_count;
+};
+
+EventPoolTestCase::EventPoolTestCase ()
+  : TestCase ("Check that the storage of expired events is recycled")
+{}
+void
+EventPoolTestCase::Chain (uint32_t left)
+{
+  m_count++;
+  if (left > 0)
+    {
+      // the previous event is released before this one is invoked.
+      Simulator::Schedule (MicroSeconds (1), &EventPoolTestCase::Chain, this, left - 1);
+    }
+}
+bool
+EventPoolTestCase::DoRun (void)
+{
+  m_count = 0;
+  Simulator::Schedule (MicroSeconds (1), &EventPoolTestCase::Chain, this, 99);
+  EventImpl::PoolStats before = EventImpl::GetPoolStats ();
+  Simulator::Run ();
+  EventImpl::PoolStats after = EventImpl::GetPoolStats ();
+  NS_TEST_ASSERT_MSG_EQ (m_count, 100, "Wrong number of events executed");
+  NS_TEST_EXPECT_MSG_EQ (after.allocations - before.allocations, 99, "Wrong number of events allocated");
+  // only the second event cannot reuse the storage of an expired event.
+  NS_TEST_EXPECT_MSG_EQ ((after.hits - before.hits >= 98), true, "Events were not allocated from the pool");
+  NS_TEST_EXPECT_MSG_NE (after.pooled, 0, "No block was returned to the pool");
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (EventImpl::GetPoolStats ().pooled, 0, "Simulator::Destroy did not trim the pool");
+  return false;
+}
+
+#ifdef HAVE_PTHREAD_H
+
+class MultiThreadedSimulatorTestCase : public TestCase
+{
+public:
+  MultiThreadedSimulatorTestCase (bool resize);
+private:
+  virtual bool DoRun (void);
+  void Hop (uint32_t hops, uint64_t expectedTs);
+  void Local (uint64_t expectedTs);
+
+  // each element is only accessed from the partition which owns its context.
+  std::vector<uint32_t> m_hops;
+  std::vector<uint32_t> m_local;
+  std::vector<uint32_t> m_errors;
+  // change ThreadCount after the first events are scheduled.
+  bool m_resize;
+};
+
+MultiThreadedSimulatorTestCase::MultiThreadedSimulatorTestCase (bool resize)
+  : TestCase (resize ?
+              "Check that the multi-threaded simulator moves the pending events when ThreadCount changes" :
+              "Check that events hopping between contexts are executed in order by the multi-threaded simulator"),
+    m_resize (resize)
+{}
+void
+MultiThreadedSimulatorTestCase::Hop (uint32_t hops, uint64_t expectedTs)
+{
+  uint32_t context = Simulator::GetContext ();
+  m_hops[context]++;
+  if (Simulator::Now ().GetTimeStep () != (int64_t)expectedTs)
+    {
+      m_errors[context]++;
+    }
+  Simulator::Schedule (MicroSeconds (300), &MultiThreadedSimulatorTestCase::Local, this,
+                       expectedTs + MicroSeconds (300).GetTimeStep ());
+  if (hops > 0)
+    {
+      Simulator::ScheduleWithContext ((context + 1) % m_hops.size (), MilliSeconds (2),
+                                      &MultiThreadedSimulatorTestCase::Hop, this,
+                                      hops - 1, expectedTs + MilliSeconds (2).GetTimeStep ());
+    }
+}
+void
+MultiThreadedSimulatorTestCase::Local (uint64_t expectedTs)
+{
+  uint32_t context = Simulator::GetContext ();
+  m_local[context]++;
+  if (Simulator::Now ().GetTimeStep () != (int64_t)expectedTs)
+    {
+      m_errors[context]++;
+    }
+}
+bool
+MultiThreadedSimulatorTestCase::DoRun (void)
+{
+  const uint32_t nContexts = 8;
+  m_hops = std::vector<uint32_t> (nContexts, 0);
+  m_local = std::vector<uint32_t> (nContexts, 0);
+  m_errors = std::vector<uint32_t> (nContexts, 0);
+
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::MultiThreadedSimulatorImpl");
+  factory.Set ("ThreadCount", UintegerValue (4));
+  factory.Set ("Lookahead", TimeValue (MilliSeconds (1)));
+  Ptr<SimulatorImpl> impl = factory.Create<SimulatorImpl> ();
+  Simulator::SetImplementation (impl);
+
+  for (uint32_t i = 0; i < nContexts; i++)
+    {
+      Simulator::ScheduleWithContext (i, MilliSeconds (i), &MultiThreadedSimulatorTestCase::Hop, this,
+                                      20, MilliSeconds (i).GetTimeStep ());
+    }
+  Simulator::Stop (MilliSeconds (100));
+  if (m_resize)
+    {
+      impl->SetAttribute ("ThreadCount", UintegerValue (3));
+      UintegerValue threadCount;
+      impl->GetAttribute ("ThreadCount", threadCount);
+      NS_TEST_EXPECT_MSG_EQ (threadCount.Get (), 3, "ThreadCount was not changed");
+    }
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), MilliSeconds (100), "Simulation did not stop at the right time");
+  for (uint32_t i = 0; i < nContexts; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_hops[i], 21, "Wrong number of hops in context " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_local[i], 21, "Wrong number of local events in context " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_errors[i], 0, "Events executed at the wrong time in context " << i);
+    }
+  Simulator::Destroy ();
+
+  return false;
+}
+
+class MultiThreadedSimulatorStopTestCase : public TestCase
+{
+public:
+  MultiThreadedSimulatorStopTestCase ();
+private:
+  virtual bool DoRun (void);
+  void Tick (void);
+
+  // each element is only accessed from the partition which owns its context.
+  std::vector<uint32_t> m_ticks;
+};
+
+MultiThreadedSimulatorStopTestCase::MultiThreadedSimulatorStopTestCase ()
+  : TestCase ("Check that all the partitions of the multi-threaded simulator stop at the end of the window")
+{}
+void
+MultiThreadedSimulatorStopTestCase::Tick (void)
+{
+  uint32_t context = Simulator::GetContext ();
+  m_ticks[context]++;
+  if (context == 0 && Simulator::Now () == MicroSeconds (500))
+    {
+      Simulator::Stop ();
+    }
+  Simulator::Schedule (MicroSeconds (100), &MultiThreadedSimulatorStopTestCase::Tick, this);
+}
+bool
+MultiThreadedSimulatorStopTestCase::DoRun (void)
+{
+  const uint32_t nContexts = 4;
+  m_ticks = std::vector<uint32_t> (nContexts, 0);
+
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::MultiThreadedSimulatorImpl");
+  factory.Set ("ThreadCount", UintegerValue (nContexts));
+  factory.Set ("Lookahead", TimeValue (MilliSeconds (1)));
+  Simulator::SetImplementation (factory.Create<SimulatorImpl> ());
+
+  for (uint32_t i = 0; i < nContexts; i++)
+    {
+      Simulator::ScheduleWithContext (i, Seconds (0.0), &MultiThreadedSimulatorStopTestCase::Tick, this);
+    }
+  Simulator::Run ();
+
+  // the first window is [0, 1ms): every partition executes its ten
+  // ticks, whenever context 0 calls Stop.
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), MicroSeconds (900), "Simulation did not stop at the end of the window");
+  for (uint32_t i = 0; i < nContexts; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ticks[i], 10, "Wrong number of ticks in context " << i);
+    }
+  Simulator::Destroy ();
+
+  return false;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -835,6 +1260,25 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (FourAryHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new CancelledEventsTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new CancelledEventsTestCase (factory));
+    factory.SetTypeId (FourAryHeapScheduler::GetTypeId ());
+    AddTestCase (new CancelledEventsTestCase (factory));
+    AddTestCase (new LadderSchedulerTestCase ());
+    AddTestCase (new EventPoolTestCase ());
+    AddTestCase (new EventProfilerTestCase ());
+    AddTestCase (new LatenessStatisticsTestCase ());
+#ifdef HAVE_PTHREAD_H
+    AddTestCase (new MultiThreadedSimulatorTestCase (false));
+    AddTestCase (new MultiThreadedSimulatorTestCase (true));
+    AddTestCase (new MultiThreadedSimulatorStopTestCase ());
+#endif /* HAVE_PTHREAD_H */
   }
 } g_simulatorTestSuite;
 
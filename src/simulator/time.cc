@@ -190,16 +190,6 @@ TimeUnit<1>::GetFemtoSeconds (void) const
   return fs;
 }
 
-/**
- * This returns the value with the precision returned by TimeStepPrecision::Get
- */
-int64_t
-TimeUnit<1>::GetTimeStep (void) const
-{
-  int64_t timeValue = GetHighPrecision ().GetInteger ();
-  return timeValue;
-}
-
 
 std::ostream& 
 operator<< (std::ostream& os, const Time & time)
@@ -339,16 +329,6 @@ Time FemtoSeconds (uint64_t fs)
   return TimeStep(ts);
 }
 
-
-/*
- * The timestep value passed to this function must be of the precision
- * of TimeStepPrecision::Get
- */
-Time TimeStep (uint64_t ts)
-{
-  return Time (HighPrecision (ts, false));
-}
-
 TimeUnit<0>::TimeUnit (double scalar)
   : m_data (HighPrecision (scalar))
 {}
@@ -522,8 +502,11 @@ TimeStepTestCase::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (tooBig.IsNegative (), true, "Is not negative ?");
   tooBig = TimeStep (0x7fffffffffffffffLL);
   NS_TEST_ASSERT_MSG_EQ (tooBig.IsPositive (), true, "Is not negative ?");
+#ifndef USE_HIGH_PRECISION_INT64
+  // the 64 bit implementation reports overflows as fatal errors.
   tooBig += TimeStep (1);
   NS_TEST_ASSERT_MSG_EQ (tooBig.IsNegative (), true, "Is not negative ?");
+#endif /* USE_HIGH_PRECISION_INT64 */
   return false;
 }
 
@@ -18,9 +18,13 @@
 
 #include <time.h>
 #include <sys/time.h>
+#include <errno.h>
+#include <string.h>
 
 #include "ns3/log.h"
+#include "ns3/fatal-error.h"
 #include "ns3/system-condition.h"
+#include "ns3/enum.h"
 
 #include "wall-clock-synchronizer.h"
 
@@ -28,7 +32,37 @@ NS_LOG_COMPONENT_DEFINE ("WallClockSynchronizer");
 
 namespace ns3 {
 
+NS_OBJECT_ENSURE_REGISTERED (WallClockSynchronizer);
+
+TypeId
+WallClockSynchronizer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::WallClockSynchronizer")
+    .SetParent<Synchronizer> ()
+    .AddConstructor<WallClockSynchronizer> ()
+    .AddAttribute ("Mode",
+                   "How to wait for the wall clock to reach the time of the next event.",
+                   EnumValue (CONDITION),
+                   MakeEnumAccessor (&WallClockSynchronizer::m_mode),
+                   MakeEnumChecker (CONDITION, "Condition",
+                                    LOW_JITTER, "LowJitter"))
+    .AddAttribute ("SpinTime",
+                   "The time to busy-wait at the end of a wait in LowJitter mode (zero to calibrate it)",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&WallClockSynchronizer::m_spinTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("SleepSlice",
+                   "The longest time slept with clock_nanosleep in LowJitter mode",
+                   TimeValue (MicroSeconds (500)),
+                   MakeTimeAccessor (&WallClockSynchronizer::m_sleepSlice),
+                   MakeTimeChecker ())
+    ;
+  return tid;
+}
+
 WallClockSynchronizer::WallClockSynchronizer ()
+  : m_mode (CONDITION),
+    m_spin (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 //
@@ -101,6 +135,16 @@ WallClockSynchronizer::DoSetOrigin (uint64_t ns)
 //
   m_realtimeOriginNano = GetRealtime ();
   NS_LOG_INFO ("origin = " << m_realtimeOriginNano);
+
+  if (m_mode == LOW_JITTER)
+    {
+      m_spin = m_spinTime.GetNanoSeconds ();
+      if (m_spin == 0)
+        {
+          CalibrateSpin ();
+        }
+      NS_LOG_INFO ("spin = " << m_spin << " ns");
+    }
 }
 
   int64_t
@@ -147,6 +191,10 @@ WallClockSynchronizer::DoGetDrift (uint64_t ns)
 WallClockSynchronizer::DoSynchronize (uint64_t nsCurrent, uint64_t nsDelay)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  if (m_mode == LOW_JITTER)
+    {
+      return LowJitterWait (nsCurrent + nsDelay);
+    }
 //
 // This is the belly of the beast.  We have received two parameters from the
 // simulator proper -- a current simulation time (nsCurrent) and a simulation
@@ -345,6 +393,104 @@ WallClockSynchronizer::SleepWait (uint64_t ns)
   return m_condition.TimedWait (ns);
 }
 
+  bool
+WallClockSynchronizer::LowJitterWait (uint64_t ns)
+{
+  NS_LOG_FUNCTION (ns);
+//
+// Unlike DoSynchronize, we do not need to correct for drift: we wait until
+// the absolute normalized realtime ns, so a late wake-up is not carried over
+// to the next wait.
+//
+// The long waits are still performed on the condition variable so that an
+// event scheduled by another thread interrupts them.
+//
+  uint64_t nsNow = GetNormalizedRealtime ();
+  if (nsNow >= ns)
+    {
+      return true;
+    }
+  uint64_t nsSlice = m_sleepSlice.GetNanoSeconds ();
+  if (ns - nsNow > m_spin + nsSlice)
+    {
+      if (SleepWait (ns - nsNow - m_spin - nsSlice) == false)
+        {
+          NS_LOG_INFO ("SleepWait interrupted");
+          return false;
+        }
+      nsNow = GetNormalizedRealtime ();
+    }
+//
+// We are now at most about SleepSlice away from the deadline: sleep with the
+// high-resolution timer until the spin time before it, then spin.
+//
+  if (nsNow + m_spin < ns)
+    {
+      if (m_condition.GetCondition ())
+        {
+          return false;
+        }
+      NanoSleepUntil (ns - m_spin);
+    }
+  return SpinWait (ns);
+}
+
+  void
+WallClockSynchronizer::NanoSleepUntil (uint64_t ns)
+{
+#ifdef CLOCK_MONOTONIC
+  uint64_t deadline = ns + m_realtimeOriginNano;
+  struct timespec ts;
+  ts.tv_sec = deadline / NS_PER_SEC;
+  ts.tv_nsec = deadline % NS_PER_SEC;
+  int rc;
+  while ((rc = clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR)
+    {
+      // interrupted by a signal handler: sleep again.
+    }
+  if (rc != 0)
+    {
+      NS_FATAL_ERROR ("WallClockSynchronizer: clock_nanosleep failed: " << strerror (rc));
+    }
+#else
+  NS_FATAL_ERROR ("WallClockSynchronizer: LowJitter mode requires CLOCK_MONOTONIC");
+#endif
+}
+
+//
+// Sleep a few times for a short time and keep the worst oversleep, plus a
+// margin, as the time to spin at the end of each wait.
+//
+  void
+WallClockSynchronizer::CalibrateSpin (void)
+{
+  static const uint32_t N_SAMPLES = 20;
+  static const uint64_t NS_SAMPLE = 200000;
+  static const uint64_t NS_MIN_SPIN = 5000;
+  static const uint64_t NS_MAX_SPIN = 2000000;
+
+  uint64_t worst = 0;
+  for (uint32_t i = 0; i < N_SAMPLES; i++)
+    {
+      uint64_t deadline = GetNormalizedRealtime () + NS_SAMPLE;
+      NanoSleepUntil (deadline);
+      uint64_t late = GetNormalizedRealtime () - deadline;
+      if (late > worst)
+        {
+          worst = late;
+        }
+    }
+  m_spin = worst + worst / 4;
+  if (m_spin < NS_MIN_SPIN)
+    {
+      m_spin = NS_MIN_SPIN;
+    }
+  else if (m_spin > NS_MAX_SPIN)
+    {
+      m_spin = NS_MAX_SPIN;
+    }
+}
+
   uint64_t
 WallClockSynchronizer::DriftCorrect (uint64_t nsNow, uint64_t nsDelay)
 {
@@ -378,6 +524,14 @@ WallClockSynchronizer::DriftCorrect (uint64_t nsNow, uint64_t nsDelay)
   uint64_t
 WallClockSynchronizer::GetRealtime (void)
 {
+#ifdef CLOCK_MONOTONIC
+  if (m_mode == LOW_JITTER)
+    {
+      struct timespec ts;
+      clock_gettime (CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+    }
+#endif
   struct timeval tvNow;
   gettimeofday (&tvNow, NULL);
   return TimevalToNs (&tvNow);
@@ -21,6 +21,7 @@
 
 #include "ns3/system-condition.h"
 #include "synchronizer.h"
+#include "nstime.h"
 
 namespace ns3 {
 
@@ -58,10 +59,29 @@ namespace ns3 {
  * Nanosleep takes a struct timespec as an input so we have to deal with
  * conversion between Time and struct timespec here.  They are both 
  * interpreted as elapsed times.
+ *
+ * The "Mode" attribute selects how the synchronizer waits:
+ *  - Condition: the wall clock is read with gettimeofday and the waits
+ *    longer than a few jiffies are performed on a condition variable,
+ *  - LowJitter: the wall clock is read from CLOCK_MONOTONIC.  The waits
+ *    longer than SleepSlice are performed on the condition variable, the
+ *    remaining time but the last SpinTime is slept with clock_nanosleep
+ *    on an absolute deadline and the synchronizer busy-waits for the last
+ *    SpinTime.  If SpinTime is zero, it is calibrated when the simulation
+ *    starts from the worst oversleep of a few short clock_nanosleep calls.
+ *    A Signal received during the clock_nanosleep is only noticed when it
+ *    completes, that is, after at most SleepSlice.
  */
 class WallClockSynchronizer : public Synchronizer
 {
 public:
+  static TypeId GetTypeId (void);
+
+  enum Mode {
+    CONDITION,
+    LOW_JITTER
+  };
+
   WallClockSynchronizer ();
   virtual ~WallClockSynchronizer ();
 
@@ -169,6 +189,9 @@ protected:
 
   bool SpinWait (uint64_t);
   bool SleepWait (uint64_t);
+  bool LowJitterWait (uint64_t ns);
+  void NanoSleepUntil (uint64_t ns);
+  void CalibrateSpin (void);
 
   uint64_t DriftCorrect (uint64_t nsNow, uint64_t nsDelay);
 
@@ -188,6 +211,12 @@ protected:
   uint64_t m_jiffy;
   uint64_t m_nsEventStart;
 
+  enum Mode m_mode;
+  Time m_spinTime;
+  Time m_sleepSlice;
+  // the spin time in use, calibrated if m_spinTime is zero.
+  uint64_t m_spin;
+
   SystemCondition m_condition;
 };
 
@@ -26,6 +26,7 @@
 #include "ns3/simulator-module.h"
 #include "ns3/node-module.h"
 #include "ns3/core-module.h"
+#include "ns3/common-module.h"
 #include "ns3/helper-module.h"
 
 using namespace ns3;
@@ -64,6 +65,15 @@ PerfStream (ostream &stream, uint32_t n, const char *buffer, uint32_t size)
     }
 }
 
+void
+PerfPcap (Ptr<PcapFileWrapper> file, uint32_t n, Ptr<const Packet> p)
+{
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      file->Write (MicroSeconds (i), p);
+    }
+}
+
 int 
 main (int argc, char *argv[])
 {
@@ -71,6 +81,8 @@ main (int argc, char *argv[])
   uint32_t iter = 50;
   bool doStream = false;
   bool binmode = true;
+  bool doPcap = false;
+  bool async = false;
  
 
   CommandLine cmd;
@@ -78,13 +90,48 @@ main (int argc, char *argv[])
   cmd.AddValue ("iter", "How many times to run the test looking for a min (defaults to 50)", iter);
   cmd.AddValue ("doStream", "Run the C++ I/O benchmark otherwise the C I/O ", doStream);
   cmd.AddValue ("binmode", "Select binary mode for the C++ I/O benchmark (defaults to true)", binmode);
+  cmd.AddValue ("doPcap", "Run the pcap file wrapper benchmark", doPcap);
+  cmd.AddValue ("async", "Select the asynchronous pcap file wrapper (defaults to false)", async);
   cmd.Parse (argc, argv);
 
   uint64_t result = std::numeric_limits<uint64_t>::max ();
   
   char buffer[1024];
 
-  if (doStream)
+  if (doPcap)
+    {
+      //
+      // The time measured is the time spent by the simulation thread to
+      // write the records; the time spent to drain the queued records of
+      // an asynchronous file is reported separately.
+      //
+      Ptr<const Packet> p = Create<Packet> ((uint8_t const *)buffer, 1024);
+      uint64_t flush = std::numeric_limits<uint64_t>::max ();
+      uint64_t queued = 0;
+      uint64_t dropped = 0;
+      for (uint32_t i = 0; i < iter; ++i)
+        {
+          Ptr<PcapFileWrapper> file = CreateObject<PcapFileWrapper> ();
+          file->SetAttribute ("Asynchronous", BooleanValue (async));
+          file->Open ("pcaptest", "w");
+          file->Init (1);
+
+          uint64_t start = GetRealtimeInNs ();
+          PerfPcap (file, n, p);
+          uint64_t et = GetRealtimeInNs () - start;
+          result = std::min (result, et);
+          start = GetRealtimeInNs ();
+          file->Close ();
+          flush = std::min (flush, GetRealtimeInNs () - start);
+          queued = file->GetQueuedRecords ();
+          dropped = file->GetDroppedRecords ();
+          std::cout << "."; std::cout.flush ();
+        }
+      std::cout << std::endl;
+      std::cout << argv[0] << ": close " << flush << "ns, queued " << queued
+                << " records, dropped " << dropped << " records" << std::endl;
+    }
+  else if (doStream)
     {
       //
       // This will probably run on a machine doing other things.  Run it some
@@ -0,0 +1,223 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+//
+// Measure the rate at which foreign threads can inject events in a
+// RealtimeSimulatorImpl with ScheduleRealtimeNowWithContext, the way the
+// read threads of EmuNetDevice and TapBridge do, and the latency of the
+// simulation thread while it is flooded:
+//  - inject: the time from the injection of an event to its execution,
+//  - tick: how late a periodic event scheduled by the simulation thread
+//    itself is executed with respect to the wall clock.
+// The distribution of the lateness of all the events, as accounted by the
+// simulator, is printed at the end.  Use --lowJitter to select the LowJitter
+// mode of WallClockSynchronizer.
+//
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <vector>
+
+#include "ns3/simulator-module.h"
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+static const uint64_t US_PER_NS = (uint64_t)1000;
+static const uint64_t NS_PER_SEC = (uint64_t)1000000000;
+
+uint64_t
+GetRealtimeInNs (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+
+  uint64_t nsResult = tv.tv_sec * NS_PER_SEC + tv.tv_usec * US_PER_NS;
+  return nsResult;
+}
+
+class Latency
+{
+public:
+  Latency ();
+  void Record (uint64_t ns);
+  void Print (const char *name) const;
+private:
+  uint64_t m_n;
+  uint64_t m_sum;
+  uint64_t m_max;
+};
+
+Latency::Latency ()
+  : m_n (0),
+    m_sum (0),
+    m_max (0)
+{}
+
+void
+Latency::Record (uint64_t ns)
+{
+  m_n++;
+  m_sum += ns;
+  m_max = std::max (m_max, ns);
+}
+
+void
+Latency::Print (const char *name) const
+{
+  std::cout << name << " n=" << m_n
+            << ", avg=" << (m_n == 0 ? 0 : m_sum / m_n / US_PER_NS) << "us"
+            << ", max=" << m_max / US_PER_NS << "us" << std::endl;
+}
+
+class InjectionBench
+{
+public:
+  InjectionBench (uint32_t producers, uint32_t events, uint32_t gap, Time tick);
+  void Run (void);
+private:
+  void Start (void);
+  void Produce (void);
+  void Injected (uint64_t ns);
+  void Tick (void);
+
+  Ptr<RealtimeSimulatorImpl> m_impl;
+  std::vector<Ptr<SystemThread> > m_threads;
+  uint32_t m_producers;
+  uint32_t m_events;
+  uint32_t m_gap;
+  Time m_tick;
+  uint32_t m_nextContext;
+  uint64_t m_received;
+  uint64_t m_start;
+  uint64_t m_end;
+  Latency m_inject;
+  Latency m_late;
+};
+
+InjectionBench::InjectionBench (uint32_t producers, uint32_t events, uint32_t gap, Time tick)
+  : m_producers (producers),
+    m_events (events),
+    m_gap (gap),
+    m_tick (tick),
+    m_nextContext (0),
+    m_received (0),
+    m_start (0),
+    m_end (0)
+{}
+
+void
+InjectionBench::Produce (void)
+{
+  uint32_t context = __sync_fetch_and_add (&m_nextContext, 1);
+  for (uint32_t i = 0; i < m_events; ++i)
+    {
+      m_impl->ScheduleRealtimeNowWithContext (context, MakeEvent (&InjectionBench::Injected, this,
+                                                                  GetRealtimeInNs ()));
+      if (m_gap != 0)
+        {
+          usleep (m_gap);
+        }
+    }
+}
+
+void
+InjectionBench::Injected (uint64_t ns)
+{
+  uint64_t now = GetRealtimeInNs ();
+  m_inject.Record (now - ns);
+  m_received++;
+  if (m_received == (uint64_t)m_producers * m_events)
+    {
+      m_end = now;
+      Simulator::Stop ();
+    }
+}
+
+void
+InjectionBench::Tick (void)
+{
+  int64_t late = m_impl->RealtimeNow ().GetTimeStep () - Simulator::Now ().GetTimeStep ();
+  m_late.Record (late < 0 ? 0 : late);
+  Simulator::Schedule (m_tick, &InjectionBench::Tick, this);
+}
+
+void
+InjectionBench::Start (void)
+{
+  m_start = GetRealtimeInNs ();
+  for (uint32_t i = 0; i < m_producers; ++i)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&InjectionBench::Produce, this));
+      m_threads.push_back (thread);
+      thread->Start ();
+    }
+  Tick ();
+}
+
+void
+InjectionBench::Run (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
+  m_impl = DynamicCast<RealtimeSimulatorImpl> (Simulator::GetImplementation ());
+
+  Simulator::Schedule (Seconds (0), &InjectionBench::Start, this);
+  Simulator::Run ();
+  for (std::vector<Ptr<SystemThread> >::iterator i = m_threads.begin (); i != m_threads.end (); ++i)
+    {
+      (*i)->Join ();
+    }
+
+  double seconds = (m_end - m_start) / (double)NS_PER_SEC;
+  LatenessStatistics lateness = m_impl->GetLatenessStatistics ();
+  m_impl = 0;
+  Simulator::Destroy ();
+
+  std::cout << "producers=" << m_producers << ", events=" << m_received
+            << ", time=" << seconds << "s, " << m_received / seconds << " injected/s" << std::endl;
+  m_inject.Print ("inject");
+  m_late.Print ("tick");
+  lateness.Print (std::cout);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t producers = 2;
+  uint32_t events = 100000;
+  uint32_t gap = 0;
+  double tick = 0.001;
+  bool lowJitter = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("producers", "How many threads inject events (defaults to 2)", producers);
+  cmd.AddValue ("events", "How many events each thread injects (defaults to 100000)", events);
+  cmd.AddValue ("gap", "Microseconds between two injections of a thread (defaults to 0)", gap);
+  cmd.AddValue ("tick", "Period of the event of the simulation thread in seconds (defaults to 0.001)", tick);
+  cmd.AddValue ("lowJitter", "Use the LowJitter mode of the synchronizer (defaults to false)", lowJitter);
+  cmd.Parse (argc, argv);
+
+  if (lowJitter)
+    {
+      Config::SetDefault ("ns3::WallClockSynchronizer::Mode", StringValue ("LowJitter"));
+    }
+
+  InjectionBench bench (producers, events, gap, Seconds (tick));
+  bench.Run ();
+  return 0;
+}
@@ -0,0 +1,154 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/type-id.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
+#include "ns3/node-container.h"
+#include "ns3/wifi-helper.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/nqos-wifi-mac-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/trace-helper.h"
+#include "ns3/flow-monitor-helper.h"
+#include <iostream>
+
+using namespace ns3;
+
+// creates the nodes and wifi devices of a simple adhoc simulation.
+static void
+runBench (uint32_t n, char const *name)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  NodeContainer nodes;
+  nodes.Create (n);
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  phy.SetChannel (channel.Create ());
+  NqosWifiMacHelper mac = NqosWifiMacHelper::Default ();
+  mac.SetType ("ns3::AdhocWifiMac");
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.Install (phy, mac, nodes);
+  uint64_t deltaMs = time.End ();
+  double ps = n;
+  ps *= 1000;
+  ps /= deltaMs;
+  std::cout << name << "=" << ps << " nodes/s" << std::endl;
+
+  time.Start ();
+  Config::Set ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/TxGain",
+               DoubleValue (1.0));
+  deltaMs = time.End ();
+  std::cout << name << "-config-set=" << deltaMs << " ms" << std::endl;
+  Simulator::Destroy ();
+}
+
+// hooks the traces of a simulation of n nodes: the helpers connect
+// each device and each ipv4 stack with its own Config path.
+static void
+runTracing (uint32_t n)
+{
+  NodeContainer nodes;
+  nodes.Create (n);
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  phy.SetChannel (channel.Create ());
+  NqosWifiMacHelper mac = NqosWifiMacHelper::Default ();
+  mac.SetType ("ns3::AdhocWifiMac");
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.Install (phy, mac, nodes);
+
+  SystemWallClockMs time;
+  time.Start ();
+  InternetStackHelper stack;
+  stack.Install (nodes);
+  uint64_t deltaMs = time.End ();
+  std::cout << "internet-stack-install=" << deltaMs << " ms" << std::endl;
+
+  AsciiTraceHelper ascii;
+  Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream ("/dev/null");
+  time.Start ();
+  phy.EnableAsciiAll (stream);
+  deltaMs = time.End ();
+  std::cout << "enable-ascii-all=" << deltaMs << " ms" << std::endl;
+
+  time.Start ();
+  stack.EnableAsciiIpv4All (stream);
+  deltaMs = time.End ();
+  std::cout << "enable-ascii-ipv4-all=" << deltaMs << " ms" << std::endl;
+
+  FlowMonitorHelper flowmon;
+  time.Start ();
+  flowmon.InstallAll ();
+  deltaMs = time.End ();
+  std::cout << "flow-monitor-install-all=" << deltaMs << " ms" << std::endl;
+  Simulator::Destroy ();
+}
+
+// the name lookups made by Config::Set for each device of the path above.
+static void
+runLookups (uint32_t n)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      struct TypeId::AttributeInfo info;
+      TypeId::LookupByName ("ns3::Node").LookupAttributeByName ("DeviceList", &info);
+      TypeId::LookupByName ("ns3::WifiNetDevice").LookupAttributeByName ("Phy", &info);
+      TypeId::LookupByName ("ns3::YansWifiPhy").LookupAttributeByName ("TxGain", &info);
+      TypeId::LookupByName ("ns3::YansWifiPhy").LookupTraceSourceByName ("PhyRxBegin");
+    }
+  uint64_t deltaMs = time.End ();
+  double ps = n;
+  ps *= 1000;
+  ps /= deltaMs;
+  std::cout << "lookups=" << ps << " paths/s" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 10000;
+
+  CommandLine cmd;
+  cmd.AddValue ("n", "Number of nodes to create", n);
+  cmd.Parse (argc, argv);
+
+  std::cout << "Running bench-objects with n=" << n << std::endl;
+
+  runLookups (n * 100);
+  runBench (n, "initial");
+
+  // simulation scripts typically change a few default values.
+  Config::SetDefault ("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue ("2200"));
+  Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("2200"));
+  Config::SetDefault ("ns3::ConstantRateWifiManager::DataMode", StringValue ("wifia-6mbs"));
+  Config::SetDefault ("ns3::YansWifiPhy::TxGain", StringValue ("1.0"));
+  Config::SetDefault ("ns3::YansWifiPhy::RxGain", StringValue ("1.0"));
+  Config::SetDefault ("ns3::WifiRemoteStationManager::MaxSsrc", StringValue ("7"));
+  Config::SetDefault ("ns3::YansWifiPhy::EnergyDetectionThreshold", StringValue ("-96.0"));
+  Config::SetDefault ("ns3::YansWifiPhy::CcaMode1Threshold", StringValue ("-99.0"));
+
+  runBench (n, "defaults");
+  runTracing (n);
+
+  return 0;
+}
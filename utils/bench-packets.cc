@@ -241,6 +241,63 @@ benchC (uint32_t n)
   }
 }
 
+// add, peek and remove TAGS packet tags on each packet, the way a tag
+// like QosTag or SocketAddressTag is used at each hop: up to four tags
+// are stored within the packet, the others spill over to the heap.
+template <int TAGS>
+static void
+benchTags (uint32_t n)
+{
+  BenchTag<4> tag1;
+  BenchTag<8> tag2;
+  BenchTag<12> tag3;
+  BenchTag<16> tag4;
+  BenchTag<5> tag5;
+  BenchTag<9> tag6;
+  Tag *tags[] = {&tag1, &tag2, &tag3, &tag4, &tag5, &tag6};
+  NS_ASSERT (TAGS <= sizeof (tags) / sizeof (tags[0]));
+
+  Ptr<Packet> p = Create<Packet> (2000);
+  for (uint32_t i = 0; i < n; i++) {
+    for (int j = 0; j < TAGS; j++)
+      {
+        p->AddPacketTag (*tags[j]);
+      }
+    Ptr<Packet> o = p->Copy ();
+    for (int j = 0; j < TAGS; j++)
+      {
+        o->PeekPacketTag (*tags[j]);
+      }
+    for (int j = 0; j < TAGS; j++)
+      {
+        o->RemovePacketTag (*tags[j]);
+        p->RemovePacketTag (*tags[j]);
+      }
+  }
+}
+
+// serialize a packet in a raw buffer and rebuild it, the way a
+// distributed simulation hands a packet over to another partition.
+static void
+benchSerialize (uint32_t n)
+{
+  BenchHeader<25> ipv4;
+  BenchHeader<8> udp;
+  BenchTag<16> tag1;
+  BenchTag<17> tag2;
+  uint8_t raw[512];
+
+  Ptr<Packet> p = Create<Packet> (2000);
+  p->AddHeader (udp);
+  p->AddHeader (ipv4);
+  p->AddPacketTag (tag1);
+  p->AddByteTag (tag2);
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t size = p->Serialize (raw, sizeof (raw));
+    Ptr<Packet> o = Create<Packet> (raw, size, true);
+    o->RemoveHeader (ipv4);
+  }
+}
 
 static void
 runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
@@ -270,6 +327,10 @@ int main (int argc, char *argv[])
         {
           Packet::EnablePrinting ();
         }
+      if (strncmp ("--enable-lazy-printing", argv[0], strlen ("--enable-lazy-printing")) == 0)
+        {
+          Packet::EnableLazyPrinting ();
+        }
       argc--;
       argv++;
   }
@@ -285,6 +346,10 @@ int main (int argc, char *argv[])
   runBench (&benchB, n, "b");
   runBench (&benchC, n, "c");
   runBench (&benchD, n, "d");
+  runBench (&benchTags<1>, n, "tags1");
+  runBench (&benchTags<4>, n, "tags4");
+  runBench (&benchTags<6>, n, "tags6");
+  runBench (&benchSerialize, n, "serialize");
 
   return 0;
 }
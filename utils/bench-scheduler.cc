@@ -0,0 +1,633 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+//
+// Drive every Scheduler registered in the TypeId database directly, without
+// a simulator, through a set of workloads:
+//  - hold: the classic hold model.  The queue is filled with n events, then
+//    each operation removes the next event and inserts a new one at the time
+//    of the removed event plus a random increment,
+//  - updown: the queue is repeatedly filled with n events and drained,
+//  - timers: the hold model in which, with probability --cancel, an operation
+//    removes a random pending event (a timer which is cancelled) and inserts
+//    it again instead of removing the next event.
+// The queue is initially filled with n events separated by successive
+// increments, so that it already has the shape of the distribution when the
+// measured operations start.
+// The increments are drawn from one of the distributions below, all with the
+// same mean of 1ms:
+//  - exponential,
+//  - uniform: uniform in [0,2ms],
+//  - bimodal: 0.1ms with probability 0.9 and 9.1ms with probability 0.1,
+//  - burst: zero, except for one event out of 32 which gets an exponential
+//    increment of mean 32ms, so events come in batches with the same timestamp.
+//
+// One line of comma-separated values is printed per run, after a header line.
+// The cost of one operation out of eight is measured to report the median and
+// the 99th percentile of the cost of Insert and of the removals (RemoveNext
+// or Remove), which includes the cost of reading the clock.  The memory is the
+// number of bytes allocated with operator new once the queue is filled, divided
+// by the number of events, including the events themselves.  A run which
+// exceeds --budget seconds is stopped early and flagged as such.
+//
+
+#include "ns3/simulator-module.h"
+#include "ns3/core-module.h"
+
+#include <time.h>
+#include <stdlib.h>
+#include <math.h>
+#include <new>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace ns3;
+
+// operator new and delete are replaced to account the memory used by the
+// schedulers.
+static uint64_t g_allocated = 0;
+
+union AllocationHeader
+{
+  size_t size;
+  double align;
+  void *pointer;
+  char pad[16];
+};
+
+void *
+operator new (size_t size) throw (std::bad_alloc)
+{
+  AllocationHeader *header = (AllocationHeader *)malloc (sizeof (AllocationHeader) + size);
+  if (header == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  header->size = size;
+  g_allocated += size;
+  return header + 1;
+}
+
+void
+operator delete (void *p) throw ()
+{
+  if (p == 0)
+    {
+      return;
+    }
+  AllocationHeader *header = ((AllocationHeader *)p) - 1;
+  g_allocated -= header->size;
+  free (header);
+}
+
+void *
+operator new[] (size_t size) throw (std::bad_alloc)
+{
+  return operator new (size);
+}
+
+void
+operator delete[] (void *p) throw ()
+{
+  operator delete (p);
+}
+
+static uint64_t
+GetNanoseconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// a fast generator: the generators of the RandomVariable classes would
+// dominate the cost of the cheapest schedulers.
+class Random
+{
+public:
+  Random (uint64_t seed) : m_state (seed) {}
+  uint64_t
+  Next (void)
+  {
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    return m_state * 2685821657736338717ULL;
+  }
+  // uniform in (0,1)
+  double
+  NextDouble (void)
+  {
+    return ((Next () >> 11) + 0.5) / 9007199254740992.0;
+  }
+private:
+  uint64_t m_state;
+};
+
+enum Distribution
+{
+  EXPONENTIAL,
+  UNIFORM,
+  BIMODAL,
+  BURST
+};
+
+static const char *g_distributionNames[] = {"exponential", "uniform", "bimodal", "burst"};
+
+static const double MEAN = 1000000;
+
+class Increment
+{
+public:
+  Increment (enum Distribution distribution, uint64_t seed)
+    : m_distribution (distribution),
+      m_random (seed),
+      m_n (0)
+  {}
+  uint64_t
+  Next (void)
+  {
+    switch (m_distribution)
+      {
+      case EXPONENTIAL:
+        return (uint64_t)(-MEAN * log (m_random.NextDouble ()));
+      case UNIFORM:
+        return (uint64_t)(2 * MEAN * m_random.NextDouble ());
+      case BIMODAL:
+        return m_random.NextDouble () < 0.9 ? (uint64_t)(0.1 * MEAN) : (uint64_t)(9.1 * MEAN);
+      case BURST:
+        m_n++;
+        if (m_n % 32 != 0)
+          {
+            return 0;
+          }
+        return (uint64_t)(-32 * MEAN * log (m_random.NextDouble ()));
+      }
+    return 0;
+  }
+private:
+  enum Distribution m_distribution;
+  Random m_random;
+  uint32_t m_n;
+};
+
+class BenchEvent : public EventImpl
+{
+public:
+  Scheduler::EventKey m_key;
+protected:
+  virtual void Notify (void) {}
+};
+
+enum Workload
+{
+  HOLD,
+  UPDOWN,
+  TIMERS
+};
+
+static const char *g_workloadNames[] = {"hold", "updown", "timers"};
+
+struct Config
+{
+  uint64_t ops;
+  double cancel;
+  double budget;
+};
+
+class SchedulerBench
+{
+public:
+  SchedulerBench (TypeId scheduler, enum Workload workload, enum Distribution distribution,
+                  uint32_t size, const struct Config &config);
+  void Run (void);
+  void Print (std::ostream &os) const;
+
+private:
+  BenchEvent *CreateEvent (void);
+  void Insert (BenchEvent *event, uint64_t ts, bool sample);
+  BenchEvent *RemoveNext (bool sample);
+  void Remove (BenchEvent *event, bool sample);
+  bool Fill (void);
+  bool OverBudget (void) const;
+  void RunHold (void);
+  void RunUpDown (void);
+  void RunTimers (void);
+  void Clear (void);
+
+  TypeId m_tid;
+  enum Workload m_workload;
+  enum Distribution m_distribution;
+  uint32_t m_size;
+  struct Config m_config;
+  Ptr<Scheduler> m_scheduler;
+  Increment m_increment;
+  Random m_random;
+  std::vector<BenchEvent *> m_events;
+  uint32_t m_uid;
+  uint64_t m_now;
+  uint64_t m_start;
+  uint64_t m_done;
+  uint64_t m_elapsed;
+  uint64_t m_bytes;
+  bool m_overBudget;
+  // LatenessStatistics provides a constant-size histogram of nanoseconds.
+  LatenessStatistics m_insertCost;
+  LatenessStatistics m_removeCost;
+};
+
+SchedulerBench::SchedulerBench (TypeId scheduler, enum Workload workload, enum Distribution distribution,
+                                uint32_t size, const struct Config &config)
+  : m_tid (scheduler),
+    m_workload (workload),
+    m_distribution (distribution),
+    m_size (size),
+    m_config (config),
+    m_increment (distribution, 0x9e3779b97f4a7c15ULL),
+    m_random (0x2545f4914f6cdd1dULL),
+    m_uid (0),
+    m_now (0),
+    m_start (0),
+    m_done (0),
+    m_elapsed (0),
+    m_bytes (0),
+    m_overBudget (false)
+{}
+
+BenchEvent *
+SchedulerBench::CreateEvent (void)
+{
+  BenchEvent *event = new BenchEvent ();
+  m_events.push_back (event);
+  return event;
+}
+
+void
+SchedulerBench::Insert (BenchEvent *event, uint64_t ts, bool sample)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_uid = m_uid++;
+  ev.key.m_context = 0;
+  event->m_key = ev.key;
+  if (sample)
+    {
+      uint64_t start = GetNanoseconds ();
+      m_scheduler->Insert (ev);
+      m_insertCost.Record (GetNanoseconds () - start);
+    }
+  else
+    {
+      m_scheduler->Insert (ev);
+    }
+}
+
+BenchEvent *
+SchedulerBench::RemoveNext (bool sample)
+{
+  Scheduler::Event ev;
+  if (sample)
+    {
+      uint64_t start = GetNanoseconds ();
+      ev = m_scheduler->RemoveNext ();
+      m_removeCost.Record (GetNanoseconds () - start);
+    }
+  else
+    {
+      ev = m_scheduler->RemoveNext ();
+    }
+  m_now = ev.key.m_ts;
+  return static_cast<BenchEvent *> (ev.impl);
+}
+
+void
+SchedulerBench::Remove (BenchEvent *event, bool sample)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key = event->m_key;
+  if (sample)
+    {
+      uint64_t start = GetNanoseconds ();
+      m_scheduler->Remove (ev);
+      m_removeCost.Record (GetNanoseconds () - start);
+    }
+  else
+    {
+      m_scheduler->Remove (ev);
+    }
+}
+
+bool
+SchedulerBench::OverBudget (void) const
+{
+  return (GetNanoseconds () - m_start) / 1e9 > m_config.budget;
+}
+
+bool
+SchedulerBench::Fill (void)
+{
+  // the time base advances with each event: with the burst distribution,
+  // the events come in batches at distinct timestamps rather than all at
+  // the current time.
+  uint64_t ts = m_now;
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      ts += m_increment.Next ();
+      Insert (CreateEvent (), ts, false);
+      if ((i & 1023) == 1023 && OverBudget ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+SchedulerBench::RunHold (void)
+{
+  for (m_done = 0; m_done < m_config.ops; m_done++)
+    {
+      bool sample = (m_done & 7) == 0;
+      BenchEvent *event = RemoveNext (sample);
+      Insert (event, m_now + m_increment.Next (), sample);
+      if ((m_done & 1023) == 1023 && OverBudget ())
+        {
+          m_overBudget = true;
+          m_done++;
+          break;
+        }
+    }
+}
+
+void
+SchedulerBench::RunUpDown (void)
+{
+  m_done = 0;
+  while (m_done < m_config.ops && !m_overBudget)
+    {
+      // the queue is full when we start.
+      for (uint32_t i = 0; i < m_size; i++)
+        {
+          bool sample = (m_done & 7) == 0;
+          m_events[i] = RemoveNext (sample);
+          m_done++;
+        }
+      for (uint32_t i = 0; i < m_size; i++)
+        {
+          bool sample = (m_done & 7) == 0;
+          Insert (m_events[i], m_now + m_increment.Next (), sample);
+          m_done++;
+        }
+      m_overBudget = OverBudget ();
+    }
+}
+
+void
+SchedulerBench::RunTimers (void)
+{
+  for (m_done = 0; m_done < m_config.ops; m_done++)
+    {
+      bool sample = (m_done & 7) == 0;
+      BenchEvent *event;
+      if (m_random.NextDouble () < m_config.cancel)
+        {
+          event = m_events[m_random.Next () % m_size];
+          Remove (event, sample);
+        }
+      else
+        {
+          event = RemoveNext (sample);
+        }
+      Insert (event, m_now + m_increment.Next (), sample);
+      if ((m_done & 1023) == 1023 && OverBudget ())
+        {
+          m_overBudget = true;
+          m_done++;
+          break;
+        }
+    }
+}
+
+void
+SchedulerBench::Clear (void)
+{
+  while (!m_scheduler->IsEmpty ())
+    {
+      m_scheduler->RemoveNext ();
+    }
+  for (std::vector<BenchEvent *>::iterator i = m_events.begin (); i != m_events.end (); i++)
+    {
+      (*i)->Unref ();
+    }
+  m_events.clear ();
+  m_scheduler = 0;
+  EventImpl::TrimPool ();
+}
+
+void
+SchedulerBench::Run (void)
+{
+  EventImpl::TrimPool ();
+  m_events.reserve (m_size);
+  uint64_t before = g_allocated;
+  ObjectFactory factory;
+  factory.SetTypeId (m_tid);
+  m_scheduler = factory.Create<Scheduler> ();
+
+  m_start = GetNanoseconds ();
+  if (!Fill ())
+    {
+      m_overBudget = true;
+      Clear ();
+      return;
+    }
+  // the vector of events is not part of the scheduler.
+  m_bytes = g_allocated - before - m_events.capacity () * sizeof (BenchEvent *);
+
+  m_start = GetNanoseconds ();
+  switch (m_workload)
+    {
+    case HOLD:
+      RunHold ();
+      break;
+    case UPDOWN:
+      RunUpDown ();
+      break;
+    case TIMERS:
+      RunTimers ();
+      break;
+    }
+  m_elapsed = GetNanoseconds () - m_start;
+  Clear ();
+}
+
+void
+SchedulerBench::Print (std::ostream &os) const
+{
+  double seconds = m_elapsed / 1e9;
+  os << m_tid.GetName () << ","
+     << g_workloadNames[m_workload] << ","
+     << g_distributionNames[m_distribution] << ","
+     << m_size << ","
+     << m_done << ","
+     << seconds << ","
+     << (seconds == 0 ? 0 : m_done / seconds) << ","
+     << (double)m_bytes / m_size << ","
+     << m_insertCost.GetPercentile (50) << ","
+     << m_insertCost.GetPercentile (99) << ","
+     << m_removeCost.GetPercentile (50) << ","
+     << m_removeCost.GetPercentile (99) << ","
+     << (m_overBudget ? (m_done == 0 ? "fill-budget" : "budget") : "ok")
+     << std::endl;
+}
+
+static std::vector<std::string>
+Split (std::string list)
+{
+  std::vector<std::string> items;
+  std::istringstream iss (list);
+  std::string item;
+  while (std::getline (iss, item, ','))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+template <typename T>
+static std::vector<T>
+ParseNames (std::string list, const char *names[], uint32_t n)
+{
+  std::vector<T> values;
+  std::vector<std::string> items = Split (list);
+  for (std::vector<std::string>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      uint32_t j;
+      for (j = 0; j < n; j++)
+        {
+          if (*i == names[j])
+            {
+              values.push_back ((T)j);
+              break;
+            }
+        }
+      if (j == n)
+        {
+          NS_FATAL_ERROR ("Unknown value \"" << *i << "\"");
+        }
+    }
+  return values;
+}
+
+static std::vector<TypeId>
+GetSchedulers (std::string list)
+{
+  std::vector<TypeId> schedulers;
+  if (list == "all")
+    {
+      std::vector<std::string> names;
+      for (uint32_t i = 0; i < TypeId::GetRegisteredN (); i++)
+        {
+          TypeId tid = TypeId::GetRegistered (i);
+          if (tid != Scheduler::GetTypeId () && tid.IsChildOf (Scheduler::GetTypeId ())
+              && tid.HasConstructor ())
+            {
+              names.push_back (tid.GetName ());
+            }
+        }
+      std::sort (names.begin (), names.end ());
+      for (std::vector<std::string>::const_iterator i = names.begin (); i != names.end (); i++)
+        {
+          schedulers.push_back (TypeId::LookupByName (*i));
+        }
+      return schedulers;
+    }
+  std::vector<std::string> items = Split (list);
+  for (std::vector<std::string>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      std::string name = *i;
+      if (name.find ("::") == std::string::npos)
+        {
+          name = "ns3::" + name;
+        }
+      schedulers.push_back (TypeId::LookupByName (name));
+    }
+  return schedulers;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string schedulerList = "all";
+  std::string workloadList = "hold,updown,timers";
+  std::string distributionList = "exponential,uniform,bimodal,burst";
+  std::string sizeList = "100,1000,10000,100000,1000000";
+  struct Config config;
+  config.ops = 1000000;
+  config.cancel = 0.5;
+  config.budget = 10;
+
+  CommandLine cmd;
+  cmd.AddValue ("schedulers", "Comma-separated scheduler TypeIds, \"ns3::\" may be omitted (defaults to all)",
+                schedulerList);
+  cmd.AddValue ("workloads", "Comma-separated among hold, updown and timers (defaults to all)", workloadList);
+  cmd.AddValue ("distributions", "Comma-separated among exponential, uniform, bimodal and burst (defaults to all)",
+                distributionList);
+  cmd.AddValue ("sizes", "Comma-separated queue sizes, up to 10000000 (defaults to 100,1000,10000,100000,1000000)", sizeList);
+  cmd.AddValue ("ops", "How many operations to perform per run (defaults to 1000000)", config.ops);
+  cmd.AddValue ("cancel", "Probability that a timers operation cancels a timer (defaults to 0.5)", config.cancel);
+  cmd.AddValue ("budget", "Maximum duration of a run in seconds (defaults to 10)", config.budget);
+  cmd.Parse (argc, argv);
+
+  std::vector<TypeId> schedulers = GetSchedulers (schedulerList);
+  std::vector<enum Workload> workloads = ParseNames<enum Workload> (workloadList, g_workloadNames, 3);
+  std::vector<enum Distribution> distributions =
+    ParseNames<enum Distribution> (distributionList, g_distributionNames, 4);
+  std::vector<uint32_t> sizes;
+  std::vector<std::string> items = Split (sizeList);
+  for (std::vector<std::string>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      sizes.push_back ((uint32_t)atof (i->c_str ()));
+    }
+
+  std::cout << "scheduler,workload,distribution,size,ops,seconds,ops_per_s,bytes_per_event,"
+            << "insert_p50_ns,insert_p99_ns,remove_p50_ns,remove_p99_ns,status" << std::endl;
+  for (std::vector<TypeId>::const_iterator s = schedulers.begin (); s != schedulers.end (); s++)
+    {
+      for (std::vector<enum Workload>::const_iterator w = workloads.begin (); w != workloads.end (); w++)
+        {
+          for (std::vector<enum Distribution>::const_iterator d = distributions.begin ();
+               d != distributions.end (); d++)
+            {
+              for (std::vector<uint32_t>::const_iterator n = sizes.begin (); n != sizes.end (); n++)
+                {
+                  SchedulerBench bench (*s, *w, *d, *n, config);
+                  bench.Run ();
+                  bench.Print (std::cout);
+                }
+            }
+        }
+    }
+  return 0;
+}
@@ -136,6 +136,11 @@ PrintHelp (void)
   std::cout << "      --list: use std::list scheduler"<<std::endl;
   std::cout << "      --map: use std::map cheduler"<<std::endl;
   std::cout << "      --heap: use Binary Heap scheduler"<<std::endl;
+  std::cout << "      --calendar: use Calendar Queue scheduler"<<std::endl;
+  std::cout << "      --ns2calendar: use ns-2 Calendar Queue scheduler"<<std::endl;
+  std::cout << "      --ladder: use Ladder Queue scheduler"<<std::endl;
+  std::cout << "      --four-ary-heap: use 4-ary Heap scheduler"<<std::endl;
+  std::cout << "      (see bench-scheduler for a comparison of all the schedulers)"<<std::endl;
   std::cout << "      --debug: enable some debugging"<<std::endl;
 }
 
@@ -175,7 +180,7 @@ int main (int argc, char *argv[])
         } 
       else if (strcmp ("--map", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::HeapScheduler");
+          factory.SetTypeId ("ns3::MapScheduler");
           Simulator::SetScheduler (factory);
         } 
       else if (strcmp ("--calendar", argv[0]) == 0)
@@ -183,6 +188,21 @@ int main (int argc, char *argv[])
           factory.SetTypeId ("ns3::CalendarScheduler");
           Simulator::SetScheduler (factory);
         }
+      else if (strcmp ("--ns2calendar", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::Ns2CalendarScheduler");
+          Simulator::SetScheduler (factory);
+        }
+      else if (strcmp ("--ladder", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::LadderScheduler");
+          Simulator::SetScheduler (factory);
+        }
+      else if (strcmp ("--four-ary-heap", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::FourAryHeapScheduler");
+          Simulator::SetScheduler (factory);
+        }
       else if (strcmp ("--debug", argv[0]) == 0) 
         {
           g_debug = true;